@@ -16,6 +16,9 @@
 
 #include "APError.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+
 APError::APError(const char *in_fmt, ...) throw()
 {
 	va_list v1;
@@ -0,0 +1,339 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "AsyncSphere2DWorld.h"
+#include "Timer.h"
+
+#include <sched.h>
+#include <unistd.h>
+
+enum
+{
+	STATE_SLOT		= 3,		//Mask of the slot in m_middle
+	STATE_FRESH		= 4,		//Set in m_middle when it holds an unread state
+
+	MAX_INLINE_STEPS	= 4		//Steps per update() before dropping time
+};
+
+
+//Swap a value in, with a full barrier
+static int exchange(volatile int *io_value, int in_new)
+{
+	int old;
+	do
+	{
+		old = *io_value;
+	} while (!__sync_bool_compare_and_swap(io_value, old, in_new));
+
+	return old;
+}
+
+
+//Rolling average
+static inline float smooth(float in_average, float in_sample)
+{
+	return in_average + (in_sample - in_average) * 0.1f;
+}
+
+
+AsyncSphere2DWorld::AsyncSphere2DWorld(Sphere2DWorld *io_world, float in_timestep,
+									   bool in_threaded, int in_queueSize)
+: m_world(io_world)
+, m_timestep(in_timestep)
+, m_threaded(in_threaded)
+, m_quit(0)
+, m_head(0)
+, m_tail(0)
+, m_back(0)
+, m_middle(1)
+, m_front(2)
+, m_accumulator(0)
+, m_stepCount(0)
+, m_stepMs(0)
+, m_callerMs(0)
+{
+	if (in_timestep <= 0)
+		throw "AsyncSphere2DWorld::AsyncSphere2DWorld::Timestep must be positive";
+
+	//Power of two so that the indices may simply wrap
+	int size = 16;
+	while (size < in_queueSize)
+		size *= 2;
+	m_commands.resize(size);
+
+	m_nextHandle = m_world->count();
+	m_constantForces.resize(m_nextHandle);
+
+	//Something to draw before the first step
+	publish(0);
+
+	if (m_threaded && pthread_create(&m_thread, NULL, threadMain, this) != 0)
+		throw "AsyncSphere2DWorld::AsyncSphere2DWorld::Failed to create thread";
+}
+
+
+AsyncSphere2DWorld::~AsyncSphere2DWorld()
+{
+	if (m_threaded)
+	{
+		m_quit = 1;
+		pthread_join(m_thread, NULL);
+	}
+}
+
+
+void *AsyncSphere2DWorld::threadMain(void *in_self)
+{
+	AsyncSphere2DWorld *self = (AsyncSphere2DWorld*)in_self;
+	double next = x_time();
+
+	while (!self->m_quit)
+	{
+		double now = x_time();
+		if (now < next)
+		{
+			usleep((useconds_t)((next - now) * 1000000.0));
+			continue;
+		}
+
+		self->publish(self->simulate());
+		next += self->m_timestep;
+
+		//Too far behind to catch up; drop the time rather than spiral
+		now = x_time();
+		if (now - next > MAX_INLINE_STEPS * self->m_timestep)
+			next = now;
+	}
+
+	return NULL;
+}
+
+
+void AsyncSphere2DWorld::submit(Sphere2DCommand &io_command)
+{
+	io_command.submitTime = x_time();
+
+	unsigned int tail = m_tail;
+	while (tail - m_head == m_commands.size())
+	{
+		//Inline, the consumer is this thread
+		if (m_threaded)
+			sched_yield();
+		else
+			drainCommands();
+	}
+
+	m_commands[tail & (m_commands.size() - 1)] = io_command;
+
+	//The command must be complete before it is seen
+	__sync_synchronize();
+	m_tail = tail + 1;
+}
+
+
+double AsyncSphere2DWorld::drainCommands()
+{
+	double oldest = 0;
+	unsigned int head = m_head;
+	unsigned int tail = m_tail;
+
+	//Commands up to tail are complete
+	__sync_synchronize();
+
+	for (; head != tail; head++)
+	{
+		const Sphere2DCommand &c = m_commands[head & (m_commands.size() - 1)];
+
+		switch (c.type)
+		{
+		case Sphere2DCommand::Add:
+			m_world->add(c.body);
+			m_constantForces.resize(m_world->count());
+			break;
+
+		case Sphere2DCommand::AddForce:
+			m_world->body(c.handle).addForce(c.value);
+			break;
+
+		case Sphere2DCommand::SetConstantForce:
+			if (c.handle >= (int)m_constantForces.size())
+				m_constantForces.resize(c.handle + 1);
+			m_constantForces[c.handle] = c.value;
+			break;
+
+		case Sphere2DCommand::SetPosition:
+			m_world->body(c.handle).setPosition(c.value);
+			break;
+		}
+
+		if (oldest == 0)
+			oldest = c.submitTime;
+	}
+
+	//Done reading the slots before handing them back
+	__sync_synchronize();
+	m_head = head;
+
+	return oldest;
+}
+
+
+double AsyncSphere2DWorld::simulate()
+{
+	double start = x_time();
+	double commandTime = drainCommands();
+
+	for (int i=0; i<(int)m_constantForces.size(); i++)
+	{
+		if (m_constantForces[i].x != 0 || m_constantForces[i].y != 0)
+			m_world->body(i).addForce(m_constantForces[i]);
+	}
+
+	m_world->step(m_timestep);
+	m_stepCount++;
+
+	m_stepMs = smooth(m_stepMs, (float)((x_time() - start) * 1000.0));
+
+	return commandTime;
+}
+
+
+void AsyncSphere2DWorld::publish(double in_commandTime)
+{
+	Sphere2DWorldState &s = m_states[m_back];
+	int n = m_world->count();
+
+	s.positions.resize(n);
+	s.velocities.resize(n);
+	s.radii.resize(n);
+
+	for (int i=0; i<n; i++)
+	{
+		const Sphere2D &b = m_world->body(i);
+		s.positions[i] = b.position();
+		s.velocities[i] = b.velocity();
+		s.radii[i] = b.radius;
+	}
+
+	s.step = m_stepCount;
+	s.commandTime = in_commandTime;
+	s.publishTime = x_time();
+
+	//The previous middle was either read or is now stale; reuse it
+	m_back = exchange(&m_middle, m_back | STATE_FRESH) & STATE_SLOT;
+}
+
+
+int AsyncSphere2DWorld::add(const Sphere2D &in_body)
+{
+	Sphere2DCommand c;
+	c.type = Sphere2DCommand::Add;
+	c.handle = m_nextHandle;
+	c.body = in_body;
+	submit(c);
+
+	return m_nextHandle++;
+}
+
+
+void AsyncSphere2DWorld::addForce(int in_handle, const Coord2D in_force)
+{
+	Sphere2DCommand c;
+	c.type = Sphere2DCommand::AddForce;
+	c.handle = in_handle;
+	c.value = in_force;
+	submit(c);
+}
+
+
+void AsyncSphere2DWorld::setConstantForce(int in_handle, const Coord2D in_force)
+{
+	Sphere2DCommand c;
+	c.type = Sphere2DCommand::SetConstantForce;
+	c.handle = in_handle;
+	c.value = in_force;
+	submit(c);
+}
+
+
+void AsyncSphere2DWorld::setPosition(int in_handle, const Coord2D in_position)
+{
+	Sphere2DCommand c;
+	c.type = Sphere2DCommand::SetPosition;
+	c.handle = in_handle;
+	c.value = in_position;
+	submit(c);
+}
+
+
+void AsyncSphere2DWorld::update(float in_dt)
+{
+	double start = x_time();
+
+	//Close the previous frame's measurement
+	m_timings.callerMs = smooth(m_timings.callerMs, m_callerMs);
+	if (m_callerMs > m_timings.maxCallerMs)
+		m_timings.maxCallerMs = m_callerMs;
+	m_callerMs = 0;
+
+	if (!m_threaded)
+	{
+		double commandTime = 0;
+		int steps = 0;
+
+		m_accumulator += in_dt;
+		while (m_accumulator >= m_timestep && steps < MAX_INLINE_STEPS)
+		{
+			double t = simulate();
+			if (commandTime == 0)
+				commandTime = t;
+
+			m_accumulator -= m_timestep;
+			steps++;
+		}
+
+		if (steps == MAX_INLINE_STEPS)
+			m_accumulator = 0;
+
+		if (steps)
+			publish(commandTime);
+	}
+
+	m_timings.stepMs = m_stepMs;
+	m_callerMs += (float)((x_time() - start) * 1000.0);
+}
+
+
+const Sphere2DWorldState *AsyncSphere2DWorld::state()
+{
+	double start = x_time();
+
+	if (m_middle & STATE_FRESH)
+	{
+		m_front = exchange(&m_middle, m_front) & STATE_SLOT;
+
+		const Sphere2DWorldState &s = m_states[m_front];
+		if (s.commandTime != 0)
+			m_timings.inputLatencyMs = smooth(m_timings.inputLatencyMs,
+											  (float)((start - s.commandTime) * 1000.0));
+	}
+
+	m_timings.stateAgeMs = smooth(m_timings.stateAgeMs,
+								  (float)((start - m_states[m_front].publishTime) * 1000.0));
+
+	m_callerMs += (float)((x_time() - start) * 1000.0);
+	return &m_states[m_front];
+}
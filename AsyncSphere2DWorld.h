@@ -0,0 +1,264 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef ASYNCSPHERE2DWORLD_H
+#define ASYNCSPHERE2DWORLD_H
+
+#include <pthread.h>
+#include <vector>
+#include "Sphere2DWorld.h"
+
+/*!	\file	AsyncSphere2DWorld.h
+	\brief	Run a Sphere2DWorld on its own thread, or inline, behind one API.
+
+	A heavy physics step on the render thread delays the frame it happens
+	in.  Here the world steps at a fixed rate on a thread of its own.  Each
+	completed step is published into a triple buffer: the render thread
+	picks up the newest complete state without ever waiting, and the physics
+	thread never waits on the render thread either.
+
+	The game talks to the world through commands (add a body, push it, move
+	it) which are queued and applied before the next step.  The same object
+	can run inline (stepping inside update()) so that both modes can be
+	measured against each other; see timings().
+
+	\code
+AsyncSphere2DWorld physics(&world, 1.0f/120.0f, true);
+
+//Game thread, each frame
+physics.addForce(player, input);
+physics.update(dt);
+
+const Sphere2DWorldState *s = physics.state();
+for (int i=0; i<s->count(); i++)
+	drawBall(s->positions[i], s->radii[i]);
+	\endcode
+
+	Once constructed, the world must only be touched through this object.
+*/
+
+
+//! Copy of the bodies' state published after a step
+class Sphere2DWorldState
+{
+public:
+	//! Position of each body (indexed by handle)
+	std::vector<Coord2D>	positions;
+
+	//! Velocity of each body
+	std::vector<Coord2D>	velocities;
+
+	//! Radius of each body
+	std::vector<float>		radii;
+
+	//! Number of steps simulated when this was published
+	int						step;
+
+	//! x_time() when this was published
+	double					publishTime;
+
+	//! x_time() when the oldest command applied in this step was submitted
+	/*!	0 when no command was applied */
+	double					commandTime;
+
+	Sphere2DWorldState()
+	: step(0)
+	, publishTime(0)
+	, commandTime(0)
+	{}
+
+	//! Number of bodies
+	int count() const		{	return (int)positions.size();		}
+};
+
+
+//! Something for the simulation to do before its next step
+class Sphere2DCommand
+{
+public:
+	enum Type
+	{
+		Add,				//!< Add body
+		AddForce,			//!< Force for the next step only
+		SetConstantForce,	//!< Force for every step until changed
+		SetPosition			//!< Sphere2D::setPosition
+	};
+
+	Type		type;
+	int			handle;
+	Coord2D		value;
+	Sphere2D	body;
+	double		submitTime;
+};
+
+
+//! Rolling timings (milliseconds), averaged over the last updates
+class Sphere2DWorldTimings
+{
+public:
+	//! Time spent in one simulation step
+	float	stepMs;
+
+	//! Time the caller spent inside update() and state()
+	float	callerMs;
+
+	//! Time from submitting a command to seeing its effect in state()
+	float	inputLatencyMs;
+
+	//! Age of the state returned by state() when it was picked up
+	float	stateAgeMs;
+
+	//! Worst callerMs since reset
+	float	maxCallerMs;
+
+	Sphere2DWorldTimings()
+	: stepMs(0)
+	, callerMs(0)
+	, inputLatencyMs(0)
+	, stateAgeMs(0)
+	, maxCallerMs(0)
+	{}
+};
+
+
+//! Steps a Sphere2DWorld on a thread of its own (or inline)
+class AsyncSphere2DWorld
+{
+private:
+	//! The simulation (not owned)
+	Sphere2DWorld				*m_world;
+
+	//! Fixed step
+	float						m_timestep;
+
+	//! Running on a separate thread?
+	bool						m_threaded;
+
+	//! The physics thread (when threaded)
+	pthread_t					m_thread;
+
+	//! Tells the physics thread to exit
+	volatile int				m_quit;
+
+	//! Command ring (single producer: the caller, single consumer: physics)
+	std::vector<Sphere2DCommand>	m_commands;
+
+	//! Next command to consume
+	volatile unsigned int		m_head;
+
+	//! Next free command slot
+	volatile unsigned int		m_tail;
+
+	//! Handle the next added body will get
+	int							m_nextHandle;
+
+	//! Forces applied to every step (indexed by handle)
+	std::vector<Coord2D>		m_constantForces;
+
+	//! The triple buffer
+	Sphere2DWorldState			m_states[3];
+
+	//! Slot the physics side writes to
+	int							m_back;
+
+	//! Slot waiting to be picked up (| STATE_FRESH when newer than m_front)
+	volatile int				m_middle;
+
+	//! Slot the caller reads from
+	int							m_front;
+
+	//! Time not yet simulated (inline)
+	float						m_accumulator;
+
+	//! Steps simulated
+	int							m_stepCount;
+
+	//! Timing accumulators
+	Sphere2DWorldTimings		m_timings;
+
+	//! Step time as measured on the physics thread
+	volatile float				m_stepMs;
+
+	//! Time spent by the caller since the last update()
+	float						m_callerMs;
+
+	//! Thread entry point
+	static void *threadMain(void *in_self);
+
+	//! Queue a command
+	void submit(Sphere2DCommand &io_command);
+
+	//! Apply the queued commands
+	/*!	\return	Submission time of the oldest command applied (0 for none) */
+	double drainCommands();
+
+	//! Apply the commands and constant forces, and step once
+	/*!	\return	As drainCommands()	*/
+	double simulate();
+
+	//! Copy the world into the back slot and swap it into the middle
+	void publish(double in_commandTime);
+
+	//! Prevent copies
+	AsyncSphere2DWorld(const AsyncSphere2DWorld &)	{}
+
+public:
+	//! Take over a world
+	/*!	\param io_world		The world to simulate
+		\param in_timestep	Length of a step (seconds)
+		\param in_threaded	Run on a separate thread?
+		\param in_queueSize	Commands that may be waiting at once	*/
+	AsyncSphere2DWorld(Sphere2DWorld *io_world, float in_timestep,
+					   bool in_threaded, int in_queueSize = 4096);
+
+	//! Stops the physics thread
+	~AsyncSphere2DWorld();
+
+	//! Running on a separate thread?
+	bool isThreaded() const				{	return m_threaded;		}
+
+	//! Add a body
+	/*!	\return	The handle it will have once the command is applied	*/
+	int add(const Sphere2D &in_body);
+
+	//! Force applied to the next step only
+	void addForce(int in_handle, const Coord2D in_force);
+
+	//! Force applied to every step until changed (eg. held input)
+	void setConstantForce(int in_handle, const Coord2D in_force);
+
+	//! Move a body (and stop it, as Sphere2D::setPosition does)
+	void setPosition(int in_handle, const Coord2D in_position);
+
+	//! Call once per frame
+	/*!	Inline, this simulates as many steps as fit in the elapsed time.
+		Threaded, the physics thread keeps its own pace and this does nothing
+		but measure.
+		\param in_dt	Time since the last frame (seconds)	*/
+	void update(float in_dt);
+
+	//! Newest complete state; never waits on the simulation
+	/*!	The pointer remains valid until the next call to state().	*/
+	const Sphere2DWorldState *state();
+
+	//! Rolling timings
+	Sphere2DWorldTimings timings() const	{	return m_timings;		}
+
+	//! Reset the maxima of the timings
+	void resetTimings()						{	m_timings.maxCallerMs = 0;	}
+};
+
+#endif
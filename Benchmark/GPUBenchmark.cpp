@@ -0,0 +1,788 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*!	\file	GPUBenchmark.cpp
+	\brief	Drives gli through a GPU::RecordingBackend, reporting JSON.
+
+	Built with GPU_HEADLESS: no GL, no GPU and no Apple framework is
+	needed.  Each scene draws the same frame a number of times through gli,
+	and the calls that reach the backend are counted.  Scenes:
+		- batched		Textured quads, batched and streamed
+		- immediate		The same quads, one draw call each
+		- text			Lines of drawText32Batched
+		- text_per_glyph	The same lines with drawText32, one draw call per glyph
+		- clipped		A scrolling list inside a gliClip
+
+	Every scene knows how many draw calls a frame takes; the benchmark fails
+	(exit status 1) when the backend counts another number, or when any call
+	fails the backend's checks.  What is reported per frame: draw calls,
+	bytes handed to the GL, calls logged, and the CPU time gli took.
+
+	Rotated sprites are then drawn three ways, each on a backend of its own
+	(Support::Instancing() is read once per backend):
+		- gli			Four coloured, textured vertices each, batched
+		- instanced		A GPU::SpriteBatch, with instancing
+		- fallback		A GPU::SpriteBatch, each record written 4 times
+	and reported in bytes handed to the GL per sprite, and CPU time.
+
+	Last, a Tilemap tile and a blit of the same rectangle are drawn, and
+	the benchmark fails unless their corners reach the GL at the same
+	place.  So does a rectangle drawn at a position scale of 4, unless its
+	corners reach the GL 4 times further, with the modelview scaled back
+	around its draw (and clamped where that is beyond a GLshort's range).
+	And translucent drawables at the same depth must leave a RenderQueue
+	in the order they were added, and a shape clipped with the scissor must
+	put back the scissor box it found.
+
+	\code
+make gpu_bench
+./gpu_bench --quads 1000 --sprites 1000 --out gpu.json
+	\endcode
+*/
+
+#include "../Immediate.h"
+#include "../Blit.h"
+#include "../GPUBuffer.h"
+#include "../GPUState.h"
+#include "../GPURecordingBackend.h"
+#include "../GPUSprites.h"
+#include "../GPUStats.h"
+#include "../RenderQueue.h"
+#include "../Tilemap.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+using GPU::RecordingBackend;
+
+
+//! Monotonic time in seconds
+static double now()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec / 1000000000.0;
+}
+
+
+//! Command line
+struct Options
+{
+	int				quads;			//!< Quads of the batched and immediate scenes
+	int				sprites;		//!< Rotated sprites drawn each way
+	int				frames;			//!< Frames drawn per scene
+	const char		*out;
+
+	Options() : quads(1000), sprites(1000), frames(200), out(NULL)	{}
+};
+
+
+//! What a scene measured, per frame
+struct Result
+{
+	const char		*scene;
+	int				expected;		//!< Draw calls the scene should take
+	int				draws;
+	double			bytes;
+	int				calls;
+	double			ms;
+	int				errors;
+	const char		*lastError;
+};
+
+
+//! Draws one frame of a scene
+typedef void (*Scene)(const Options &in_opt);
+
+
+static void batched(const Options &in_opt)
+{
+	gliEnableTexture t;
+	gliEnableTexCoordArray tc;
+
+	for (int i=0; i<in_opt.quads; i++)
+		blitS((i % 16) * 16, 0, 16, 16, (i % 30) * 16, (i / 30) * 16, 16, 16);
+}
+
+
+//! A line of 21 glyphs (digits and punctuation are not in the font)
+static const char *const g_textLine = "The quick brown fox, 123 times";
+
+
+static void text(const Options &)
+{
+	gliEnableTexture t;
+	gliEnableTexCoordArray tc;
+
+	for (int i=0; i<20; i++)
+		drawText32Batched(0, 0, 0, i * 16, 8, 16, g_textLine);
+}
+
+
+static void textPerGlyph(const Options &)
+{
+	GPU::State::clientState(GL_TEXTURE_COORD_ARRAY, true);
+
+	for (int i=0; i<20; i++)
+		drawText32(0, 0, 0, i * 32, 16, 32, g_textLine);
+
+	GPU::State::clientState(GL_TEXTURE_COORD_ARRAY, false);
+}
+
+
+static void clipped(const Options &)
+{
+	//Clipping needs gli to do the transforms
+	gl.setCPUTransforms(true);
+
+	{
+		gliEnableTexture t;
+		gliEnableTexCoordArray tc;
+		gliClip clip(Rect2D(0, 40, 320, 400));
+
+		//500 rows, scrolled half way: about 20 of them show
+		gliTransform scroll;
+		scroll.translate(Coord2D(0, -5000 + 3));
+		for (int i=0; i<500; i++)
+			blitS(0, 0, 64, 20, 0, i * 20.0f, 320, 20);
+	}
+
+	gl.setCPUTransforms(false);
+}
+
+
+//! What drawing the sprites one way measured, per frame
+struct SpriteResult
+{
+	const char		*path;
+	int				draws;
+	double			bytesPerSprite;
+	double			ms;
+	int				errors;
+	const char		*lastError;
+};
+
+
+//! Where sprite i goes, and how it is turned
+static inline Coord2D spritePosition(int in_i)	{	return Coord2D((in_i % 30) * 10 + 8, (in_i / 30) * 10 + 8);	}
+static inline float spriteAngle(int in_i)		{	return in_i * 0.1f;		}
+
+
+//! A frame of rotated sprites, worked out on the CPU and batched by gli
+static void gliSprites(const Options &in_opt)
+{
+	gliEnableTexture t;
+	gliEnableTexCoordArray tc;
+	gliEnableColorArray c;
+
+	static const float cx[4] = {-8, 8, -8, 8}, cy[4] = {-8, -8, 8, 8};
+
+	for (int i=0; i<in_opt.sprites; i++)
+	{
+		const Coord2D p = spritePosition(i);
+		const float cs = cosf(spriteAngle(i)), sn = sinf(spriteAngle(i));
+
+		Draw d(GL_TRIANGLE_STRIP);
+		d.colouri(255, 255, 255, 255);
+		for (int k=0; k<4; k++)
+		{
+			d.texCoordi((k & 1) * 16, (k >> 1) * 16);
+			d.vertex(p.x + cs*cx[k] - sn*cy[k], p.y + sn*cx[k] + cs*cy[k]);
+		}
+	}
+}
+
+
+//! Draw the sprites one way, on a backend of its own
+/*!	\param in_extensions	What the backend reports (instancing, or not)
+	\param in_batch			Through a SpriteBatch, or through gli	*/
+static SpriteResult sprites(const char *in_path, const char *in_extensions,
+							bool in_batch, const Options &in_opt)
+{
+	RecordingBackend rec;
+	rec.setExtensions(in_extensions);
+	GPU::setBackend(&rec);
+
+	gli &g = gl;
+	g.setBatching(true);
+	g.setStreaming(4 * GLI_SUBMISSION_SIZE);
+	GPU::State::clientState(GL_VERTEX_ARRAY, true);
+
+	GLuint texture;
+	rec.genTextures(1, &texture);
+	GPU::State::bindTexture(0, texture);
+	rec.texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1024, 1024, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	SpriteResult r;
+	r.path = in_path;
+
+	{
+		One<GPU::SpriteBatch> batch(in_batch ? new GPU::SpriteBatch(in_opt.sprites) : NULL);
+
+		double time = 0;
+		for (int f=0; f<=in_opt.frames; f++)
+		{
+			//The first frame creates buffers, and is not counted
+			if (f == 1)
+			{
+				rec.clear();
+				g.resetStatistics();
+				GPU::Stats::reset();
+				time = 0;
+			}
+
+			const double start = now();
+
+			if (batch())
+			{
+				for (int i=0; i<in_opt.sprites; i++)
+					batch->add(spritePosition(i), Coord2D(1, 1), Angle(spriteAngle(i)),
+							   Rect2D(0, 0, 16, 16));
+				batch->draw();
+			}
+			else
+			{
+				gliSprites(in_opt);
+				g.flush();
+			}
+
+			time += now() - start;
+		}
+
+		const double bytes = batch() ? GPU::Stats::current(GPU::Stats::UploadBytes) : g.submitBytes();
+
+		r.draws = (rec.calls(RecordingBackend::DrawArrays)
+				   + rec.calls(RecordingBackend::DrawElements)
+				   + rec.calls(RecordingBackend::DrawArraysInstanced)) / in_opt.frames;
+		r.bytesPerSprite = bytes / ((double)in_opt.frames * in_opt.sprites);
+		r.ms = time * 1000 / in_opt.frames;
+	}
+
+	g.setStreaming(0);
+	GPU::releaseQuadIndices();
+	rec.deleteTextures(1, &texture);
+
+	r.errors = rec.errors();
+	r.lastError = rec.lastError();
+
+	GPU::setBackend(NULL);
+	return r;
+}
+
+
+//! Also keeps what buffers hold, and where the corners of the last quad drawn are
+class CaptureBackend : public RecordingBackend
+{
+	std::map<GLuint, std::vector<char> >	m_data;
+	GLuint		m_array, m_element;
+
+	//Vertex pointer
+	GLenum		m_type;
+	GLsizei		m_stride;
+	size_t		m_offset;
+
+	//! Position of a vertex, as the GL gets it
+	Coord2D position(int in_vertex)
+	{
+		const char *v = &m_data[m_array][0] + m_offset + in_vertex * m_stride;
+
+		if (m_type == GL_FLOAT)
+			return Coord2D(((const GLfloat*)v)[0], ((const GLfloat*)v)[1]);
+		return Coord2D(((const GLshort*)v)[0], ((const GLshort*)v)[1]);
+	}
+
+public:
+	//! Corners of the first quad of the last draw
+	std::vector<Coord2D>	corners;
+
+	CaptureBackend() : m_array(0), m_element(0), m_type(0), m_stride(0), m_offset(0)	{}
+
+	void bindBuffer(GLenum in_target, GLuint in_buffer)
+	{
+		RecordingBackend::bindBuffer(in_target, in_buffer);
+		(in_target == GL_ARRAY_BUFFER ? m_array : m_element) = in_buffer;
+	}
+
+	void bufferData(GLenum in_target, GLsizeiptr in_size, const GLvoid *in_data, GLenum in_usage)
+	{
+		RecordingBackend::bufferData(in_target, in_size, in_data, in_usage);
+
+		std::vector<char> &d = m_data[in_target == GL_ARRAY_BUFFER ? m_array : m_element];
+		d.assign(in_size, 0);
+		if (in_data)
+			memcpy(&d[0], in_data, in_size);
+	}
+
+	void bufferSubData(GLenum in_target, GLintptr in_offset, GLsizeiptr in_size, const GLvoid *in_data)
+	{
+		RecordingBackend::bufferSubData(in_target, in_offset, in_size, in_data);
+		memcpy(&m_data[in_target == GL_ARRAY_BUFFER ? m_array : m_element][in_offset], in_data, in_size);
+	}
+
+	void vertexPointer(GLint in_size, GLenum in_type, GLsizei in_stride, const GLvoid *in_pointer)
+	{
+		RecordingBackend::vertexPointer(in_size, in_type, in_stride, in_pointer);
+		m_type = in_type;
+		m_stride = in_stride;
+		m_offset = (const char*)in_pointer - (const char*)NULL;
+	}
+
+	void drawArrays(GLenum in_mode, GLint in_first, GLsizei in_count)
+	{
+		RecordingBackend::drawArrays(in_mode, in_first, in_count);
+
+		corners.clear();
+		for (int i=0; i<4 && i<in_count; i++)
+			corners.push_back(position(in_first + i));
+	}
+
+	void drawElements(GLenum in_mode, GLsizei in_count, GLenum in_type, const GLvoid *in_indices)
+	{
+		RecordingBackend::drawElements(in_mode, in_count, in_type, in_indices);
+
+		const GLushort *i = (const GLushort*)(&m_data[m_element][0]
+											   + ((const char*)in_indices - (const char*)NULL));
+
+		//Triangles of a quad: 0 1 2, 2 1 3
+		corners.clear();
+		if (in_count >= 6)
+		{
+			corners.push_back(position(i[0]));
+			corners.push_back(position(i[1]));
+			corners.push_back(position(i[2]));
+			corners.push_back(position(i[5]));
+		}
+	}
+};
+
+
+static bool byPosition(const Coord2D &in_a, const Coord2D &in_b)
+{
+	return in_a.x < in_b.x || (in_a.x == in_b.x && in_a.y < in_b.y);
+}
+
+
+//! Do a tile, and a blit of the same rectangle, reach the GL at the same place?
+static bool tileMatchesBlit()
+{
+	CaptureBackend rec;
+	GPU::setBackend(&rec);
+
+	gli &g = gl;
+	g.setBatching(true);
+	g.setStreaming(4 * GLI_SUBMISSION_SIZE);
+	GPU::State::clientState(GL_VERTEX_ARRAY, true);
+
+	GLuint texture;
+	rec.genTextures(1, &texture);
+	GPU::State::bindTexture(0, texture);
+	rec.texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1024, 1024, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	bool match;
+	{
+		//Tile (3, 2) is at (96, 64), 32 by 32
+		Tilemap map(8, 8, 1, Coord2D(32, 32), Coord2D(32, 32), 16);
+		map.set(0, 3, 2, 5);
+		map.draw(Rect2D(0, 0, 320, 480));
+		std::vector<Coord2D> tile = rec.corners;
+
+		{
+			gliEnableTexture t;
+			gliEnableTexCoordArray tc;
+			blit<32, 32>(Coord2D(5, 0), Coord2D(96, 64));
+		}
+		g.flush();
+		std::vector<Coord2D> blitted = rec.corners;
+
+		std::sort(tile.begin(), tile.end(), byPosition);
+		std::sort(blitted.begin(), blitted.end(), byPosition);
+
+		match = tile.size() == 4 && blitted.size() == 4 && rec.errors() == 0;
+		for (size_t i=0; match && i<4; i++)
+			match = tile[i].x == blitted[i].x && tile[i].y == blitted[i].y;
+		if (!match)
+			for (size_t i=0; i<tile.size() && i<blitted.size(); i++)
+				fprintf(stderr, "tile corner (%g, %g), blit corner (%g, %g)\n",
+						tile[i].x, tile[i].y, blitted[i].x, blitted[i].y);
+	}
+
+	g.setStreaming(0);
+	GPU::releaseQuadIndices();
+	rec.deleteTextures(1, &texture);
+
+	GPU::setBackend(NULL);
+	return match;
+}
+
+
+//! Are positions stored at the position scale, and is it undone around their draw?
+static bool scaleFolds()
+{
+	CaptureBackend rec;
+	GPU::setBackend(&rec);
+
+	gli &g = gl;
+	g.setBatching(true);
+	g.setStreaming(4 * GLI_SUBMISSION_SIZE);
+	GPU::State::clientState(GL_VERTEX_ARRAY, true);
+
+	std::vector<Coord2D> corners[2];
+	const float scales[2] = {1, 4};
+
+	for (int i=0; i<2; i++)
+	{
+		g.setPositionScale(scales[i]);
+		rec.clear();
+
+		fillRect(96, 64, 32, 32);
+		g.flush();
+
+		corners[i] = rec.corners;
+		std::sort(corners[i].begin(), corners[i].end(), byPosition);
+	}
+
+	//At 4, the modelview is scaled by 1/4 around the draw, and only then
+	bool match = corners[0].size() == 4 && corners[1].size() == 4 && rec.errors() == 0
+				&& rec.calls(RecordingBackend::Scalef) == 1
+				&& rec.calls(RecordingBackend::PushMatrix) == 1
+				&& rec.calls(RecordingBackend::PopMatrix) == 1;
+	for (size_t i=0; match && i<4; i++)
+		match = corners[1][i].x == corners[0][i].x * 4 && corners[1][i].y == corners[0][i].y * 4;
+	if (!match)
+		for (size_t i=0; i<corners[0].size() && i<corners[1].size(); i++)
+			fprintf(stderr, "corner (%g, %g), at a scale of 4 (%g, %g)\n",
+					corners[0][i].x, corners[0][i].y, corners[1][i].x, corners[1][i].y);
+
+	//Out of a GLshort's range at 4: clamped, not wrapped around
+	fillRect(5000, -5000, 1, 1);
+	g.flush();
+	for (size_t i=0; match && i<rec.corners.size(); i++)
+		match = rec.corners[i].x == 32767 && rec.corners[i].y == -32768;
+	if (!match)
+		fprintf(stderr, "positions out of range are not clamped\n");
+
+	g.setPositionScale(1);
+	g.setStreaming(0);
+	GPU::releaseQuadIndices();
+
+	GPU::setBackend(NULL);
+	return match;
+}
+
+
+//! Does a shape clipped with the scissor stay inside the scissor box in use, and put it back?
+static bool clipKeepsScissor()
+{
+	RecordingBackend rec;
+	GPU::setBackend(&rec);
+
+	gli &g = gl;
+	g.specifyDeviceSize(320, 480);
+	g.specifyDeviceScale(1);
+	g.setCPUTransforms(true);
+	GPU::State::clientState(GL_VERTEX_ARRAY, true);
+
+	//A damaged rectangle, as DirtyRegion sets it
+	GPU::State::enable(GL_SCISSOR_TEST, true);
+	GPU::State::scissor(10, 20, 100, 50);
+
+	{
+		//A triangle is not a quad: it is drawn with the scissor
+		gliClip clip(Rect2D(0, 0, 320, 240));
+		Draw d(GL_TRIANGLES);
+		d.vertex(0, 0);
+		d.vertex(300, 0);
+		d.vertex(0, 300);
+	}
+	g.flush();
+
+	GLint x, y;
+	GLsizei w, h;
+	bool match = GPU::State::scissorBox(&x, &y, &w, &h)
+				&& x == 10 && y == 20 && w == 100 && h == 50
+				&& GPU::State::isEnabled(GL_SCISSOR_TEST)
+				&& rec.calls(RecordingBackend::DrawArrays) == 1
+				&& rec.errors() == 0;
+
+	GPU::State::enable(GL_SCISSOR_TEST, false);
+	g.setCPUTransforms(false);
+
+	GPU::setBackend(NULL);
+	return match;
+}
+
+
+//! Logs the order drawables render in
+class Logged : public IDrawable
+{
+	std::vector<int>	&m_log;
+	int					m_id;
+
+public:
+	Logged(std::vector<int> &io_log, int in_id) : m_log(io_log), m_id(in_id)	{}
+
+	void onLogic()		{}
+	void onRender()		{	m_log.push_back(m_id);	}
+};
+
+
+//! Do translucent drawables at the same depth render in the order they were added?
+static bool queueKeepsOrder()
+{
+	RecordingBackend rec;
+	GPU::setBackend(&rec);
+
+	GLuint textures[3];
+	rec.genTextures(3, textures);
+
+	std::vector<int> log;
+	std::vector<Logged*> drawables;
+	RenderQueue queue;
+
+	//Textures alternate, and an opaque one is added last (drawn first)
+	for (int i=0; i<8; i++)
+	{
+		drawables.push_back(new Logged(log, i));
+		queue.add(drawables.back(), RenderState(textures[i % 3], 0, 0.5f)
+												.blend(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+	}
+	drawables.push_back(new Logged(log, 8));
+	queue.add(drawables.back(), RenderState(textures[1]));
+
+	queue.submit();
+	gl.flush();
+
+	bool match = log.size() == 9 && log[0] == 8 && rec.errors() == 0;
+	for (int i=0; match && i<8; i++)
+		match = log[i+1] == i;
+
+	for (size_t i=0; i<drawables.size(); i++)
+		delete drawables[i];
+	rec.deleteTextures(3, textures);
+
+	GPU::setBackend(NULL);
+	return match;
+}
+
+
+//! Draw in_frames frames of a scene, and count what reached the backend
+static Result run(RecordingBackend &io_rec, const char *in_name, Scene in_scene,
+				  bool in_batching, int in_expected, const Options &in_opt)
+{
+	gli &g = gl;
+	g.setBatching(in_batching);
+
+	//Warm up: buffers are created once
+	in_scene(in_opt);
+	g.flush();
+
+	io_rec.clear();
+	g.resetStatistics();
+
+	double time = 0;
+	for (int f=0; f<in_opt.frames; f++)
+	{
+		const double start = now();
+
+		in_scene(in_opt);
+		g.flush();
+
+		time += now() - start;
+	}
+
+	Result r;
+	r.scene = in_name;
+	r.expected = in_expected;
+	r.draws = (io_rec.calls(RecordingBackend::DrawArrays)
+			   + io_rec.calls(RecordingBackend::DrawElements)
+			   + io_rec.calls(RecordingBackend::DrawArraysInstanced)) / in_opt.frames;
+	r.bytes = g.submitBytes() / in_opt.frames;
+	r.calls = io_rec.calls() / in_opt.frames;
+	r.ms = time * 1000 / in_opt.frames;
+	r.errors = io_rec.errors();
+	r.lastError = io_rec.lastError();
+
+	return r;
+}
+
+
+static void usage()
+{
+	fprintf(stderr, "usage: gpu_bench [--quads N] [--sprites N] [--frames N] [--out FILE]\n");
+}
+
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i=1; i<argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = i+1 < argc ? argv[i+1] : NULL;
+
+		if (!v)
+		{
+			usage();
+			return 1;
+		}
+
+		i++;
+
+		if (!strcmp(a, "--quads"))			opt.quads = atoi(v);
+		else if (!strcmp(a, "--sprites"))	opt.sprites = atoi(v);
+		else if (!strcmp(a, "--frames"))	opt.frames = atoi(v);
+		else if (!strcmp(a, "--out"))		opt.out = v;
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	//A batch holds what fits the submission
+	if (opt.quads <= 0 || opt.quads * 4 > GLI_SUBMISSION_SIZE
+		|| opt.sprites <= 0 || opt.sprites * 4 > GLI_SUBMISSION_SIZE || opt.frames <= 0)
+	{
+		usage();
+		return 1;
+	}
+
+	RecordingBackend rec(320, 480);
+	GPU::setBackend(&rec);
+
+	gli &g = gl;
+	g.specifyDeviceSize(320, 480);
+	g.specifyDeviceScale(1);
+	g.setStreaming(4 * GLI_SUBMISSION_SIZE);
+	GPU::State::clientState(GL_VERTEX_ARRAY, true);
+
+	GLuint texture;
+	rec.genTextures(1, &texture);
+	GPU::State::bindTexture(0, texture);
+	rec.texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1024, 1024, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	std::vector<Result> results;
+	results.push_back(run(rec, "batched", batched, true, 1, opt));
+	results.push_back(run(rec, "immediate", batched, false, opt.quads, opt));
+	results.push_back(run(rec, "text", text, true, 1, opt));
+	results.push_back(run(rec, "text_per_glyph", textPerGlyph, false, 20 * 21, opt));
+	results.push_back(run(rec, "clipped", clipped, true, 1, opt));
+
+	//Before the backend goes
+	g.setStreaming(0);
+	GPU::releaseQuadIndices();
+	rec.deleteTextures(1, &texture);
+
+	std::vector<SpriteResult> spriteResults;
+	spriteResults.push_back(sprites("gli", "", false, opt));
+	spriteResults.push_back(sprites("instanced", "GL_EXT_instanced_arrays GL_EXT_draw_instanced", true, opt));
+	spriteResults.push_back(sprites("fallback", "", true, opt));
+
+	const bool tileMatch = tileMatchesBlit();
+	const bool scaleFold = scaleFolds();
+	const bool queueOrder = queueKeepsOrder();
+	const bool clipScissor = clipKeepsScissor();
+
+	bool failed = !tileMatch || !scaleFold || !queueOrder || !clipScissor;
+	if (!tileMatch)
+		fprintf(stderr, "a tile and a blit of the same rectangle are drawn apart\n");
+	if (!scaleFold)
+		fprintf(stderr, "the position scale is not undone where it is drawn\n");
+	if (!queueOrder)
+		fprintf(stderr, "translucent drawables at the same depth are drawn out of order\n");
+	if (!clipScissor)
+		fprintf(stderr, "a clipped shape does not put the scissor box in use back\n");
+
+	for (size_t i=0; i<results.size(); i++)
+	{
+		const Result &r = results[i];
+
+		if (r.errors != 0)
+		{
+			fprintf(stderr, "%s: %d failed checks (%s)\n", r.scene, r.errors, r.lastError);
+			failed = true;
+		}
+		if (r.draws != r.expected)
+		{
+			fprintf(stderr, "%s: %d draw calls a frame, expected %d\n", r.scene, r.draws, r.expected);
+			failed = true;
+		}
+	}
+
+	for (size_t i=0; i<spriteResults.size(); i++)
+	{
+		const SpriteResult &r = spriteResults[i];
+
+		if (r.errors != 0)
+		{
+			fprintf(stderr, "sprites %s: %d failed checks (%s)\n", r.path, r.errors, r.lastError);
+			failed = true;
+		}
+		if (r.draws != 1)
+		{
+			fprintf(stderr, "sprites %s: %d draw calls a frame, expected 1\n", r.path, r.draws);
+			failed = true;
+		}
+	}
+
+	FILE *out = opt.out ? fopen(opt.out, "w") : stdout;
+	if (!out)
+	{
+		perror(opt.out);
+		return 1;
+	}
+
+	fprintf(out, "{\n");
+	fprintf(out, "  \"quads\": %d,\n", opt.quads);
+	fprintf(out, "  \"sprites\": %d,\n", opt.sprites);
+	fprintf(out, "  \"frames\": %d,\n", opt.frames);
+	fprintf(out, "  \"results\": [\n");
+	for (size_t i=0; i<results.size(); i++)
+	{
+		const Result &r = results[i];
+		fprintf(out, "    {\"scene\": \"%s\", \"draw_calls\": %d, \"bytes\": %.0f, \"calls\": %d, "
+				"\"ms\": %.3f, \"errors\": %d}%s\n", r.scene, r.draws, r.bytes, r.calls, r.ms,
+				r.errors, i+1 < results.size() ? "," : "");
+	}
+	fprintf(out, "  ],\n");
+	fprintf(out, "  \"sprite_results\": [\n");
+	for (size_t i=0; i<spriteResults.size(); i++)
+	{
+		const SpriteResult &r = spriteResults[i];
+		fprintf(out, "    {\"path\": \"%s\", \"draw_calls\": %d, \"bytes_per_sprite\": %.1f, "
+				"\"ms\": %.3f, \"errors\": %d}%s\n", r.path, r.draws, r.bytesPerSprite, r.ms,
+				r.errors, i+1 < spriteResults.size() ? "," : "");
+	}
+	fprintf(out, "  ],\n");
+	fprintf(out, "  \"tile_matches_blit\": %s,\n", tileMatch ? "true" : "false");
+	fprintf(out, "  \"scale_folds\": %s,\n", scaleFold ? "true" : "false");
+	fprintf(out, "  \"queue_keeps_order\": %s,\n", queueOrder ? "true" : "false");
+	fprintf(out, "  \"clip_keeps_scissor\": %s\n", clipScissor ? "true" : "false");
+	fprintf(out, "}\n");
+
+	if (out != stdout)
+		fclose(out);
+
+	return failed ? 1 : 0;
+}
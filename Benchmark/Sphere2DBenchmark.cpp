@@ -0,0 +1,629 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*!	\file	Sphere2DBenchmark.cpp
+	\brief	Times Sphere2DWorld on reproducible scenes, reporting JSON.
+
+	Every scene is generated from a seed, so two builds given the same
+	arguments simulate exactly the same bodies.  Each step is split into the
+	world's phases and every phase is timed on its own.
+
+	\code
+make
+./sphere2d_bench --sizes 1000,100000 --scenes gas,pile --out results.json
+	\endcode
+
+	Scenes:
+		- gas		Bodies bouncing around a box with random velocities
+		- pile		Bodies packed at the bottom of a box, pulled down
+		- cluster	Bodies orbiting four attractors
+		- level		Gas inside a level of 50k wall segments
+
+	Phases (as Sphere2DWorld::step runs them):
+		- collisions	Repulsion between bodies, and the static geometry
+		- forces		Resistance, and the pile's weight
+		- gravity		Attraction towards the attractors
+		- integrate		Verlet integration
+		- grid			Grid rebuild (or Morton reorder, with --reorder)
+
+	Progress goes to stderr; the JSON goes to stdout unless --out is given.
+*/
+
+#include "../Sphere2DWorld.h"
+#include "../StaticGeometry2D.h"
+#include "../AsyncSphere2DWorld.h"
+#include "../PerfCounters.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//! Length of a step (seconds)
+#define BENCH_TIMESTEP		(1.0f/60.0f)
+
+//! Steps run before measuring
+#define BENCH_WARMUP		5
+
+//! Segments in the level scene
+#define BENCH_LEVEL_SEGMENTS	50000
+
+
+//! Monotonic time in seconds
+static double now()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec / 1000000000.0;
+}
+
+
+//! Same numbers on every platform (rand() is not)
+class Random
+{
+	unsigned int m_state;
+
+public:
+	Random(unsigned int in_seed) : m_state(in_seed ? in_seed : 1)	{}
+
+	unsigned int next()
+	{
+		m_state ^= m_state << 13;
+		m_state ^= m_state >> 17;
+		m_state ^= m_state << 5;
+		return m_state;
+	}
+
+	//! [0, 1)
+	float uniform()					{	return (float)(next() >> 8) / 16777216.0f;		}
+
+	//! [in_lo, in_hi)
+	float range(float in_lo, float in_hi)	{	return in_lo + (in_hi - in_lo) * uniform();	}
+};
+
+
+//! A world and everything it refers to
+class Scene
+{
+public:
+	Sphere2DWorld		world;
+	StaticGeometry2D	level;
+
+	//! Constant force on every body (the pile's weight)
+	Coord2D				pull;
+
+	//! Add a body moving at in_velocity
+	void addBody(const Coord2D in_p, const Coord2D in_velocity, float in_radius,
+				 float in_mass = 1)
+	{
+		Sphere2D s;
+		s.radius = in_radius;
+		s.mass = in_mass;
+
+		//Verlet velocity comes from the previous position
+		s.setPosition(in_p - in_velocity * BENCH_TIMESTEP);
+		s.displace(in_velocity * BENCH_TIMESTEP);
+
+		world.add(s);
+	}
+
+	//! Four walls around [0, in_w] x [0, in_h]
+	void addBox(float in_w, float in_h)
+	{
+		level.addSegment(Coord2D(0, 0), Coord2D(in_w, 0));
+		level.addSegment(Coord2D(in_w, 0), Coord2D(in_w, in_h));
+		level.addSegment(Coord2D(in_w, in_h), Coord2D(0, in_h));
+		level.addSegment(Coord2D(0, in_h), Coord2D(0, 0));
+	}
+};
+
+
+static void buildGas(Scene &s, int in_count, Random &r)
+{
+	//About 16 units of area per body
+	float side = 4 * sqrtf((float)in_count);
+
+	for (int i=0; i<in_count; i++)
+		s.addBody(Coord2D(r.range(1, side-1), r.range(1, side-1)),
+				  Coord2D(r.range(-20, 20), r.range(-20, 20)), 1);
+
+	s.addBox(side, side);
+}
+
+
+static void buildPile(Scene &s, int in_count, Random &r)
+{
+	//Touching rows, four times as wide as tall, in a box twice as tall
+	int across = (int)ceilf(sqrtf(in_count * 4.0f));
+	int rows = (in_count + across - 1) / across;
+	float w = across * 2.0f + 2;
+
+	for (int i=0; i<in_count; i++)
+	{
+		float jitter = r.range(-0.05f, 0.05f);
+		s.addBody(Coord2D(2.0f + (i % across) * 2.0f + jitter, 1.0f + (i / across) * 2.0f),
+				  Coord2D(), 1);
+	}
+
+	s.addBox(w, rows * 4.0f + 4);
+	s.pull = Coord2D(0, -100);
+}
+
+
+static void buildCluster(Scene &s, int in_count, Random &r)
+{
+	const int attractors = 4;
+	const float mass = 10000;
+
+	float spread = 6 * sqrtf((float)in_count / attractors) + 20;
+
+	std::vector<Coord2D> centres;
+	for (int a=0; a<attractors; a++)
+	{
+		float angle = a * 2 * (float)M_PI / attractors;
+		Coord2D c = Coord2D(cosf(angle), sinf(angle)) * (spread * 2);
+
+		centres.push_back(c);
+		s.addBody(c, Coord2D(), 5, mass);
+		s.world.addAttractor(s.world.count() - 1);
+	}
+
+	for (int i=attractors; i<in_count; i++)
+	{
+		const Coord2D &c = centres[i % attractors];
+
+		float radius = r.range(10, spread);
+		float angle = r.range(0, 2 * (float)M_PI);
+		Coord2D dir(cosf(angle), sinf(angle));
+
+		//Circular orbit: v^2 = G M / r
+		float speed = sqrtf(mass / radius);
+		s.addBody(c + dir * radius, Coord2D(-dir.y, dir.x) * speed, 1);
+	}
+}
+
+
+static void buildLevel(Scene &s, int in_count, Random &r)
+{
+	//Half of the edges of a lattice, enough cells for the segments
+	int cells = (int)ceilf(sqrtf(BENCH_LEVEL_SEGMENTS));
+	float side = 4 * sqrtf((float)in_count);
+	if (side < cells * 8.0f)
+		side = cells * 8.0f;
+
+	float cell = side / cells;
+
+	int added = 0;
+	while (added < BENCH_LEVEL_SEGMENTS)
+	{
+		int x = (int)(r.uniform() * cells);
+		int y = (int)(r.uniform() * cells);
+		Coord2D a(x * cell, y * cell);
+
+		if (r.next() & 1)
+			s.level.addSegment(a, a + Coord2D(cell, 0));
+		else
+			s.level.addSegment(a, a + Coord2D(0, cell));
+		added++;
+	}
+
+	for (int i=0; i<in_count; i++)
+	{
+		//Away from the lattice lines
+		int cx = (int)(r.uniform() * cells);
+		int cy = (int)(r.uniform() * cells);
+		Coord2D p(cx * cell + r.range(1.5f, cell - 1.5f),
+				  cy * cell + r.range(1.5f, cell - 1.5f));
+
+		s.addBody(p, Coord2D(r.range(-20, 20), r.range(-20, 20)), 1);
+	}
+}
+
+
+//! Order statistics of a set of samples (milliseconds)
+class Stats
+{
+public:
+	double median, p99, mean, min;
+
+	Stats(std::vector<double> in_samples)
+	: median(0), p99(0), mean(0), min(0)
+	{
+		if (in_samples.empty())	return;
+
+		std::sort(in_samples.begin(), in_samples.end());
+		size_t n = in_samples.size();
+
+		median = n % 2 ? in_samples[n/2] : (in_samples[n/2-1] + in_samples[n/2]) / 2;
+		p99 = in_samples[(size_t)ceil(0.99 * n) - 1];
+		min = in_samples[0];
+
+		for (size_t i=0; i<n; i++)
+			mean += in_samples[i];
+		mean /= n;
+	}
+
+	void write(FILE *out) const
+	{
+		fprintf(out, "{\"median\": %.6f, \"p99\": %.6f, \"mean\": %.6f, \"min\": %.6f}",
+				median, p99, mean, min);
+	}
+};
+
+
+enum Phase
+{
+	PhaseCollisions,
+	PhaseForces,
+	PhaseGravity,
+	PhaseIntegrate,
+	PhaseGrid,
+
+	PHASE_COUNT
+};
+
+static const char *s_phaseNames[PHASE_COUNT] =
+{
+	"collisions", "forces", "gravity", "integrate", "grid"
+};
+
+
+//! Options from the command line
+class Options
+{
+public:
+	std::vector<int>			sizes;
+	std::vector<std::string>	scenes;
+	unsigned int				seed;
+	int							steps;
+	int							reorder;
+	bool						async;
+	const char					*out;
+
+	Options()
+	: seed(1)
+	, steps(0)
+	, reorder(0)
+	, async(false)
+	, out(NULL)
+	{}
+};
+
+
+//! Steps for a size when not given (about 2M body-steps, 10 ... 200)
+static int stepsFor(const Options &in_opt, int in_count)
+{
+	if (in_opt.steps > 0)	return in_opt.steps;
+
+	int steps = 2000000 / in_count;
+	return steps < 10 ? 10 : (steps > 200 ? 200 : steps);
+}
+
+
+static bool buildScene(Scene &s, const std::string &in_name, int in_count, unsigned int in_seed)
+{
+	Random r(in_seed);
+
+	if (in_name == "gas")			buildGas(s, in_count, r);
+	else if (in_name == "pile")		buildPile(s, in_count, r);
+	else if (in_name == "cluster")	buildCluster(s, in_count, r);
+	else if (in_name == "level")	buildLevel(s, in_count, r);
+	else							return false;
+
+	s.level.build();
+	s.world.setStaticGeometry(&s.level);
+	s.world.updateGrid();
+	return true;
+}
+
+
+//! Time every phase of every step; one JSON object to out
+static void runPhases(FILE *out, const Options &in_opt, const std::string &in_scene, int in_count)
+{
+	Scene s;
+	double t0 = now();
+	buildScene(s, in_scene, in_count, in_opt.seed);
+	double setup = now() - t0;
+
+	int steps = stepsFor(in_opt, in_count);
+	int sinceReorder = 0;
+
+	std::vector<double> phases[PHASE_COUNT];
+	std::vector<double> total;
+	PerfCounters counters;
+	long long counts[PerfCounters::COUNTER_COUNT] = {0};
+
+	for (int step=0; step<BENCH_WARMUP + steps; step++)
+	{
+		bool measured = step >= BENCH_WARMUP;
+		double t[PHASE_COUNT + 1];
+
+		if (measured)	counters.start();
+
+		t[0] = now();
+		s.world.resolveCollisions();
+		t[1] = now();
+		if (s.pull.x != 0 || s.pull.y != 0)
+		{
+			for (int i=0; i<s.world.count(); i++)
+				s.world.body(i).addForce(s.pull * s.world.body(i).mass);
+		}
+		s.world.accumulateForces();
+		t[2] = now();
+		s.world.applyGravity();
+		t[3] = now();
+		s.world.integrate(BENCH_TIMESTEP);
+		t[4] = now();
+		if (in_opt.reorder > 0 && ++sinceReorder >= in_opt.reorder)
+		{
+			s.world.reorder();
+			sinceReorder = 0;
+		}
+		else
+			s.world.updateGrid();
+		t[5] = now();
+
+		if (!measured)	continue;
+
+		counters.stop();
+		for (int c=0; c<PerfCounters::COUNTER_COUNT; c++)
+			counts[c] += counters.value((PerfCounters::Counter)c);
+
+		for (int p=0; p<PHASE_COUNT; p++)
+			phases[p].push_back((t[p+1] - t[p]) * 1000.0);
+		total.push_back((t[PHASE_COUNT] - t[0]) * 1000.0);
+	}
+
+	Stats step(total);
+
+	fprintf(stderr, "%-8s %8d bodies  %4d steps  median %9.3f ms  p99 %9.3f ms\n",
+			in_scene.c_str(), in_count, steps, step.median, step.p99);
+
+	fprintf(out, "\t\t{\"scene\": \"%s\", \"bodies\": %d, \"steps\": %d, \"setup_ms\": %.3f,\n",
+			in_scene.c_str(), in_count, steps, setup * 1000.0);
+	fprintf(out, "\t\t \"step_ms\": ");
+	step.write(out);
+	fprintf(out, ",\n\t\t \"bodies_per_second\": %.1f,\n",
+			step.median > 0 ? in_count / (step.median / 1000.0) : 0.0);
+
+	fprintf(out, "\t\t \"phases_ms\": {");
+	for (int p=0; p<PHASE_COUNT; p++)
+	{
+		fprintf(out, "%s\n\t\t\t\"%s\": ", p ? "," : "", s_phaseNames[p]);
+		Stats(phases[p]).write(out);
+	}
+	fprintf(out, "},\n");
+
+	//Per step, or null when the counters cannot be read here
+	fprintf(out, "\t\t \"counters_per_step\": {");
+	for (int c=0; c<PerfCounters::COUNTER_COUNT; c++)
+	{
+		PerfCounters::Counter counter = (PerfCounters::Counter)c;
+		fprintf(out, "%s\"%s\": ", c ? ", " : "", PerfCounters::name(counter));
+
+		if (counters.isAvailable(counter) && counts[c] >= 0)
+			fprintf(out, "%lld", counts[c] / steps);
+		else
+			fprintf(out, "null");
+	}
+	fprintf(out, "}}");
+}
+
+
+//! Time the caller's side of a frame with physics inline and threaded
+static void runAsync(FILE *out, const Options &in_opt, const std::string &in_scene, int in_count)
+{
+	const int frames = 120;
+	const float frame = 1.0f / 60.0f;
+
+	fprintf(out, "\t\t{\"scene\": \"%s\", \"bodies\": %d, \"frames\": %d",
+			in_scene.c_str(), in_count, frames);
+
+	for (int threaded=0; threaded<2; threaded++)
+	{
+		Scene s;
+		buildScene(s, in_scene, in_count, in_opt.seed);
+
+		AsyncSphere2DWorld async(&s.world, BENCH_TIMESTEP, threaded != 0);
+		std::vector<double> caller;
+
+		for (int f=0; f<frames; f++)
+		{
+			double start = now();
+
+			async.addForce(0, Coord2D(1, 0));
+			async.update(frame);
+			async.state();
+
+			double end = now();
+			caller.push_back((end - start) * 1000.0);
+
+			//The rest of the frame goes to "rendering"
+			double left = frame - (end - start);
+			if (left > 0)
+				usleep((useconds_t)(left * 1000000.0));
+		}
+
+		Sphere2DWorldTimings t = async.timings();
+
+		fprintf(stderr, "%-8s %8d bodies  %-8s caller median %8.3f ms  input latency %8.3f ms\n",
+				in_scene.c_str(), in_count, threaded ? "threaded" : "inline",
+				Stats(caller).median, t.inputLatencyMs);
+
+		fprintf(out, ",\n\t\t \"%s\": {\"caller_ms\": ", threaded ? "threaded" : "inline");
+		Stats(caller).write(out);
+		fprintf(out, ", \"step_ms\": %.4f, \"input_latency_ms\": %.4f, \"state_age_ms\": %.4f}",
+				t.stepMs, t.inputLatencyMs, t.stateAgeMs);
+	}
+
+	fprintf(out, "}");
+}
+
+
+//! Split "a,b,c"
+static std::vector<std::string> split(const char *in_list)
+{
+	std::vector<std::string> parts;
+	std::string s(in_list);
+	size_t start = 0;
+
+	while (start <= s.size())
+	{
+		size_t comma = s.find(',', start);
+		if (comma == std::string::npos)	comma = s.size();
+
+		if (comma > start)
+			parts.push_back(s.substr(start, comma - start));
+		start = comma + 1;
+	}
+
+	return parts;
+}
+
+
+static void usage()
+{
+	fprintf(stderr,
+		"usage: sphere2d_bench [options]\n"
+		"  --sizes N,N,...     body counts (default 100,1000,10000,100000,1000000)\n"
+		"  --scenes S,S,...    gas, pile, cluster, level (default all)\n"
+		"  --steps N           measured steps per run (default ~2M body-steps)\n"
+		"  --seed N            scene seed (default 1)\n"
+		"  --reorder N         Morton reorder every N steps (default off)\n"
+		"  --async             also compare threaded and inline stepping\n"
+		"  --out FILE          write the JSON to FILE instead of stdout\n");
+}
+
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i=1; i<argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = i+1 < argc ? argv[i+1] : NULL;
+
+		if (!strcmp(a, "--async"))
+		{
+			opt.async = true;
+			continue;
+		}
+
+		if (!v)
+		{
+			usage();
+			return 1;
+		}
+
+		i++;
+
+		if (!strcmp(a, "--sizes"))
+		{
+			std::vector<std::string> sizes = split(v);
+			for (size_t k=0; k<sizes.size(); k++)
+				opt.sizes.push_back(atoi(sizes[k].c_str()));
+		}
+		else if (!strcmp(a, "--scenes"))	opt.scenes = split(v);
+		else if (!strcmp(a, "--steps"))		opt.steps = atoi(v);
+		else if (!strcmp(a, "--seed"))		opt.seed = (unsigned int)strtoul(v, NULL, 10);
+		else if (!strcmp(a, "--reorder"))	opt.reorder = atoi(v);
+		else if (!strcmp(a, "--out"))		opt.out = v;
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	if (opt.sizes.empty())
+	{
+		static const int sizes[] = {100, 1000, 10000, 100000, 1000000};
+		opt.sizes.assign(sizes, sizes + 5);
+	}
+
+	if (opt.scenes.empty())
+		opt.scenes = split("gas,pile,cluster,level");
+
+	for (size_t i=0; i<opt.scenes.size(); i++)
+	{
+		const std::string &n = opt.scenes[i];
+		if (n != "gas" && n != "pile" && n != "cluster" && n != "level")
+		{
+			fprintf(stderr, "unknown scene: %s\n", opt.scenes[i].c_str());
+			return 1;
+		}
+	}
+
+	FILE *out = opt.out ? fopen(opt.out, "w") : stdout;
+	if (!out)
+	{
+		fprintf(stderr, "cannot write %s\n", opt.out);
+		return 1;
+	}
+
+	fprintf(out, "{\n\t\"benchmark\": \"sphere2d\",\n");
+	fprintf(out, "\t\"seed\": %u,\n\t\"timestep\": %.6f,\n\t\"warmup_steps\": %d,\n",
+			opt.seed, BENCH_TIMESTEP, BENCH_WARMUP);
+	fprintf(out, "\t\"reorder_interval\": %d,\n", opt.reorder);
+#ifdef __VERSION__
+	fprintf(out, "\t\"compiler\": \"%s\",\n", __VERSION__);
+#endif
+	fprintf(out, "\t\"results\": [\n");
+
+	bool first = true;
+	for (size_t sc=0; sc<opt.scenes.size(); sc++)
+	{
+		for (size_t sz=0; sz<opt.sizes.size(); sz++)
+		{
+			fprintf(out, first ? "" : ",\n");
+			first = false;
+			runPhases(out, opt, opt.scenes[sc], opt.sizes[sz]);
+		}
+	}
+
+	fprintf(out, "\n\t]");
+
+	if (opt.async)
+	{
+		fprintf(out, ",\n\t\"async\": [\n");
+
+		first = true;
+		for (size_t sc=0; sc<opt.scenes.size(); sc++)
+		{
+			for (size_t sz=0; sz<opt.sizes.size(); sz++)
+			{
+				fprintf(out, first ? "" : ",\n");
+				first = false;
+				runAsync(out, opt, opt.scenes[sc], opt.sizes[sz]);
+			}
+		}
+
+		fprintf(out, "\n\t]");
+	}
+
+	fprintf(out, "\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}
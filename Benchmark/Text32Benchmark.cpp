@@ -0,0 +1,306 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/*!	\file	Text32Benchmark.cpp
+	\brief	Times the generation of glyph quads for drawText32, reporting JSON.
+
+	Every frame lays out the same set of seeded strings (HUD lines, mixing
+	letters, spaces, apostrophes and accented letters) into one vertex and
+	index buffer, as a single submission would hold them.  Two layouts are
+	timed:
+		- branching		The per-character tests drawText32 used to make,
+						one 4-vertex quad (and draw call) per character
+		- table			Text32::quads and Text32::indices
+
+	The GL is not involved: only the CPU side of text drawing is measured.
+
+	\code
+make text32_bench
+./text32_bench --strings 200 --length 40 --out text.json
+	\endcode
+*/
+
+#include "../Text32.h"
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+//! Monotonic time in seconds
+static double now()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec / 1000000000.0;
+}
+
+
+//! Same numbers on every platform (rand() is not)
+class Random
+{
+	unsigned int m_state;
+
+public:
+	Random(unsigned int in_seed) : m_state(in_seed ? in_seed : 1)	{}
+
+	unsigned int next()
+	{
+		m_state ^= m_state << 13;
+		m_state ^= m_state >> 17;
+		m_state ^= m_state << 5;
+		return m_state;
+	}
+};
+
+
+//! Command line
+struct Options
+{
+	int				strings;		//!< Strings per frame
+	int				length;			//!< Characters per string
+	int				frames;			//!< Frames timed
+	unsigned int	seed;
+	const char		*out;
+
+	Options() : strings(200), length(40), frames(500), seed(1), out(NULL)	{}
+};
+
+
+//! A HUD line of in_length characters
+static std::string makeString(Random &io_r, int in_length)
+{
+	static const char *accents[] = {"\xc3\xa9", "\xc3\xa0", "\xc3\xaa", "\xc3\x89"};
+	std::string s;
+
+	for (int i=0; i<in_length; i++)
+	{
+		const unsigned int k = io_r.next() % 64;
+
+		if (k < 26)			s += (char)('a' + k);
+		else if (k < 52)	s += (char)('A' + k - 26);
+		else if (k < 60)	s += ' ';
+		else if (k < 62)	s += '\'';
+		else				s += accents[io_r.next() % 4];
+	}
+
+	return s;
+}
+
+
+//! The quads drawText32 used to make: texture coordinates by branching
+static int branching(float in_sx, float in_sy, float in_x, float in_y,
+					 float in_w, float in_h, const char *in_sz_uch,
+					 float *out_data)
+{
+	in_sx /= 1024.0f;
+	in_sy /= 1024.0f;
+
+	const unsigned char *in_sz = (const unsigned char*)in_sz_uch;
+	int quads = 0;
+
+	while (*in_sz)
+	{
+		float x1 = -1;
+		float y1 = -1;
+		if (*in_sz >= 'a' && *in_sz <= 'z')
+		{
+			x1 = 16.0f / 1024.0f;
+			y1 = (*in_sz - 'a') * 32 / 1024.0f;
+		}
+		else if (*in_sz >= 'A' && *in_sz <= 'Z')
+		{
+			x1 = 0;
+			y1 = (*in_sz - 'A') * 32 / 1024.0f;
+		}
+		else if (*in_sz == '\'')
+		{
+			x1 = 0;
+			y1 = ('z'-'a'+1)*32 / 1024.0f;
+		}
+		else if (*in_sz == 0xc3)
+		{
+			in_sz++;
+			switch(*in_sz)
+			{
+				case 0x80:	x1 = 0;				y1 = ('z'-'a'+3)*32 / 1024.0f;	break;
+				case 0x89:	x1 = 0;				y1 = ('z'-'a'+2)*32 / 1024.0f;	break;
+				case 0x8A:	x1 = 0;				y1 = ('z'-'a'+4)*32 / 1024.0f;	break;
+				case 0xa0:	x1 = 16.0f/1024.0f;	y1 = ('z'-'a'+3)*32 / 1024.0f;	break;
+				case 0xa9:	x1 = 16.0f/1024.0f;	y1 = ('z'-'a'+2)*32 / 1024.0f;	break;
+				case 0xaa:	x1 = 16.0f/1024.0f;	y1 = ('z'-'a'+4)*32 / 1024.0f;	break;
+			}
+		}
+
+		if (! (x1 < 0 || y1 < 0))
+		{
+			float data[20] = {
+				in_x,		in_y,		0,	in_sx+x1+0.0001f,				in_sy+y1+0.0001f,
+				in_x+in_w,	in_y,		0,	in_sx+x1+16.0f/1024.0f-0.0001f,	in_sy+y1+0.0001f,
+				in_x,		in_y+in_h,	0,	in_sx+x1+0.0001f,				in_sy+y1+32.0f/1024.0f-0.0001f,
+				in_x+in_w,	in_y+in_h,	0,	in_sx+x1+16.0f/1024.0f-0.0001f,	in_sy+y1+32.0f/1024.0f-0.0001f};
+
+			//Stands in for the draw call made per character
+			memcpy(out_data + quads*20, data, sizeof(data));
+			quads++;
+		}
+
+		in_x += in_w;
+		in_sz++;
+	}
+
+	return quads;
+}
+
+
+static void usage()
+{
+	fprintf(stderr,
+			"usage: text32_bench [--strings N] [--length N] [--frames N]\n"
+			"                    [--seed N] [--out FILE]\n");
+}
+
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i=1; i<argc; i++)
+	{
+		const char *a = argv[i];
+		const char *v = i+1 < argc ? argv[i+1] : NULL;
+
+		if (!v)
+		{
+			usage();
+			return 1;
+		}
+
+		i++;
+
+		if (!strcmp(a, "--strings"))		opt.strings = atoi(v);
+		else if (!strcmp(a, "--length"))	opt.length = atoi(v);
+		else if (!strcmp(a, "--frames"))	opt.frames = atoi(v);
+		else if (!strcmp(a, "--seed"))		opt.seed = (unsigned int)strtoul(v, NULL, 10);
+		else if (!strcmp(a, "--out"))		opt.out = v;
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	if (opt.strings <= 0 || opt.length <= 0 || opt.frames <= 0)
+	{
+		usage();
+		return 1;
+	}
+
+	Random r(opt.seed);
+	std::vector<std::string> strings;
+	for (int i=0; i<opt.strings; i++)
+		strings.push_back(makeString(r, opt.length));
+
+	const int glyphs = opt.strings * opt.length;
+
+	std::vector<float> legacy(glyphs * 20);
+	std::vector<TextVertex32> vertices(glyphs * Text32::QUAD_VERTICES);
+	std::vector<unsigned short> indices(glyphs * Text32::QUAD_INDICES);
+
+	//Indices are 16 bits: a submission is cut every 16384 quads
+	const int maxQuads = 65536 / Text32::QUAD_VERTICES;
+
+	int legacyQuads = 0, legacyCalls = 0;
+	double legacyTime = 0;
+
+	int tableQuads = 0, tableSubmissions = 0;
+	double tableTime = 0;
+
+	for (int f=0; f<opt.frames; f++)
+	{
+		double start = now();
+
+		legacyQuads = 0;
+		for (int i=0; i<opt.strings; i++)
+			legacyQuads += branching(0, 0, 0, i*32.0f, 16, 32, strings[i].c_str(),
+									 &legacy[legacyQuads * 20]);
+		legacyCalls = legacyQuads;
+
+		legacyTime += now() - start;
+
+
+		start = now();
+
+		tableQuads = 0;
+		tableSubmissions = 1;
+		int first = 0;
+		for (int i=0; i<opt.strings; i++)
+		{
+			if (tableQuads - first + opt.length > maxQuads)
+			{
+				first = tableQuads;
+				tableSubmissions++;
+			}
+
+			int n = Text32::quads(0, 0, 0, i*32.0f, 16, 32, strings[i].c_str(),
+								  &vertices[tableQuads * Text32::QUAD_VERTICES],
+								  glyphs - tableQuads);
+
+			Text32::indices((tableQuads - first) * Text32::QUAD_VERTICES, n,
+							&indices[tableQuads * Text32::QUAD_INDICES]);
+			tableQuads += n;
+		}
+
+		tableTime += now() - start;
+	}
+
+	if (legacyQuads != tableQuads)
+	{
+		fprintf(stderr, "layouts disagree: %d quads against %d\n", legacyQuads, tableQuads);
+		return 1;
+	}
+
+	FILE *out = opt.out ? fopen(opt.out, "w") : stdout;
+	if (!out)
+	{
+		perror(opt.out);
+		return 1;
+	}
+
+	const double laidOut = (double)opt.strings * opt.frames;
+
+	fprintf(out, "{\n");
+	fprintf(out, "  \"strings\": %d,\n", opt.strings);
+	fprintf(out, "  \"length\": %d,\n", opt.length);
+	fprintf(out, "  \"frames\": %d,\n", opt.frames);
+	fprintf(out, "  \"seed\": %u,\n", opt.seed);
+	fprintf(out, "  \"glyphs_per_frame\": %d,\n", tableQuads);
+	fprintf(out, "  \"results\": [\n");
+	fprintf(out, "    {\"layout\": \"branching\", \"strings_per_ms\": %.1f, \"draw_calls_per_frame\": %d},\n",
+			laidOut / (legacyTime * 1000), legacyCalls);
+	fprintf(out, "    {\"layout\": \"table\", \"strings_per_ms\": %.1f, \"draw_calls_per_frame\": %d}\n",
+			laidOut / (tableTime * 1000), tableSubmissions);
+	fprintf(out, "  ]\n");
+	fprintf(out, "}\n");
+
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}
@@ -18,10 +18,14 @@
 
 #include <stdlib.h>
 #include "Immediate.h"
+#include "GPUState.h"
+#include "Text32.h"
 #include <sys/time.h>
 
+#ifndef GPU_HEADLESS
 #import <OpenGLES/ES1/gl.h>
 #import <OpenGLES/ES1/glext.h>
+#endif
 
 #include <stdio.h>
 #include <math.h>
@@ -86,91 +90,105 @@ static void fillRect(float d_x, float d_y, float in_dw, float in_dh)
 }
 
 
+//! Draw a string with the 32 pixel font (see Text32.h), a draw call per glyph
+/*!	Positions are the GL's own units, as the modelview gets them (not those
+	of gl.vertex()), and texture coordinates are normalized, inset by a
+	tenth of a texel so that neighbouring glyphs don't bleed in.  Whatever
+	gli kept is drawn first.  See drawText32Batched for one draw call.
+
+	\param in_sx, in_sy	Where the font is in the bound 1024x1024 texture (texels)
+	\param in_x, in_y	Top left of the first character
+	\param in_w, in_h	Size of a character
+	\param in_sz_uch	The string (UTF-8)	*/
 static void drawText32(float in_sx, float in_sy,
 				float in_x, float in_y,
 				float in_w, float in_h,
 				const char *in_sz_uch)
 {
-	in_sx /= 1024.0f;
-	in_sy /= 1024.0f;
-	
 	const unsigned char *in_sz = (const unsigned char*)in_sz_uch;
 	
+	//Drawn from client memory, after what came before
+	gliCurrent().flush();
+	GPU::State::bindBuffer(GL_ARRAY_BUFFER, 0);
+	
+	const float texel = 1.0f / 1024.0f;
+	const float w = Text32::GLYPH_WIDTH * texel, h = Text32::GLYPH_HEIGHT * texel;
+	
 	while (*in_sz)
 	{
-		float x1 = -1;
-		float y1 = -1;
-		if (*in_sz >= 'a' && *in_sz <= 'z')
-		{
-			x1 = 16.0f / 1024.0f;
-			y1 = (*in_sz - 'a') * 32;
-			y1 /= 1024.0f;
-		}
-		else if (*in_sz >= 'A' && *in_sz <= 'Z')
-		{
-			x1 = 0;
-			y1 = (*in_sz - 'A') * 32;
-			y1 /= 1024.0f;
-		}
-		else if (*in_sz == '\'')
-		{
-			x1 = 0;
-			y1 = ('z'-'a'+1)*32 / 1024.0f;
-		}
-		else if (*in_sz == 0xc3)
-		{
-			in_sz++;
-			switch(*in_sz)
-			{
-				case 0x80:	//À
-					x1 = 0;
-					y1 = ('z'-'a'+3)*32 / 1024.0f;
-					break;
-					
-				case 0x89: 	//É
-					x1 = 0;
-					y1 = ('z'-'a'+2)*32 / 1024.0f;
-					break;
-					
-				case 0x8A:	//Ê
-					x1 = 0;
-					y1 = ('z'-'a'+4)*32 / 1024.0f;
-					break;
-					
-				case 0xa0:	//à
-					x1 = 16.0f / 1024.0f;
-					y1 = ('z'-'a'+3)*32 / 1024.0f;
-					break;
-					
-				case 0xa9:	//é
-					x1 = 16.0f / 1024.0f;
-					y1 = ('z'-'a'+2)*32 / 1024.0f;
-					break;
-					
-				case 0xaa:	//ê
-					x1 = 16.0f / 1024.0f;
-					y1 = ('z'-'a'+4)*32 / 1024.0f;
-					break;
-			}
-		}
+		const Glyph32 *g = Text32::next(in_sz);
 		
-		if (! (x1 < 0 || y1 < 0))
+		if (g)
 		{
+			const float u = (in_sx + g->u) * texel;
+			const float v = (in_sy + g->v) * texel;
+			
 			float data[20] = {
-				in_x,		in_y,		0,	in_sx+x1+0.0001f,				in_sy+y1+0.0001f,
-				in_x+in_w,	in_y,		0,	in_sx+x1+16.0f/1024.0f-0.0001f,	in_sy+y1+0.0001f,
-				in_x,		in_y+in_h,	0,	in_sx+x1+0.0001f,				in_sy+y1+32.0f/1024.0f-0.0001f,
-				in_x+in_w, in_y+in_h,	0,	in_sx+x1+16.0f/1024.0f-0.0001f,	in_sy+y1+32.0f/1024.0f-0.0001f};
+				in_x,		in_y,		0,	u+0.0001f,		v+0.0001f,
+				in_x+in_w,	in_y,		0,	u+w-0.0001f,	v+0.0001f,
+				in_x,		in_y+in_h,	0,	u+0.0001f,		v+h-0.0001f,
+				in_x+in_w,	in_y+in_h,	0,	u+w-0.0001f,	v+h-0.0001f};
 			
-			glVertexPointer(3,GL_FLOAT,sizeof(float)*5,data);
-			glTexCoordPointer(2,GL_FLOAT,sizeof(float)*5,data+3);
-			glDrawArrays(GL_TRIANGLE_STRIP,0,4);
+			GPU::backend().vertexPointer(3, GL_FLOAT, sizeof(float)*5, data);
+			GPU::backend().texCoordPointer(2, GL_FLOAT, sizeof(float)*5, data+3);
+			GPU::backend().drawArrays(GL_TRIANGLE_STRIP, 0, 4);
 		}
 		
 		in_x += in_w;
+	}
+}
+
+
+//! Draw a string with the 32 pixel font (see Text32.h), batched
+/*!	Every glyph of the string is batched and drawn in one call; while
+	gli::isBatching(), consecutive strings (and whatever else is batched with
+	them) share that call too.  Unlike drawText32, positions are in the
+	units of gl.vertex() and texture coordinates in those of gl.texCoordi()
+	(1024ths, see gliTextureMatrixSetup), with no inset.
+
+	\param in_sx, in_sy	Where the font is in the bound texture (texels)
+	\param in_x, in_y	Top left of the first character
+	\param in_w, in_h	Size of a character
+	\param in_sz_uch	The string (UTF-8)	*/
+static void drawText32Batched(float in_sx, float in_sy,
+				float in_x, float in_y,
+				float in_w, float in_h,
+				const char *in_sz_uch)
+{
+	const unsigned char *in_sz = (const unsigned char*)in_sz_uch;
+	
+	gli &c = gliCurrent();
+	const bool wasBatching = c.isBatching();
+	c.setBatching(true);
+	
+	while (*in_sz)
+	{
+		const Glyph32 *g = Text32::next(in_sz);
 		
-		in_sz++;
+		if (g)
+		{
+			const GLshort u = in_sx + g->u;
+			const GLshort v = in_sy + g->v;
+			
+			Draw d(c, GL_TRIANGLE_STRIP);
+			d.texCoordi(u, v);
+			d.vertex(in_x, in_y);
+			
+			d.texCoordi(u + Text32::GLYPH_WIDTH, v);
+			d.vertex(in_x+in_w, in_y);
+			
+			d.texCoordi(u, v + Text32::GLYPH_HEIGHT);
+			d.vertex(in_x, in_y+in_h);
+			
+			d.texCoordi(u + Text32::GLYPH_WIDTH, v + Text32::GLYPH_HEIGHT);
+			d.vertex(in_x+in_w, in_y+in_h);
+		}
+		
+		in_x += in_w;
 	}
+	
+	//Draws the string, unless the caller batches
+	c.setBatching(wasBatching);
 }
 
 static float frand()
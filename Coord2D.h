@@ -17,8 +17,10 @@
 #ifndef COORD2D
 #define COORD2D
 
+#ifdef __APPLE__
 #include <CoreGraphics/CoreGraphics.h>
 #include "Restorer.h"
+#endif
 #include "Angle.h"
 
 
@@ -50,10 +52,12 @@ public:
 	: x(ix), y(iy)
 	{}
 	
+#ifdef __APPLE__
 	//! Conversion from a CGPoint
 	TCoord2D(CGPoint in_pt)
 	: x(in_pt.x), y(in_pt.y)
 	{}
+#endif
 	
 	//! Increment the components
 	TCoord2D &operator+=(const TCoord2D &other)
@@ -164,10 +168,12 @@ public:
 		return *this;
 	}
 	
+#ifdef __APPLE__
 	operator CGPoint()
 	{
 		return CGPointMake(x, y);
 	}
+#endif
 };
 
 //! Specialize 2D coordinates for floats
@@ -282,6 +288,7 @@ static Coord2D floor(const Coord2D &a)
 }
 
 
+#ifdef __APPLE__
 ////////////////////////////////////////////////////////////////////////////////
 //		Interop object that allows us to save/restore a Coord2D...
 //
@@ -307,3 +314,5 @@ public:
 };
 
 #endif
+
+#endif
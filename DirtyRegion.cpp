@@ -0,0 +1,257 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#include "DirtyRegion.h"
+#include "FrameBuffer.h"
+#include "GPUState.h"
+#include "Immediate.h"
+#include "TextureManager.h"
+
+#include <algorithm>
+#include <math.h>
+
+//! Smallest rectangle holding both
+static Rect2D bounds(const Rect2D &in_a, const Rect2D &in_b)
+{
+	const float x0 = std::min(in_a.corner.x, in_b.corner.x);
+	const float y0 = std::min(in_a.corner.y, in_b.corner.y);
+	const float x1 = std::max(in_a.corner.x + in_a.size.x, in_b.corner.x + in_b.size.x);
+	const float y1 = std::max(in_a.corner.y + in_a.size.y, in_b.corner.y + in_b.size.y);
+
+	return Rect2D(x0, y0, x1 - x0, y1 - y0);
+}
+
+
+static inline float area(const Rect2D &in_r)
+{
+	return in_r.size.x * in_r.size.y;
+}
+
+
+static inline bool overlap(const Rect2D &in_a, const Rect2D &in_b)
+{
+	return in_a.corner.x < in_b.corner.x + in_b.size.x && in_b.corner.x < in_a.corner.x + in_a.size.x
+		&& in_a.corner.y < in_b.corner.y + in_b.size.y && in_b.corner.y < in_a.corner.y + in_a.size.y;
+}
+
+
+DirtyRegion::DirtyRegion(const Coord2D &in_size, const Coord2DI &in_pixels,
+						 bool in_yDown, FrameBuffer *in_target)
+: m_size(in_size)
+, m_pixels(in_pixels)
+, m_yDown(in_yDown)
+, m_target(in_target)
+, m_lastPixels(0)
+, m_lastRects(0)
+, m_framesDrawn(0)
+, m_framesSkipped(0)
+{
+	if (in_size.x <= 0 || in_size.y <= 0 || in_pixels.x <= 0 || in_pixels.y <= 0)
+		throw "DirtyRegion::DirtyRegion::Invalid size";
+
+	damageAll();
+}
+
+
+void DirtyRegion::resize(const Coord2D &in_size, const Coord2DI &in_pixels)
+{
+	if (in_size.x <= 0 || in_size.y <= 0 || in_pixels.x <= 0 || in_pixels.y <= 0)
+		throw "DirtyRegion::resize::Invalid size";
+
+	m_size = in_size;
+	m_pixels = in_pixels;
+	damageAll();
+}
+
+
+void DirtyRegion::damage(const Rect2D &in_rect)
+{
+	//Clipped to the screen (sizes may be negative)
+	float x0 = std::min(in_rect.corner.x, in_rect.corner.x + in_rect.size.x);
+	float y0 = std::min(in_rect.corner.y, in_rect.corner.y + in_rect.size.y);
+	float x1 = std::max(in_rect.corner.x, in_rect.corner.x + in_rect.size.x);
+	float y1 = std::max(in_rect.corner.y, in_rect.corner.y + in_rect.size.y);
+
+	x0 = std::max(x0, 0.0f);
+	y0 = std::max(y0, 0.0f);
+	x1 = std::min(x1, m_size.x);
+	y1 = std::min(y1, m_size.y);
+
+	if (x1 <= x0 || y1 <= y0)
+		return;
+
+	m_damage.push_back(Rect2D(x0, y0, x1 - x0, y1 - y0));
+}
+
+
+void DirtyRegion::damageAll()
+{
+	m_damage.clear();
+	m_damage.push_back(Rect2D(Coord2D(0, 0), m_size));
+}
+
+
+void DirtyRegion::merge()
+{
+	for (;;)
+	{
+		//Overlapping rectangles (that would be drawn twice), or ones whose
+		//bounds cost no more than they do apart, become their bounds
+		bool merged = true;
+		while (merged)
+		{
+			merged = false;
+
+			for (size_t i=0; i<m_damage.size() && !merged; i++)
+				for (size_t j=i+1; j<m_damage.size() && !merged; j++)
+				{
+					const Rect2D b = bounds(m_damage[i], m_damage[j]);
+
+					if (overlap(m_damage[i], m_damage[j])
+						|| area(b) <= area(m_damage[i]) + area(m_damage[j]))
+					{
+						m_damage[i] = b;
+						m_damage.erase(m_damage.begin() + j);
+						merged = true;
+					}
+				}
+		}
+
+		if (m_damage.size() <= DIRTY_REGION_RECTS)
+			return;
+
+		//Still too many?  Merge the pair that grows the least, and look again.
+		size_t bi = 0, bj = 1;
+		float best = -1;
+
+		for (size_t i=0; i<m_damage.size(); i++)
+			for (size_t j=i+1; j<m_damage.size(); j++)
+			{
+				const float growth = area(bounds(m_damage[i], m_damage[j]))
+									- area(m_damage[i]) - area(m_damage[j]);
+
+				if (best < 0 || growth < best)
+				{
+					best = growth;
+					bi = i;
+					bj = j;
+				}
+			}
+
+		m_damage[bi] = bounds(m_damage[bi], m_damage[bj]);
+		m_damage.erase(m_damage.begin() + bj);
+	}
+}
+
+
+void DirtyRegion::present()
+{
+	//The target's texture, whole over the screen, as it is (no blending)
+	gliEnableTexture tex;
+	gliEnableTexCoordArray texCoords;
+	gliDisableColorArray colours;
+	gliDisableBlendFunc blend;
+	BindTexture bt(m_target);
+	gli &g = gliCurrent();
+
+	//In 1024ths of the texture (see gliTextureMatrixSetup), of which the
+	//target may use only part; the GL's rows go up the screen.
+	const Coord2D used = m_target->sizeInTexture();
+	const GLshort u = (GLshort)(used.x * 1024.0f + 0.5f);
+	const GLshort v = (GLshort)(used.y * 1024.0f + 0.5f);
+	const GLshort top = m_yDown ? v : 0, bottom = m_yDown ? 0 : v;
+
+	{
+		Draw d(g, GL_TRIANGLE_STRIP);
+		d.texCoordi(0, top);
+		d.vertex(0, 0);
+
+		d.texCoordi(u, top);
+		d.vertex(m_size.x, 0);
+
+		d.texCoordi(0, bottom);
+		d.vertex(0, m_size.y);
+
+		d.texCoordi(u, bottom);
+		d.vertex(m_size.x, m_size.y);
+	}
+
+	g.flush();
+}
+
+
+bool DirtyRegion::render(IDrawable *in_screen)
+{
+	m_lastPixels = 0;
+	m_lastRects = 0;
+
+	if (m_damage.empty())
+	{
+		m_framesSkipped++;
+		return false;
+	}
+
+	merge();
+
+	//What gli kept was meant for the whole screen
+	gli &g = gliCurrent();
+	g.flush();
+
+	const float sx = m_pixels.x / m_size.x, sy = m_pixels.y / m_size.y;
+
+	//Drawn into the target, if any, until the end of the block
+	{
+		One<RenderToTarget> target(m_target ? new RenderToTarget(m_target) : NULL);
+
+		GPU::State::enable(GL_SCISSOR_TEST, true);
+
+		for (size_t i=0; i<m_damage.size(); i++)
+		{
+			const Rect2D &r = m_damage[i];
+
+			//Whole pixels around the rectangle, from the bottom left
+			const int x0 = (int)floorf(r.corner.x * sx);
+			const int x1 = (int)ceilf((r.corner.x + r.size.x) * sx);
+			int y0 = (int)floorf(r.corner.y * sy);
+			int y1 = (int)ceilf((r.corner.y + r.size.y) * sy);
+
+			if (m_yDown)
+			{
+				const int top = y0;
+				y0 = m_pixels.y - y1;
+				y1 = m_pixels.y - top;
+			}
+
+			GPU::State::scissor(x0, y0, x1 - x0, y1 - y0);
+
+			in_screen->onRender();
+			g.flush();
+
+			m_lastPixels += (x1 - x0) * (y1 - y0);
+		}
+
+		GPU::State::enable(GL_SCISSOR_TEST, false);
+	}
+
+	if (m_target)
+		present();
+
+	m_lastRects = (int)m_damage.size();
+	m_damage.clear();
+	m_framesDrawn++;
+
+	return true;
+}
@@ -0,0 +1,135 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#ifndef DIRTYREGION_H
+#define DIRTYREGION_H
+
+#include "Coord2D.h"
+#include "Rect2D.h"
+#include "Events.h"
+#include <vector>
+
+class FrameBuffer;
+
+/*!	\file	DirtyRegion.h
+	\brief	Redraw only what changed, or nothing at all.
+
+	A menu or puzzle screen mostly shows the same frame again.  Rather than
+	render it whole every frame, the screen reports what it changed with
+	damage(), and render() draws it again only there: the damaged rectangles
+	are merged into a few, and the screen is rendered once per rectangle
+	with the scissor box around it.  Without damage, nothing is drawn, and
+	the frame need not be presented.
+
+	What was drawn before must still be there: either the back buffer is
+	retained (kEAGLDrawablePropertyRetainedBacking), or the screen is drawn
+	into a FrameBuffer given to the DirtyRegion, which render() then draws
+	to the screen whole (one quad) on the frames it drew.  The target is as
+	big as the screen, in pixels; gli's projection and model matrices are
+	those the screen is drawn with.
+
+	\code
+DirtyRegion region(Coord2D(480, 320), Coord2DI(960, 640));
+
+//When something moves...
+region.damage(oldBounds);
+region.damage(newBounds);
+
+//Each frame...
+if (region.render(&menu))
+	present();
+	\endcode
+*/
+
+//! Rectangles redrawn apart, at most (more are merged)
+#define DIRTY_REGION_RECTS	4
+
+//! Damaged rectangles of a screen, redrawn with the scissor (see DirtyRegion.h)
+class DirtyRegion
+{
+private:
+	//! The screen, in the units of gli::vertex() and in pixels
+	Coord2D			m_size;
+	Coord2DI		m_pixels;
+
+	//! Do units go down the screen (and the GL's pixels up)?
+	bool			m_yDown;
+
+	//! Drawn into rather than the screen (NULL: the screen)
+	FrameBuffer		*m_target;
+
+	//! Damage since the last render(), clipped to the screen
+	std::vector<Rect2D>	m_damage;
+
+	//Statistics
+	int				m_lastPixels;
+	int				m_lastRects;
+	int				m_framesDrawn;
+	int				m_framesSkipped;
+
+	//! Merge m_damage down to DIRTY_REGION_RECTS rectangles or fewer
+	void merge();
+
+	//! Draw m_target over the whole screen
+	void present();
+
+public:
+	//! A screen of in_size units and in_pixels pixels, all damaged
+	/*!	\param in_target	Where the screen is drawn (NULL: the screen)	*/
+	DirtyRegion(const Coord2D &in_size, const Coord2DI &in_pixels,
+				bool in_yDown = true, FrameBuffer *in_target = NULL);
+
+	//! The screen changed size (all of it is damaged)
+	void resize(const Coord2D &in_size, const Coord2DI &in_pixels);
+
+	//! Something changed in in_rect (in the units of gli::vertex())
+	void damage(const Rect2D &in_rect);
+
+	//! Everything changed
+	void damageAll();
+
+	//! Is there anything to redraw?
+	inline bool isDamaged() const				{	return !m_damage.empty();	}
+
+	//! Render in_screen where it was damaged
+	/*!	The scissor test is left disabled.  With a target, the target is
+		then drawn to the screen, textured and not blended.
+		\return	Was anything drawn?  (If not, the frame need not be presented.)	*/
+	bool render(IDrawable *in_screen);
+
+	//! Pixels the last render() drew (0: skipped)
+	inline int lastPixels() const				{	return m_lastPixels;		}
+
+	//! Rectangles the last render() drew
+	inline int lastRects() const				{	return m_lastRects;			}
+
+	//! Share of the screen the last render() drew (0 to 1)
+	inline float lastCoverage() const
+	{	return (float)m_lastPixels / ((float)m_pixels.x * m_pixels.y);	}
+
+	//! Frames render() drew, and skipped, since resetStatistics()
+	inline int framesDrawn() const				{	return m_framesDrawn;		}
+	inline int framesSkipped() const			{	return m_framesSkipped;		}
+
+	//! Start counting frames from 0
+	inline void resetStatistics()
+	{
+		m_framesDrawn = 0;
+		m_framesSkipped = 0;
+	}
+};
+
+#endif
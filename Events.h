@@ -19,6 +19,7 @@
 
 #include "Coord2D.h"
 #include "Coord3D.h"
+#include "Restorer.h"
 #include <vector>
 
 //!For objects that can be drawn onto the screen...
@@ -0,0 +1,545 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "FlowField2D.h"
+#include "Sphere2DWorld.h"
+
+#include <algorithm>
+#include <functional>
+#include <float.h>
+#include <math.h>
+
+//Neighbours: the 4 sides, then the 4 corners
+static const int	s_dx[8]		= {1, -1, 0, 0, 1, -1, 1, -1};
+static const int	s_dy[8]		= {0, 0, 1, -1, 1, 1, -1, -1};
+static const float	s_len[8]	= {1, 1, 1, 1,
+								   (float)M_SQRT2, (float)M_SQRT2,
+								   (float)M_SQRT2, (float)M_SQRT2};
+
+typedef std::greater<std::pair<float,int> > HeapOrder;
+
+
+FlowField2D::FlowField2D(int in_width, int in_height, float in_cellSize,
+						 const Coord2D in_origin, bool in_threaded)
+: m_width(in_width)
+, m_height(in_height)
+, m_cellSize(in_cellSize)
+, m_origin(in_origin)
+, m_fullRebuild(true)
+, m_front(0)
+, m_threaded(in_threaded)
+, m_jobPending(false)
+, m_jobDone(false)
+, m_quit(false)
+, m_busy(false)
+, m_rebuildRequested(false)
+, m_jobFull(true)
+{
+	if (in_width <= 0 || in_height <= 0 || in_cellSize <= 0)
+		throw "FlowField2D::FlowField2D::Invalid grid";
+
+	int n = in_width * in_height;
+	m_costs.assign(n, DefaultCost);
+
+	for (int f=0; f<2; f++)
+	{
+		m_fields[f].distance.assign(n, FLT_MAX);
+		m_fields[f].parent.assign(n, -1);
+		m_fields[f].direction.assign(n, Coord2D());
+	}
+
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_wake, NULL);
+
+	if (m_threaded && pthread_create(&m_thread, NULL, threadMain, this) != 0)
+		m_threaded = false;
+}
+
+
+FlowField2D::~FlowField2D()
+{
+	if (m_threaded)
+	{
+		pthread_mutex_lock(&m_mutex);
+		m_quit = true;
+		pthread_cond_signal(&m_wake);
+		pthread_mutex_unlock(&m_mutex);
+
+		pthread_join(m_thread, NULL);
+	}
+
+	pthread_cond_destroy(&m_wake);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+
+void *FlowField2D::threadMain(void *in_self)
+{
+	FlowField2D *self = (FlowField2D*)in_self;
+
+	pthread_mutex_lock(&self->m_mutex);
+
+	for (;;)
+	{
+		while (!self->m_jobPending && !self->m_quit)
+			pthread_cond_wait(&self->m_wake, &self->m_mutex);
+
+		if (self->m_quit)	break;
+
+		self->m_jobPending = false;
+		pthread_mutex_unlock(&self->m_mutex);
+
+		self->build();
+
+		pthread_mutex_lock(&self->m_mutex);
+		self->m_jobDone = true;
+	}
+
+	pthread_mutex_unlock(&self->m_mutex);
+	return NULL;
+}
+
+
+int FlowField2D::cellX(float in_x) const
+{
+	int x = (int)floorf((in_x - m_origin.x) / m_cellSize);
+	return x < 0 ? 0 : (x >= m_width ? m_width-1 : x);
+}
+
+
+int FlowField2D::cellY(float in_y) const
+{
+	int y = (int)floorf((in_y - m_origin.y) / m_cellSize);
+	return y < 0 ? 0 : (y >= m_height ? m_height-1 : y);
+}
+
+
+void FlowField2D::setCost(int in_x, int in_y, int in_cost)
+{
+	if (in_cost < 1)				in_cost = 1;
+	if (in_cost > Impassable)		in_cost = Impassable;
+
+	int cell = in_y*m_width + in_x;
+	if (m_costs[cell] == in_cost)	return;
+
+	if (!m_fullRebuild)
+	{
+		Change c;
+		c.cell = cell;
+		c.oldCost = m_costs[cell];
+		c.newCost = (unsigned char)in_cost;
+		m_changes.push_back(c);
+
+		//Past this, starting over is cheaper than patching
+		if ((int)m_changes.size() > (int)m_costs.size() / 16)
+		{
+			m_fullRebuild = true;
+			m_changes.clear();
+		}
+	}
+
+	m_costs[cell] = (unsigned char)in_cost;
+}
+
+
+void FlowField2D::addGoal(int in_x, int in_y)
+{
+	m_goals.push_back(in_y*m_width + in_x);
+	m_fullRebuild = true;
+}
+
+
+void FlowField2D::clearGoals()
+{
+	m_goals.clear();
+	m_fullRebuild = true;
+}
+
+
+void FlowField2D::rebuild()
+{
+	if (m_busy)
+		m_rebuildRequested = true;
+	else
+		startJob();
+}
+
+
+bool FlowField2D::poll()
+{
+	if (!m_threaded || !m_busy)	return false;
+
+	pthread_mutex_lock(&m_mutex);
+	bool done = m_jobDone;
+	m_jobDone = false;
+	pthread_mutex_unlock(&m_mutex);
+
+	if (!done)	return false;
+
+	m_front = 1 - m_front;
+	m_busy = false;
+
+	if (m_rebuildRequested)
+		startJob();
+
+	return true;
+}
+
+
+void FlowField2D::startJob()
+{
+	m_busy = true;
+	m_rebuildRequested = false;
+
+	pthread_mutex_lock(&m_mutex);
+
+	m_jobCosts = m_costs;
+	m_jobGoals = m_goals;
+	m_jobChanges.swap(m_changes);
+	m_changes.clear();
+	m_jobFull = m_fullRebuild;
+	m_fullRebuild = false;
+
+	if (m_threaded)
+	{
+		m_jobPending = true;
+		pthread_cond_signal(&m_wake);
+		pthread_mutex_unlock(&m_mutex);
+		return;
+	}
+
+	pthread_mutex_unlock(&m_mutex);
+
+	build();
+	m_front = 1 - m_front;
+	m_busy = false;
+}
+
+
+void FlowField2D::build()
+{
+	Field &out = m_fields[1 - m_front];
+
+	if (m_jobFull)
+	{
+		buildFull(out);
+		return;
+	}
+
+	//Start from the fields in use, then patch
+	const Field &in = m_fields[m_front];
+	out.distance = in.distance;
+	out.parent = in.parent;
+	out.direction = in.direction;
+
+	buildIncremental(out);
+}
+
+
+bool FlowField2D::canStep(const unsigned char *in_costs, int in_x, int in_y, int in_n) const
+{
+	int nx = in_x + s_dx[in_n];
+	int ny = in_y + s_dy[in_n];
+
+	if (nx < 0 || nx >= m_width || ny < 0 || ny >= m_height)
+		return false;
+
+	if (in_costs[ny*m_width + nx] == Impassable)
+		return false;
+
+	//Squeezing diagonally between two walls
+	if (in_n >= 4 && (in_costs[in_y*m_width + nx] == Impassable
+					  || in_costs[ny*m_width + in_x] == Impassable))
+		return false;
+
+	return true;
+}
+
+
+void FlowField2D::relax(Field &io_field)
+{
+	const unsigned char *costs = &m_jobCosts[0];
+
+	while (!m_heap.empty())
+	{
+		std::pop_heap(m_heap.begin(), m_heap.end(), HeapOrder());
+		float d = m_heap.back().first;
+		int c = m_heap.back().second;
+		m_heap.pop_back();
+
+		//Stale entry; the cell was improved since
+		if (d > io_field.distance[c])	continue;
+
+		int x = c % m_width;
+		int y = c / m_width;
+
+		for (int k=0; k<8; k++)
+		{
+			if (!canStep(costs, x, y, k))	continue;
+
+			int n = c + s_dy[k]*m_width + s_dx[k];
+			float nd = d + s_len[k] * costs[n];
+
+			if (nd < io_field.distance[n])
+			{
+				io_field.distance[n] = nd;
+				io_field.parent[n] = c;
+				m_touched.push_back(n);
+
+				m_heap.push_back(std::make_pair(nd, n));
+				std::push_heap(m_heap.begin(), m_heap.end(), HeapOrder());
+			}
+		}
+	}
+}
+
+
+void FlowField2D::updateDirection(Field &io_field, int in_cell) const
+{
+	int p = io_field.parent[in_cell];
+
+	if (p < 0)
+	{
+		io_field.direction[in_cell] = Coord2D();
+		return;
+	}
+
+	Coord2D d((float)(p % m_width - in_cell % m_width),
+			  (float)(p / m_width - in_cell / m_width));
+	io_field.direction[in_cell] = d / d.magnitude();
+}
+
+
+void FlowField2D::buildFull(Field &io_field)
+{
+	int n = (int)m_jobCosts.size();
+
+	io_field.distance.assign(n, FLT_MAX);
+	io_field.parent.assign(n, -1);
+
+	m_heap.clear();
+	m_touched.clear();
+
+	for (size_t g=0; g<m_jobGoals.size(); g++)
+	{
+		int c = m_jobGoals[g];
+		if (m_jobCosts[c] == Impassable)	continue;
+
+		io_field.distance[c] = 0;
+		m_heap.push_back(std::make_pair(0.0f, c));
+	}
+
+	std::make_heap(m_heap.begin(), m_heap.end(), HeapOrder());
+	relax(io_field);
+
+	io_field.direction.resize(n);
+	for (int c=0; c<n; c++)
+		updateDirection(io_field, c);
+}
+
+
+void FlowField2D::invalidate(Field &io_field, int in_cell)
+{
+	m_stack.clear();
+	m_stack.push_back(in_cell);
+
+	while (!m_stack.empty())
+	{
+		int c = m_stack.back();
+		m_stack.pop_back();
+
+		if (m_invalid[c])	continue;
+
+		m_invalid[c] = 1;
+		m_touched.push_back(c);
+		io_field.distance[c] = FLT_MAX;
+		io_field.parent[c] = -1;
+
+		//Only neighbours can have this cell as their parent
+		int x = c % m_width;
+		int y = c / m_width;
+
+		for (int k=0; k<8; k++)
+		{
+			int nx = x + s_dx[k];
+			int ny = y + s_dy[k];
+
+			if (nx < 0 || nx >= m_width || ny < 0 || ny >= m_height)
+				continue;
+
+			int n = ny*m_width + nx;
+			if (io_field.parent[n] == c)
+				m_stack.push_back(n);
+		}
+	}
+}
+
+
+void FlowField2D::reseed(Field &io_field, int in_cell)
+{
+	const unsigned char *costs = &m_jobCosts[0];
+	if (costs[in_cell] == Impassable)	return;
+
+	int x = in_cell % m_width;
+	int y = in_cell / m_width;
+
+	float best = io_field.distance[in_cell];
+	int parent = -1;
+
+	for (int k=0; k<8; k++)
+	{
+		//Steps are symmetric, so stepping out tells whether one can step in
+		if (!canStep(costs, x, y, k))	continue;
+
+		int n = in_cell + s_dy[k]*m_width + s_dx[k];
+		if (io_field.distance[n] == FLT_MAX)	continue;
+
+		float d = io_field.distance[n] + s_len[k] * costs[in_cell];
+		if (d < best)
+		{
+			best = d;
+			parent = n;
+		}
+	}
+
+	if (parent < 0)	return;
+
+	io_field.distance[in_cell] = best;
+	io_field.parent[in_cell] = parent;
+	m_touched.push_back(in_cell);
+
+	m_heap.push_back(std::make_pair(best, in_cell));
+	std::push_heap(m_heap.begin(), m_heap.end(), HeapOrder());
+}
+
+
+void FlowField2D::buildIncremental(Field &io_field)
+{
+	m_invalid.assign(m_jobCosts.size(), 0);
+	m_touched.clear();
+	m_heap.clear();
+
+	//Dearer cells: forget every path that went through them
+	for (size_t i=0; i<m_jobChanges.size(); i++)
+	{
+		const Change &ch = m_jobChanges[i];
+		if (ch.newCost <= ch.oldCost)	continue;
+
+		invalidate(io_field, ch.cell);
+
+		if (ch.newCost != Impassable)	continue;
+
+		//A new wall also blocks diagonal steps squeezing past its corner
+		int cx = ch.cell % m_width;
+		int cy = ch.cell / m_width;
+
+		for (int k=0; k<8; k++)
+		{
+			int nx = cx + s_dx[k];
+			int ny = cy + s_dy[k];
+
+			if (nx < 0 || nx >= m_width || ny < 0 || ny >= m_height)
+				continue;
+
+			int n = ny*m_width + nx;
+			int p = io_field.parent[n];
+			if (p < 0)	continue;
+
+			int px = p % m_width;
+			int py = p / m_width;
+
+			if (px != nx && py != ny
+				&& (py*m_width + nx == ch.cell || ny*m_width + px == ch.cell))
+				invalidate(io_field, n);
+		}
+	}
+
+	//Goals may have been invalidated (or were walls until now)
+	for (size_t g=0; g<m_jobGoals.size(); g++)
+	{
+		int c = m_jobGoals[g];
+
+		if (m_jobCosts[c] == Impassable || io_field.distance[c] == 0)
+			continue;
+
+		io_field.distance[c] = 0;
+		io_field.parent[c] = -1;
+		m_touched.push_back(c);
+
+		m_heap.push_back(std::make_pair(0.0f, c));
+		std::push_heap(m_heap.begin(), m_heap.end(), HeapOrder());
+	}
+
+	//Forgotten cells pick the best of the neighbours that were not
+	for (size_t i=0; i<m_touched.size(); i++)
+	{
+		if (m_invalid[m_touched[i]])
+			reseed(io_field, m_touched[i]);
+	}
+
+	//Cheaper cells may offer shortcuts, to themselves and (no longer being
+	//	walls) to diagonal steps between their neighbours
+	for (size_t i=0; i<m_jobChanges.size(); i++)
+	{
+		const Change &ch = m_jobChanges[i];
+		if (ch.newCost >= ch.oldCost)	continue;
+
+		reseed(io_field, ch.cell);
+
+		int cx = ch.cell % m_width;
+		int cy = ch.cell / m_width;
+
+		for (int k=0; k<8; k++)
+		{
+			int nx = cx + s_dx[k];
+			int ny = cy + s_dy[k];
+
+			if (nx >= 0 && nx < m_width && ny >= 0 && ny < m_height)
+				reseed(io_field, ny*m_width + nx);
+		}
+	}
+
+	relax(io_field);
+
+	for (size_t i=0; i<m_touched.size(); i++)
+		updateDirection(io_field, m_touched[i]);
+}
+
+
+Coord2D FlowField2D::steeringForce(const Coord2D in_position, const Coord2D in_velocity,
+								   float in_maxSpeed, float in_maxForce) const
+{
+	//Turning around at full speed takes twice the maximum force
+	Coord2D desired = direction(in_position) * in_maxSpeed;
+	Coord2D force = (desired - in_velocity) * (in_maxForce / in_maxSpeed);
+
+	float len2 = dot(force, force);
+	if (len2 > in_maxForce * in_maxForce)
+		force = force * (in_maxForce / sqrtf(len2));
+
+	return force;
+}
+
+
+void FlowField2D::steer(Sphere2DWorld *io_world, const int *in_handles, int in_count,
+						float in_maxSpeed, float in_maxForce) const
+{
+	for (int i=0; i<in_count; i++)
+	{
+		Sphere2D &b = io_world->body(in_handles[i]);
+		b.addForce(steeringForce(b.position(), b.velocity(), in_maxSpeed, in_maxForce));
+	}
+}
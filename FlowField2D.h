@@ -0,0 +1,258 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef FLOWFIELD2D_H
+#define FLOWFIELD2D_H
+
+#include <pthread.h>
+#include <vector>
+#include "Coord2D.h"
+
+class Sphere2DWorld;
+
+/*!	\file	FlowField2D.h
+	\brief	Pathfinding for swarms: one field that every agent follows.
+
+	Rather than searching a path per agent, the level is divided into a grid
+	of cells that each have a cost to cross.  From the goals, a Dijkstra
+	search gives every cell its cost to reach the nearest goal (the
+	integration field) and the direction of the next cell on the way there
+	(the direction field).  An agent anywhere only needs to look up the
+	cell it is in.
+
+	\code
+FlowField2D field(128, 128, 16, Coord2D(0,0));
+field.setCost(x, y, FlowField2D::Impassable);	//for each wall cell
+field.addGoal(field.cellX(player.x), field.cellY(player.y));
+field.rebuild();
+
+//Each frame
+field.poll();
+for (int i=0; i<swarm; i++)
+{
+	Sphere2D &b = world.body(handles[i]);
+	b.addForce(field.steeringForce(b.position(), b.velocity(), 40, 80));
+}
+	\endcode
+
+	Fields are double buffered.  rebuild() hands the work to a thread of its
+	own; the previous field remains in use until poll() notices that the new
+	one is ready.  When only a few costs changed since the last rebuild, only
+	the cells whose path went through them are recomputed.
+*/
+class FlowField2D
+{
+public:
+	enum
+	{
+		Impassable		= 255,		//!< Cost of a cell that cannot be entered
+		DefaultCost		= 1			//!< Cost of every cell at first
+	};
+
+private:
+	//! Integration and direction of every cell
+	struct Field
+	{
+		//! Cost to the nearest goal (FLT_MAX when unreachable)
+		std::vector<float>		distance;
+
+		//! Next cell towards the goal (-1 for goals and unreachable cells)
+		std::vector<int>		parent;
+
+		//! Unit direction towards parent (0 for goals and unreachable cells)
+		std::vector<Coord2D>	direction;
+	};
+
+	//! A cost changed since the last rebuild
+	struct Change
+	{
+		int				cell;
+		unsigned char	oldCost;
+		unsigned char	newCost;
+	};
+
+	//! Size of the grid, in cells
+	int							m_width, m_height;
+
+	//! Size of a cell
+	float						m_cellSize;
+
+	//! Corner of cell (0,0)
+	Coord2D						m_origin;
+
+	//! Cost of entering each cell (1 ... Impassable)
+	std::vector<unsigned char>	m_costs;
+
+	//! Goal cells
+	std::vector<int>			m_goals;
+
+	//! Costs changed since the last rebuild
+	std::vector<Change>			m_changes;
+
+	//! Do the changes require a full rebuild (goals moved, never built...)
+	bool						m_fullRebuild;
+
+	//! The two fields; m_fields[m_front] is sampled
+	Field						m_fields[2];
+	int							m_front;
+
+	//! Run rebuilds on m_thread?
+	bool						m_threaded;
+
+	//! The builder thread
+	pthread_t					m_thread;
+
+	//! Guards everything used by both threads
+	pthread_mutex_t				m_mutex;
+
+	//! Signalled when there is work for the builder (or on quit)
+	pthread_cond_t				m_wake;
+
+	//! Work handed to the builder
+	bool						m_jobPending;
+
+	//! The builder finished; poll() may swap
+	bool						m_jobDone;
+
+	//! Tells the builder to exit
+	bool						m_quit;
+
+	//! A rebuild is in progress (main thread only)
+	bool						m_busy;
+
+	//! Another rebuild was asked for while busy (main thread only)
+	bool						m_rebuildRequested;
+
+	//! Snapshot of the costs, goals and changes the builder works on
+	std::vector<unsigned char>	m_jobCosts;
+	std::vector<int>			m_jobGoals;
+	std::vector<Change>			m_jobChanges;
+	bool						m_jobFull;
+
+	//! Builder scratch
+	std::vector<std::pair<float,int> >	m_heap;
+	std::vector<int>			m_stack;
+	std::vector<int>			m_touched;
+	std::vector<unsigned char>	m_invalid;
+
+	//! Thread entry point
+	static void *threadMain(void *in_self);
+
+	//! Snapshot the state and hand it to the builder (or build it right away)
+	void startJob();
+
+	//! Build m_fields[!m_front] from the job
+	void build();
+
+	//! Dijkstra from every goal
+	void buildFull(Field &io_field);
+
+	//! Recompute the cells affected by the job's changes
+	void buildIncremental(Field &io_field);
+
+	//! Mark in_cell and every cell whose path goes through it as unreachable
+	void invalidate(Field &io_field, int in_cell);
+
+	//! Best distance of a cell from its neighbours; queued if improved
+	void reseed(Field &io_field, int in_cell);
+
+	//! Dijkstra from the queued cells
+	void relax(Field &io_field);
+
+	//! Recompute the direction of a cell from its parent
+	void updateDirection(Field &io_field, int in_cell) const;
+
+	//! May one step from cell (x,y) by neighbour n? (no cutting corners)
+	bool canStep(const unsigned char *in_costs, int in_x, int in_y, int in_n) const;
+
+	//! Prevent copies
+	FlowField2D(const FlowField2D &)	{}
+
+public:
+	//! A grid where every cell costs DefaultCost
+	/*!	\param in_width		Cells across
+		\param in_height	Cells down
+		\param in_cellSize	Size of a cell
+		\param in_origin	Corner of cell (0,0)
+		\param in_threaded	Rebuild on a thread of its own?	*/
+	FlowField2D(int in_width, int in_height, float in_cellSize,
+				const Coord2D in_origin = Coord2D(), bool in_threaded = true);
+
+	//! Stops the builder thread
+	~FlowField2D();
+
+	//! Cells across
+	int width() const						{	return m_width;			}
+
+	//! Cells down
+	int height() const						{	return m_height;		}
+
+	//! Column of a position (clamped to the grid)
+	int cellX(float in_x) const;
+
+	//! Row of a position (clamped to the grid)
+	int cellY(float in_y) const;
+
+	//! Set the cost of entering a cell (1 ... Impassable)
+	/*!	Takes effect at the next rebuild().	*/
+	void setCost(int in_x, int in_y, int in_cost);
+
+	//! Cost of entering a cell
+	int cost(int in_x, int in_y) const		{	return m_costs[in_y*m_width + in_x];	}
+
+	//! Add a goal cell
+	void addGoal(int in_x, int in_y);
+
+	//! Remove all goals
+	void clearGoals();
+
+	//! Recompute the fields from the current costs and goals
+	/*!	Threaded, the new fields are only used once poll() sees them ready.	*/
+	void rebuild();
+
+	//! Swap in a finished rebuild (call once per frame when threaded)
+	/*!	\return	true if the fields changed	*/
+	bool poll();
+
+	//! Is a rebuild running?
+	bool isBuilding() const					{	return m_busy;			}
+
+	//! Direction towards the nearest goal (0 at goals and where unreachable)
+	inline Coord2D direction(const Coord2D in_position) const
+	{
+		return m_fields[m_front].direction[cellY(in_position.y)*m_width + cellX(in_position.x)];
+	}
+
+	//! Cost to reach the nearest goal (FLT_MAX where unreachable)
+	inline float distance(const Coord2D in_position) const
+	{
+		return m_fields[m_front].distance[cellY(in_position.y)*m_width + cellX(in_position.x)];
+	}
+
+	//! Force for Sphere2D::addForce that steers along the field
+	/*!	\param in_position	Where the body is
+		\param in_velocity	Its velocity
+		\param in_maxSpeed	Speed it should reach
+		\param in_maxForce	Longest force returned	*/
+	Coord2D steeringForce(const Coord2D in_position, const Coord2D in_velocity,
+						  float in_maxSpeed, float in_maxForce) const;
+
+	//! Add the steering force to bodies of a world
+	void steer(Sphere2DWorld *io_world, const int *in_handles, int in_count,
+			   float in_maxSpeed, float in_maxForce) const;
+};
+
+#endif
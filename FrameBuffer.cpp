@@ -19,6 +19,8 @@
 #include "Immediate.h"
 #include "TextureManager.h"
 #include "GPUExtensions.h"
+#include "GPUState.h"
+#include "GPUBackend.h"
 
 
 #include <OpenGLES/ES2/gl.h>
@@ -36,16 +38,16 @@ static FrameBuffer *g_curFB = NULL;
 
 void FrameBuffer::lazyInit()
 {
-	glGenTextures(1, &m_texID);
-	glGenFramebuffers(1, &m_fbID);
+	GPU::backend().genTextures(1, &m_texID);
+	GPU::backend().genFramebuffers(1, &m_fbID);
 	
 	BindTexture bt(this);
 	
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	
 	if (GPU::Support::NPOT())
 	{
@@ -72,15 +74,15 @@ void FrameBuffer::lazyInit()
 		m_pot.y++;
 	}
 	
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_pot.x, m_pot.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	GPU::backend().texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_pot.x, m_pot.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 	
-	glBindFramebuffer(GL_FRAMEBUFFER, m_fbID);
+	GPU::State::bindFramebuffer(m_fbID);
 	
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texID, 0);
+	GPU::backend().framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texID, 0);
 	
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	if (GPU::backend().checkFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	{
-		printf("failed to make complete framebuffer object %x\n", glCheckFramebufferStatus(GL_FRAMEBUFFER));
+		printf("failed to make complete framebuffer object %x\n", GPU::backend().checkFramebufferStatus(GL_FRAMEBUFFER));
 		throw "Failed creating frame buffer object";
 	}
 	
@@ -99,26 +101,26 @@ FrameBuffer::FrameBuffer(GLuint in_renderBuffer)
 	assert(g_curFB == NULL);
 	g_curFB = this;
 
-	glGenFramebuffers(1, &m_fbID);
-	glBindFramebuffer(GL_FRAMEBUFFER, m_fbID);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER_OES, in_renderBuffer);
+	GPU::backend().genFramebuffers(1, &m_fbID);
+	GPU::State::bindFramebuffer(m_fbID);
+	GPU::backend().framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER_OES, in_renderBuffer);
 	
 	int width, height;
-	glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
-	glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
+	GPU::backend().getRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
+	GPU::backend().getRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
 	
 	m_size.x = width;
 	m_size.y = height;
 	
 	m_pot = m_size;
 	
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	if (GPU::backend().checkFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	{
-		printf("failed to make complete framebuffer object %x\n", glCheckFramebufferStatus(GL_FRAMEBUFFER));
+		printf("failed to make complete framebuffer object %x\n", GPU::backend().checkFramebufferStatus(GL_FRAMEBUFFER));
 		throw "Failed creating frame buffer object";
 	}
 	
-	glViewport(0, 0, m_size.x, m_size.y);
+	GPU::State::viewport(0, 0, m_size.x, m_size.y);
 	
 	//gl.specifyDeviceSize(m_width, m_height);
 }
@@ -128,16 +130,18 @@ void FrameBuffer::downloadFrameBuffer(int8_t *out_dest)
 {
 	assert(g_curFB != NULL);
 	
+	gliCurrent().flush();
+	
 	if (this != g_curFB)
 	{
 		RenderToTarget t(this);
-		glReadPixels(	0,0, m_size.x, m_size.y, GL_RGBA,
+		GPU::backend().readPixels(	0,0, m_size.x, m_size.y, GL_RGBA,
 						GL_UNSIGNED_BYTE,
 						out_dest);
 	}
 	else
 	{
-		glReadPixels(	0,0, m_size.x, m_size.y, GL_RGBA,
+		GPU::backend().readPixels(	0,0, m_size.x, m_size.y, GL_RGBA,
 						GL_UNSIGNED_BYTE,
 						out_dest);
 	}
@@ -153,10 +157,16 @@ FrameBuffer::~FrameBuffer()
 	}
 	
 	if (m_texID != 0)
-		glDeleteTextures(1, &m_texID);
+	{
+		GPU::State::forgetTexture(m_texID);
+		GPU::backend().deleteTextures(1, &m_texID);
+	}
 	
 	if (m_fbID != 0)
-		glDeleteFramebuffers(1, &m_fbID);
+	{
+		GPU::State::forgetFramebuffer(m_fbID);
+		GPU::backend().deleteFramebuffers(1, &m_fbID);
+	}
 }
 
 
@@ -165,22 +175,26 @@ FrameBuffer::~FrameBuffer()
 
 RenderToTarget::RenderToTarget(FrameBuffer *in_fb)
 {
+	gliCurrent().flush();
+	
 	m_prev = g_curFB;
 	g_curFB = in_fb;
 	
 	if (in_fb->m_fbID == 0)
 		in_fb->lazyInit();
 	else
-		glBindFramebuffer(GL_FRAMEBUFFER, in_fb->m_fbID);
+		GPU::State::bindFramebuffer(in_fb->m_fbID);
 	
-	glViewport(0,0,in_fb->m_size.x, in_fb->m_size.y);
+	GPU::State::viewport(0,0,in_fb->m_size.x, in_fb->m_size.y);
 }
 
 
 RenderToTarget::~RenderToTarget()
 {
+	gliCurrent().flush();
+	
 	g_curFB = m_prev;
 	
-	glBindFramebuffer(GL_FRAMEBUFFER, m_prev->m_fbID);
-	glViewport(0, 0, m_prev->m_size.x, m_prev->m_size.y);
+	GPU::State::bindFramebuffer(m_prev->m_fbID);
+	GPU::State::viewport(0, 0, m_prev->m_size.x, m_prev->m_size.y);
 }
@@ -17,8 +17,10 @@
 #ifndef FRAMEBUFFER_H
 #define FRAMEBUFFER_H
 
+#ifndef GPU_HEADLESS
 #include <OpenGLES/ES1/gl.h>
 #include <OpenGLES/ES1/glext.h>
+#endif
 
 #include "Immediate.h"
 #include "Coord2D.h"
@@ -0,0 +1,513 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#include "GPUBackend.h"
+#include "GPUState.h"
+#include "GPUExtensions.h"
+
+#ifndef GPU_HEADLESS
+#include <OpenGLES/ES1/gl.h>
+#include <OpenGLES/ES2/glext.h>
+#endif
+
+#include <stddef.h>
+
+namespace GPU
+{
+#ifndef GPU_HEADLESS
+	static GLBackend g_glBackend;
+
+	//! Where calls go (NULL until a backend is set, in headless builds)
+	static IBackend *g_backend = &g_glBackend;
+#else
+	static IBackend *g_backend = NULL;
+#endif
+
+
+	IBackend &backend()
+	{
+#ifdef GPU_HEADLESS
+		if (g_backend == NULL)
+			throw "GPU::backend::No backend set";
+#endif
+		return *g_backend;
+	}
+
+
+	void setBackend(IBackend *in_backend)
+	{
+#ifndef GPU_HEADLESS
+		if (in_backend == NULL)
+			in_backend = &g_glBackend;
+#endif
+		g_backend = in_backend;
+		State::invalidate();
+		Support::invalidate();
+	}
+
+
+
+#ifndef GPU_HEADLESS
+	void GLBackend::enable(GLenum in_cap)
+	{
+		glEnable(in_cap);
+	}
+
+
+	void GLBackend::disable(GLenum in_cap)
+	{
+		glDisable(in_cap);
+	}
+
+
+	void GLBackend::enableClientState(GLenum in_array)
+	{
+		glEnableClientState(in_array);
+	}
+
+
+	void GLBackend::disableClientState(GLenum in_array)
+	{
+		glDisableClientState(in_array);
+	}
+
+
+	void GLBackend::enableVertexAttribArray(GLuint in_index)
+	{
+		glEnableVertexAttribArray(in_index);
+	}
+
+
+	void GLBackend::disableVertexAttribArray(GLuint in_index)
+	{
+		glDisableVertexAttribArray(in_index);
+	}
+
+
+	void GLBackend::blendFunc(GLenum in_src, GLenum in_dst)
+	{
+		glBlendFunc(in_src, in_dst);
+	}
+
+
+	void GLBackend::viewport(GLint in_x, GLint in_y, GLsizei in_width,
+						GLsizei in_height)
+	{
+		glViewport(in_x, in_y, in_width, in_height);
+	}
+
+
+	void GLBackend::scissor(GLint in_x, GLint in_y, GLsizei in_width,
+						GLsizei in_height)
+	{
+		glScissor(in_x, in_y, in_width, in_height);
+	}
+
+
+	void GLBackend::activeTexture(GLenum in_unit)
+	{
+		glActiveTexture(in_unit);
+	}
+
+
+	void GLBackend::bindTexture(GLenum in_target, GLuint in_texture)
+	{
+		glBindTexture(in_target, in_texture);
+	}
+
+
+	void GLBackend::bindFramebuffer(GLenum in_target, GLuint in_framebuffer)
+	{
+		glBindFramebuffer(in_target, in_framebuffer);
+	}
+
+
+	void GLBackend::bindBuffer(GLenum in_target, GLuint in_buffer)
+	{
+		glBindBuffer(in_target, in_buffer);
+	}
+
+
+	void GLBackend::useProgram(GLuint in_program)
+	{
+		glUseProgram(in_program);
+	}
+
+
+	void GLBackend::matrixMode(GLenum in_mode)
+	{
+		glMatrixMode(in_mode);
+	}
+
+
+	void GLBackend::loadIdentity()
+	{
+		glLoadIdentity();
+	}
+
+
+	void GLBackend::pushMatrix()
+	{
+		glPushMatrix();
+	}
+
+
+	void GLBackend::popMatrix()
+	{
+		glPopMatrix();
+	}
+
+
+	void GLBackend::translatef(GLfloat in_x, GLfloat in_y, GLfloat in_z)
+	{
+		glTranslatef(in_x, in_y, in_z);
+	}
+
+
+	void GLBackend::scalef(GLfloat in_x, GLfloat in_y, GLfloat in_z)
+	{
+		glScalef(in_x, in_y, in_z);
+	}
+
+
+	void GLBackend::multMatrixf(const GLfloat *in_m)
+	{
+		glMultMatrixf(in_m);
+	}
+
+
+	void GLBackend::vertexPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+						const GLvoid *in_pointer)
+	{
+		glVertexPointer(in_size, in_type, in_stride, in_pointer);
+	}
+
+
+	void GLBackend::colorPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+						const GLvoid *in_pointer)
+	{
+		glColorPointer(in_size, in_type, in_stride, in_pointer);
+	}
+
+
+	void GLBackend::texCoordPointer(GLint in_size, GLenum in_type,
+						GLsizei in_stride, const GLvoid *in_pointer)
+	{
+		glTexCoordPointer(in_size, in_type, in_stride, in_pointer);
+	}
+
+
+	void GLBackend::vertexAttribPointer(GLuint in_index, GLint in_size,
+						GLenum in_type, GLboolean in_normalized, GLsizei in_stride,
+						const GLvoid *in_pointer)
+	{
+		glVertexAttribPointer(in_index, in_size, in_type, in_normalized, in_stride,
+						in_pointer);
+	}
+
+
+	void GLBackend::vertexAttrib4f(GLuint in_index, GLfloat in_x, GLfloat in_y,
+						GLfloat in_z, GLfloat in_w)
+	{
+		glVertexAttrib4f(in_index, in_x, in_y, in_z, in_w);
+	}
+
+
+	void GLBackend::vertexAttribDivisor(GLuint in_index, GLuint in_divisor)
+	{
+		glVertexAttribDivisorEXT(in_index, in_divisor);
+	}
+
+
+	void GLBackend::drawArrays(GLenum in_mode, GLint in_first, GLsizei in_count)
+	{
+		glDrawArrays(in_mode, in_first, in_count);
+	}
+
+
+	void GLBackend::drawElements(GLenum in_mode, GLsizei in_count, GLenum in_type,
+						const GLvoid *in_indices)
+	{
+		glDrawElements(in_mode, in_count, in_type, in_indices);
+	}
+
+
+	void GLBackend::drawArraysInstanced(GLenum in_mode, GLint in_first,
+						GLsizei in_count, GLsizei in_instances)
+	{
+		glDrawArraysInstancedEXT(in_mode, in_first, in_count, in_instances);
+	}
+
+
+	void GLBackend::readPixels(GLint in_x, GLint in_y, GLsizei in_width,
+						GLsizei in_height, GLenum in_format, GLenum in_type,
+						GLvoid *out_pixels)
+	{
+		glReadPixels(in_x, in_y, in_width, in_height, in_format, in_type,
+						out_pixels);
+	}
+
+
+	void GLBackend::genBuffers(GLsizei in_n, GLuint *out_buffers)
+	{
+		glGenBuffers(in_n, out_buffers);
+	}
+
+
+	void GLBackend::deleteBuffers(GLsizei in_n, const GLuint *in_buffers)
+	{
+		glDeleteBuffers(in_n, in_buffers);
+	}
+
+
+	void GLBackend::bufferData(GLenum in_target, GLsizeiptr in_size,
+						const GLvoid *in_data, GLenum in_usage)
+	{
+		glBufferData(in_target, in_size, in_data, in_usage);
+	}
+
+
+	void GLBackend::bufferSubData(GLenum in_target, GLintptr in_offset,
+						GLsizeiptr in_size, const GLvoid *in_data)
+	{
+		glBufferSubData(in_target, in_offset, in_size, in_data);
+	}
+
+
+	void GLBackend::genTextures(GLsizei in_n, GLuint *out_textures)
+	{
+		glGenTextures(in_n, out_textures);
+	}
+
+
+	void GLBackend::deleteTextures(GLsizei in_n, const GLuint *in_textures)
+	{
+		glDeleteTextures(in_n, in_textures);
+	}
+
+
+	void GLBackend::texParameteri(GLenum in_target, GLenum in_name, GLint in_value)
+	{
+		glTexParameteri(in_target, in_name, in_value);
+	}
+
+
+	void GLBackend::texImage2D(GLenum in_target, GLint in_level,
+						GLint in_internalFormat, GLsizei in_width,
+						GLsizei in_height, GLint in_border, GLenum in_format,
+						GLenum in_type, const GLvoid *in_pixels)
+	{
+		glTexImage2D(in_target, in_level, in_internalFormat, in_width, in_height,
+						in_border, in_format, in_type, in_pixels);
+	}
+
+
+	void GLBackend::texSubImage2D(GLenum in_target, GLint in_level, GLint in_x,
+						GLint in_y, GLsizei in_width, GLsizei in_height,
+						GLenum in_format, GLenum in_type, const GLvoid *in_pixels)
+	{
+		glTexSubImage2D(in_target, in_level, in_x, in_y, in_width, in_height,
+						in_format, in_type, in_pixels);
+	}
+
+
+	void GLBackend::genFramebuffers(GLsizei in_n, GLuint *out_framebuffers)
+	{
+		glGenFramebuffers(in_n, out_framebuffers);
+	}
+
+
+	void GLBackend::deleteFramebuffers(GLsizei in_n, const GLuint *in_framebuffers)
+	{
+		glDeleteFramebuffers(in_n, in_framebuffers);
+	}
+
+
+	void GLBackend::framebufferTexture2D(GLenum in_target, GLenum in_attachment,
+						GLenum in_textureTarget, GLuint in_texture, GLint in_level)
+	{
+		glFramebufferTexture2D(in_target, in_attachment, in_textureTarget,
+						in_texture, in_level);
+	}
+
+
+	void GLBackend::framebufferRenderbuffer(GLenum in_target, GLenum in_attachment,
+						GLenum in_renderbufferTarget, GLuint in_renderbuffer)
+	{
+		glFramebufferRenderbuffer(in_target, in_attachment, in_renderbufferTarget,
+						in_renderbuffer);
+	}
+
+
+	GLenum GLBackend::checkFramebufferStatus(GLenum in_target)
+	{
+		return glCheckFramebufferStatus(in_target);
+	}
+
+
+	void GLBackend::getRenderbufferParameteriv(GLenum in_target, GLenum in_name,
+						GLint *out_value)
+	{
+		glGetRenderbufferParameteriv(in_target, in_name, out_value);
+	}
+
+
+	GLuint GLBackend::createShader(GLenum in_type)
+	{
+		return glCreateShader(in_type);
+	}
+
+
+	void GLBackend::deleteShader(GLuint in_shader)
+	{
+		glDeleteShader(in_shader);
+	}
+
+
+	void GLBackend::shaderSource(GLuint in_shader, GLsizei in_count,
+						const GLchar **in_strings, const GLint *in_lengths)
+	{
+		glShaderSource(in_shader, in_count, in_strings, in_lengths);
+	}
+
+
+	void GLBackend::compileShader(GLuint in_shader)
+	{
+		glCompileShader(in_shader);
+	}
+
+
+	void GLBackend::getShaderiv(GLuint in_shader, GLenum in_name, GLint *out_value)
+	{
+		glGetShaderiv(in_shader, in_name, out_value);
+	}
+
+
+	void GLBackend::getShaderInfoLog(GLuint in_shader, GLsizei in_size,
+						GLsizei *out_length, GLchar *out_log)
+	{
+		glGetShaderInfoLog(in_shader, in_size, out_length, out_log);
+	}
+
+
+	GLuint GLBackend::createProgram()
+	{
+		return glCreateProgram();
+	}
+
+
+	void GLBackend::deleteProgram(GLuint in_program)
+	{
+		glDeleteProgram(in_program);
+	}
+
+
+	void GLBackend::attachShader(GLuint in_program, GLuint in_shader)
+	{
+		glAttachShader(in_program, in_shader);
+	}
+
+
+	void GLBackend::linkProgram(GLuint in_program)
+	{
+		glLinkProgram(in_program);
+	}
+
+
+	void GLBackend::validateProgram(GLuint in_program)
+	{
+		glValidateProgram(in_program);
+	}
+
+
+	void GLBackend::getProgramiv(GLuint in_program, GLenum in_name,
+						GLint *out_value)
+	{
+		glGetProgramiv(in_program, in_name, out_value);
+	}
+
+
+	void GLBackend::getProgramInfoLog(GLuint in_program, GLsizei in_size,
+						GLsizei *out_length, GLchar *out_log)
+	{
+		glGetProgramInfoLog(in_program, in_size, out_length, out_log);
+	}
+
+
+	GLint GLBackend::getAttribLocation(GLuint in_program, const GLchar *in_name)
+	{
+		return glGetAttribLocation(in_program, in_name);
+	}
+
+
+	GLint GLBackend::getUniformLocation(GLuint in_program, const GLchar *in_name)
+	{
+		return glGetUniformLocation(in_program, in_name);
+	}
+
+
+	void GLBackend::uniform1i(GLint in_location, GLint in_x)
+	{
+		glUniform1i(in_location, in_x);
+	}
+
+
+	void GLBackend::uniform1f(GLint in_location, GLfloat in_x)
+	{
+		glUniform1f(in_location, in_x);
+	}
+
+
+	void GLBackend::uniform2f(GLint in_location, GLfloat in_x, GLfloat in_y)
+	{
+		glUniform2f(in_location, in_x, in_y);
+	}
+
+
+	void GLBackend::uniform3f(GLint in_location, GLfloat in_x, GLfloat in_y,
+						GLfloat in_z)
+	{
+		glUniform3f(in_location, in_x, in_y, in_z);
+	}
+
+
+	void GLBackend::uniform4f(GLint in_location, GLfloat in_x, GLfloat in_y,
+						GLfloat in_z, GLfloat in_w)
+	{
+		glUniform4f(in_location, in_x, in_y, in_z, in_w);
+	}
+
+
+	void GLBackend::uniformMatrix2fv(GLint in_location, GLsizei in_count,
+						GLboolean in_transpose, const GLfloat *in_m)
+	{
+		glUniformMatrix2fv(in_location, in_count, in_transpose, in_m);
+	}
+
+
+	void GLBackend::uniformMatrix3fv(GLint in_location, GLsizei in_count,
+						GLboolean in_transpose, const GLfloat *in_m)
+	{
+		glUniformMatrix3fv(in_location, in_count, in_transpose, in_m);
+	}
+
+
+	const GLubyte * GLBackend::getString(GLenum in_name)
+	{
+		return glGetString(in_name);
+	}
+#endif
+};
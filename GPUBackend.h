@@ -0,0 +1,294 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#ifndef BubblePod_GPUBackend_h
+#define BubblePod_GPUBackend_h
+
+#include "GPUTypes.h"
+
+/*!	\file	GPUBackend.h
+	\brief	What the library calls instead of the GL.
+
+	gli, GPU::State, the buffers, shaders, textures and frame buffers never
+	call a GL entry point themselves: they call the same function, without
+	the gl prefix, on backend().  By default that is a GLBackend, which
+	hands every call to the GL as is.
+
+	Another backend may be put in its place with setBackend(), before
+	anything is drawn or created.  GPU::RecordingBackend (see
+	GPURecordingBackend.h) needs no GPU: it checks the calls and logs them,
+	so that what the library submits can be measured on a machine without
+	one.
+
+	Builds made for such machines define GPU_HEADLESS: GLBackend is then
+	left out (along with the need to link a GL, or to have its headers: see
+	GPUTypes.h), and a backend must be set before the library is used.
+	Benchmark/GPUBenchmark.cpp is such a build.
+
+	Only the entry points the library uses are part of the interface.
+ */
+
+namespace GPU
+{
+	//! The GL entry points the library uses
+	class IBackend
+	{
+	public:
+		virtual ~IBackend()	{}
+
+		//State...
+		virtual void enable(GLenum in_cap)												= 0;
+		virtual void disable(GLenum in_cap)												= 0;
+		virtual void enableClientState(GLenum in_array)									= 0;
+		virtual void disableClientState(GLenum in_array)								= 0;
+		virtual void enableVertexAttribArray(GLuint in_index)							= 0;
+		virtual void disableVertexAttribArray(GLuint in_index)							= 0;
+		virtual void blendFunc(GLenum in_src, GLenum in_dst)							= 0;
+		virtual void viewport(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height)	= 0;
+		virtual void scissor(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height)	= 0;
+		virtual void activeTexture(GLenum in_unit)										= 0;
+		virtual void bindTexture(GLenum in_target, GLuint in_texture)					= 0;
+		virtual void bindFramebuffer(GLenum in_target, GLuint in_framebuffer)			= 0;
+		virtual void bindBuffer(GLenum in_target, GLuint in_buffer)						= 0;
+		virtual void useProgram(GLuint in_program)										= 0;
+
+		//Fixed function matrices (OpenGL ES 1x)...
+		virtual void matrixMode(GLenum in_mode)											= 0;
+		virtual void loadIdentity()														= 0;
+		virtual void pushMatrix()														= 0;
+		virtual void popMatrix()														= 0;
+		virtual void translatef(GLfloat in_x, GLfloat in_y, GLfloat in_z)				= 0;
+		virtual void scalef(GLfloat in_x, GLfloat in_y, GLfloat in_z)					= 0;
+		virtual void multMatrixf(const GLfloat *in_m)									= 0;
+
+		//Vertex arrays...
+		virtual void vertexPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+								   const GLvoid *in_pointer)							= 0;
+		virtual void colorPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+								  const GLvoid *in_pointer)								= 0;
+		virtual void texCoordPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+									 const GLvoid *in_pointer)							= 0;
+		virtual void vertexAttribPointer(GLuint in_index, GLint in_size, GLenum in_type,
+										 GLboolean in_normalized, GLsizei in_stride,
+										 const GLvoid *in_pointer)						= 0;
+		virtual void vertexAttrib4f(GLuint in_index, GLfloat in_x, GLfloat in_y,
+									GLfloat in_z, GLfloat in_w)							= 0;
+		virtual void vertexAttribDivisor(GLuint in_index, GLuint in_divisor)			= 0;
+
+		//Drawing...
+		virtual void drawArrays(GLenum in_mode, GLint in_first, GLsizei in_count)		= 0;
+		virtual void drawElements(GLenum in_mode, GLsizei in_count, GLenum in_type,
+								  const GLvoid *in_indices)								= 0;
+		virtual void drawArraysInstanced(GLenum in_mode, GLint in_first, GLsizei in_count,
+										 GLsizei in_instances)							= 0;
+		virtual void readPixels(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height,
+								GLenum in_format, GLenum in_type, GLvoid *out_pixels)	= 0;
+
+		//Buffers...
+		virtual void genBuffers(GLsizei in_n, GLuint *out_buffers)						= 0;
+		virtual void deleteBuffers(GLsizei in_n, const GLuint *in_buffers)				= 0;
+		virtual void bufferData(GLenum in_target, GLsizeiptr in_size,
+								const GLvoid *in_data, GLenum in_usage)					= 0;
+		virtual void bufferSubData(GLenum in_target, GLintptr in_offset,
+								   GLsizeiptr in_size, const GLvoid *in_data)			= 0;
+
+		//Textures...
+		virtual void genTextures(GLsizei in_n, GLuint *out_textures)					= 0;
+		virtual void deleteTextures(GLsizei in_n, const GLuint *in_textures)			= 0;
+		virtual void texParameteri(GLenum in_target, GLenum in_name, GLint in_value)	= 0;
+		virtual void texImage2D(GLenum in_target, GLint in_level, GLint in_internalFormat,
+								GLsizei in_width, GLsizei in_height, GLint in_border,
+								GLenum in_format, GLenum in_type,
+								const GLvoid *in_pixels)								= 0;
+		virtual void texSubImage2D(GLenum in_target, GLint in_level,
+								   GLint in_x, GLint in_y,
+								   GLsizei in_width, GLsizei in_height,
+								   GLenum in_format, GLenum in_type,
+								   const GLvoid *in_pixels)								= 0;
+
+		//Frame buffers...
+		virtual void genFramebuffers(GLsizei in_n, GLuint *out_framebuffers)			= 0;
+		virtual void deleteFramebuffers(GLsizei in_n, const GLuint *in_framebuffers)	= 0;
+		virtual void framebufferTexture2D(GLenum in_target, GLenum in_attachment,
+										  GLenum in_textureTarget, GLuint in_texture,
+										  GLint in_level)								= 0;
+		virtual void framebufferRenderbuffer(GLenum in_target, GLenum in_attachment,
+											 GLenum in_renderbufferTarget,
+											 GLuint in_renderbuffer)					= 0;
+		virtual GLenum checkFramebufferStatus(GLenum in_target)							= 0;
+		virtual void getRenderbufferParameteriv(GLenum in_target, GLenum in_name,
+												GLint *out_value)						= 0;
+
+		//Shaders...
+		virtual GLuint createShader(GLenum in_type)										= 0;
+		virtual void deleteShader(GLuint in_shader)										= 0;
+		virtual void shaderSource(GLuint in_shader, GLsizei in_count,
+								  const GLchar **in_strings, const GLint *in_lengths)	= 0;
+		virtual void compileShader(GLuint in_shader)									= 0;
+		virtual void getShaderiv(GLuint in_shader, GLenum in_name, GLint *out_value)	= 0;
+		virtual void getShaderInfoLog(GLuint in_shader, GLsizei in_size,
+									  GLsizei *out_length, GLchar *out_log)				= 0;
+		virtual GLuint createProgram()													= 0;
+		virtual void deleteProgram(GLuint in_program)									= 0;
+		virtual void attachShader(GLuint in_program, GLuint in_shader)					= 0;
+		virtual void linkProgram(GLuint in_program)										= 0;
+		virtual void validateProgram(GLuint in_program)									= 0;
+		virtual void getProgramiv(GLuint in_program, GLenum in_name, GLint *out_value)	= 0;
+		virtual void getProgramInfoLog(GLuint in_program, GLsizei in_size,
+									   GLsizei *out_length, GLchar *out_log)			= 0;
+		virtual GLint getAttribLocation(GLuint in_program, const GLchar *in_name)		= 0;
+		virtual GLint getUniformLocation(GLuint in_program, const GLchar *in_name)		= 0;
+
+		//Uniforms...
+		virtual void uniform1i(GLint in_location, GLint in_x)							= 0;
+		virtual void uniform1f(GLint in_location, GLfloat in_x)							= 0;
+		virtual void uniform2f(GLint in_location, GLfloat in_x, GLfloat in_y)			= 0;
+		virtual void uniform3f(GLint in_location, GLfloat in_x, GLfloat in_y,
+							   GLfloat in_z)											= 0;
+		virtual void uniform4f(GLint in_location, GLfloat in_x, GLfloat in_y,
+							   GLfloat in_z, GLfloat in_w)								= 0;
+		virtual void uniformMatrix2fv(GLint in_location, GLsizei in_count,
+									  GLboolean in_transpose, const GLfloat *in_m)		= 0;
+		virtual void uniformMatrix3fv(GLint in_location, GLsizei in_count,
+									  GLboolean in_transpose, const GLfloat *in_m)		= 0;
+
+		//Queries...
+		virtual const GLubyte *getString(GLenum in_name)								= 0;
+	};
+
+
+	//! The backend every call goes to
+	IBackend &backend();
+
+	//! Send every call to another backend (NULL: back to the GL)
+	/*!	The backend is not deleted.  Objects are deleted through the backend
+		that created them, so it must outlive them (gl's included: see
+		gli::setStreaming).  GPU::State is invalidated, since the new backend
+		knows nothing of the old state, and the extensions are read again
+		(see GPUExtensions.h). */
+	void setBackend(IBackend *in_backend);
+
+
+#ifndef GPU_HEADLESS
+	//! Hands every call to the GL
+	class GLBackend : public IBackend
+	{
+	public:
+		void enable(GLenum in_cap);
+		void disable(GLenum in_cap);
+		void enableClientState(GLenum in_array);
+		void disableClientState(GLenum in_array);
+		void enableVertexAttribArray(GLuint in_index);
+		void disableVertexAttribArray(GLuint in_index);
+		void blendFunc(GLenum in_src, GLenum in_dst);
+		void viewport(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height);
+		void scissor(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height);
+		void activeTexture(GLenum in_unit);
+		void bindTexture(GLenum in_target, GLuint in_texture);
+		void bindFramebuffer(GLenum in_target, GLuint in_framebuffer);
+		void bindBuffer(GLenum in_target, GLuint in_buffer);
+		void useProgram(GLuint in_program);
+
+		void matrixMode(GLenum in_mode);
+		void loadIdentity();
+		void pushMatrix();
+		void popMatrix();
+		void translatef(GLfloat in_x, GLfloat in_y, GLfloat in_z);
+		void scalef(GLfloat in_x, GLfloat in_y, GLfloat in_z);
+		void multMatrixf(const GLfloat *in_m);
+
+		void vertexPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+						   const GLvoid *in_pointer);
+		void colorPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+						  const GLvoid *in_pointer);
+		void texCoordPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+							 const GLvoid *in_pointer);
+		void vertexAttribPointer(GLuint in_index, GLint in_size, GLenum in_type,
+								 GLboolean in_normalized, GLsizei in_stride,
+								 const GLvoid *in_pointer);
+		void vertexAttrib4f(GLuint in_index, GLfloat in_x, GLfloat in_y,
+							GLfloat in_z, GLfloat in_w);
+		void vertexAttribDivisor(GLuint in_index, GLuint in_divisor);
+
+		void drawArrays(GLenum in_mode, GLint in_first, GLsizei in_count);
+		void drawElements(GLenum in_mode, GLsizei in_count, GLenum in_type,
+						  const GLvoid *in_indices);
+		void drawArraysInstanced(GLenum in_mode, GLint in_first, GLsizei in_count,
+								 GLsizei in_instances);
+		void readPixels(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height,
+						GLenum in_format, GLenum in_type, GLvoid *out_pixels);
+
+		void genBuffers(GLsizei in_n, GLuint *out_buffers);
+		void deleteBuffers(GLsizei in_n, const GLuint *in_buffers);
+		void bufferData(GLenum in_target, GLsizeiptr in_size,
+						const GLvoid *in_data, GLenum in_usage);
+		void bufferSubData(GLenum in_target, GLintptr in_offset,
+						   GLsizeiptr in_size, const GLvoid *in_data);
+
+		void genTextures(GLsizei in_n, GLuint *out_textures);
+		void deleteTextures(GLsizei in_n, const GLuint *in_textures);
+		void texParameteri(GLenum in_target, GLenum in_name, GLint in_value);
+		void texImage2D(GLenum in_target, GLint in_level, GLint in_internalFormat,
+						GLsizei in_width, GLsizei in_height, GLint in_border,
+						GLenum in_format, GLenum in_type, const GLvoid *in_pixels);
+		void texSubImage2D(GLenum in_target, GLint in_level, GLint in_x, GLint in_y,
+						   GLsizei in_width, GLsizei in_height,
+						   GLenum in_format, GLenum in_type, const GLvoid *in_pixels);
+
+		void genFramebuffers(GLsizei in_n, GLuint *out_framebuffers);
+		void deleteFramebuffers(GLsizei in_n, const GLuint *in_framebuffers);
+		void framebufferTexture2D(GLenum in_target, GLenum in_attachment,
+								  GLenum in_textureTarget, GLuint in_texture, GLint in_level);
+		void framebufferRenderbuffer(GLenum in_target, GLenum in_attachment,
+									 GLenum in_renderbufferTarget, GLuint in_renderbuffer);
+		GLenum checkFramebufferStatus(GLenum in_target);
+		void getRenderbufferParameteriv(GLenum in_target, GLenum in_name, GLint *out_value);
+
+		GLuint createShader(GLenum in_type);
+		void deleteShader(GLuint in_shader);
+		void shaderSource(GLuint in_shader, GLsizei in_count,
+						  const GLchar **in_strings, const GLint *in_lengths);
+		void compileShader(GLuint in_shader);
+		void getShaderiv(GLuint in_shader, GLenum in_name, GLint *out_value);
+		void getShaderInfoLog(GLuint in_shader, GLsizei in_size,
+							  GLsizei *out_length, GLchar *out_log);
+		GLuint createProgram();
+		void deleteProgram(GLuint in_program);
+		void attachShader(GLuint in_program, GLuint in_shader);
+		void linkProgram(GLuint in_program);
+		void validateProgram(GLuint in_program);
+		void getProgramiv(GLuint in_program, GLenum in_name, GLint *out_value);
+		void getProgramInfoLog(GLuint in_program, GLsizei in_size,
+							   GLsizei *out_length, GLchar *out_log);
+		GLint getAttribLocation(GLuint in_program, const GLchar *in_name);
+		GLint getUniformLocation(GLuint in_program, const GLchar *in_name);
+
+		void uniform1i(GLint in_location, GLint in_x);
+		void uniform1f(GLint in_location, GLfloat in_x);
+		void uniform2f(GLint in_location, GLfloat in_x, GLfloat in_y);
+		void uniform3f(GLint in_location, GLfloat in_x, GLfloat in_y, GLfloat in_z);
+		void uniform4f(GLint in_location, GLfloat in_x, GLfloat in_y, GLfloat in_z, GLfloat in_w);
+		void uniformMatrix2fv(GLint in_location, GLsizei in_count,
+							  GLboolean in_transpose, const GLfloat *in_m);
+		void uniformMatrix3fv(GLint in_location, GLsizei in_count,
+							  GLboolean in_transpose, const GLfloat *in_m);
+
+		const GLubyte *getString(GLenum in_name);
+	};
+#endif
+};
+
+#endif
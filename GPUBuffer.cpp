@@ -15,11 +15,20 @@
  */
 
 #include "GPUBuffer.h"
+#include "GPUState.h"
+#include "GPUBackend.h"
+#include "GPUStats.h"
 
 namespace GPU
 {
-	//! Global VBO reference (for binding)
-	static VBO *g_vbo = NULL;
+	//! Global VBO references (for binding): vertices, then elements
+	static VBO *g_vbo[2] = {NULL, NULL};
+	
+	//! Index in g_vbo of a binding
+	static inline int slot(bool in_isVertices)
+	{
+		return in_isVertices ? 0 : 1;
+	}
 	
 	
 	VBO::VBO(int in_maxSize, bool in_isVertices, bool in_isStatic)
@@ -27,10 +36,10 @@ namespace GPU
 	, m_isStatic(in_isStatic)
 	, m_maxSize(in_maxSize)
 	{
-		glGenBuffers(1, &m_buff);
+		backend().genBuffers(1, &m_buff);
 		
 		BindVBO b(this);
-		glBufferData(	m_isVertices?GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER,
+		backend().bufferData(	m_isVertices?GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER,
 						m_maxSize, NULL,
 						m_isStatic ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
 	}
@@ -38,14 +47,20 @@ namespace GPU
 	
 	VBO::~VBO()
 	{
-		glDeleteBuffers(1, &m_buff);
+		State::forgetBuffer(m_buff);
+		backend().deleteBuffers(1, &m_buff);
 	}
 	
 	
 	void VBO::bind()
 	{
-		if (g_vbo != this)
-			glBindBuffer(m_isVertices?GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER, m_buff);
+		State::bindBuffer(m_isVertices?GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER, m_buff);
+	}
+	
+	
+	void VBO::unbind()
+	{
+		State::bindBuffer(m_isVertices?GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
 	
 	
@@ -55,28 +70,120 @@ namespace GPU
 		
 		if (length <= 0)	length = m_maxSize - start;
 		
-		glBufferSubData(m_isVertices?GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER,
+		backend().bufferSubData(m_isVertices?GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER,
 						start, length, in_data);
+		
+		Stats::count(Stats::BufferUploads);
+		Stats::count(Stats::UploadBytes, length);
+	}
+	
+	
+	void VBO::orphan()
+	{
+		BindVBO b(this);
+		
+		backend().bufferData(	m_isVertices?GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER,
+						m_maxSize, NULL,
+						m_isStatic ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
+	}
+	
+	
+	
+	StreamVBO::StreamVBO(int in_size, bool in_isVertices)
+	: VBO(in_size, in_isVertices, false)
+	, m_head(0)
+	{}
+	
+	
+	int StreamVBO::stream(const void *in_data, int in_length)
+	{
+		if (in_length > size())
+			throw "StreamVBO::stream::Larger than the buffer";
+		
+		if (m_head + in_length > size())
+		{
+			orphan();
+			m_head = 0;
+		}
+		
+		int r = m_head;
+		uploadData(in_data, in_length, r);
+		
+		//Keep the next offset aligned for any type
+		m_head = (r + in_length + 3) & ~3;
+		
+		return r;
+	}
+	
+	
+	
+	IndexVBO::IndexVBO(const GLushort *in_indices, int in_count)
+	: VBO(in_count * sizeof(GLushort), false, true)
+	, m_count(in_count)
+	{
+		uploadData(in_indices);
+	}
+	
+	
+	
+	//! The buffer of quadIndices() (NULL until used)
+	static IndexVBO *g_quadIndices = NULL;
+	
+	
+	IndexVBO *quadIndices()
+	{
+		if (g_quadIndices == NULL)
+		{
+			Many<GLushort> data(new GLushort[GPU_QUAD_INDICES * 6]);
+			GLushort *idx = data();
+			
+			for (int i=0; i<GPU_QUAD_INDICES; i++)
+			{
+				const GLushort q = i*4;
+				
+				*(idx++) = q;		*(idx++) = q + 1;	*(idx++) = q + 2;
+				*(idx++) = q + 2;	*(idx++) = q + 1;	*(idx++) = q + 3;
+			}
+			
+			g_quadIndices = new IndexVBO(data(), GPU_QUAD_INDICES * 6);
+		}
+		
+		return g_quadIndices;
+	}
+	
+	
+	void releaseQuadIndices()
+	{
+		delete g_quadIndices;
+		g_quadIndices = NULL;
 	}
 	
 	
 	
 	BindVBO::BindVBO(VBO *in_vbo)
-	: m_vbo(g_vbo)
+	: m_vbo(g_vbo[slot(in_vbo->isVertices())])
+	, m_isVertices(in_vbo->isVertices())
 	{
 		rebind(in_vbo);
 	}
 	
 	BindVBO::~BindVBO()
 	{
-		if (m_vbo != NULL) m_vbo->bind();
-		g_vbo = m_vbo;
+		VBO *&cur = g_vbo[slot(m_isVertices)];
+		
+		if (m_vbo != NULL)		m_vbo->bind();
+		else if (cur != NULL)	cur->unbind();
+		
+		cur = m_vbo;
 	}
 	
 	void BindVBO::rebind(VBO *in_other)
 	{
+		if (in_other->isVertices() != m_isVertices)
+			throw "BindVBO::rebind::Different kind of VBO";
+		
 		in_other->bind();
-		g_vbo = in_other;
+		g_vbo[slot(m_isVertices)] = in_other;
 	}
 	
 	namespace Type
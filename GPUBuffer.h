@@ -58,7 +58,7 @@
  */
 
 #include "Smart.h"
-#include <OpenGLES/ES2/gl.h>
+#include "GPUTypes.h"
 
 namespace GPU
 {	
@@ -96,6 +96,9 @@ namespace GPU
 		//! Do the binding (used by BindVBO)
 		void bind();
 		
+		//! Bind nothing in place of this buffer (used by BindVBO)
+		void unbind();
+		
 		//! Actually upload the data
 		/*!	\param	in_data		The data to be uploaded to the GPU
 			\param	in_length	The amount of data (<=0 for full length)
@@ -103,25 +106,102 @@ namespace GPU
 		 */
 		void uploadData(const void *in_data, int in_length=-1, int in_start=0);
 		
+		//! Give the buffer new storage; the GL keeps the old while drawing from it
+		void orphan();
+		
 	public:
 		//! Create a new VBO (default is for vertices with static data)
 		VBO(int in_maxSize, bool in_isVertices = true, bool in_isStatic = true);
 		
 		//! Clear out the buffer
 		virtual ~VBO();
+		
+		//! The size that the buffer was allocated for
+		int size() const				{	return m_maxSize;			}
+		
+		//! Vertices, or shorts / elements?
+		bool isVertices() const			{	return m_isVertices;		}
+		
+		//! Uploaded once, or over and over?
+		bool isStatic() const			{	return m_isStatic;			}
+	};
+	
+	
+	//! A VBO for data that is drawn once, such as immediate mode vertices
+	/*!	Data is appended behind what was streamed before.  When the end is
+		reached, the buffer is orphaned: the GL gets new storage while it
+		still draws from the old one.  The CPU thus never waits on the GPU
+		to be done with a region before writing to it, as it would if data
+		was uploaded to the start of the buffer every time.
+	 
+		The buffer should hold a few frames' worth of data, so that it is
+		orphaned rarely.	*/
+	class StreamVBO : public VBO
+	{
+	private:
+		//! Where the next data goes
+		int m_head;
+		
+	public:
+		//! Create a stream of in_size bytes
+		StreamVBO(int in_size, bool in_isVertices = true);
+		
+		//! Upload data behind what was streamed before
+		/*!	\param	in_data		The data to be uploaded to the GPU
+			\param	in_length	The amount of data (at most size())
+			\return	Offset of the data within the buffer	*/
+		int stream(const void *in_data, int in_length);
+	};
+	
+	
+	//! A VBO of 16-bit indices, uploaded once
+	class IndexVBO : public VBO
+	{
+	private:
+		//! Number of indices
+		int m_count;
+		
+	public:
+		//! Upload in_count indices
+		IndexVBO(const GLushort *in_indices, int in_count);
+		
+		//! Number of indices
+		int count() const				{	return m_count;				}
 	};
 	
 	
+	//! Most quads quadIndices() draws (every index of 16 bits used)
+	#define GPU_QUAD_INDICES	16384
+	
+	//! Indices drawing quads as two triangles each, shared by everything
+	/*!	Quad i is made of vertices 4i to 4i+3, in the order of a triangle
+		strip: its triangles are 4i, 4i+1, 4i+2 then 4i+2, 4i+1, 4i+3.  The
+		buffer holds GPU_QUAD_INDICES quads, and is made at first use.
+	 
+		It belongs to the GL context (or backend) it was made in: call
+		releaseQuadIndices() before that goes.	*/
+	IndexVBO *quadIndices();
+	
+	//! Delete the buffer of quadIndices(); the next call makes a new one
+	void releaseQuadIndices();
+	
+	
 	//! Provides a means to bind and unbind vertex buffer objects
 	/*!	Note, like the other Bind objects, this one provides increased code
 		legibility only if it is used on the stack.  On the heap, it may
-		overly complicate the code.	*/
+		overly complicate the code.
+	 
+		Vertex and element buffers are bound independently; rebind() must
+		be given a VBO of the same kind.	*/
 	class BindVBO
 	{
 	private:
-		//! Previously bound VBO object
+		//! Previously bound VBO object (NULL restores no binding)
 		VBO	*m_vbo;
 		
+		//! Binding vertices or elements?
+		bool m_isVertices;
+		
 	public:
 		//! Initialize with a VBO object (can't be NULL)
 		/*!	Internally, the currently bound vbo is stored into m_vbo	*/
@@ -255,7 +335,7 @@ namespace GPU
 		public:
 			//! Create a new VBO with in_count elements
 			TVBO(int in_count, bool in_isStatic = true)
-			: VBO(in_count *sizeof(T), false, in_isStatic)
+			: VBO(in_count *sizeof(T), true, in_isStatic)
 			, m_count(in_count)
 			{
 				m_data = new T[in_count];
@@ -273,6 +353,20 @@ namespace GPU
 				uploadData((void*)m_data());
 			}
 			
+			//! Synchronize the first in_count elements only
+			/*!	A dynamic VBO is given new storage first, so that the GL may
+				still draw from the data it held.	*/
+			void sync(int in_count)
+			{
+				if (in_count <= 0)
+					return;
+				
+				if (!isStatic())
+					orphan();
+				
+				uploadData((void*)m_data(), in_count * sizeof(T));
+			}
+			
 			//! The number of elements in the VBO data structure
 			static const int elementCount()	{	return T::length();		}
 			
@@ -0,0 +1,80 @@
+/*
+ Copyright 2011 Michael Fortin
+ 
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+ 
+ http://www.apache.org/licenses/LICENSE-2.0
+ 
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+#include "GPUExtensions.h"
+#include "GPUBackend.h"
+
+#include <string>
+#include <string.h>
+
+namespace GPU {
+	namespace Support {
+
+		//! Extensions, between spaces (empty: to be read)
+		static std::string g_exts;
+
+		static void initExtensions()
+		{
+			if (!g_exts.empty())
+				return;
+			
+			const char *exts = (const char*)backend().getString(GL_EXTENSIONS);
+			g_exts = std::string(" ") + (exts ? exts : "") + " ";
+			
+			const char *version = (const char*)backend().getString(GL_VERSION);
+			if (version && strncmp(version, "OpenGL ES 2", 11) == 0)
+				g_exts += "GL_APPLE_texture_2D_limited_npot ";
+		}
+		
+		
+		static bool supports(const char *in_name)
+		{
+			initExtensions();
+			return g_exts.find(std::string(" ") + in_name + " ") != std::string::npos;
+		}
+		
+
+		void invalidate()
+		{
+			g_exts.clear();
+		}
+		
+
+		bool NPOT()
+		{
+			return supports("GL_APPLE_texture_2D_limited_npot");
+		}
+
+
+		bool BGRATexture()
+		{
+			return supports("GL_APPLE_texture_format_BGRA8888");
+		}
+		
+		
+		bool MapBuffer()
+		{
+			return supports("GL_OES_mapbuffer");
+		}
+		
+		
+		bool Instancing()
+		{
+			return supports("GL_EXT_instanced_arrays")
+				&& supports("GL_EXT_draw_instanced");
+		}
+	} 
+}
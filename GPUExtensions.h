@@ -55,6 +55,16 @@ namespace GPU
 		//! True if a buffer may be mapped into main memory
 		/*!	Unlocks glGetPointervOES						*/
 		bool MapBuffer();
+		
+		
+		//! Read the extensions again when next asked (the backend changed)
+		void invalidate();
+		
+		
+		//! True if instances of a shape may be drawn in one call
+		/*!	Unlocks glDrawArraysInstancedEXT and glVertexAttribDivisorEXT
+			(OpenGL ES 2x only)								*/
+		bool Instancing();
 	};
 	
 };
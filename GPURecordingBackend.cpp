@@ -0,0 +1,1158 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#include "GPURecordingBackend.h"
+
+#ifndef GPU_HEADLESS
+#include <OpenGLES/ES1/gl.h>
+#endif
+
+#include <stddef.h>
+#include <string.h>
+
+//! Logged in place of pointers to client memory
+#define CLIENT_POINTER		0xffffffff
+
+namespace GPU
+{
+	//! Names of the calls, in the order of RecordingBackend::Call
+	static const char *g_names[RecordingBackend::CALL_COUNT] =
+	{
+		"glEnable", "glDisable", "glEnableClientState", "glDisableClientState",
+		"glEnableVertexAttribArray", "glDisableVertexAttribArray", "glBlendFunc",
+		"glViewport", "glScissor", "glActiveTexture", "glBindTexture", "glBindFramebuffer", "glBindBuffer",
+		"glUseProgram",
+
+		"glMatrixMode", "glLoadIdentity", "glPushMatrix", "glPopMatrix", "glTranslatef",
+		"glScalef", "glMultMatrixf",
+
+		"glVertexPointer", "glColorPointer", "glTexCoordPointer", "glVertexAttribPointer",
+		"glVertexAttrib4f", "glVertexAttribDivisorEXT",
+
+		"glDrawArrays", "glDrawElements", "glDrawArraysInstancedEXT", "glReadPixels",
+
+		"glGenBuffers", "glDeleteBuffers", "glBufferData", "glBufferSubData",
+
+		"glGenTextures", "glDeleteTextures", "glTexParameteri", "glTexImage2D",
+		"glTexSubImage2D",
+
+		"glGenFramebuffers", "glDeleteFramebuffers", "glFramebufferTexture2D",
+		"glFramebufferRenderbuffer", "glCheckFramebufferStatus",
+		"glGetRenderbufferParameteriv",
+
+		"glCreateShader", "glDeleteShader", "glShaderSource", "glCompileShader",
+		"glGetShaderiv", "glGetShaderInfoLog", "glCreateProgram", "glDeleteProgram",
+		"glAttachShader", "glLinkProgram", "glValidateProgram", "glGetProgramiv",
+		"glGetProgramInfoLog", "glGetAttribLocation", "glGetUniformLocation",
+
+		"glUniform1i", "glUniform1f", "glUniform2f", "glUniform3f", "glUniform4f",
+		"glUniformMatrix2fv", "glUniformMatrix3fv",
+
+		"glGetString"
+	};
+
+	//! Deepest matrix stacks OpenGL ES 1x promises (modelview, projection, texture)
+	static const int g_matrixDepths[3] = {16, 2, 2};
+
+
+	RecordingBackend::RecordingBackend(GLint in_width, GLint in_height)
+	: m_errors(0)
+	, m_lastError(NULL)
+	, m_nextName(1)
+	, m_arrayBuffer(0)
+	, m_elementBuffer(0)
+	, m_activeUnit(0)
+	, m_framebuffer(0)
+	, m_program(0)
+	, m_vertexArray(false)
+	, m_attribArrays(0)
+	, m_matrixMode(GL_MODELVIEW)
+	, m_width(in_width)
+	, m_height(in_height)
+	{
+		memset(m_calls, 0, sizeof(m_calls));
+		memset(m_texture, 0, sizeof(m_texture));
+		memset(m_matrixDepth, 0, sizeof(m_matrixDepth));
+	}
+
+
+	int RecordingBackend::calls() const
+	{
+		int total = 0;
+		for (int i=0; i<CALL_COUNT; i++)
+			total += m_calls[i];
+		return total;
+	}
+
+
+	void RecordingBackend::clear()
+	{
+		m_stream.clear();
+		memset(m_calls, 0, sizeof(m_calls));
+		m_errors = 0;
+		m_lastError = NULL;
+	}
+
+
+	void RecordingBackend::setExtensions(const char *in_extensions)
+	{
+		m_extensions = in_extensions ? in_extensions : "";
+	}
+
+
+	const char *RecordingBackend::name(Call in_call)
+	{
+		return in_call < CALL_COUNT ? g_names[in_call] : NULL;
+	}
+
+
+	void RecordingBackend::call(Call in_call)
+	{
+		m_calls[in_call]++;
+		m_stream.push_back((unsigned char)in_call);
+	}
+
+
+	void RecordingBackend::word(GLuint in_value)
+	{
+		m_stream.push_back((unsigned char)(in_value));
+		m_stream.push_back((unsigned char)(in_value >> 8));
+		m_stream.push_back((unsigned char)(in_value >> 16));
+		m_stream.push_back((unsigned char)(in_value >> 24));
+	}
+
+
+	void RecordingBackend::real(GLfloat in_value)
+	{
+		GLuint bits;
+		memcpy(&bits, &in_value, sizeof(bits));
+		word(bits);
+	}
+
+
+	void RecordingBackend::pointer(GLuint in_buffer, const GLvoid *in_pointer)
+	{
+		word(in_buffer ? (GLuint)((const char*)in_pointer - (const char*)NULL) : CLIENT_POINTER);
+	}
+
+
+	void RecordingBackend::error(const char *in_message)
+	{
+		m_errors++;
+		m_lastError = in_message;
+	}
+
+
+	GLuint RecordingBackend::create()
+	{
+		return m_nextName++;
+	}
+
+
+	int &RecordingBackend::matrixDepth()
+	{
+		if (m_matrixMode == GL_PROJECTION)	return m_matrixDepth[1];
+		if (m_matrixMode == GL_TEXTURE)		return m_matrixDepth[2];
+		return m_matrixDepth[0];
+	}
+
+
+	void RecordingBackend::forget(GLuint in_name)
+	{
+		if (m_arrayBuffer == in_name)		m_arrayBuffer = 0;
+		if (m_elementBuffer == in_name)		m_elementBuffer = 0;
+		if (m_framebuffer == in_name)		m_framebuffer = 0;
+
+		for (int i=0; i<TEXTURE_UNITS; i++)
+			if (m_texture[i] == in_name)
+				m_texture[i] = 0;
+	}
+
+
+
+	void RecordingBackend::enable(GLenum in_cap)
+	{
+		call(Enable);
+		word(in_cap);
+	}
+
+
+	void RecordingBackend::disable(GLenum in_cap)
+	{
+		call(Disable);
+		word(in_cap);
+	}
+
+
+	void RecordingBackend::enableClientState(GLenum in_array)
+	{
+		call(EnableClientState);
+		word(in_array);
+
+		if (in_array == GL_VERTEX_ARRAY)
+			m_vertexArray = true;
+	}
+
+
+	void RecordingBackend::disableClientState(GLenum in_array)
+	{
+		call(DisableClientState);
+		word(in_array);
+
+		if (in_array == GL_VERTEX_ARRAY)
+			m_vertexArray = false;
+	}
+
+
+	void RecordingBackend::enableVertexAttribArray(GLuint in_index)
+	{
+		call(EnableVertexAttribArray);
+		word(in_index);
+
+		if (in_index >= VERTEX_ATTRIBS)
+			error("RecordingBackend::enableVertexAttribArray::Invalid attribute");
+		else
+			m_attribArrays |= 1 << in_index;
+	}
+
+
+	void RecordingBackend::disableVertexAttribArray(GLuint in_index)
+	{
+		call(DisableVertexAttribArray);
+		word(in_index);
+
+		if (in_index >= VERTEX_ATTRIBS)
+			error("RecordingBackend::disableVertexAttribArray::Invalid attribute");
+		else
+			m_attribArrays &= ~(1 << in_index);
+	}
+
+
+	void RecordingBackend::blendFunc(GLenum in_src, GLenum in_dst)
+	{
+		call(BlendFunc);
+		word(in_src);
+		word(in_dst);
+	}
+
+
+	void RecordingBackend::viewport(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height)
+	{
+		call(Viewport);
+		word(in_x);
+		word(in_y);
+		word(in_width);
+		word(in_height);
+
+		if (in_width < 0 || in_height < 0)
+			error("RecordingBackend::viewport::Negative size");
+	}
+
+
+	void RecordingBackend::scissor(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height)
+	{
+		call(Scissor);
+		word(in_x);
+		word(in_y);
+		word(in_width);
+		word(in_height);
+
+		if (in_width < 0 || in_height < 0)
+			error("RecordingBackend::scissor::Negative size");
+	}
+
+
+	void RecordingBackend::activeTexture(GLenum in_unit)
+	{
+		call(ActiveTexture);
+		word(in_unit);
+
+		if (in_unit < GL_TEXTURE0 || in_unit >= GL_TEXTURE0 + TEXTURE_UNITS)
+			error("RecordingBackend::activeTexture::Invalid unit");
+		else
+			m_activeUnit = in_unit - GL_TEXTURE0;
+	}
+
+
+	void RecordingBackend::bindTexture(GLenum in_target, GLuint in_texture)
+	{
+		call(BindTexture);
+		word(in_target);
+		word(in_texture);
+
+		if (in_texture && m_textures.find(in_texture) == m_textures.end())
+			error("RecordingBackend::bindTexture::Unknown texture");
+		else
+			m_texture[m_activeUnit] = in_texture;
+	}
+
+
+	void RecordingBackend::bindFramebuffer(GLenum in_target, GLuint in_framebuffer)
+	{
+		call(BindFramebuffer);
+		word(in_target);
+		word(in_framebuffer);
+
+		if (in_framebuffer && m_framebuffers.find(in_framebuffer) == m_framebuffers.end())
+			error("RecordingBackend::bindFramebuffer::Unknown frame buffer");
+		else
+			m_framebuffer = in_framebuffer;
+	}
+
+
+	void RecordingBackend::bindBuffer(GLenum in_target, GLuint in_buffer)
+	{
+		call(BindBuffer);
+		word(in_target);
+		word(in_buffer);
+
+		if (in_buffer && m_buffers.find(in_buffer) == m_buffers.end())
+			error("RecordingBackend::bindBuffer::Unknown buffer");
+		else if (in_target == GL_ARRAY_BUFFER)
+			m_arrayBuffer = in_buffer;
+		else if (in_target == GL_ELEMENT_ARRAY_BUFFER)
+			m_elementBuffer = in_buffer;
+		else
+			error("RecordingBackend::bindBuffer::Invalid target");
+	}
+
+
+	void RecordingBackend::useProgram(GLuint in_program)
+	{
+		call(UseProgram);
+		word(in_program);
+
+		if (in_program && m_programs.find(in_program) == m_programs.end())
+			error("RecordingBackend::useProgram::Unknown program");
+		else
+			m_program = in_program;
+	}
+
+
+
+	void RecordingBackend::matrixMode(GLenum in_mode)
+	{
+		call(MatrixMode);
+		word(in_mode);
+
+		if (in_mode != GL_MODELVIEW && in_mode != GL_PROJECTION && in_mode != GL_TEXTURE)
+			error("RecordingBackend::matrixMode::Invalid mode");
+		else
+			m_matrixMode = in_mode;
+	}
+
+
+	void RecordingBackend::loadIdentity()
+	{
+		call(LoadIdentity);
+	}
+
+
+	void RecordingBackend::pushMatrix()
+	{
+		call(PushMatrix);
+
+		int &depth = matrixDepth();
+		if (depth + 1 >= g_matrixDepths[&depth - m_matrixDepth])
+			error("RecordingBackend::pushMatrix::Stack overflow");
+		else
+			depth++;
+	}
+
+
+	void RecordingBackend::popMatrix()
+	{
+		call(PopMatrix);
+
+		int &depth = matrixDepth();
+		if (depth == 0)
+			error("RecordingBackend::popMatrix::Stack underflow");
+		else
+			depth--;
+	}
+
+
+	void RecordingBackend::translatef(GLfloat in_x, GLfloat in_y, GLfloat in_z)
+	{
+		call(Translatef);
+		real(in_x);
+		real(in_y);
+		real(in_z);
+	}
+
+
+	void RecordingBackend::scalef(GLfloat in_x, GLfloat in_y, GLfloat in_z)
+	{
+		call(Scalef);
+		real(in_x);
+		real(in_y);
+		real(in_z);
+	}
+
+
+	void RecordingBackend::multMatrixf(const GLfloat *in_m)
+	{
+		call(MultMatrixf);
+		for (int i=0; i<16; i++)
+			real(in_m[i]);
+	}
+
+
+
+	void RecordingBackend::vertexPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+										 const GLvoid *in_pointer)
+	{
+		call(VertexPointer);
+		word(in_size);
+		word(in_type);
+		word(in_stride);
+		pointer(m_arrayBuffer, in_pointer);
+	}
+
+
+	void RecordingBackend::colorPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+										const GLvoid *in_pointer)
+	{
+		call(ColorPointer);
+		word(in_size);
+		word(in_type);
+		word(in_stride);
+		pointer(m_arrayBuffer, in_pointer);
+	}
+
+
+	void RecordingBackend::texCoordPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+										   const GLvoid *in_pointer)
+	{
+		call(TexCoordPointer);
+		word(in_size);
+		word(in_type);
+		word(in_stride);
+		pointer(m_arrayBuffer, in_pointer);
+	}
+
+
+	void RecordingBackend::vertexAttribPointer(GLuint in_index, GLint in_size, GLenum in_type,
+											   GLboolean in_normalized, GLsizei in_stride,
+											   const GLvoid *in_pointer)
+	{
+		call(VertexAttribPointer);
+		word(in_index);
+		word(in_size);
+		word(in_type);
+		word(in_normalized);
+		word(in_stride);
+		pointer(m_arrayBuffer, in_pointer);
+
+		if (in_index >= VERTEX_ATTRIBS)
+			error("RecordingBackend::vertexAttribPointer::Invalid attribute");
+		if (in_size < 1 || in_size > 4)
+			error("RecordingBackend::vertexAttribPointer::Invalid size");
+	}
+
+
+	void RecordingBackend::vertexAttrib4f(GLuint in_index, GLfloat in_x, GLfloat in_y,
+										  GLfloat in_z, GLfloat in_w)
+	{
+		call(VertexAttrib4f);
+		word(in_index);
+		real(in_x);
+		real(in_y);
+		real(in_z);
+		real(in_w);
+
+		if (in_index >= VERTEX_ATTRIBS)
+			error("RecordingBackend::vertexAttrib4f::Invalid attribute");
+	}
+
+
+	void RecordingBackend::vertexAttribDivisor(GLuint in_index, GLuint in_divisor)
+	{
+		call(VertexAttribDivisor);
+		word(in_index);
+		word(in_divisor);
+
+		if (in_index >= VERTEX_ATTRIBS)
+			error("RecordingBackend::vertexAttribDivisor::Invalid attribute");
+	}
+
+
+
+	void RecordingBackend::drawArrays(GLenum in_mode, GLint in_first, GLsizei in_count)
+	{
+		call(DrawArrays);
+		word(in_mode);
+		word(in_first);
+		word(in_count);
+
+		if (in_mode > GL_TRIANGLE_FAN)
+			error("RecordingBackend::drawArrays::Invalid mode");
+		if (in_first < 0 || in_count < 0)
+			error("RecordingBackend::drawArrays::Negative range");
+		if (!m_vertexArray && !m_attribArrays)
+			error("RecordingBackend::drawArrays::No vertex array enabled");
+	}
+
+
+	void RecordingBackend::drawElements(GLenum in_mode, GLsizei in_count, GLenum in_type,
+										const GLvoid *in_indices)
+	{
+		call(DrawElements);
+		word(in_mode);
+		word(in_count);
+		word(in_type);
+		pointer(m_elementBuffer, in_indices);
+
+		if (in_mode > GL_TRIANGLE_FAN)
+			error("RecordingBackend::drawElements::Invalid mode");
+		if (in_count < 0)
+			error("RecordingBackend::drawElements::Negative count");
+		if (in_type != GL_UNSIGNED_BYTE && in_type != GL_UNSIGNED_SHORT)
+			error("RecordingBackend::drawElements::Invalid index type");
+		if (!m_vertexArray && !m_attribArrays)
+			error("RecordingBackend::drawElements::No vertex array enabled");
+
+		if (m_elementBuffer)
+		{
+			const GLsizeiptr end = ((const char*)in_indices - (const char*)NULL)
+									+ in_count * (in_type == GL_UNSIGNED_SHORT ? 2 : 1);
+			if (end > m_buffers[m_elementBuffer])
+				error("RecordingBackend::drawElements::Indices out of the buffer");
+		}
+		else if (in_indices == NULL)
+		{
+			error("RecordingBackend::drawElements::No indices");
+		}
+	}
+
+
+	void RecordingBackend::drawArraysInstanced(GLenum in_mode, GLint in_first, GLsizei in_count,
+											   GLsizei in_instances)
+	{
+		call(DrawArraysInstanced);
+		word(in_mode);
+		word(in_first);
+		word(in_count);
+		word(in_instances);
+
+		if (in_mode > GL_TRIANGLE_FAN)
+			error("RecordingBackend::drawArraysInstanced::Invalid mode");
+		if (in_first < 0 || in_count < 0 || in_instances < 0)
+			error("RecordingBackend::drawArraysInstanced::Negative range");
+		if (!m_attribArrays)
+			error("RecordingBackend::drawArraysInstanced::No vertex array enabled");
+	}
+
+
+	void RecordingBackend::readPixels(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height,
+									  GLenum in_format, GLenum in_type, GLvoid *out_pixels)
+	{
+		call(ReadPixels);
+		word(in_x);
+		word(in_y);
+		word(in_width);
+		word(in_height);
+		word(in_format);
+		word(in_type);
+
+		if (in_format != GL_RGBA || in_type != GL_UNSIGNED_BYTE)
+			error("RecordingBackend::readPixels::Unsupported format");
+		else if (in_width > 0 && in_height > 0)
+			memset(out_pixels, 0, in_width * in_height * 4);
+	}
+
+
+
+	void RecordingBackend::genBuffers(GLsizei in_n, GLuint *out_buffers)
+	{
+		call(GenBuffers);
+		word(in_n);
+
+		for (int i=0; i<in_n; i++)
+		{
+			out_buffers[i] = create();
+			m_buffers[out_buffers[i]] = 0;
+		}
+	}
+
+
+	void RecordingBackend::deleteBuffers(GLsizei in_n, const GLuint *in_buffers)
+	{
+		call(DeleteBuffers);
+		word(in_n);
+
+		for (int i=0; i<in_n; i++)
+		{
+			if (in_buffers[i] == 0)
+				continue;
+
+			if (m_buffers.erase(in_buffers[i]) == 0)
+				error("RecordingBackend::deleteBuffers::Unknown buffer");
+
+			forget(in_buffers[i]);
+		}
+	}
+
+
+	void RecordingBackend::bufferData(GLenum in_target, GLsizeiptr in_size,
+									  const GLvoid *in_data, GLenum in_usage)
+	{
+		call(BufferData);
+		word(in_target);
+		word((GLuint)in_size);
+		word(in_usage);
+
+		const GLuint b = in_target == GL_ARRAY_BUFFER ? m_arrayBuffer : m_elementBuffer;
+
+		if (b == 0)
+			error("RecordingBackend::bufferData::No buffer bound");
+		else if (in_size < 0)
+			error("RecordingBackend::bufferData::Negative size");
+		else
+			m_buffers[b] = in_size;
+	}
+
+
+	void RecordingBackend::bufferSubData(GLenum in_target, GLintptr in_offset,
+										 GLsizeiptr in_size, const GLvoid *in_data)
+	{
+		call(BufferSubData);
+		word(in_target);
+		word((GLuint)in_offset);
+		word((GLuint)in_size);
+
+		const GLuint b = in_target == GL_ARRAY_BUFFER ? m_arrayBuffer : m_elementBuffer;
+
+		if (b == 0)
+			error("RecordingBackend::bufferSubData::No buffer bound");
+		else if (in_offset < 0 || in_size < 0 || in_offset + in_size > m_buffers[b])
+			error("RecordingBackend::bufferSubData::Out of the buffer");
+	}
+
+
+
+	void RecordingBackend::genTextures(GLsizei in_n, GLuint *out_textures)
+	{
+		call(GenTextures);
+		word(in_n);
+
+		for (int i=0; i<in_n; i++)
+		{
+			TextureSize s = {0, 0};
+			out_textures[i] = create();
+			m_textures[out_textures[i]] = s;
+		}
+	}
+
+
+	void RecordingBackend::deleteTextures(GLsizei in_n, const GLuint *in_textures)
+	{
+		call(DeleteTextures);
+		word(in_n);
+
+		for (int i=0; i<in_n; i++)
+		{
+			if (in_textures[i] == 0)
+				continue;
+
+			if (m_textures.erase(in_textures[i]) == 0)
+				error("RecordingBackend::deleteTextures::Unknown texture");
+
+			forget(in_textures[i]);
+		}
+	}
+
+
+	void RecordingBackend::texParameteri(GLenum in_target, GLenum in_name, GLint in_value)
+	{
+		call(TexParameteri);
+		word(in_target);
+		word(in_name);
+		word(in_value);
+
+		if (m_texture[m_activeUnit] == 0)
+			error("RecordingBackend::texParameteri::No texture bound");
+	}
+
+
+	void RecordingBackend::texImage2D(GLenum in_target, GLint in_level, GLint in_internalFormat,
+									  GLsizei in_width, GLsizei in_height, GLint in_border,
+									  GLenum in_format, GLenum in_type, const GLvoid *in_pixels)
+	{
+		call(TexImage2D);
+		word(in_target);
+		word(in_level);
+		word(in_internalFormat);
+		word(in_width);
+		word(in_height);
+		word(in_border);
+		word(in_format);
+		word(in_type);
+
+		const GLuint t = m_texture[m_activeUnit];
+
+		if (t == 0)
+		{
+			error("RecordingBackend::texImage2D::No texture bound");
+		}
+		else if (in_width < 0 || in_height < 0 || in_border != 0)
+		{
+			error("RecordingBackend::texImage2D::Invalid size");
+		}
+		else if (in_level == 0)
+		{
+			TextureSize s = {in_width, in_height};
+			m_textures[t] = s;
+		}
+	}
+
+
+	void RecordingBackend::texSubImage2D(GLenum in_target, GLint in_level, GLint in_x, GLint in_y,
+										 GLsizei in_width, GLsizei in_height,
+										 GLenum in_format, GLenum in_type, const GLvoid *in_pixels)
+	{
+		call(TexSubImage2D);
+		word(in_target);
+		word(in_level);
+		word(in_x);
+		word(in_y);
+		word(in_width);
+		word(in_height);
+		word(in_format);
+		word(in_type);
+
+		const GLuint t = m_texture[m_activeUnit];
+
+		if (t == 0)
+		{
+			error("RecordingBackend::texSubImage2D::No texture bound");
+		}
+		else if (in_level == 0)
+		{
+			const TextureSize &s = m_textures[t];
+
+			if (in_x < 0 || in_y < 0 || in_x + in_width > s.width || in_y + in_height > s.height)
+				error("RecordingBackend::texSubImage2D::Out of the texture");
+		}
+	}
+
+
+
+	void RecordingBackend::genFramebuffers(GLsizei in_n, GLuint *out_framebuffers)
+	{
+		call(GenFramebuffers);
+		word(in_n);
+
+		for (int i=0; i<in_n; i++)
+		{
+			out_framebuffers[i] = create();
+			m_framebuffers.insert(out_framebuffers[i]);
+		}
+	}
+
+
+	void RecordingBackend::deleteFramebuffers(GLsizei in_n, const GLuint *in_framebuffers)
+	{
+		call(DeleteFramebuffers);
+		word(in_n);
+
+		for (int i=0; i<in_n; i++)
+		{
+			if (in_framebuffers[i] == 0)
+				continue;
+
+			if (m_framebuffers.erase(in_framebuffers[i]) == 0)
+				error("RecordingBackend::deleteFramebuffers::Unknown frame buffer");
+
+			forget(in_framebuffers[i]);
+		}
+	}
+
+
+	void RecordingBackend::framebufferTexture2D(GLenum in_target, GLenum in_attachment,
+												GLenum in_textureTarget, GLuint in_texture,
+												GLint in_level)
+	{
+		call(FramebufferTexture2D);
+		word(in_target);
+		word(in_attachment);
+		word(in_textureTarget);
+		word(in_texture);
+		word(in_level);
+
+		if (m_framebuffer == 0)
+			error("RecordingBackend::framebufferTexture2D::No frame buffer bound");
+		if (in_texture && m_textures.find(in_texture) == m_textures.end())
+			error("RecordingBackend::framebufferTexture2D::Unknown texture");
+	}
+
+
+	void RecordingBackend::framebufferRenderbuffer(GLenum in_target, GLenum in_attachment,
+												   GLenum in_renderbufferTarget,
+												   GLuint in_renderbuffer)
+	{
+		call(FramebufferRenderbuffer);
+		word(in_target);
+		word(in_attachment);
+		word(in_renderbufferTarget);
+		word(in_renderbuffer);
+
+		if (m_framebuffer == 0)
+			error("RecordingBackend::framebufferRenderbuffer::No frame buffer bound");
+	}
+
+
+	GLenum RecordingBackend::checkFramebufferStatus(GLenum in_target)
+	{
+		call(CheckFramebufferStatus);
+		word(in_target);
+
+		return GL_FRAMEBUFFER_COMPLETE;
+	}
+
+
+	void RecordingBackend::getRenderbufferParameteriv(GLenum in_target, GLenum in_name,
+													  GLint *out_value)
+	{
+		call(GetRenderbufferParameteriv);
+		word(in_target);
+		word(in_name);
+
+		if (in_name == GL_RENDERBUFFER_WIDTH)			*out_value = m_width;
+		else if (in_name == GL_RENDERBUFFER_HEIGHT)		*out_value = m_height;
+		else											*out_value = 0;
+	}
+
+
+
+	GLuint RecordingBackend::createShader(GLenum in_type)
+	{
+		call(CreateShader);
+		word(in_type);
+
+		GLuint s = create();
+		m_shaders.insert(s);
+		return s;
+	}
+
+
+	void RecordingBackend::deleteShader(GLuint in_shader)
+	{
+		call(DeleteShader);
+		word(in_shader);
+
+		if (in_shader && m_shaders.erase(in_shader) == 0)
+			error("RecordingBackend::deleteShader::Unknown shader");
+	}
+
+
+	void RecordingBackend::shaderSource(GLuint in_shader, GLsizei in_count,
+										const GLchar **in_strings, const GLint *in_lengths)
+	{
+		GLuint bytes = 0;
+		for (int i=0; i<in_count; i++)
+			bytes += in_lengths && in_lengths[i] >= 0 ? in_lengths[i] : strlen(in_strings[i]);
+
+		call(ShaderSource);
+		word(in_shader);
+		word(in_count);
+		word(bytes);
+
+		if (m_shaders.find(in_shader) == m_shaders.end())
+			error("RecordingBackend::shaderSource::Unknown shader");
+	}
+
+
+	void RecordingBackend::compileShader(GLuint in_shader)
+	{
+		call(CompileShader);
+		word(in_shader);
+
+		if (m_shaders.find(in_shader) == m_shaders.end())
+			error("RecordingBackend::compileShader::Unknown shader");
+	}
+
+
+	void RecordingBackend::getShaderiv(GLuint in_shader, GLenum in_name, GLint *out_value)
+	{
+		call(GetShaderiv);
+		word(in_shader);
+		word(in_name);
+
+		*out_value = in_name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+
+		if (m_shaders.find(in_shader) == m_shaders.end())
+			error("RecordingBackend::getShaderiv::Unknown shader");
+	}
+
+
+	void RecordingBackend::getShaderInfoLog(GLuint in_shader, GLsizei in_size,
+											GLsizei *out_length, GLchar *out_log)
+	{
+		call(GetShaderInfoLog);
+		word(in_shader);
+
+		if (out_length)		*out_length = 0;
+		if (in_size > 0)	out_log[0] = 0;
+	}
+
+
+	GLuint RecordingBackend::createProgram()
+	{
+		call(CreateProgram);
+
+		GLuint p = create();
+		m_programs.insert(p);
+		m_nextLocation[p] = 0;
+		return p;
+	}
+
+
+	void RecordingBackend::deleteProgram(GLuint in_program)
+	{
+		call(DeleteProgram);
+		word(in_program);
+
+		if (in_program && m_programs.erase(in_program) == 0)
+			error("RecordingBackend::deleteProgram::Unknown program");
+
+		if (m_program == in_program)
+			m_program = 0;
+	}
+
+
+	void RecordingBackend::attachShader(GLuint in_program, GLuint in_shader)
+	{
+		call(AttachShader);
+		word(in_program);
+		word(in_shader);
+
+		if (m_programs.find(in_program) == m_programs.end())
+			error("RecordingBackend::attachShader::Unknown program");
+		if (m_shaders.find(in_shader) == m_shaders.end())
+			error("RecordingBackend::attachShader::Unknown shader");
+	}
+
+
+	void RecordingBackend::linkProgram(GLuint in_program)
+	{
+		call(LinkProgram);
+		word(in_program);
+
+		if (m_programs.find(in_program) == m_programs.end())
+			error("RecordingBackend::linkProgram::Unknown program");
+	}
+
+
+	void RecordingBackend::validateProgram(GLuint in_program)
+	{
+		call(ValidateProgram);
+		word(in_program);
+
+		if (m_programs.find(in_program) == m_programs.end())
+			error("RecordingBackend::validateProgram::Unknown program");
+	}
+
+
+	void RecordingBackend::getProgramiv(GLuint in_program, GLenum in_name, GLint *out_value)
+	{
+		call(GetProgramiv);
+		word(in_program);
+		word(in_name);
+
+		*out_value = (in_name == GL_LINK_STATUS || in_name == GL_VALIDATE_STATUS) ? GL_TRUE : 0;
+
+		if (m_programs.find(in_program) == m_programs.end())
+			error("RecordingBackend::getProgramiv::Unknown program");
+	}
+
+
+	void RecordingBackend::getProgramInfoLog(GLuint in_program, GLsizei in_size,
+											 GLsizei *out_length, GLchar *out_log)
+	{
+		call(GetProgramInfoLog);
+		word(in_program);
+
+		if (out_length)		*out_length = 0;
+		if (in_size > 0)	out_log[0] = 0;
+	}
+
+
+	GLint RecordingBackend::getAttribLocation(GLuint in_program, const GLchar *in_name)
+	{
+		call(GetAttribLocation);
+		word(in_program);
+
+		if (m_programs.find(in_program) == m_programs.end())
+		{
+			error("RecordingBackend::getAttribLocation::Unknown program");
+			return -1;
+		}
+
+		//Attributes and uniforms are numbered apart, as in the GL
+		std::pair<GLuint, std::string> k(in_program, std::string("a") + in_name);
+		std::map<std::pair<GLuint, std::string>, GLint>::iterator i = m_locations.find(k);
+		if (i != m_locations.end())
+			return i->second;
+
+		GLint attributes = 0;
+		for (i = m_locations.begin(); i != m_locations.end(); ++i)
+			if (i->first.first == in_program && i->first.second[0] == 'a')
+				attributes++;
+
+		if (attributes >= VERTEX_ATTRIBS)
+			return -1;
+
+		m_locations[k] = attributes;
+		return attributes;
+	}
+
+
+	GLint RecordingBackend::getUniformLocation(GLuint in_program, const GLchar *in_name)
+	{
+		call(GetUniformLocation);
+		word(in_program);
+
+		if (m_programs.find(in_program) == m_programs.end())
+		{
+			error("RecordingBackend::getUniformLocation::Unknown program");
+			return -1;
+		}
+
+		std::pair<GLuint, std::string> k(in_program, std::string("u") + in_name);
+		std::map<std::pair<GLuint, std::string>, GLint>::iterator i = m_locations.find(k);
+		if (i != m_locations.end())
+			return i->second;
+
+		return m_locations[k] = m_nextLocation[in_program]++;
+	}
+
+
+
+	void RecordingBackend::uniform1i(GLint in_location, GLint in_x)
+	{
+		call(Uniform1i);
+		word(in_location);
+		word(in_x);
+
+		if (m_program == 0)
+			error("RecordingBackend::uniform1i::No program in use");
+	}
+
+
+	void RecordingBackend::uniform1f(GLint in_location, GLfloat in_x)
+	{
+		call(Uniform1f);
+		word(in_location);
+		real(in_x);
+
+		if (m_program == 0)
+			error("RecordingBackend::uniform1f::No program in use");
+	}
+
+
+	void RecordingBackend::uniform2f(GLint in_location, GLfloat in_x, GLfloat in_y)
+	{
+		call(Uniform2f);
+		word(in_location);
+		real(in_x);
+		real(in_y);
+
+		if (m_program == 0)
+			error("RecordingBackend::uniform2f::No program in use");
+	}
+
+
+	void RecordingBackend::uniform3f(GLint in_location, GLfloat in_x, GLfloat in_y, GLfloat in_z)
+	{
+		call(Uniform3f);
+		word(in_location);
+		real(in_x);
+		real(in_y);
+		real(in_z);
+
+		if (m_program == 0)
+			error("RecordingBackend::uniform3f::No program in use");
+	}
+
+
+	void RecordingBackend::uniform4f(GLint in_location, GLfloat in_x, GLfloat in_y,
+									 GLfloat in_z, GLfloat in_w)
+	{
+		call(Uniform4f);
+		word(in_location);
+		real(in_x);
+		real(in_y);
+		real(in_z);
+		real(in_w);
+
+		if (m_program == 0)
+			error("RecordingBackend::uniform4f::No program in use");
+	}
+
+
+	void RecordingBackend::uniformMatrix2fv(GLint in_location, GLsizei in_count,
+											GLboolean in_transpose, const GLfloat *in_m)
+	{
+		call(UniformMatrix2fv);
+		word(in_location);
+		word(in_count);
+		word(in_transpose);
+		for (int i=0; i<in_count*4; i++)
+			real(in_m[i]);
+
+		if (m_program == 0)
+			error("RecordingBackend::uniformMatrix2fv::No program in use");
+		if (in_transpose)
+			error("RecordingBackend::uniformMatrix2fv::Transpose must be false");
+	}
+
+
+	void RecordingBackend::uniformMatrix3fv(GLint in_location, GLsizei in_count,
+											GLboolean in_transpose, const GLfloat *in_m)
+	{
+		call(UniformMatrix3fv);
+		word(in_location);
+		word(in_count);
+		word(in_transpose);
+		for (int i=0; i<in_count*9; i++)
+			real(in_m[i]);
+
+		if (m_program == 0)
+			error("RecordingBackend::uniformMatrix3fv::No program in use");
+		if (in_transpose)
+			error("RecordingBackend::uniformMatrix3fv::Transpose must be false");
+	}
+
+
+
+	const GLubyte *RecordingBackend::getString(GLenum in_name)
+	{
+		call(GetString);
+		word(in_name);
+
+		switch (in_name)
+		{
+			case GL_VENDOR:		return (const GLubyte*)"AgilePod";
+			case GL_RENDERER:	return (const GLubyte*)"RecordingBackend";
+			case GL_VERSION:	return (const GLubyte*)"OpenGL ES 2.0 RecordingBackend";
+			case GL_EXTENSIONS:	return (const GLubyte*)m_extensions.c_str();
+		}
+
+		error("RecordingBackend::getString::Invalid name");
+		return NULL;
+	}
+};
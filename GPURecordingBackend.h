@@ -0,0 +1,312 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#ifndef BubblePod_GPURecordingBackend_h
+#define BubblePod_GPURecordingBackend_h
+
+#include "GPUBackend.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/*!	\file	GPURecordingBackend.h
+	\brief	A backend that needs no GPU: calls are checked and logged.
+
+	Every call is appended to a byte stream: one byte naming the call (see
+	RecordingBackend::Call), then its arguments, 4 bytes each, little
+	endian (floats as their bits).  What is passed through pointers is
+	logged by size only (pixels, buffer contents, shader sources), except
+	matrices, which are logged in full.  Vertex and index pointers are
+	logged as offsets into the bound buffer, or as 0xffffffff for client
+	memory, so that the same frame always gives the same stream.
+
+	Calls are also checked against what the GL would accept, as far as the
+	backend can tell: objects that were never created (or already deleted),
+	data out of a buffer's range, uploads without a texture bound, uniforms
+	without a program in use, draws with nothing to draw from, matrix stacks
+	deeper than OpenGL ES 1x promises, etc.  Each failed check is counted;
+	the message of the last one is kept.  The call is logged all the same.
+
+	Queries answer as a working GL would: shaders compile, programs link,
+	frame buffers are complete, pixels read back as 0.
+
+	\code
+GPU::RecordingBackend recorder;
+GPU::setBackend(&recorder);
+
+drawFrame();
+
+printf("%d draw calls, %d bytes, %d errors\\n",
+	   recorder.calls(GPU::RecordingBackend::DrawArrays)
+		+ recorder.calls(GPU::RecordingBackend::DrawElements),
+	   recorder.size(), recorder.errors());
+	\endcode
+ */
+
+namespace GPU
+{
+	//! Checks and logs calls instead of making them (see GPURecordingBackend.h)
+	class RecordingBackend : public IBackend
+	{
+	public:
+		//! First byte of each call in the stream
+		enum Call
+		{
+			Enable, Disable, EnableClientState, DisableClientState,
+			EnableVertexAttribArray, DisableVertexAttribArray, BlendFunc,
+			Viewport, Scissor, ActiveTexture, BindTexture, BindFramebuffer, BindBuffer,
+			UseProgram,
+
+			MatrixMode, LoadIdentity, PushMatrix, PopMatrix, Translatef,
+			Scalef, MultMatrixf,
+
+			VertexPointer, ColorPointer, TexCoordPointer, VertexAttribPointer,
+			VertexAttrib4f, VertexAttribDivisor,
+
+			DrawArrays, DrawElements, DrawArraysInstanced, ReadPixels,
+
+			GenBuffers, DeleteBuffers, BufferData, BufferSubData,
+
+			GenTextures, DeleteTextures, TexParameteri, TexImage2D,
+			TexSubImage2D,
+
+			GenFramebuffers, DeleteFramebuffers, FramebufferTexture2D,
+			FramebufferRenderbuffer, CheckFramebufferStatus,
+			GetRenderbufferParameteriv,
+
+			CreateShader, DeleteShader, ShaderSource, CompileShader,
+			GetShaderiv, GetShaderInfoLog, CreateProgram, DeleteProgram,
+			AttachShader, LinkProgram, ValidateProgram, GetProgramiv,
+			GetProgramInfoLog, GetAttribLocation, GetUniformLocation,
+
+			Uniform1i, Uniform1f, Uniform2f, Uniform3f, Uniform4f,
+			UniformMatrix2fv, UniformMatrix3fv,
+
+			GetString,
+
+			CALL_COUNT
+		};
+
+		enum
+		{
+			TEXTURE_UNITS		= 8,
+			VERTEX_ATTRIBS		= 16
+		};
+
+	private:
+		//! Size of a texture
+		struct TextureSize
+		{
+			GLsizei width, height;
+		};
+
+		std::vector<unsigned char>	m_stream;
+		int							m_calls[CALL_COUNT];
+
+		int							m_errors;
+		const char					*m_lastError;
+
+		//Objects alive, by name (shared between kinds, so mix-ups show)
+		GLuint								m_nextName;
+		std::map<GLuint, GLsizeiptr>		m_buffers;			//!< Sizes
+		std::map<GLuint, TextureSize>		m_textures;
+		std::set<GLuint>					m_framebuffers;
+		std::set<GLuint>					m_shaders;
+		std::set<GLuint>					m_programs;
+
+		//Locations handed out, per program and name
+		std::map<std::pair<GLuint, std::string>, GLint>	m_locations;
+		std::map<GLuint, GLint>							m_nextLocation;
+
+		//Bindings
+		GLuint			m_arrayBuffer;
+		GLuint			m_elementBuffer;
+		int				m_activeUnit;
+		GLuint			m_texture[TEXTURE_UNITS];
+		GLuint			m_framebuffer;
+		GLuint			m_program;
+
+		//What draws take their vertices from
+		bool			m_vertexArray;
+		int				m_attribArrays;
+
+		//Matrix stacks (OpenGL ES 1x)
+		GLenum			m_matrixMode;
+		int				m_matrixDepth[3];
+
+		GLint			m_width, m_height;
+		std::string		m_extensions;
+
+		//! Start logging a call
+		void call(Call in_call);
+
+		//! Log an argument
+		void word(GLuint in_value);
+		void real(GLfloat in_value);
+
+		//! Log a vertex or index pointer (see GPURecordingBackend.h)
+		void pointer(GLuint in_buffer, const GLvoid *in_pointer);
+
+		//! A check failed
+		void error(const char *in_message);
+
+		//! A new name
+		GLuint create();
+
+		//! Matrix stack of the current mode
+		int &matrixDepth();
+
+		//! Stop tracking a buffer, texture or frame buffer (unbinding it)
+		void forget(GLuint in_name);
+
+	public:
+		//! in_width, in_height: size of the screen's render buffer
+		RecordingBackend(GLint in_width = 320, GLint in_height = 480);
+
+		//! The log
+		inline const unsigned char *stream() const	{	return m_stream.empty() ? NULL : &m_stream[0];	}
+
+		//! Bytes logged
+		inline int size() const						{	return (int)m_stream.size();	}
+
+		//! Times a call was made
+		inline int calls(Call in_call) const		{	return m_calls[in_call];		}
+
+		//! Calls made
+		int calls() const;
+
+		//! Checks that failed
+		inline int errors() const					{	return m_errors;				}
+
+		//! Message of the last check that failed (NULL: none)
+		inline const char *lastError() const		{	return m_lastError;				}
+
+		//! Empty the log and reset the counts (objects and bindings remain)
+		void clear();
+
+		//! What getString(GL_EXTENSIONS) answers (none by default)
+		void setExtensions(const char *in_extensions);
+
+		//! Name of a call, as the GL has it
+		static const char *name(Call in_call);
+
+
+		void enable(GLenum in_cap);
+		void disable(GLenum in_cap);
+		void enableClientState(GLenum in_array);
+		void disableClientState(GLenum in_array);
+		void enableVertexAttribArray(GLuint in_index);
+		void disableVertexAttribArray(GLuint in_index);
+		void blendFunc(GLenum in_src, GLenum in_dst);
+		void viewport(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height);
+		void scissor(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height);
+		void activeTexture(GLenum in_unit);
+		void bindTexture(GLenum in_target, GLuint in_texture);
+		void bindFramebuffer(GLenum in_target, GLuint in_framebuffer);
+		void bindBuffer(GLenum in_target, GLuint in_buffer);
+		void useProgram(GLuint in_program);
+
+		void matrixMode(GLenum in_mode);
+		void loadIdentity();
+		void pushMatrix();
+		void popMatrix();
+		void translatef(GLfloat in_x, GLfloat in_y, GLfloat in_z);
+		void scalef(GLfloat in_x, GLfloat in_y, GLfloat in_z);
+		void multMatrixf(const GLfloat *in_m);
+
+		void vertexPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+						   const GLvoid *in_pointer);
+		void colorPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+						  const GLvoid *in_pointer);
+		void texCoordPointer(GLint in_size, GLenum in_type, GLsizei in_stride,
+							 const GLvoid *in_pointer);
+		void vertexAttribPointer(GLuint in_index, GLint in_size, GLenum in_type,
+								 GLboolean in_normalized, GLsizei in_stride,
+								 const GLvoid *in_pointer);
+		void vertexAttrib4f(GLuint in_index, GLfloat in_x, GLfloat in_y,
+							GLfloat in_z, GLfloat in_w);
+		void vertexAttribDivisor(GLuint in_index, GLuint in_divisor);
+
+		void drawArrays(GLenum in_mode, GLint in_first, GLsizei in_count);
+		void drawElements(GLenum in_mode, GLsizei in_count, GLenum in_type,
+						  const GLvoid *in_indices);
+		void drawArraysInstanced(GLenum in_mode, GLint in_first, GLsizei in_count,
+								 GLsizei in_instances);
+		void readPixels(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height,
+						GLenum in_format, GLenum in_type, GLvoid *out_pixels);
+
+		void genBuffers(GLsizei in_n, GLuint *out_buffers);
+		void deleteBuffers(GLsizei in_n, const GLuint *in_buffers);
+		void bufferData(GLenum in_target, GLsizeiptr in_size,
+						const GLvoid *in_data, GLenum in_usage);
+		void bufferSubData(GLenum in_target, GLintptr in_offset,
+						   GLsizeiptr in_size, const GLvoid *in_data);
+
+		void genTextures(GLsizei in_n, GLuint *out_textures);
+		void deleteTextures(GLsizei in_n, const GLuint *in_textures);
+		void texParameteri(GLenum in_target, GLenum in_name, GLint in_value);
+		void texImage2D(GLenum in_target, GLint in_level, GLint in_internalFormat,
+						GLsizei in_width, GLsizei in_height, GLint in_border,
+						GLenum in_format, GLenum in_type, const GLvoid *in_pixels);
+		void texSubImage2D(GLenum in_target, GLint in_level, GLint in_x, GLint in_y,
+						   GLsizei in_width, GLsizei in_height,
+						   GLenum in_format, GLenum in_type, const GLvoid *in_pixels);
+
+		void genFramebuffers(GLsizei in_n, GLuint *out_framebuffers);
+		void deleteFramebuffers(GLsizei in_n, const GLuint *in_framebuffers);
+		void framebufferTexture2D(GLenum in_target, GLenum in_attachment,
+								  GLenum in_textureTarget, GLuint in_texture, GLint in_level);
+		void framebufferRenderbuffer(GLenum in_target, GLenum in_attachment,
+									 GLenum in_renderbufferTarget, GLuint in_renderbuffer);
+		GLenum checkFramebufferStatus(GLenum in_target);
+		void getRenderbufferParameteriv(GLenum in_target, GLenum in_name, GLint *out_value);
+
+		GLuint createShader(GLenum in_type);
+		void deleteShader(GLuint in_shader);
+		void shaderSource(GLuint in_shader, GLsizei in_count,
+						  const GLchar **in_strings, const GLint *in_lengths);
+		void compileShader(GLuint in_shader);
+		void getShaderiv(GLuint in_shader, GLenum in_name, GLint *out_value);
+		void getShaderInfoLog(GLuint in_shader, GLsizei in_size,
+							  GLsizei *out_length, GLchar *out_log);
+		GLuint createProgram();
+		void deleteProgram(GLuint in_program);
+		void attachShader(GLuint in_program, GLuint in_shader);
+		void linkProgram(GLuint in_program);
+		void validateProgram(GLuint in_program);
+		void getProgramiv(GLuint in_program, GLenum in_name, GLint *out_value);
+		void getProgramInfoLog(GLuint in_program, GLsizei in_size,
+							   GLsizei *out_length, GLchar *out_log);
+		GLint getAttribLocation(GLuint in_program, const GLchar *in_name);
+		GLint getUniformLocation(GLuint in_program, const GLchar *in_name);
+
+		void uniform1i(GLint in_location, GLint in_x);
+		void uniform1f(GLint in_location, GLfloat in_x);
+		void uniform2f(GLint in_location, GLfloat in_x, GLfloat in_y);
+		void uniform3f(GLint in_location, GLfloat in_x, GLfloat in_y, GLfloat in_z);
+		void uniform4f(GLint in_location, GLfloat in_x, GLfloat in_y, GLfloat in_z, GLfloat in_w);
+		void uniformMatrix2fv(GLint in_location, GLsizei in_count,
+							  GLboolean in_transpose, const GLfloat *in_m);
+		void uniformMatrix3fv(GLint in_location, GLsizei in_count,
+							  GLboolean in_transpose, const GLfloat *in_m);
+
+		const GLubyte *getString(GLenum in_name);
+	};
+};
+
+#endif
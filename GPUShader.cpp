@@ -0,0 +1,194 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *	 
+ *	 http://www.apache.org/licenses/LICENSE-2.0
+ *	 
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#include "GPUShader.h"
+
+#include "APError.h"
+#include "Smart.h"
+
+namespace GPU
+{
+	Shader::Shader()
+	{
+		m_program = 0;
+	}
+
+	void Shader::initFromSource(const char *in_name, const char *in_vertex, const char *in_fragment)
+	{
+		if (m_program != 0)
+		{
+			State::forgetProgram(m_program);
+			backend().deleteProgram(m_program);
+			m_program = 0;
+		}
+		
+		m_program = backend().createProgram();
+		
+		
+		//Compile...
+		GLuint vertShader = backend().createShader(GL_VERTEX_SHADER);
+		GLuint fragShader = backend().createShader(GL_FRAGMENT_SHADER);
+		
+		backend().shaderSource(vertShader, 1, &in_vertex, NULL);
+		backend().compileShader(vertShader);
+		
+		backend().shaderSource(fragShader, 1, &in_fragment, NULL);
+		backend().compileShader(fragShader);
+		
+		
+		//Display any errors
+		int logLength = 0;
+		backend().getShaderiv(vertShader, GL_INFO_LOG_LENGTH, &logLength);
+		if (logLength > 0)
+		{
+			Many<char> x(new char[logLength]);
+			backend().getShaderInfoLog(vertShader, logLength, &logLength, x());
+			
+			printf("\n\nLog for Vertex Shader %s\n%s\n", in_name, x());
+		}
+		
+		backend().getShaderiv(fragShader, GL_INFO_LOG_LENGTH, &logLength);
+		if (logLength > 0)
+		{
+			Many<char> x(new char[logLength]);
+			backend().getShaderInfoLog(fragShader, logLength, &logLength, x());
+			
+			printf("\n\nLog for Vertex Shader %s\n%s\n", in_name, x());
+		}
+		
+		
+		//Destroy the object upon any error
+		int vertStatus=0, fragStatus=0;
+		backend().getShaderiv(vertShader, GL_COMPILE_STATUS, &vertStatus);
+		backend().getShaderiv(fragShader, GL_COMPILE_STATUS, &fragStatus);
+		
+		if (vertStatus == 0 || fragStatus == 0)
+		{
+			backend().deleteShader(vertShader);
+			backend().deleteShader(fragShader);
+			
+			throw APError("Failed to compile shader %s", in_name);
+		}
+		
+		
+		//Attach shaders to program
+		backend().attachShader(m_program, vertShader);
+		backend().attachShader(m_program, fragShader);
+		
+		
+		//Bind the attributes
+		
+		
+		//Link the program
+		int status=0;
+		backend().linkProgram(m_program);
+		
+		backend().getProgramiv(m_program, GL_INFO_LOG_LENGTH, &logLength);
+		if (logLength > 0)
+		{
+			Many<char> x(new char[logLength]);
+			backend().getProgramInfoLog(m_program, logLength, &logLength, x());
+			
+			printf("\n\nLog for linking %s\n%s\n", in_name, x());
+		}
+		
+		backend().getProgramiv(m_program, GL_LINK_STATUS, &status);
+		if (status == 0)
+		{
+			backend().deleteShader(vertShader);
+			backend().deleteShader(fragShader);
+			throw APError("Failed to link shader %s", in_name);
+		}
+		
+		
+		//Validate the program
+		backend().validateProgram(m_program);
+		
+		backend().getProgramiv(m_program, GL_INFO_LOG_LENGTH, &logLength);
+		if (logLength > 0)
+		{
+			Many<char> x(new char[logLength]);
+			backend().getProgramInfoLog(m_program, logLength, &logLength, x());
+			
+			printf("\n\nLog for validating %s\n%s\n", in_name, x());
+		}
+		
+		backend().getProgramiv(m_program, GL_VALIDATE_STATUS, &status);
+		if (status == 0)
+		{
+			throw APError("Failed to validate program %s", in_name);
+		}
+		backend().deleteShader(vertShader);
+		backend().deleteShader(fragShader);
+	}
+	
+	
+	Uniform Shader::getUniform(const char *in_name) const
+	{
+		GLint offset = backend().getUniformLocation(m_program, in_name);
+		
+		if (offset == -1)
+			throw APError("Unable to find uniform %s", in_name);
+		
+		return Uniform(offset);
+	}
+	
+	
+	Attribute Shader::getAttribute(const char *in_name) const
+	{
+		GLint offset = backend().getAttribLocation(m_program, in_name);
+		
+		if (offset == -1)
+			throw APError("Unable to find attribute %s", in_name);
+		
+		return Attribute((GLuint)offset);
+	}
+	
+	
+	void Shader::unloadShader()
+	{
+		if (m_program)
+		{
+			State::forgetProgram(m_program);
+			backend().deleteProgram(m_program);
+			m_program = 0;
+		}
+	}
+	
+	
+	Shader::~Shader()
+	{
+		unloadShader();
+	}
+	
+	
+	
+	BindShader::BindShader(Shader *in_program)
+	{
+		m_prevProgram = State::program();
+		State::useProgram(in_program->m_program);
+	}
+	
+	void BindShader::rebind(Shader *in_program)
+	{
+		State::useProgram(in_program->m_program);
+	}
+	
+	BindShader::~BindShader()
+	{
+		State::useProgram(m_prevProgram);
+	}
+}
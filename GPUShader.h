@@ -17,7 +17,7 @@
 #ifndef BubblePod_GPUShader_h
 #define BubblePod_GPUShader_h
 
-#include <OpenGLES/ES2/gl.h>
+#include "GPUTypes.h"
 
 #include "Coord2D.h"
 #include "Coord3D.h"
@@ -25,6 +25,8 @@
 #include "Matrix2D.h"
 #include "Matrix3D.h"
 #include "GPUBuffer.h"
+#include "GPUState.h"
+#include "GPUBackend.h"
 
 /*!	\file	GPUShader.h
 	\brief	The ability to specify a shader for a given VBO
@@ -57,31 +59,31 @@ namespace GPU
 		
 		//! Send in an integer
 		void set(const int in_val) const
-		{	glUniform1i(offset, in_val);	}
+		{	backend().uniform1i(offset, in_val);	}
 	
 		//! Send in a scalar
 		void set(const float in_val) const
-		{	glUniform1f(offset, in_val);	}
+		{	backend().uniform1f(offset, in_val);	}
 		
 		//! Send in a vector-2
 		void set(const Coord2D &in_val) const
-		{	glUniform2f(offset, in_val.x, in_val.y);	}
+		{	backend().uniform2f(offset, in_val.x, in_val.y);	}
 		
 		//! Send in a vector-3
 		void set(const Coord3D &in_val) const
-		{	glUniform3f(offset, in_val.x, in_val.y, in_val.z);	}
+		{	backend().uniform3f(offset, in_val.x, in_val.y, in_val.z);	}
 		
 		//! Send in a vector-4
 		void set(const Coord4D &in_val) const
-		{	glUniform4f(offset, in_val.x, in_val.y, in_val.z, in_val.w);	}
+		{	backend().uniform4f(offset, in_val.x, in_val.y, in_val.z, in_val.w);	}
 		
 		//! Send in a matrix2x2
 		void set(const Matrix2D &in_val) const
-		{	glUniformMatrix2fv(offset, 1, GL_FALSE, (float*)in_val.rows);	}
+		{	backend().uniformMatrix2fv(offset, 1, GL_FALSE, (float*)in_val.rows);	}
 		
 		//! Send in a matrix3x3
 		void set(const Matrix3D &in_val) const
-		{	glUniformMatrix3fv(offset, 1, GL_FALSE, (float*)in_val.rows);	}
+		{	backend().uniformMatrix3fv(offset, 1, GL_FALSE, (float*)in_val.rows);	}
 	};
 	
 	
@@ -105,8 +107,28 @@ namespace GPU
 		//! Associate to a specified VBO index
 		void attribPointer(int in_size, unsigned int in_type, bool in_normalize, int in_stride, const void *in_pointer)
 		{
-			glEnableVertexAttribArray(offset);	//TODO: make this better...
-			glVertexAttribPointer(offset, in_size, in_type, in_normalize, in_stride, in_pointer);
+			State::vertexAttribArray(offset, true);
+			backend().vertexAttribPointer(offset, in_size, in_type, in_normalize, in_stride, in_pointer);
+		}
+		
+		//! Give every vertex the same value, rather than reading an array
+		void constant(const Coord4D &in_val)
+		{
+			State::vertexAttribArray(offset, false);
+			backend().vertexAttrib4f(offset, in_val.x, in_val.y, in_val.z, in_val.w);
+		}
+		
+		//! Stop reading the array
+		void disable()
+		{
+			State::vertexAttribArray(offset, false);
+		}
+		
+		//! Advance once per in_divisor instances rather than per vertex
+		/*!	Needs Support::Instancing(); 0 goes back to per vertex	*/
+		void divisor(GLuint in_divisor)
+		{
+			backend().vertexAttribDivisor(offset, in_divisor);
 		}
 	
 		//! Associate an attribute to an element within a VBO
@@ -146,6 +168,15 @@ namespace GPU
 			 */
 		void init(const char *in_szFile);
 		
+		//! Load a new shader from source code
+		/*!	\param in_name		Name of the shader (for error messages)
+			\param in_vertex	Code of the vertex shader
+			\param in_fragment	Code of the fragment shader	*/
+		void initFromSource(const char *in_name, const char *in_vertex, const char *in_fragment);
+		
+		//! The GL program (0 if not loaded)
+		GLuint program() const		{	return m_program;	}
+		
 		//! Get the location of a given uniform
 		Uniform getUniform(const char *in_name) const;
 		
@@ -18,23 +18,13 @@
 
 #include <Foundation/Foundation.h>
 #include "APError.h"
-#include "Smart.h"
+
+//The rest of GPU::Shader is in GPUShader.cpp: only loading from the bundle needs Foundation
 
 namespace GPU
 {
-	Shader::Shader()
-	{
-		m_program = 0;
-	}
-
 	void Shader::init(const char *in_szFile)
 	{
-		if (m_program != 0)
-		{
-			glDeleteProgram(m_program);
-			m_program = 0;
-		}
-	
 		NSString *s = [NSString stringWithUTF8String:in_szFile];
 		
 		// Get the files
@@ -44,8 +34,6 @@ namespace GPU
 		NSLog(@"GPU::Shader::init::vert_shader=%@", vertPath);
 		NSLog(@"GPU::Shader::init::frag_shader=%@", fragPath);
 		
-		m_program = glCreateProgram();
-		
 		if (vertPath == nil || fragPath == nil)
 		{
 			throw APError("Unable to find %s in bundle", in_szFile);
@@ -61,172 +49,6 @@ namespace GPU
 			throw APError("Unable to load contents of %s", in_szFile);
 		}
 		
-		
-		//Compile...
-		GLuint vertShader = glCreateShader(GL_VERTEX_SHADER);
-		GLuint fragShader = glCreateShader(GL_FRAGMENT_SHADER);
-		
-		const char* vertCCode = [vertCode UTF8String];
-		const char* fragCCode = [fragCode UTF8String];
-		
-		glShaderSource(vertShader, 1, &vertCCode, NULL);
-		glCompileShader(vertShader);
-		
-		glShaderSource(fragShader, 1, &fragCCode, NULL);
-		glCompileShader(fragShader);
-		
-		
-		//Display any errors
-		int logLength = 0;
-		glGetShaderiv(vertShader, GL_INFO_LOG_LENGTH, &logLength);
-		if (logLength > 0)
-		{
-			Many<char> x(new char[logLength]);
-			glGetShaderInfoLog(vertShader, logLength, &logLength, x());
-			
-			printf("\n\nLog for Vertex Shader %s\n%s\n", in_szFile, x());
-		}
-		
-		glGetShaderiv(fragShader, GL_INFO_LOG_LENGTH, &logLength);
-		if (logLength > 0)
-		{
-			Many<char> x(new char[logLength]);
-			glGetShaderInfoLog(fragShader, logLength, &logLength, x());
-			
-			printf("\n\nLog for Vertex Shader %s\n%s\n", in_szFile, x());
-		}
-		
-		
-		//Destroy the object upon any error
-		int vertStatus=0, fragStatus=0;
-		glGetShaderiv(vertShader, GL_COMPILE_STATUS, &vertStatus);
-		glGetShaderiv(fragShader, GL_COMPILE_STATUS, &fragStatus);
-		
-		if (vertStatus == 0 || fragStatus == 0)
-		{
-			glDeleteShader(vertShader);
-			glDeleteShader(fragShader);
-			
-			throw APError("Failed to compile shader %s", in_szFile);
-		}
-		
-		
-		//Attach shaders to program
-		glAttachShader(m_program, vertShader);
-		glAttachShader(m_program, fragShader);
-		
-		
-		//Bind the attributes
-		
-		
-		//Link the program
-		int status=0;
-		glLinkProgram(m_program);
-		
-		glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &logLength);
-		if (logLength > 0)
-		{
-			Many<char> x(new char[logLength]);
-			glGetProgramInfoLog(m_program, logLength, &logLength, x());
-			
-			printf("\n\nLog for linking %s\n%s\n", in_szFile, x());
-		}
-		
-		glGetProgramiv(m_program, GL_LINK_STATUS, &status);
-		if (status == 0)
-		{
-			glDeleteShader(vertShader);
-			glDeleteShader(fragShader);
-			throw APError("Failed to link shader %s", in_szFile);
-		}
-		
-		
-		//Validate the program
-		glValidateProgram(m_program);
-		
-		glGetProgramiv(m_program, GL_INFO_LOG_LENGTH, &logLength);
-		if (logLength > 0)
-		{
-			Many<char> x(new char[logLength]);
-			glGetProgramInfoLog(m_program, logLength, &logLength, x());
-			
-			printf("\n\nLog for validating %s\n%s\n", in_szFile, x());
-		}
-		
-		glGetProgramiv(m_program, GL_VALIDATE_STATUS, &status);
-		if (status == 0)
-		{
-			throw APError("Failed to validate program %s", in_szFile);
-		}
-		glDeleteShader(vertShader);
-		glDeleteShader(fragShader);
-	}
-	
-	
-	Uniform Shader::getUniform(const char *in_name) const
-	{
-		GLint offset = glGetUniformLocation(m_program, in_name);
-		
-		if (offset == -1)
-			throw APError("Unable to find uniform %s", in_name);
-		
-		return Uniform(offset);
-	}
-	
-	
-	Attribute Shader::getAttribute(const char *in_name) const
-	{
-		GLint offset = glGetAttribLocation(m_program, in_name);
-		
-		if (offset == -1)
-			throw APError("Unable to find attribute %s", in_name);
-		
-		return Attribute((GLuint)offset);
-	}
-	
-	
-	void Shader::unloadShader()
-	{
-		if (m_program)
-		{
-			glDeleteProgram(m_program);
-			m_program = 0;
-		}
-	}
-	
-	
-	Shader::~Shader()
-	{
-		unloadShader();
-	}
-	
-	
-	
-	static GLuint g_bound = 0;		//!< Currently bound shader
-	
-	BindShader::BindShader(Shader *in_program)
-	{
-		m_prevProgram = g_bound;
-		g_bound = in_program->m_program;
-		
-		if (g_bound != m_prevProgram)
-			glUseProgram(g_bound);
-	}
-	
-	void BindShader::rebind(Shader *in_program)
-	{
-		if (in_program->m_program != g_bound)
-		{
-			g_bound = in_program->m_program;
-			glUseProgram(g_bound);
-		}
-	}
-	
-	BindShader::~BindShader()
-	{
-		if (g_bound != m_prevProgram)
-			glUseProgram(m_prevProgram);
-		
-		g_bound = m_prevProgram;
+		initFromSource(in_szFile, [vertCode UTF8String], [fragCode UTF8String]);
 	}
 }
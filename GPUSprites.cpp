@@ -0,0 +1,211 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *	 http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#include "GPUSprites.h"
+#include "GPUExtensions.h"
+#include "GPUStats.h"
+
+#include <stddef.h>
+#include <string.h>
+
+//! Expands a sprite record into the corner a_corner of its quad
+static const char *g_spriteVertexShader =
+	"attribute vec2 a_corner;\n"
+	"attribute vec2 a_position;\n"
+	"attribute vec4 a_atlas;\n"
+	"attribute vec2 a_scale;\n"
+	"attribute float a_angle;\n"
+	"attribute vec4 a_colour;\n"
+	"uniform mat3 u_projection;\n"
+	"uniform vec2 u_texel;\n"
+	"uniform float u_unit;\n"
+	"varying lowp vec4 v_colour;\n"
+	"varying mediump vec2 v_texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 size = a_atlas.zw * a_scale * (u_unit / 256.0);\n"
+	"	vec2 p = (a_corner - 0.5) * size;\n"
+	"	float angle = a_angle * (6.2831853 / 65536.0);\n"
+	"	float c = cos(angle);\n"
+	"	float s = sin(angle);\n"
+	"	p = vec2(c*p.x - s*p.y, s*p.x + c*p.y) + a_position;\n"
+	"	vec3 q = vec3(p, 1.0) * u_projection;\n"
+	"	gl_Position = vec4(q.xy, 0.0, 1.0);\n"
+	"	v_colour = a_colour;\n"
+	"	v_texCoord = (a_atlas.xy + a_corner * a_atlas.zw) * u_texel;\n"
+	"}\n";
+
+static const char *g_spriteFragmentShader =
+	"varying lowp vec4 v_colour;\n"
+	"varying mediump vec2 v_texCoord;\n"
+	"uniform sampler2D u_texture;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = v_colour * texture2D(u_texture, v_texCoord);\n"
+	"}\n";
+
+//! Names of the attributes, in the order of Sprite::description()
+static const char *g_spriteAttributes[] = {	"a_position", "a_atlas", "a_scale",
+											"a_angle", "a_colour"	};
+
+
+namespace GPU
+{
+	namespace Type
+	{
+		namespace Description
+		{
+			const TypeDescription Sprite::desc[]
+			=	{	TypeDescription(Int16,		2, offsetof(Sprite, position)),
+					TypeDescription(Int16,		4, offsetof(Sprite, atlas)),
+					TypeDescription(Int16,		2, offsetof(Sprite, scale)),
+					TypeDescription(Int16,		1, offsetof(Sprite, angle)),
+					TypeDescription(Int8,		4, offsetof(Sprite, colour))	};
+
+			const int Sprite::length()
+			{	return sizeof(desc) / sizeof(TypeDescription);	}
+		}
+	};
+
+
+	//! Corners of quads, (0,0) to (1,1) in strip order
+	class SpriteCorners : public VBO
+	{
+	public:
+		SpriteCorners(int in_quads)
+		: VBO(in_quads * 4 * 2, true, true)
+		{
+			static const GLubyte corner[8] = {0,0, 1,0, 0,1, 1,1};
+
+			Many<GLubyte> data(new GLubyte[in_quads * 8]);
+			for (int i=0; i<in_quads; i++)
+				memcpy(data() + i*8, corner, sizeof(corner));
+
+			uploadData(data());
+		}
+	};
+
+
+	//! in_capacity, if a batch can hold that many sprites
+	static int validCapacity(int in_capacity, bool in_instanced)
+	{
+		if (in_capacity <= 0 || (!in_instanced && in_capacity > GPU_QUAD_INDICES))
+			throw "SpriteBatch::SpriteBatch::Invalid capacity";
+
+		return in_capacity;
+	}
+
+
+	SpriteBatch::SpriteBatch(int in_capacity)
+	: m_instanced(Support::Instancing())
+	, m_capacity(validCapacity(in_capacity, m_instanced))
+	, m_count(0)
+	, m_sprites(m_capacity * (m_instanced ? 1 : 4), false)
+	{
+		if (m_instanced)
+		{
+			m_corners = new SpriteCorners(1);
+		}
+		else
+		{
+			m_corners = new SpriteCorners(in_capacity);
+		}
+
+		m_shader.initFromSource("sprites", g_spriteVertexShader, g_spriteFragmentShader);
+
+		m_corner = m_shader.getAttribute("a_corner");
+		for (int i=0; i<Sprite::length(); i++)
+			m_attributes[i] = m_shader.getAttribute(g_spriteAttributes[i]);
+
+		m_projection = m_shader.getUniform("u_projection");
+		m_texel = m_shader.getUniform("u_texel");
+
+		BindShader s(&m_shader);
+		m_shader.getUniform("u_unit").set((float)POSITION_MULT);
+		m_shader.getUniform("u_texture").set(0);
+		m_projection.set(Matrix3D());
+		m_texel.set(Coord2D(1.0f/1024.0f, 1.0f/1024.0f));
+	}
+
+
+	void SpriteBatch::setProjection(const Matrix3D &in_projection)
+	{
+		draw();
+
+		BindShader s(&m_shader);
+		m_projection.set(in_projection);
+	}
+
+
+	void SpriteBatch::setTextureSize(int in_width, int in_height)
+	{
+		draw();
+
+		BindShader s(&m_shader);
+		m_texel.set(Coord2D(1.0f/in_width, 1.0f/in_height));
+	}
+
+
+	void SpriteBatch::draw()
+	{
+		if (m_count == 0)
+			return;
+
+		//What came before goes below
+		gliCurrent().flush();
+
+		BindShader s(&m_shader);
+		BindVBO v(&m_sprites);
+
+		m_sprites.sync(m_instanced ? m_count : m_count*4);
+
+		const Type::TypeDescription *d = Sprite::description();
+		for (int i=0; i<Sprite::length(); i++)
+		{
+			m_attributes[i].attribPointer(d[i].size(), d[i].type(), d[i].type() == Type::Int8,
+										  sizeof(Sprite), (const char*)NULL + d[i].offset());
+
+			if (m_instanced)
+				m_attributes[i].divisor(1);
+		}
+
+		v.rebind(m_corners());
+		m_corner.attribPointer(2, GL_UNSIGNED_BYTE, false, 0, NULL);
+
+		if (m_instanced)
+		{
+			backend().drawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_count);
+
+			//Other shaders may use these attributes
+			for (int i=0; i<Sprite::length(); i++)
+				m_attributes[i].divisor(0);
+		}
+		else
+		{
+			BindVBO i(quadIndices());
+			backend().drawElements(GL_TRIANGLES, m_count*6, GL_UNSIGNED_SHORT, NULL);
+		}
+
+		Stats::count(Stats::DrawCalls);
+		Stats::count(Stats::Vertices, m_count*4);
+
+		m_corner.disable();
+		for (int i=0; i<Sprite::length(); i++)
+			m_attributes[i].disable();
+
+		m_count = 0;
+	}
+};
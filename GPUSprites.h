@@ -0,0 +1,180 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#ifndef BubblePod_GPUSprites_h
+#define BubblePod_GPUSprites_h
+
+#include "Angle.h"
+#include "Coord2D.h"
+#include "Coord4D.h"
+#include "Matrix3D.h"
+#include "Rect2D.h"
+#include "Immediate.h"
+#include "GPUBuffer.h"
+#include "GPUShader.h"
+
+/*!	\file	GPUSprites.h
+	\brief	Sprites drawn from one compact record each (OpenGL ES 2x).
+
+	Through gli, a sprite is four full vertices, worked out on the CPU.  A
+	SpriteBatch rather keeps one Type::Description::Sprite per sprite: where
+	it is, its size, rotation, atlas rectangle and colour.  Its shader makes
+	the quad out of that.
+
+	With Support::Instancing(), the records are uploaded as they are and the
+	quad is drawn once per record.  Without, every record is written four
+	times, once per corner; the corners come from a buffer that never
+	changes, and the triangles from GPU::quadIndices().  The shader is the
+	same either way.
+
+	Positions are in the units of gli::vertex(), and the texture is the one
+	bound to unit 0.	*/
+
+namespace GPU
+{
+	namespace Type
+	{
+		namespace Description
+		{
+			//! A sprite, expanded into a quad by SpriteBatch (22 bytes)
+			class Sprite
+			{
+				static const TypeDescription desc[];
+
+			public:
+				GLshort		position[2];	//!< Centre, in submission units (see POSITION_MULT)
+				GLshort		atlas[4];		//!< Corner and size in the texture, in texels
+				GLshort		scale[2];		//!< Size on screen per texel, in 256ths
+				GLshort		angle;			//!< Rotation about the centre, in 65536ths of a turn
+				ByteCoord4D	colour;			//!< x=r, y=g, z=b, w=a
+
+				static const int length();
+				static const TypeDescription* description() { return desc;	}
+			};
+		};
+	};
+
+
+	//! Draws many sprites with a few GL calls
+	/*!	Sprites are added between draw() calls; a full batch draws itself.
+		Whatever gli batched is drawn first, so that sprites land on top of
+		what was drawn before them.
+
+		Needs an OpenGL ES 2 context (with gli, see gli::setProgrammable).
+
+	\code
+GPU::SpriteBatch sprites(1000);
+sprites.setProjection(gliOrtho(0, 320, 480, 0));
+
+for (int i=0; i<count; i++)
+	sprites.add(ships[i].position, Coord2D(1, 1), ships[i].heading,
+				Rect2D(0, 64, 32, 32));
+sprites.draw();
+	\endcode	*/
+	class SpriteBatch
+	{
+	private:
+		typedef Type::Description::Sprite Sprite;
+
+		//! Draw with instancing?  (Otherwise every record is written 4 times)
+		const bool		m_instanced;
+
+		//! Sprites drawn at once
+		const int		m_capacity;
+
+		//! Sprites added since the last draw()
+		int				m_count;
+
+		//! The records (4 per sprite without instancing)
+		Type::TVBO<Sprite>	m_sprites;
+
+		//! Corner of every vertex (4, or 4 per sprite without instancing)
+		One<VBO>		m_corners;
+
+		Shader			m_shader;
+		Attribute		m_corner;
+		Attribute		m_attributes[5];	//!< As in Sprite::description()
+		Uniform			m_projection;
+		Uniform			m_texel;
+
+	public:
+		//! Room for in_capacity sprites per draw call
+		/*!	Without instancing, at most GPU_QUAD_INDICES	*/
+		SpriteBatch(int in_capacity);
+
+		//! Projection applied to positions (see gliOrtho)
+		void setProjection(const Matrix3D &in_projection);
+
+		//! Size of the texture atlases, in texels (1024 by default, as gli)
+		void setTextureSize(int in_width, int in_height);
+
+		//! Add a sprite
+		/*!	\param in_position	Centre
+			\param in_scale		Size on screen of a texel (1: drawn at the
+								size of in_atlas, up to 127)
+			\param in_angle		Rotation about the centre
+			\param in_atlas		Where the sprite is in the texture (texels)
+			\param in_colour	Multiplies the texture	*/
+		inline void add(const Coord2D &in_position, const Coord2D &in_scale,
+						const Angle &in_angle, const Rect2D &in_atlas,
+						const ByteCoord4D &in_colour = ByteCoord4D(255, 255, 255, 255))
+		{
+			if (m_count == m_capacity)
+				draw();
+
+			const int copies = m_instanced ? 1 : 4;
+			Sprite *s = &m_sprites[m_count * copies];
+
+			s->position[0] = (GLshort)(in_position.x * POSITION_MULT);
+			s->position[1] = (GLshort)(in_position.y * POSITION_MULT);
+			s->atlas[0] = (GLshort)in_atlas.corner.x;
+			s->atlas[1] = (GLshort)in_atlas.corner.y;
+			s->atlas[2] = (GLshort)in_atlas.size.x;
+			s->atlas[3] = (GLshort)in_atlas.size.y;
+			s->scale[0] = (GLshort)(in_scale.x * 256);
+			s->scale[1] = (GLshort)(in_scale.y * 256);
+			//Wraps around at half a turn, as the angle does
+			const float turns = in_angle.radians() * (float)(32768 / M_PI);
+			s->angle = (GLshort)(int)(turns < 0 ? turns - 0.5f : turns + 0.5f);
+			s->colour = in_colour;
+
+			for (int i=1; i<copies; i++)
+				s[i] = s[0];
+
+			m_count++;
+		}
+
+		//! Sprites added since the last draw()
+		inline int count() const					{	return m_count;		}
+
+		//! Sprites drawn at once
+		inline int capacity() const					{	return m_capacity;	}
+
+		//! Are instances drawn, or every corner written?
+		inline bool isInstanced() const				{	return m_instanced;	}
+
+		//! Bytes uploaded per sprite
+		inline int bytesPerSprite() const
+		{
+			return sizeof(Sprite) * (m_instanced ? 1 : 4);
+		}
+
+		//! Draw the sprites added, and start over
+		void draw();
+	};
+};
+
+#endif
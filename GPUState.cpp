@@ -0,0 +1,369 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *	 http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#include "GPUState.h"
+#include "GPUBackend.h"
+#include "GPUStats.h"
+
+#ifndef GPU_HEADLESS
+#include <OpenGLES/ES1/gl.h>
+#endif
+
+namespace GPU
+{
+	namespace State
+	{
+		//! Calls counted this frame, and the frame before
+		static Counters g_frame = {0, 0};
+		static Counters g_lastFrame = {0, 0};
+
+
+		//! What the GL was last told (nothing is known until it is told)
+		template<class T>
+		class Shadow
+		{
+		private:
+			T		m_value;
+			bool	m_known;
+
+		public:
+			Shadow() : m_value(), m_known(false)	{}
+
+			//! Record in_value; false (and counted as skipped) if already set
+			bool set(const T &in_value)
+			{
+				if (m_known && m_value == in_value)
+				{
+					g_frame.skipped++;
+					return false;
+				}
+
+				m_value = in_value;
+				m_known = true;
+				g_frame.issued++;
+				return true;
+			}
+
+			//! Last value set (T() when unknown)
+			T get() const					{	return m_known ? m_value : T();	}
+
+			//! Was a value set?
+			bool known() const				{	return m_known;					}
+
+			//! Was in_value the last value set?
+			bool is(const T &in_value) const	{	return m_known && m_value == in_value;	}
+
+			//! The GL changed the value by itself
+			void assume(const T &in_value)	{	m_value = in_value; m_known = true;	}
+
+			//! Forget the value
+			void invalidate()				{	m_known = false;				}
+		};
+
+
+		//! The viewport or scissor rectangle
+		struct Viewport
+		{
+			GLint	x, y;
+			GLsizei	width, height;
+
+			bool operator==(const Viewport &in_o) const
+			{
+				return x == in_o.x && y == in_o.y
+						&& width == in_o.width && height == in_o.height;
+			}
+		};
+
+
+		//! The blend function
+		struct Blend
+		{
+			GLenum	src, dst;
+
+			bool operator==(const Blend &in_o) const
+			{
+				return src == in_o.src && dst == in_o.dst;
+			}
+		};
+
+
+		enum
+		{
+			TEXTURE_UNITS		= 8,
+			VERTEX_ATTRIBS		= 16
+		};
+
+		//! Capabilities that are tracked
+		static const GLenum g_caps[] = {	GL_TEXTURE_2D, GL_BLEND, GL_SCISSOR_TEST,
+											GL_DEPTH_TEST, GL_CULL_FACE, GL_DITHER	};
+		static const int CAP_COUNT = sizeof(g_caps) / sizeof(g_caps[0]);
+
+		//! Client arrays that are tracked
+		static const GLenum g_arrays[] = {	GL_VERTEX_ARRAY, GL_COLOR_ARRAY,
+											GL_TEXTURE_COORD_ARRAY	};
+		static const int ARRAY_COUNT = sizeof(g_arrays) / sizeof(g_arrays[0]);
+
+		static Shadow<bool>		g_cap[CAP_COUNT];
+		static Shadow<bool>		g_array[ARRAY_COUNT];
+		static Shadow<bool>		g_attrib[VERTEX_ATTRIBS];
+		static Shadow<Blend>	g_blend;
+		static Shadow<Viewport>	g_viewport;
+		static Shadow<Viewport>	g_scissor;
+		static Shadow<int>		g_activeTexture;
+		static Shadow<GLuint>	g_texture[TEXTURE_UNITS];
+		static Shadow<GLuint>	g_framebuffer;
+		static Shadow<GLuint>	g_buffer[2];		//Array, then element
+		static Shadow<GLuint>	g_program;
+
+
+		void enable(GLenum in_cap, bool in_enable)
+		{
+			for (int i=0; i<CAP_COUNT; i++)
+			{
+				if (g_caps[i] == in_cap)
+				{
+					if (!g_cap[i].set(in_enable))
+						return;
+					break;
+				}
+			}
+
+			if (in_enable)
+				backend().enable(in_cap);
+			else
+				backend().disable(in_cap);
+		}
+
+
+		bool isEnabled(GLenum in_cap)
+		{
+			for (int i=0; i<CAP_COUNT; i++)
+				if (g_caps[i] == in_cap)
+					return g_cap[i].get();
+
+			return false;
+		}
+
+
+		void clientState(GLenum in_array, bool in_enable)
+		{
+			for (int i=0; i<ARRAY_COUNT; i++)
+			{
+				if (g_arrays[i] == in_array)
+				{
+					if (!g_array[i].set(in_enable))
+						return;
+					break;
+				}
+			}
+
+			if (in_enable)
+				backend().enableClientState(in_array);
+			else
+				backend().disableClientState(in_array);
+		}
+
+
+		void vertexAttribArray(GLuint in_index, bool in_enable)
+		{
+			if (in_index < VERTEX_ATTRIBS && !g_attrib[in_index].set(in_enable))
+				return;
+
+			if (in_enable)
+				backend().enableVertexAttribArray(in_index);
+			else
+				backend().disableVertexAttribArray(in_index);
+		}
+
+
+		void blendFunc(GLenum in_src, GLenum in_dst)
+		{
+			Blend b = {in_src, in_dst};
+
+			if (g_blend.set(b))
+				backend().blendFunc(in_src, in_dst);
+		}
+
+
+		void viewport(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height)
+		{
+			Viewport v = {in_x, in_y, in_width, in_height};
+
+			if (g_viewport.set(v))
+				backend().viewport(in_x, in_y, in_width, in_height);
+		}
+
+
+		void scissor(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height)
+		{
+			Viewport s = {in_x, in_y, in_width, in_height};
+
+			if (g_scissor.set(s))
+				backend().scissor(in_x, in_y, in_width, in_height);
+		}
+
+
+		bool scissorBox(GLint *out_x, GLint *out_y, GLsizei *out_width, GLsizei *out_height)
+		{
+			if (!g_scissor.known())
+				return false;
+
+			const Viewport s = g_scissor.get();
+			*out_x = s.x;
+			*out_y = s.y;
+			*out_width = s.width;
+			*out_height = s.height;
+			return true;
+		}
+
+
+		void activeTexture(int in_unit)
+		{
+			if (g_activeTexture.set(in_unit))
+				backend().activeTexture(GL_TEXTURE0 + in_unit);
+		}
+
+
+		void bindTexture(int in_unit, GLuint in_texture)
+		{
+			if (in_unit >= TEXTURE_UNITS)
+			{
+				activeTexture(in_unit);
+				backend().bindTexture(GL_TEXTURE_2D, in_texture);
+				Stats::count(Stats::TextureBinds);
+				return;
+			}
+
+			if (g_texture[in_unit].is(in_texture))
+			{
+				g_frame.skipped++;
+				return;
+			}
+
+			activeTexture(in_unit);
+			g_texture[in_unit].set(in_texture);
+			backend().bindTexture(GL_TEXTURE_2D, in_texture);
+			Stats::count(Stats::TextureBinds);
+		}
+
+
+		GLuint boundTexture(int in_unit)
+		{
+			return in_unit < TEXTURE_UNITS ? g_texture[in_unit].get() : 0;
+		}
+
+
+		void bindFramebuffer(GLuint in_framebuffer)
+		{
+			if (g_framebuffer.set(in_framebuffer))
+			{
+				backend().bindFramebuffer(GL_FRAMEBUFFER, in_framebuffer);
+				Stats::count(Stats::FramebufferSwitches);
+			}
+		}
+
+
+		void bindBuffer(GLenum in_target, GLuint in_buffer)
+		{
+			if (g_buffer[in_target == GL_ARRAY_BUFFER ? 0 : 1].set(in_buffer))
+				backend().bindBuffer(in_target, in_buffer);
+		}
+
+
+		void useProgram(GLuint in_program)
+		{
+			if (g_program.set(in_program))
+			{
+				backend().useProgram(in_program);
+				Stats::count(Stats::ShaderBinds);
+			}
+		}
+
+
+		GLuint program()
+		{
+			return g_program.get();
+		}
+
+
+		void forgetTexture(GLuint in_texture)
+		{
+			for (int i=0; i<TEXTURE_UNITS; i++)
+				if (g_texture[i].is(in_texture))
+					g_texture[i].assume(0);
+		}
+
+
+		void forgetFramebuffer(GLuint in_framebuffer)
+		{
+			if (g_framebuffer.is(in_framebuffer))
+				g_framebuffer.assume(0);
+		}
+
+
+		void forgetBuffer(GLuint in_buffer)
+		{
+			for (int i=0; i<2; i++)
+				if (g_buffer[i].is(in_buffer))
+					g_buffer[i].assume(0);
+		}
+
+
+		void forgetProgram(GLuint in_program)
+		{
+			//Stays in use until another is; but its name may be reused
+			if (g_program.is(in_program))
+				g_program.invalidate();
+		}
+
+
+		void invalidate()
+		{
+			for (int i=0; i<CAP_COUNT; i++)			g_cap[i].invalidate();
+			for (int i=0; i<ARRAY_COUNT; i++)		g_array[i].invalidate();
+			for (int i=0; i<VERTEX_ATTRIBS; i++)	g_attrib[i].invalidate();
+			for (int i=0; i<TEXTURE_UNITS; i++)		g_texture[i].invalidate();
+			for (int i=0; i<2; i++)					g_buffer[i].invalidate();
+
+			g_blend.invalidate();
+			g_viewport.invalidate();
+			g_scissor.invalidate();
+			g_activeTexture.invalidate();
+			g_framebuffer.invalidate();
+			g_program.invalidate();
+		}
+
+
+		const Counters &frame()
+		{
+			return g_frame;
+		}
+
+
+		const Counters &lastFrame()
+		{
+			return g_lastFrame;
+		}
+
+
+		void endFrame()
+		{
+			g_lastFrame = g_frame;
+			g_frame.issued = 0;
+			g_frame.skipped = 0;
+		}
+	};
+};
@@ -0,0 +1,129 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#ifndef BubblePod_GPUState_h
+#define BubblePod_GPUState_h
+
+#include "GPUTypes.h"
+
+/*!	\file	GPUState.h
+	\brief	A shadow of the GL state, so that nothing is set twice.
+
+	Changing GL state is costly even when the new value is the one already
+	in place: the driver validates it all the same.  Every part of the
+	library that changes state goes through these functions, which remember
+	what the GL was last told and skip calls that would change nothing.
+
+	Code that talks to the GL directly (or a GL context that is shared) will
+	leave the shadow out of date.  invalidate() forgets what is known; the
+	next call of each function then always reaches the GL.
+
+	Calls that reached the GL and calls that were skipped are counted, so
+	that the savings can be measured: call endFrame() once per frame.
+ */
+
+namespace GPU
+{
+	namespace State
+	{
+		//! Calls made through the cache
+		struct Counters
+		{
+			int issued;			//!< Reached the GL
+			int skipped;		//!< State was already in place
+		};
+
+
+		//! glEnable / glDisable
+		/*!	Tracks GL_TEXTURE_2D, GL_BLEND, GL_SCISSOR_TEST, GL_DEPTH_TEST,
+			GL_CULL_FACE and GL_DITHER; other capabilities go straight to the
+			GL.	*/
+		void enable(GLenum in_cap, bool in_enable);
+
+		//! Is a capability enabled?  (As far as the cache knows: false if not tracked)
+		bool isEnabled(GLenum in_cap);
+
+		//! glEnableClientState / glDisableClientState (OpenGL ES 1x)
+		/*!	Tracks GL_VERTEX_ARRAY, GL_COLOR_ARRAY and GL_TEXTURE_COORD_ARRAY */
+		void clientState(GLenum in_array, bool in_enable);
+
+		//! glEnableVertexAttribArray / glDisableVertexAttribArray
+		void vertexAttribArray(GLuint in_index, bool in_enable);
+
+		//! glBlendFunc
+		void blendFunc(GLenum in_src, GLenum in_dst);
+
+		//! glViewport
+		void viewport(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height);
+
+		//! glScissor (the box, GL_SCISSOR_TEST is enabled with enable())
+		void scissor(GLint in_x, GLint in_y, GLsizei in_width, GLsizei in_height);
+
+		//! The scissor box, if the cache knows it
+		/*!	\return	false if it was never set through scissor()	*/
+		bool scissorBox(GLint *out_x, GLint *out_y, GLsizei *out_width, GLsizei *out_height);
+
+		//! glActiveTexture (in_unit counts from 0, not GL_TEXTURE0)
+		void activeTexture(int in_unit);
+
+		//! glBindTexture(GL_TEXTURE_2D) on a given unit
+		/*!	The active texture unit is changed only if the binding is.	*/
+		void bindTexture(int in_unit, GLuint in_texture);
+
+		//! Texture bound to a unit (as far as the cache knows)
+		GLuint boundTexture(int in_unit);
+
+		//! glBindFramebuffer(GL_FRAMEBUFFER)
+		void bindFramebuffer(GLuint in_framebuffer);
+
+		//! glBindBuffer (GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER)
+		void bindBuffer(GLenum in_target, GLuint in_buffer);
+
+		//! glUseProgram
+		void useProgram(GLuint in_program);
+
+		//! Program in use (as far as the cache knows)
+		GLuint program();
+
+
+		//! A texture is about to be deleted (the GL unbinds it)
+		void forgetTexture(GLuint in_texture);
+
+		//! A frame buffer is about to be deleted (the GL unbinds it)
+		void forgetFramebuffer(GLuint in_framebuffer);
+
+		//! A buffer is about to be deleted (the GL unbinds it)
+		void forgetBuffer(GLuint in_buffer);
+
+		//! A program is about to be deleted
+		void forgetProgram(GLuint in_program);
+
+
+		//! Forget everything; the GL was changed behind the cache's back
+		void invalidate();
+
+		//! Calls made since the last endFrame()
+		const Counters &frame();
+
+		//! Calls made during the frame before the last endFrame()
+		const Counters &lastFrame();
+
+		//! Start counting a new frame
+		void endFrame();
+	};
+};
+
+#endif
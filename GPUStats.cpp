@@ -0,0 +1,119 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#include "GPUStats.h"
+
+#include <string.h>
+
+namespace GPU
+{
+	namespace Stats
+	{
+		static const char *g_names[COUNTER_COUNT] =
+		{
+			"draw calls", "vertices", "texture binds", "buffer uploads",
+			"upload bytes", "framebuffer switches", "shader binds"
+		};
+
+
+		const char *name(Counter in_counter)
+		{
+			return g_names[in_counter];
+		}
+
+
+#ifndef GPU_NO_STATS
+		int g_frame[COUNTER_COUNT];
+
+		//! Counts of the last frames, the oldest overwritten first
+		static int g_history[GPU_STATS_FRAMES][COUNTER_COUNT];
+		static int g_frames = 0;		//!< Frames in g_history
+		static int g_next = 0;			//!< Where the next frame goes
+
+
+		void endFrame()
+		{
+			memcpy(g_history[g_next], g_frame, sizeof(g_frame));
+			memset(g_frame, 0, sizeof(g_frame));
+
+			g_next = (g_next + 1) % GPU_STATS_FRAMES;
+			if (g_frames < GPU_STATS_FRAMES)
+				g_frames++;
+		}
+
+
+		int current(Counter in_counter)
+		{
+			return g_frame[in_counter];
+		}
+
+
+		int last(Counter in_counter)
+		{
+			if (g_frames == 0)
+				return 0;
+
+			return g_history[(g_next + GPU_STATS_FRAMES - 1) % GPU_STATS_FRAMES][in_counter];
+		}
+
+
+		float average(Counter in_counter)
+		{
+			if (g_frames == 0)
+				return 0;
+
+			double sum = 0;
+			for (int i=0; i<g_frames; i++)
+				sum += g_history[i][in_counter];
+
+			return (float)(sum / g_frames);
+		}
+
+
+		int maximum(Counter in_counter)
+		{
+			int m = 0;
+			for (int i=0; i<g_frames; i++)
+				if (g_history[i][in_counter] > m)
+					m = g_history[i][in_counter];
+
+			return m;
+		}
+
+
+		int frames()
+		{
+			return g_frames;
+		}
+
+
+		void reset()
+		{
+			memset(g_frame, 0, sizeof(g_frame));
+			g_frames = 0;
+			g_next = 0;
+		}
+#else
+		void endFrame()						{}
+		int current(Counter)				{	return 0;	}
+		int last(Counter)					{	return 0;	}
+		float average(Counter)				{	return 0;	}
+		int maximum(Counter)				{	return 0;	}
+		int frames()						{	return 0;	}
+		void reset()						{}
+#endif
+	};
+};
@@ -0,0 +1,98 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#ifndef BubblePod_GPUStats_h
+#define BubblePod_GPUStats_h
+
+/*!	\file	GPUStats.h
+	\brief	What each frame asked of the GPU, counted.
+
+	The library counts, as it happens, the draw calls it makes and their
+	vertices, the textures, frame buffers and shaders it binds (only when
+	the binding changes: see GPUState.h) and the data it uploads to VBOs.
+	Counting is an increment in an array.
+
+	Call endFrame() once per frame.  The last frame's counts, and their
+	average and maximum over the last GPU_STATS_FRAMES frames, can then be
+	read, or shown by a StatsOverlay.
+
+	Define GPU_NO_STATS to build without the counters: counting is then
+	compiled out and every query answers 0.
+ */
+
+//! Frames kept for averages and maxima
+#ifndef GPU_STATS_FRAMES
+#define GPU_STATS_FRAMES	60
+#endif
+
+namespace GPU
+{
+	namespace Stats
+	{
+		//! What is counted
+		enum Counter
+		{
+			DrawCalls,
+			Vertices,				//!< Submitted by draw calls
+			TextureBinds,
+			BufferUploads,			//!< VBO::uploadData calls
+			UploadBytes,			//!< Bytes they uploaded
+			FramebufferSwitches,
+			ShaderBinds,
+
+			COUNTER_COUNT
+		};
+
+#ifndef GPU_NO_STATS
+		//! Counts of the frame under way
+		extern int g_frame[COUNTER_COUNT];
+
+		//! Count something
+		inline void count(Counter in_counter, int in_amount = 1)
+		{
+			g_frame[in_counter] += in_amount;
+		}
+#else
+		inline void count(Counter, int = 1)		{}
+#endif
+
+		//! Start counting a new frame
+		void endFrame();
+
+		//! Count of the frame under way
+		int current(Counter in_counter);
+
+		//! Count of the last frame
+		int last(Counter in_counter);
+
+		//! Average count over the last frames
+		float average(Counter in_counter);
+
+		//! Largest count over the last frames
+		int maximum(Counter in_counter);
+
+		//! Frames the averages and maxima are taken over (up to GPU_STATS_FRAMES)
+		int frames();
+
+		//! Forget every frame
+		void reset();
+
+		//! Name of a counter, for display
+		const char *name(Counter in_counter);
+	};
+};
+
+#endif
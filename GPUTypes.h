@@ -0,0 +1,163 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#ifndef BubblePod_GPUTypes_h
+#define BubblePod_GPUTypes_h
+
+/*!	\file	GPUTypes.h
+	\brief	The GL's types and enums, with or without the GL's headers.
+
+	Normally the OpenGL ES headers.  Builds that define GPU_HEADLESS (see
+	GPUBackend.h) get the types, and the enums the library uses, from here
+	instead: they need no GL headers at all, and build on any platform.
+	Values are those of the GL, so that what a RecordingBackend logs reads
+	the same either way.
+ */
+
+#ifndef GPU_HEADLESS
+#include <OpenGLES/ES2/gl.h>
+#else
+
+#include <stddef.h>
+
+typedef void			GLvoid;
+typedef char			GLchar;
+typedef unsigned int	GLenum;
+typedef unsigned char	GLboolean;
+typedef unsigned int	GLbitfield;
+typedef signed char		GLbyte;
+typedef short			GLshort;
+typedef int				GLint;
+typedef int				GLsizei;
+typedef unsigned char	GLubyte;
+typedef unsigned short	GLushort;
+typedef unsigned int	GLuint;
+typedef float			GLfloat;
+typedef float			GLclampf;
+typedef int				GLfixed;
+typedef ptrdiff_t		GLintptr;
+typedef ptrdiff_t		GLsizeiptr;
+
+//Booleans and errors
+#define GL_FALSE						0
+#define GL_TRUE							1
+#define GL_NO_ERROR						0
+#define GL_INVALID_ENUM					0x0500
+#define GL_INVALID_VALUE				0x0501
+#define GL_INVALID_OPERATION			0x0502
+#define GL_OUT_OF_MEMORY				0x0505
+
+//Primitives
+#define GL_POINTS						0x0000
+#define GL_LINES						0x0001
+#define GL_LINE_LOOP					0x0002
+#define GL_LINE_STRIP					0x0003
+#define GL_TRIANGLES					0x0004
+#define GL_TRIANGLE_STRIP				0x0005
+#define GL_TRIANGLE_FAN					0x0006
+
+//Blending
+#define GL_ZERO							0
+#define GL_ONE							1
+#define GL_SRC_COLOR					0x0300
+#define GL_ONE_MINUS_SRC_COLOR			0x0301
+#define GL_SRC_ALPHA					0x0302
+#define GL_ONE_MINUS_SRC_ALPHA			0x0303
+#define GL_DST_ALPHA					0x0304
+#define GL_ONE_MINUS_DST_ALPHA			0x0305
+#define GL_DST_COLOR					0x0306
+#define GL_ONE_MINUS_DST_COLOR			0x0307
+
+//Capabilities
+#define GL_CULL_FACE					0x0B44
+#define GL_DEPTH_TEST					0x0B71
+#define GL_DITHER						0x0BD0
+#define GL_BLEND						0x0BE2
+#define GL_SCISSOR_TEST					0x0C11
+#define GL_TEXTURE_2D					0x0DE1
+
+//Clearing
+#define GL_DEPTH_BUFFER_BIT				0x00000100
+#define GL_COLOR_BUFFER_BIT				0x00004000
+
+//Data types
+#define GL_BYTE							0x1400
+#define GL_UNSIGNED_BYTE				0x1401
+#define GL_SHORT						0x1402
+#define GL_UNSIGNED_SHORT				0x1403
+#define GL_INT							0x1404
+#define GL_UNSIGNED_INT					0x1405
+#define GL_FLOAT						0x1406
+#define GL_FIXED						0x140C
+
+//Fixed function matrices and arrays (OpenGL ES 1x)
+#define GL_MODELVIEW					0x1700
+#define GL_PROJECTION					0x1701
+#define GL_TEXTURE						0x1702
+#define GL_VERTEX_ARRAY					0x8074
+#define GL_COLOR_ARRAY					0x8076
+#define GL_TEXTURE_COORD_ARRAY			0x8078
+
+//Pixel formats
+#define GL_ALPHA						0x1906
+#define GL_RGB							0x1907
+#define GL_RGBA							0x1908
+#define GL_LUMINANCE					0x1909
+#define GL_BGRA_EXT						0x80E1
+
+//Strings
+#define GL_VENDOR						0x1F00
+#define GL_RENDERER						0x1F01
+#define GL_VERSION						0x1F02
+#define GL_EXTENSIONS					0x1F03
+
+//Textures
+#define GL_NEAREST						0x2600
+#define GL_LINEAR						0x2601
+#define GL_TEXTURE_MAG_FILTER			0x2800
+#define GL_TEXTURE_MIN_FILTER			0x2801
+#define GL_TEXTURE_WRAP_S				0x2802
+#define GL_TEXTURE_WRAP_T				0x2803
+#define GL_REPEAT						0x2901
+#define GL_CLAMP_TO_EDGE				0x812F
+#define GL_TEXTURE0						0x84C0
+
+//Buffers
+#define GL_ARRAY_BUFFER					0x8892
+#define GL_ELEMENT_ARRAY_BUFFER			0x8893
+#define GL_STREAM_DRAW					0x88E0
+#define GL_STATIC_DRAW					0x88E4
+#define GL_DYNAMIC_DRAW					0x88E8
+
+//Shaders
+#define GL_FRAGMENT_SHADER				0x8B30
+#define GL_VERTEX_SHADER				0x8B31
+#define GL_COMPILE_STATUS				0x8B81
+#define GL_LINK_STATUS					0x8B82
+#define GL_VALIDATE_STATUS				0x8B83
+#define GL_INFO_LOG_LENGTH				0x8B84
+
+//Frame buffers
+#define GL_FRAMEBUFFER_COMPLETE			0x8CD5
+#define GL_COLOR_ATTACHMENT0			0x8CE0
+#define GL_FRAMEBUFFER					0x8D40
+#define GL_RENDERBUFFER					0x8D41
+#define GL_RENDERBUFFER_WIDTH			0x8D42
+#define GL_RENDERBUFFER_HEIGHT			0x8D43
+
+#endif
+
+#endif
@@ -15,25 +15,1312 @@
  */
 
 #import "Immediate.h"
+#import "GPUBuffer.h"
+#import "GPUState.h"
+#import "GPUShader.h"
+#import "GPUStats.h"
+#import "Timer.h"
+#import "Smart.h"
+#import <pthread.h>
+#import <string.h>
+#import <math.h>
+#import <algorithm>
 
 gli gl;
 gliColour gliColourWhite(255,255,255,255);
 
+bool gliThreaded = false;
+
+//! Context made current on each thread (see gliMakeCurrent)
+static pthread_key_t g_threadContext;
+static pthread_once_t g_threadContextOnce = PTHREAD_ONCE_INIT;
+
+static void createThreadContext()
+{
+	pthread_key_create(&g_threadContext, NULL);
+}
+
+
+//! A vertex as streamed: its position, and its colour and texture coordinate if drawn
+template<bool COLOUR, bool TEXCOORD>
+struct gliLayout
+{
+	enum
+	{
+		COLOUR_OFFSET	= sizeof(gliPosition3D),
+		TEXCOORD_OFFSET	= COLOUR_OFFSET + (COLOUR ? sizeof(gliColour) : 0),
+		STRIDE			= TEXCOORD_OFFSET + (TEXCOORD ? sizeof(gliTexCoord) : 0)
+	};
+	
+	static void pack(const gliSubmit *in_vertices, int in_count, char *out_data)
+	{
+		for (int i=0; i<in_count; i++, out_data += STRIDE)
+		{
+			memcpy(out_data, &in_vertices[i].position, sizeof(gliPosition3D));
+			if (COLOUR)
+				memcpy(out_data + COLOUR_OFFSET, &in_vertices[i].colour, sizeof(gliColour));
+			if (TEXCOORD)
+				memcpy(out_data + TEXCOORD_OFFSET, &in_vertices[i].texCoord, sizeof(gliTexCoord));
+		}
+	}
+};
+
+//With everything drawn, a streamed vertex is a gliSubmit: nothing to pack
+typedef char gliLayoutCheck[gliLayout<true, true>::STRIDE == sizeof(gliSubmit) ? 1 : -1];
+
+//! Layouts by enable state: colour array, then texture coordinate array
+static const gliVertexLayout g_layouts[2][2] =
+{
+	{
+		{	gliLayout<false, false>::STRIDE, gliLayout<false, false>::COLOUR_OFFSET,
+			gliLayout<false, false>::TEXCOORD_OFFSET, &gliLayout<false, false>::pack	},
+		{	gliLayout<false, true>::STRIDE, gliLayout<false, true>::COLOUR_OFFSET,
+			gliLayout<false, true>::TEXCOORD_OFFSET, &gliLayout<false, true>::pack		}
+	},
+	{
+		{	gliLayout<true, false>::STRIDE, gliLayout<true, false>::COLOUR_OFFSET,
+			gliLayout<true, false>::TEXCOORD_OFFSET, &gliLayout<true, false>::pack		},
+		{	gliLayout<true, true>::STRIDE, gliLayout<true, true>::COLOUR_OFFSET,
+			gliLayout<true, true>::TEXCOORD_OFFSET, NULL								}
+	}
+};
+
+//! The layout of gliSubmit, for what is drawn from client memory or lists
+static const gliVertexLayout &g_submitLayout = g_layouts[1][1];
+
+//! The layout vertices are streamed in for an enable state
+static inline const gliVertexLayout &streamLayout(const char *in_enable)
+{
+	return g_layouts[in_enable[2] ? 1 : 0][in_enable[3] ? 1 : 0];
+}
+
+
+//! Vertex shader standing in for the fixed-function pipeline
+static const char *g_vertexShader =
+	"attribute vec2 a_position;\n"
+	"attribute vec4 a_colour;\n"
+	"attribute vec2 a_texCoord;\n"
+	"uniform mat3 u_projection;\n"
+	"varying lowp vec4 v_colour;\n"
+	"varying mediump vec2 v_texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	vec3 p = vec3(a_position, 1.0) * u_projection;\n"
+	"	gl_Position = vec4(p.xy, 0.0, 1.0);\n"
+	"	v_colour = a_colour;\n"
+	"	v_texCoord = a_texCoord * (1.0 / 1024.0);\n"
+	"}\n";
+
+//! Fragment shader standing in for the fixed-function pipeline
+static const char *g_fragmentShader =
+	"varying lowp vec4 v_colour;\n"
+	"varying mediump vec2 v_texCoord;\n"
+	"uniform sampler2D u_texture;\n"
+	"uniform lowp float u_texturing;\n"
+	"void main()\n"
+	"{\n"
+	"	lowp vec4 t = texture2D(u_texture, v_texCoord);\n"
+	"	gl_FragColor = v_colour * mix(vec4(1.0), t, u_texturing);\n"
+	"}\n";
+
+
+//! The built-in shaders, and where their inputs are
+struct gliProgram
+{
+	GPU::Shader		shader;
+	
+	GPU::Attribute	position;
+	GPU::Attribute	colour;
+	GPU::Attribute	texCoord;
+	
+	GPU::Uniform	projection;
+	GPU::Uniform	texturing;
+	
+	//Uniforms as last set (texturing -1: never set)
+	Matrix3D		projectionValue;
+	bool			projectionSet;
+	float			texturingValue;
+	
+	gliProgram()
+	: projectionSet(false)
+	, texturingValue(-1)
+	{
+		shader.initFromSource("gli", g_vertexShader, g_fragmentShader);
+		
+		position = shader.getAttribute("a_position");
+		colour = shader.getAttribute("a_colour");
+		texCoord = shader.getAttribute("a_texCoord");
+		
+		projection = shader.getUniform("u_projection");
+		texturing = shader.getUniform("u_texturing");
+	}
+};
+
+
+gli::gli(bool in_deferred)
+: submission(NULL)
+, m_capacity(0)
+, m_maxCapacity(GLI_SUBMISSION_SIZE)
+, m_packed(NULL)
+, m_indices(NULL)
+, m_indexCount(0)
+, m_quads(0)
+, m_first(0)
+, m_loopSplit(false)
+, m_spilled(0)
+, m_inDraw(false)
+, m_batching(false)
+, m_batchVertices(0)
+, m_vertexStream(NULL)
+, m_indexStream(NULL)
+, m_matrixDepth(0)
+, m_cpuTransforms(in_deferred)
+, m_positionScale(1)
+, m_clipDepth(0)
+, m_program(NULL)
+, m_recording(NULL)
+, m_recordBatching(false)
+, m_deferred(in_deferred)
+, m_blendSrc(GL_ONE)
+, m_blendDst(GL_ZERO)
+, m_drawCalls(0)
+, m_highWater(0)
+, m_splits(0)
+, m_submitTime(0)
+, m_submitBytes(0)
+, m_width(0)
+, m_height(0)
+, m_scale(1)
+, m_mode(0)
+, m_curVertex(0)
+{
+	memset(m_enable, 0, sizeof(m_enable));
+	memset(m_textures, 0, sizeof(m_textures));
+	
+	reallocate(GLI_SUBMISSION_CHUNK < m_maxCapacity ? GLI_SUBMISSION_CHUNK : m_maxCapacity);
+}
+
+
+gli::~gli()
+{
+	delete m_program;
+	delete m_vertexStream;
+	delete m_indexStream;
+	
+	delete[] submission;
+	delete[] m_packed;
+	delete[] m_indices;
+}
+
+
+void gli::reallocate(int in_vertices)
+{
+	gliSubmit *s = new gliSubmit[in_vertices];
+	GLushort *i = new GLushort[in_vertices*3];		//Strips and fans: 3 per vertex
+	
+	if (m_curVertex)
+		memcpy(s, submission, m_curVertex * sizeof(submission[0]));
+	if (m_indexCount)
+		memcpy(i, m_indices, m_indexCount * sizeof(m_indices[0]));
+	
+	delete[] submission;
+	delete[] m_packed;
+	delete[] m_indices;
+	
+	submission = s;
+	m_packed = new char[in_vertices * sizeof(gliSubmit)];
+	m_indices = i;
+	m_capacity = in_vertices;
+}
+
+
+void gli::setCapacity(int in_vertices)
+{
+	if (m_inDraw)
+		throw "gli::setCapacity::Inside a Draw";
+	
+	flush();
+	
+	//Indices are 16 bits; split strips need a few vertices to carry on
+	if (in_vertices > 65536)	in_vertices = 65536;
+	if (in_vertices < 16)		in_vertices = 16;
+	
+	m_maxCapacity = in_vertices;
+	
+	if (m_capacity > m_maxCapacity)
+		reallocate(m_maxCapacity);
+	
+	//The rings must hold a full submission
+	if (m_vertexStream && m_vertexStream->size() < m_maxCapacity * (int)sizeof(submission[0]))
+		setStreaming(m_maxCapacity);
+}
+
+
+void gli::setStreaming(int in_vertices)
+{
+	if (m_deferred && in_vertices > 0)
+		throw "gli::setStreaming::Deferred context";
+	
+	flush();
+	
+	delete m_vertexStream;
+	delete m_indexStream;
+	m_vertexStream = m_indexStream = NULL;
+	
+	if (in_vertices <= 0)
+		return;
+	
+	if (in_vertices < m_maxCapacity)
+		in_vertices = m_maxCapacity;
+	
+	m_vertexStream = new GPU::StreamVBO(in_vertices * sizeof(submission[0]), true);
+	m_indexStream = new GPU::StreamVBO(in_vertices * 3 * sizeof(m_indices[0]), false);
+}
+
+
+void gli::overflow()
+{
+	//Room to grow?
+	if (m_capacity < m_maxCapacity)
+	{
+		int grown = m_capacity + GLI_SUBMISSION_CHUNK;
+		reallocate(grown < m_maxCapacity ? grown : m_maxCapacity);
+		return;
+	}
+	
+	//Earlier shapes in the batch?  Drawing them moves this one to the front.
+	if (m_first != 0)
+	{
+		flush();
+		return;
+	}
+	
+	//This shape fills the submission on its own
+	splitShape();
+}
+
+
+void gli::splitShape()
+{
+	const int n = m_curVertex;
+	int drawn = n;
+	
+	gliSubmit carry[3];
+	int carried = 0;
+	
+	switch (m_mode)
+	{
+		case GL_TRIANGLES:
+			drawn = n - n%3;
+			for (int i=drawn; i<n; i++)
+				carry[carried++] = submission[i];
+			break;
+			
+		case GL_LINES:
+			drawn = n - n%2;
+			for (int i=drawn; i<n; i++)
+				carry[carried++] = submission[i];
+			break;
+			
+		case GL_TRIANGLE_STRIP:
+			//Odd triangles are wound the other way; an odd cut starts again
+			//with a degenerate triangle so that the next one stays odd.
+			if (n & 1)
+				carry[carried++] = submission[n-2];
+			carry[carried++] = submission[n-2];
+			carry[carried++] = submission[n-1];
+			break;
+			
+		case GL_TRIANGLE_FAN:
+			carry[carried++] = submission[0];
+			carry[carried++] = submission[n-1];
+			break;
+			
+		case GL_LINE_LOOP:
+			//Goes on as a strip, closed by end()
+			m_loopStart = submission[0];
+			m_loopSplit = true;
+			m_mode = GL_LINE_STRIP;
+			carry[carried++] = submission[n-1];
+			break;
+			
+		case GL_LINE_STRIP:
+			carry[carried++] = submission[n-1];
+			break;
+	}
+	
+	m_curVertex = drawn;
+	
+	if (m_clipDepth != 0)
+	{
+		//Too long to be a quad
+		flushBatch();
+		drawScissored(0, drawn);
+	}
+	else if (m_batching && (m_mode == GL_TRIANGLES || m_mode == GL_TRIANGLE_STRIP
+							|| m_mode == GL_TRIANGLE_FAN))
+	{
+		appendBatch();
+		flushBatch();
+	}
+	else
+	{
+		flushBatch();
+		drawArrays(0, drawn);
+	}
+	
+	for (int i=0; i<carried; i++)
+		submission[i] = carry[i];
+	
+	m_spilled += n - carried;
+	m_curVertex = carried;
+	m_first = 0;
+	m_splits++;
+}
+
+
+void gli::closeLoop()
+{
+	m_loopSplit = false;
+	
+	if (m_curVertex == m_capacity)
+		overflow();
+	
+	submission[m_curVertex++] = m_loopStart;
+}
+
+
+void gli::pushClip(const Rect2D &in_rect)
+{
+	if (m_clipDepth == GLI_CLIP_DEPTH)
+		throw "gli::pushClip::Stack overflow";
+	
+	//The rectangle would be compared with vertices the GL still transforms
+	if (!m_cpuTransforms)
+		throw "gli::pushClip::Transforms not done by gli";
+	
+	//Corners in submission units, where vertices would end up
+	const gliMatrix &m = m_matrices[m_matrixDepth];
+	float x[4], y[4];
+	for (int i=0; i<4; i++)
+	{
+		const float cx = (in_rect.corner.x + (i & 1) * in_rect.size.x) * POSITION_MULT;
+		const float cy = (in_rect.corner.y + (i >> 1) * in_rect.size.y) * POSITION_MULT;
+		
+		x[i] = (m.a*cx + m.b*cy + m.tx) * m_positionScale;
+		y[i] = (m.c*cx + m.d*cy + m.ty) * m_positionScale;
+	}
+	
+	ClipRect c;
+	c.x0 = (int)floorf(std::min(std::min(x[0], x[1]), std::min(x[2], x[3])) + 0.5f);
+	c.y0 = (int)floorf(std::min(std::min(y[0], y[1]), std::min(y[2], y[3])) + 0.5f);
+	c.x1 = (int)floorf(std::max(std::max(x[0], x[1]), std::max(x[2], x[3])) + 0.5f);
+	c.y1 = (int)floorf(std::max(std::max(y[0], y[1]), std::max(y[2], y[3])) + 0.5f);
+	
+	//Within the one it is pushed on (empty if they don't meet)
+	if (m_clipDepth != 0)
+	{
+		const ClipRect &o = m_clips[m_clipDepth-1];
+		c.x0 = std::max(c.x0, o.x0);
+		c.y0 = std::max(c.y0, o.y0);
+		c.x1 = std::max(c.x0, std::min(c.x1, o.x1));
+		c.y1 = std::max(c.y0, std::min(c.y1, o.y1));
+	}
+	
+	m_clips[m_clipDepth++] = c;
+}
+
+
+void gli::popClip()
+{
+	if (m_clipDepth == 0)
+		throw "gli::popClip::Stack underflow";
+	
+	m_clipDepth--;
+}
+
+
+bool gli::clipShape()
+{
+	//A quad drawn whole?
+	if (m_mode == GL_TRIANGLE_STRIP && m_spilled == 0 && m_curVertex - m_first == 4)
+	{
+		switch (clipQuad(submission + m_first))
+		{
+			case 1:
+				return true;
+				
+			case 0:
+				m_curVertex = m_first;
+				m_inDraw = false;
+				return false;
+		}
+	}
+	
+	m_inDraw = false;
+	
+	//Anything batched was submitted before this shape
+	flushBatch();
+	
+	drawScissored(m_first, m_curVertex - m_first);
+	
+	m_curVertex = m_first = 0;
+	return false;
+}
+
+
+//! Bilinear blend of the corners of a quad (at x0 y0, x1 y0, x0 y1, x1 y1), rounded
+static inline float blend(float in_c0, float in_c1, float in_c2, float in_c3, float in_fx, float in_fy)
+{
+	const float top = in_c0 + (in_c1 - in_c0) * in_fx;
+	const float bottom = in_c2 + (in_c3 - in_c2) * in_fx;
+	
+	return floorf(top + (bottom - top) * in_fy + 0.5f);
+}
+
+
+int gli::clipQuad(gliSubmit *io_quad)
+{
+	const ClipRect &c = m_clips[m_clipDepth-1];
+	
+	int x0 = io_quad[0].position.x(), x1 = x0;
+	int y0 = io_quad[0].position.y(), y1 = y0;
+	for (int i=1; i<4; i++)
+	{
+		x0 = std::min(x0, (int)io_quad[i].position.x());
+		x1 = std::max(x1, (int)io_quad[i].position.x());
+		y0 = std::min(y0, (int)io_quad[i].position.y());
+		y1 = std::max(y1, (int)io_quad[i].position.y());
+	}
+	
+	//Nothing to see?
+	if (x0 == x1 || y0 == y1 || x1 <= c.x0 || x0 >= c.x1 || y1 <= c.y0 || y0 >= c.y1)
+		return 0;
+	
+	//Inside?
+	if (x0 >= c.x0 && x1 <= c.x1 && y0 >= c.y0 && y1 <= c.y1)
+		return 1;
+	
+	//Axis-aligned: a vertex on each corner of its bounds
+	int corner[4] = {-1, -1, -1, -1};
+	for (int i=0; i<4; i++)
+	{
+		const int x = io_quad[i].position.x(), y = io_quad[i].position.y();
+		if ((x != x0 && x != x1) || (y != y0 && y != y1))
+			return -1;
+		
+		const int k = (x == x1) + 2*(y == y1);
+		if (corner[k] != -1)
+			return -1;
+		corner[k] = i;
+	}
+	
+	const gliSubmit q[4] = {io_quad[corner[0]], io_quad[corner[1]],
+							io_quad[corner[2]], io_quad[corner[3]]};
+	
+	const int nx[2] = {std::max(x0, c.x0), std::min(x1, c.x1)};
+	const int ny[2] = {std::max(y0, c.y0), std::min(y1, c.y1)};
+	const float fx[2] = {(float)(nx[0] - x0) / (x1 - x0), (float)(nx[1] - x0) / (x1 - x0)};
+	const float fy[2] = {(float)(ny[0] - y0) / (y1 - y0), (float)(ny[1] - y0) / (y1 - y0)};
+	
+	for (int k=0; k<4; k++)
+	{
+		gliSubmit &v = io_quad[corner[k]];
+		const float u = fx[k & 1], w = fy[k >> 1];
+		
+		v.position = gliPosition3D((GLshort)nx[k & 1], (GLshort)ny[k >> 1], q[k].position.z());
+		
+		if (m_enable[3])
+			v.texCoord = gliTexCoord(
+				(GLshort)blend(q[0].texCoord.u(), q[1].texCoord.u(), q[2].texCoord.u(), q[3].texCoord.u(), u, w),
+				(GLshort)blend(q[0].texCoord.v(), q[1].texCoord.v(), q[2].texCoord.v(), q[3].texCoord.v(), u, w));
+		
+		if (m_enable[2])
+			v.colour = gliColour(
+				(GLubyte)blend(q[0].colour.r(), q[1].colour.r(), q[2].colour.r(), q[3].colour.r(), u, w),
+				(GLubyte)blend(q[0].colour.g(), q[1].colour.g(), q[2].colour.g(), q[3].colour.g(), u, w),
+				(GLubyte)blend(q[0].colour.b(), q[1].colour.b(), q[2].colour.b(), q[3].colour.b(), u, w),
+				(GLubyte)blend(q[0].colour.a(), q[1].colour.a(), q[2].colour.a(), q[3].colour.a(), u, w));
+	}
+	
+	return 1;
+}
+
+
+void gli::drawScissored(int in_first, int in_count)
+{
+	//A list replays without it
+	if (m_recording)
+	{
+		drawArrays(in_first, in_count);
+		return;
+	}
+	
+	//Whole pixels around the clip rectangle, from the bottom left
+	const ClipRect &c = m_clips[m_clipDepth-1];
+	const float s = m_scale / (POSITION_MULT * m_positionScale);
+	const float h = m_height * m_scale;
+	
+	int x0 = (int)floorf(c.x0 * s), x1 = (int)ceilf(c.x1 * s);
+	int y0 = (int)floorf(h - c.y1 * s), y1 = (int)ceilf(h - c.y0 * s);
+	
+	//Inside the scissor box already in use (a DirtyRegion's), which is put back
+	const bool scissoring = GPU::State::isEnabled(GL_SCISSOR_TEST);
+	GLint px = 0, py = 0;
+	GLsizei pw = 0, ph = 0;
+	const bool known = GPU::State::scissorBox(&px, &py, &pw, &ph);
+	
+	if (scissoring && known)
+	{
+		x0 = std::max(x0, (int)px);
+		y0 = std::max(y0, (int)py);
+		x1 = std::max(x0, std::min(x1, (int)(px + pw)));
+		y1 = std::max(y0, std::min(y1, (int)(py + ph)));
+	}
+	
+	GPU::State::enable(GL_SCISSOR_TEST, true);
+	GPU::State::scissor(x0, y0, x1 - x0, y1 - y0);
+	
+	drawArrays(in_first, in_count);
+	
+	if (known)
+		GPU::State::scissor(px, py, pw, ph);
+	GPU::State::enable(GL_SCISSOR_TEST, scissoring);
+}
+
+
+void gli::applyState(const char *in_enable, const char *in_base,
+					 const gliVertexLayout &in_layout)
+{
+	//Where each part of the first vertex is
+	const GLsizei stride = in_layout.stride;
+	const GLvoid *position = in_base;
+	const GLvoid *colour = in_base + in_layout.colour;
+	const GLvoid *texCoord = in_base + in_layout.texCoord;
+	
+	if (m_program)
+	{
+		GPU::State::useProgram(m_program->shader.program());
+		
+		if (!m_program->projectionSet)
+		{
+			//Undoes the position scale
+			Matrix3D unscale;
+			unscale.rows[0] = Coord3D(1 / m_positionScale, 0, 0);
+			unscale.rows[1] = Coord3D(0, 1 / m_positionScale, 0);
+			unscale.rows[2] = Coord3D(0, 0, 1);
+			
+			m_program->projection.set(m_program->projectionValue * unscale);
+			m_program->projectionSet = true;
+		}
+		
+		//Texturing is a uniform, there is no GL_TEXTURE_2D to enable
+		float texturing = in_enable[0] ? 1.0f : 0.0f;
+		if (texturing != m_program->texturingValue)
+		{
+			m_program->texturing.set(texturing);
+			m_program->texturingValue = texturing;
+		}
+		
+		GPU::State::enable(GL_BLEND, in_enable[1]);
+		
+		//Colour is white and texture coordinates 0 without arrays, as in ES 1
+		if (in_enable[2])
+			m_program->colour.attribPointer(4, GL_UNSIGNED_BYTE, true,
+											stride, colour);
+		else
+			m_program->colour.constant(Coord4D(1, 1, 1, 1));
+		
+		if (in_enable[3])
+			m_program->texCoord.attribPointer(2, GL_SHORT, false,
+											  stride, texCoord);
+		else
+			m_program->texCoord.constant(Coord4D(0, 0, 0, 1));
+		
+		m_program->position.attribPointer(2, GL_SHORT, false,
+										  stride, position);
+		return;
+	}
+
+	//Texturing and blending...
+	GPU::State::enable(GL_TEXTURE_2D, in_enable[0]);
+	GPU::State::enable(GL_BLEND, in_enable[1]);
+
+	//Set up colour arrays...
+	GPU::State::clientState(GL_COLOR_ARRAY, in_enable[2]);
+	if (in_enable[2])
+		GPU::backend().colorPointer(		4, GL_UNSIGNED_BYTE,
+							stride,
+							colour);
+	
+	//Set up texture coordinate arrays...
+	GPU::State::clientState(GL_TEXTURE_COORD_ARRAY, in_enable[3]);
+	if (in_enable[3])
+		GPU::backend().texCoordPointer(	2, GL_SHORT,
+							stride,
+							texCoord);
+	
+	//Vertices...
+	GPU::backend().vertexPointer(	3, GL_SHORT,
+						stride,
+						position);
+}
+
+
+//! Undoes gli::setPositionScale in the GL's modelview matrix, for the object's lifetime
+/*!	Fixed-function only: the built-in shaders fold it into their projection.	*/
+class gliUnscale
+{
+	bool	m_pushed;
+	
+public:
+	gliUnscale(bool in_fixedFunction, float in_scale)
+	: m_pushed(in_fixedFunction && in_scale != 1)
+	{
+		if (m_pushed)
+		{
+			GPU::backend().pushMatrix();
+			GPU::backend().scalef(1 / in_scale, 1 / in_scale, 1);
+		}
+	}
+	
+	~gliUnscale()
+	{
+		if (m_pushed)
+			GPU::backend().popMatrix();
+	}
+};
+
+
+void gli::drawArrays(int in_first, int in_count)
+{
+	if (m_recording)
+	{
+		m_recording->capture(m_mode, m_enable, boundTexture(0),
+							 m_blendSrc, m_blendDst,
+							 submission + in_first, in_count, NULL, 0);
+		return;
+	}
+	
+	if (m_deferred)
+		throw "gli::drawArrays::Deferred context not recording";
+	
+	double start = x_time();
+	
+	gliUnscale u(m_program == NULL, m_positionScale);
+	int bytes = in_count * sizeof(submission[0]);
+	
+	if (m_vertexStream)
+	{
+		GPU::BindVBO b(m_vertexStream);
+		
+		int offset = streamVertices(m_enable, in_first, in_count);
+		applyState(m_enable, (const char*)NULL + offset, streamLayout(m_enable));
+		GPU::backend().drawArrays(m_mode, 0, in_count);
+		
+		bytes = in_count * streamLayout(m_enable).stride;
+	}
+	else
+	{
+		applyState(m_enable, (const char*)submission, g_submitLayout);
+		GPU::backend().drawArrays(m_mode, in_first, in_count);
+	}
+	
+	m_drawCalls++;
+	m_submitBytes += bytes;
+	GPU::Stats::count(GPU::Stats::DrawCalls);
+	GPU::Stats::count(GPU::Stats::Vertices, in_count);
+	m_submitTime += x_time() - start;
+}
+
+
+void gli::appendBatch()
+{
+	//Different state?  What came before is drawn on its own.
+	if (m_indexCount != 0 && memcmp(m_enable, m_batchEnable, sizeof(m_enable)) != 0)
+		flush();
+	
+	memcpy(m_batchEnable, m_enable, sizeof(m_enable));
+	
+	const int first = m_first;
+	const int count = m_curVertex - m_first;
+	
+	//Another quad behind the others?  Its indices are those of GPU::quadIndices().
+	if (m_mode == GL_TRIANGLE_STRIP && count == 4
+		&& m_indexCount == m_quads * 6 && first == m_quads * 4)
+	{
+		m_quads++;
+		m_indexCount += 6;
+		m_batchVertices = m_curVertex;
+		return;
+	}
+	
+	writeQuadIndices();
+	
+	GLushort *idx = m_indices + m_indexCount;
+	
+	if (m_mode == GL_TRIANGLES)
+	{
+		for (int i=0; i<count - count%3; i++)
+			*(idx++) = first + i;
+	}
+	else if (m_mode == GL_TRIANGLE_STRIP)
+	{
+		//Every other triangle swaps its first two vertices to keep the winding
+		for (int i=0; i+2<count; i++)
+		{
+			*(idx++) = first + i + (i&1);
+			*(idx++) = first + i + 1 - (i&1);
+			*(idx++) = first + i + 2;
+		}
+	}
+	else	//GL_TRIANGLE_FAN
+	{
+		for (int i=0; i+2<count; i++)
+		{
+			*(idx++) = first;
+			*(idx++) = first + i + 1;
+			*(idx++) = first + i + 2;
+		}
+	}
+	
+	m_indexCount = idx - m_indices;
+	m_batchVertices = m_curVertex;
+}
+
+
+void gli::flushBatch()
+{
+	if (m_indexCount == 0)
+		return;
+	
+	//Quads only?  Streamed, they need none of their own indices.
+	const bool quads = m_quads != 0 && m_vertexStream && !m_recording;
+	if (!quads)
+		writeQuadIndices();
+	
+	if (m_recording)
+	{
+		m_recording->capture(GL_TRIANGLES, m_batchEnable, boundTexture(0),
+							 m_blendSrc, m_blendDst,
+							 submission, m_batchVertices, m_indices, m_indexCount);
+		m_indexCount = 0;
+		m_batchVertices = 0;
+		return;
+	}
+	
+	if (m_deferred)
+		throw "gli::flushBatch::Deferred context not recording";
+	
+	double start = x_time();
+	
+	const gliVertexLayout &layout = m_vertexStream ? streamLayout(m_batchEnable)
+													: g_submitLayout;
+	
+	gliUnscale u(m_program == NULL, m_positionScale);
+	
+	if (quads)
+	{
+		GPU::BindVBO v(m_vertexStream);
+		GPU::BindVBO i(GPU::quadIndices());
+		
+		int offset = streamVertices(m_batchEnable, 0, m_batchVertices);
+		applyState(m_batchEnable, (const char*)NULL + offset, layout);
+		
+		GPU::backend().drawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT, NULL);
+	}
+	else if (m_vertexStream)
+	{
+		GPU::BindVBO v(m_vertexStream);
+		GPU::BindVBO i(m_indexStream);
+		
+		int offset = streamVertices(m_batchEnable, 0, m_batchVertices);
+		applyState(m_batchEnable, (const char*)NULL + offset, layout);
+		
+		int indices = m_indexStream->stream(m_indices, m_indexCount * sizeof(m_indices[0]));
+		GPU::backend().drawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT,
+					   (const char*)NULL + indices);
+	}
+	else
+	{
+		applyState(m_batchEnable, (const char*)submission, layout);
+		GPU::backend().drawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT, m_indices);
+	}
+	
+	m_drawCalls++;
+	m_submitBytes += m_batchVertices * layout.stride
+					+ (quads ? 0 : m_indexCount * sizeof(m_indices[0]));
+	GPU::Stats::count(GPU::Stats::DrawCalls);
+	GPU::Stats::count(GPU::Stats::Vertices, m_batchVertices);
+	m_submitTime += x_time() - start;
+	
+	m_indexCount = 0;
+	m_quads = 0;
+	m_batchVertices = 0;
+}
+
+
+int gli::streamVertices(const char *in_enable, int in_first, int in_count)
+{
+	const gliVertexLayout &layout = streamLayout(in_enable);
+	
+	if (layout.pack == NULL)
+		return m_vertexStream->stream(submission + in_first, in_count * sizeof(submission[0]));
+	
+	layout.pack(submission + in_first, in_count, m_packed);
+	return m_vertexStream->stream(m_packed, in_count * layout.stride);
+}
+
+
+void gli::writeQuadIndices()
+{
+	GLushort *idx = m_indices;
+	
+	for (int i=0; i<m_quads; i++)
+	{
+		const GLushort q = i*4;
+		
+		*(idx++) = q;		*(idx++) = q + 1;	*(idx++) = q + 2;
+		*(idx++) = q + 2;	*(idx++) = q + 1;	*(idx++) = q + 3;
+	}
+	
+	m_quads = 0;
+}
+
+
+void gli::flush()
+{
+	flushBatch();
+	
+	//Inside a shape?  Keep its vertices, at the front.
+	if (m_inDraw)
+	{
+		if (m_first != 0)
+			memmove(submission, submission + m_first,
+					(m_curVertex - m_first) * sizeof(submission[0]));
+		
+		m_curVertex -= m_first;
+		m_first = 0;
+	}
+	else
+	{
+		m_curVertex = m_first = 0;
+	}
+}
+
+
+void gli::setCPUTransforms(bool in_cpu)
+{
+	flush();
+	
+	//The shaders have no modelview matrix; deferred contexts can't reach the GL's
+	if (m_program || m_deferred)
+		in_cpu = true;
+	
+	m_cpuTransforms = in_cpu;
+	m_matrixDepth = 0;
+	m_matrices[0] = gliMatrix();
+}
+
+
+void gli::setProgrammable(bool in_programmable)
+{
+	flush();
+	
+	if (in_programmable == (m_program != NULL))
+		return;
+	
+	if (in_programmable)
+	{
+		if (m_deferred)
+			throw "gli::setProgrammable::Deferred context";
+		
+		m_program = new gliProgram();
+		setCPUTransforms(true);
+	}
+	else
+	{
+		GPU::State::useProgram(0);
+		
+		delete m_program;
+		m_program = NULL;
+	}
+}
+
+
+void gli::setPositionScale(float in_scale)
+{
+	if (in_scale <= 0)
+		throw "gli::setPositionScale::Invalid scale";
+	
+	if (in_scale == m_positionScale)
+		return;
+	
+	if (m_recording)
+		throw "gli::setPositionScale::While recording";
+	if (m_clipDepth != 0)
+		throw "gli::setPositionScale::While clipping";
+	if (m_inDraw)
+		throw "gli::setPositionScale::Inside a Draw";
+	
+	//Batched vertices were stored at the previous scale
+	flush();
+	
+	m_positionScale = in_scale;
+	
+	if (m_program)
+		m_program->projectionSet = false;
+}
+
+
+GLuint gli::program() const
+{
+	return m_program ? m_program->shader.program() : 0;
+}
+
+
+void gli::setProjection(const Matrix3D &in_projection)
+{
+	flush();
+	
+	if (m_program)
+	{
+		m_program->projectionValue = in_projection;
+		m_program->projectionSet = false;
+	}
+}
+
+
+void gli::beginRecording(gliList *io_list)
+{
+	if (m_recording)
+		throw "gli::beginRecording::Already recording";
+	if (m_inDraw)
+		throw "gli::beginRecording::Inside a Draw";
+	if (m_positionScale != 1)
+		throw "gli::beginRecording::Position scale not 1";
+	
+	flush();
+	
+	io_list->clear();
+	m_recording = io_list;
+	
+	//Shapes are merged into as few draw calls as the state allows
+	m_recordBatching = m_batching;
+	m_batching = true;
+}
+
+
+void gli::endRecording()
+{
+	flush();
+	
+	m_batching = m_recordBatching;
+	m_recording = NULL;
+}
+
+
+void gli::replay(const gliList &in_list, const gliMatrix *in_transform)
+{
+	if (m_recording)
+		throw "gli::replay::While recording";
+	if (m_deferred)
+		throw "gli::replay::Deferred context";
+	
+	if (in_list.m_commands.empty())
+		return;
+	
+	//What came before goes below
+	flush();
+	
+	//Lists recorded on other threads reach the GL here
+	in_list.upload();
+	
+	double start = x_time();
+	
+	//The list's vertices are as recorded: apply what gli would have
+	gliMatrix m = m_cpuTransforms ? m_matrices[m_matrixDepth] : gliMatrix();
+	if (in_transform)
+		m.concat(*in_transform);
+	
+	const bool transformed = in_transform != NULL || m_cpuTransforms;
+	
+	if (transformed)
+	{
+		if (m_program)
+		{
+			Matrix3D t;
+			t.rows[0] = Coord3D(m.a, m.b, m.tx);
+			t.rows[1] = Coord3D(m.c, m.d, m.ty);
+			t.rows[2] = Coord3D(0, 0, 1);
+			
+			GPU::State::useProgram(m_program->shader.program());
+			m_program->projection.set(m_program->projectionValue * t);
+			m_program->projectionSet = true;
+		}
+		else
+		{
+			const GLfloat f[16] = {	m.a,	m.c,	0,	0,
+									m.b,	m.d,	0,	0,
+									0,		0,		1,	0,
+									m.tx,	m.ty,	0,	1	};
+			GPU::backend().pushMatrix();
+			GPU::backend().multMatrixf(f);
+		}
+	}
+	
+	const GLuint texture = GPU::State::boundTexture(0);
+	
+	GPU::BindVBO v(in_list.m_vertexBuffer);
+	One<GPU::BindVBO> i(in_list.m_indexBuffer ? new GPU::BindVBO(in_list.m_indexBuffer) : NULL);
+	
+	for (size_t k=0; k<in_list.m_commands.size(); k++)
+	{
+		const gliList::Command &c = in_list.m_commands[k];
+		
+		GPU::State::bindTexture(0, c.texture);
+		GPU::State::blendFunc(c.blendSrc, c.blendDst);
+		applyState(c.enable, (const char*)NULL + c.firstVertex * sizeof(submission[0]),
+				   g_submitLayout);
+		
+		if (c.indexCount)
+			GPU::backend().drawElements(GL_TRIANGLES, c.indexCount, GL_UNSIGNED_SHORT,
+						   (const char*)NULL + c.firstIndex * sizeof(GLushort));
+		else
+			GPU::backend().drawArrays(c.mode, 0, c.vertexCount);
+		
+		m_drawCalls++;
+		GPU::Stats::count(GPU::Stats::DrawCalls);
+		GPU::Stats::count(GPU::Stats::Vertices, c.vertexCount);
+	}
+	
+	//As the caller left them
+	GPU::State::bindTexture(0, texture);
+	GPU::State::blendFunc(m_blendSrc, m_blendDst);
+	
+	if (transformed)
+	{
+		if (m_program)
+			m_program->projectionSet = false;
+		else
+			GPU::backend().popMatrix();
+	}
+	
+	m_submitTime += x_time() - start;
+}
+
+
+
+gliList::gliList()
+: m_vertexBuffer(NULL)
+, m_indexBuffer(NULL)
+{}
+
+
+gliList::~gliList()
+{
+	delete m_vertexBuffer;
+	delete m_indexBuffer;
+}
+
+
+void gliList::clear()
+{
+	//May be on any thread: the VBOs are replaced by the next upload()
+	m_commands.clear();
+	m_vertices.clear();
+	m_indices.clear();
+}
+
+
+void gliList::capture(GLenum in_mode, const char *in_enable, GLuint in_texture,
+					  GLenum in_blendSrc, GLenum in_blendDst,
+					  const gliSubmit *in_vertices, int in_vertexCount,
+					  const GLushort *in_indices, int in_indexCount)
+{
+	if (in_vertexCount <= 0)
+		return;
+	
+	Command *last = m_commands.empty() ? NULL : &m_commands.back();
+	
+	const bool sameState = last && last->mode == in_mode
+							&& memcmp(last->enable, in_enable, sizeof(last->enable)) == 0
+							&& last->texture == in_texture
+							&& last->blendSrc == in_blendSrc && last->blendDst == in_blendDst;
+	
+	//Continues the last draw call?  (Triangles while indices fit, points, lines)
+	if (sameState && in_indexCount && last->indexCount
+		&& last->vertexCount + in_vertexCount <= 65536)
+	{
+		for (int i=0; i<in_indexCount; i++)
+			m_indices.push_back(in_indices[i] + last->vertexCount);
+		
+		last->vertexCount += in_vertexCount;
+		last->indexCount += in_indexCount;
+	}
+	else if (sameState && !in_indexCount && !last->indexCount
+			 && (in_mode == GL_POINTS || in_mode == GL_LINES))
+	{
+		last->vertexCount += in_vertexCount;
+	}
+	else
+	{
+		Command c;
+		c.mode = in_mode;
+		memcpy(c.enable, in_enable, sizeof(c.enable));
+		c.texture = in_texture;
+		c.blendSrc = in_blendSrc;
+		c.blendDst = in_blendDst;
+		c.firstVertex = (int)m_vertices.size();
+		c.vertexCount = in_vertexCount;
+		c.firstIndex = (int)m_indices.size();
+		c.indexCount = in_indexCount;
+		
+		m_indices.insert(m_indices.end(), in_indices, in_indices + in_indexCount);
+		m_commands.push_back(c);
+	}
+	
+	m_vertices.insert(m_vertices.end(), in_vertices, in_vertices + in_vertexCount);
+}
+
+
+void gliList::upload() const
+{
+	//Already uploaded?
+	if (m_vertices.empty())
+		return;
+	
+	delete m_vertexBuffer;
+	delete m_indexBuffer;
+	m_vertexBuffer = NULL;
+	m_indexBuffer = NULL;
+	
+	m_vertexBuffer = new GPU::Type::TVBO<gliSubmit>((int)m_vertices.size());
+	memcpy(&(*m_vertexBuffer)[0], &m_vertices[0], m_vertices.size() * sizeof(gliSubmit));
+	m_vertexBuffer->sync();
+	
+	if (!m_indices.empty())
+		m_indexBuffer = new GPU::IndexVBO(&m_indices[0], (int)m_indices.size());
+	
+	//The GL has them now
+	std::vector<gliSubmit>().swap(m_vertices);
+	std::vector<GLushort>().swap(m_indices);
+}
+
+
+void gli::setBatching(bool in_batching)
+{
+	if (!in_batching)
+		flush();
+	
+	m_batching = in_batching;
+}
+
+
+
+GLuint gli::boundTexture(int in_unit) const
+{
+	if (m_deferred)
+		return m_textures[in_unit];
+	
+	return GPU::State::boundTexture(in_unit);
+}
+
+
+void gli::bindTexture(int in_unit, GLuint in_texture)
+{
+	//Batched triangles were meant for the previous texture
+	if (boundTexture(in_unit) != in_texture)
+		flush();
+	
+	if (m_deferred)
+		m_textures[in_unit] = in_texture;
+	else
+		GPU::State::bindTexture(in_unit, in_texture);
+}
+
+
+void gli::blendFunc(GLenum in_src, GLenum in_dst)
+{
+	//Batched triangles were meant for the previous function
+	if (in_src != m_blendSrc || in_dst != m_blendDst)
+		flush();
+	
+	m_blendSrc = in_src;
+	m_blendDst = in_dst;
+	
+	if (!m_deferred)
+		GPU::State::blendFunc(in_src, in_dst);
+}
 
 
-//! Previously applied blending modes
-static GLenum g_blendSrc = GL_ONE, g_blendDst = GL_ZERO;
 
 gliBlendFunc::gliBlendFunc(GLenum in_src, GLenum in_dst)
-: m_oldSrc(g_blendSrc)
-, m_oldDst(g_blendDst)
+: m_gl(gliCurrent())
+, m_oldSrc(m_gl.m_blendSrc)
+, m_oldDst(m_gl.m_blendDst)
 {
 	blendFunc(in_src, in_dst);
 }
 
-void gliBlendFunc::blendFunc(GLenum in_src, GLenum in_dst)
+
+
+gli *gliThreadContext()
+{
+	pthread_once(&g_threadContextOnce, createThreadContext);
+	return (gli*)pthread_getspecific(g_threadContext);
+}
+
+
+void gliThreads()
+{
+	gliThreadContext();
+	gliThreaded = true;
+}
+
+
+gliMakeCurrent::gliMakeCurrent(gli &in_context)
+{
+	//Writing gliThreaded here would race with the GL thread reading it
+	if (!gliThreaded)
+		throw "gliMakeCurrent::gliMakeCurrent::gliThreads not called";
+	
+	m_prev = gliThreadContext();
+	pthread_setspecific(g_threadContext, &in_context);
+}
+
+
+gliMakeCurrent::~gliMakeCurrent()
+{
+	pthread_setspecific(g_threadContext, m_prev);
+}
+
+
+
+gliCommandLists::gliCommandLists(int in_count)
+{
+	gliThreads();
+	
+	for (int i=0; i<in_count; i++)
+	{
+		m_contexts.push_back(new gli(true));
+		m_lists.push_back(new gliList());
+	}
+}
+
+
+gliCommandLists::~gliCommandLists()
+{
+	for (size_t i=0; i<m_lists.size(); i++)
+	{
+		delete m_contexts[i];
+		delete m_lists[i];
+	}
+}
+
+
+void gliCommandLists::submit(const gliMatrix *in_transform)
 {
-	g_blendDst = in_dst;
-	g_blendSrc = in_src;
-	glBlendFunc(in_src, in_dst);
+	for (size_t i=0; i<m_lists.size(); i++)
+		gliCurrent().replay(*m_lists[i], in_transform);
 }
@@ -25,14 +25,44 @@
 #define POSITION_MULT	2
 #endif
 
+#ifndef GPU_HEADLESS
 #import <OpenGLES/ES1/gl.h>
 #import <OpenGLES/ES1/glext.h>
+#endif
 
 #import "Camera.h"
+#import "GPUBackend.h"
 #import "Coord4D.h"
+#import "Matrix3D.h"
+#import "Rect2D.h"
+
+#include <vector>
 
 #define ALIGN(x)	__attribute__((aligned(x/8)))
 
+//! Default limit on the vertices submitted (or batched) at once
+#ifndef GLI_SUBMISSION_SIZE
+#define GLI_SUBMISSION_SIZE	4096
+#endif
+
+//! The submission buffer starts this large, and grows by as much
+#ifndef GLI_SUBMISSION_CHUNK
+#define GLI_SUBMISSION_CHUNK	1024
+#endif
+
+//! Depth of the matrix stack kept by gli (see gli::setCPUTransforms)
+#ifndef GLI_MATRIX_DEPTH
+#define GLI_MATRIX_DEPTH	32
+#endif
+
+//! Depth of the clip rectangle stack (see gli::pushClip)
+#ifndef GLI_CLIP_DEPTH
+#define GLI_CLIP_DEPTH	16
+#endif
+
+//! Texture units whose binding a deferred gli context keeps
+#define GLI_TEXTURE_UNITS	8
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //	OpenGL Colour Object
@@ -66,9 +96,26 @@ public:
 	
 	//! Obtain alpha component
 	GLubyte &a()	{	return w;	}
+	
+	//! Components, of a const colour
+	GLubyte r() const	{	return x;	}
+	GLubyte g() const	{	return y;	}
+	GLubyte b() const	{	return z;	}
+	GLubyte a() const	{	return w;	}
 } ALIGN(32);
 
 
+//! A coordinate in submission units, rounded to the nearest one
+/*!	Those out of a GLshort's range are clamped to it, rather than wrapped.	*/
+static inline GLshort gliQuantize(float in_v)
+{
+	if (in_v >= 32767)		return 32767;
+	if (in_v <= -32768)		return -32768;
+	
+	return (GLshort)(in_v < 0 ? in_v - 0.5f : in_v + 0.5f);
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //	OpenGL 3D Position Object
@@ -78,9 +125,9 @@ class gliPosition3D
 	GLshort m_x, m_y, m_z;	
 public:
 	gliPosition3D(float ix, float iy=0, float iz=0)
-	: m_x(ix*POSITION_MULT)
-	, m_y(iy*POSITION_MULT)
-	, m_z(iz*POSITION_MULT)
+	: m_x(gliQuantize(ix*POSITION_MULT))
+	, m_y(gliQuantize(iy*POSITION_MULT))
+	, m_z(gliQuantize(iz*POSITION_MULT))
 	{}
 	
 	gliPosition3D(GLshort ix=0, GLshort iy=0, GLshort iz=0)
@@ -88,6 +135,11 @@ public:
 	, m_y(iy)
 	, m_z(iz)
 	{}
+	
+	//! Coordinates, in submission units
+	inline GLshort x() const	{	return m_x;		}
+	inline GLshort y() const	{	return m_y;		}
+	inline GLshort z() const	{	return m_z;		}
 } ALIGN(32);
 
 
@@ -105,10 +157,72 @@ public:
 	gliTexCoord(GLshort iu=0, GLshort iv=0)
 	: Coord2DI(iu, iv)
 	{}
+	
+	inline GLshort u() const	{	return x;		}
+	inline GLshort v() const	{	return y;		}
 } ALIGN(32);
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//	2D transform applied to vertices by gli
+//
+//! Affine transform of positions, in submission units (see POSITION_MULT)
+class gliMatrix
+{
+public:
+	float a, b;		//!< First row of the linear part
+	float c, d;		//!< Second row of the linear part
+	float tx, ty;	//!< Translation
+	
+	//! The identity
+	gliMatrix()
+	: a(1), b(0)
+	, c(0), d(1)
+	, tx(0), ty(0)
+	{}
+	
+	//! Translate what is drawn after (in submission units)
+	inline void translate(float in_x, float in_y)
+	{
+		tx += a*in_x + b*in_y;
+		ty += c*in_x + d*in_y;
+	}
+	
+	//! Scale what is drawn after
+	inline void scale(float in_x, float in_y)
+	{
+		a *= in_x;	c *= in_x;
+		b *= in_y;	d *= in_y;
+	}
+	
+	//! Apply in_m to what is drawn after, before this transform
+	inline void concat(const gliMatrix &in_m)
+	{
+		tx += a*in_m.tx + b*in_m.ty;
+		ty += c*in_m.tx + d*in_m.ty;
+		
+		const float na = a*in_m.a + b*in_m.c;
+		const float nb = a*in_m.b + b*in_m.d;
+		const float nc = c*in_m.a + d*in_m.c;
+		const float nd = c*in_m.b + d*in_m.d;
+		
+		a = na;		b = nb;
+		c = nc;		d = nd;
+	}
+	
+	//! Transform a position, then scale it (rounded to the nearest unit)
+	inline gliPosition3D apply(float in_x, float in_y, float in_z, float in_scale = 1) const
+	{
+		float x = (a*in_x + b*in_y + tx) * in_scale;
+		float y = (c*in_x + d*in_y + ty) * in_scale;
+		
+		return gliPosition3D(gliQuantize(x), gliQuantize(y), gliQuantize(in_z));
+	}
+};
+
+
 //Aggregate object that holds all the needed data for submission to the GL
 class gliSubmit
 {
@@ -119,6 +233,22 @@ public:
 }ALIGN(32);
 
 
+//! How vertices are laid out in what is handed to the GL
+/*!	Streamed vertices hold only what their enable state draws with: their
+	position, then their colour with gliEnableColorArray, then their texture
+	coordinate with gliEnableTexCoordArray (see gliLayout in Immediate.cpp).
+	Other vertices are as in gliSubmit.	*/
+struct gliVertexLayout
+{
+	int		stride;
+	int		colour;			//!< Offset of the colour (if drawn)
+	int		texCoord;		//!< Offset of the texture coordinate (if drawn)
+	
+	//! Copy what is drawn of vertices (NULL: the layout of gliSubmit)
+	void	(*pack)(const gliSubmit *in_vertices, int in_count, char *out_data);
+};
+
+
 //Prepare...
 class Texture;
 class FrameBuffer;
@@ -126,9 +256,86 @@ class BindTexture;
 class Draw;
 
 class gliBlendFunc;
+class gliClip;
 template<int G, int I> class gliEnable;
 template<int G, int I> class gliDisable;
 
+class RecordList;
+
+struct gliProgram;
+
+namespace GPU
+{
+	class StreamVBO;
+	class IndexVBO;
+	
+	namespace Type
+	{
+		template<class T> class TVBO;
+	};
+};
+
+
+//! Drawing recorded once, replayed from VBOs (see RecordList)
+/*!	A list holds the vertices and indices that gli would have submitted,
+	and for each draw call the enable state, the texture bound to unit 0 and
+	the blend function it was made with.  Once recorded, the list does not
+	change until it is recorded again.	*/
+class gliList
+{
+private:
+	//! A draw call of the list
+	struct Command
+	{
+		GLenum		mode;
+		char		enable[4];
+		GLuint		texture;
+		GLenum		blendSrc, blendDst;
+		
+		int			firstVertex, vertexCount;	//!< In the list's vertices
+		int			firstIndex, indexCount;		//!< 0 indices: glDrawArrays
+	};
+	
+	std::vector<Command>	m_commands;
+	
+	//Filled while recording, uploaded (and emptied) on the first replay
+	mutable std::vector<gliSubmit>	m_vertices;
+	mutable std::vector<GLushort>	m_indices;
+	
+	mutable GPU::Type::TVBO<gliSubmit>	*m_vertexBuffer;
+	mutable GPU::IndexVBO				*m_indexBuffer;
+	
+	//! Add what gli was about to draw
+	void capture(GLenum in_mode, const char *in_enable, GLuint in_texture,
+				 GLenum in_blendSrc, GLenum in_blendDst,
+				 const gliSubmit *in_vertices, int in_vertexCount,
+				 const GLushort *in_indices, int in_indexCount);
+	
+	//! Move what was captured to VBOs (on the GL thread)
+	void upload() const;
+	
+	//! Forget what was recorded (the VBOs stay until replaced)
+	void clear();
+	
+	//! Prevent copies
+	gliList(const gliList &);
+	gliList &operator=(const gliList &);
+	
+	friend class gli;
+	
+public:
+	gliList();
+	
+	//! To be destroyed on the GL thread (it deletes VBOs)
+	~gliList();
+	
+	//! Nothing recorded?
+	inline bool isEmpty() const				{	return m_commands.empty();		}
+	
+	//! Draw calls made by a replay
+	inline int drawCalls() const			{	return (int)m_commands.size();	}
+};
+
 typedef gliEnable<GL_TEXTURE_2D,			0>	gliEnableTexture;
 typedef gliEnable<GL_BLEND,					1>	gliEnableBlendFunc;
 typedef gliEnable<GL_COLOR_ARRAY,			2>	gliEnableColorArray;
@@ -147,8 +354,85 @@ typedef gliDisable<GL_TEXTURE_COORD_ARRAY,	3>	gliDisableTexCoordArray;
 class gli
 {
 private:
-	//The OpenGL submission.
-	gliSubmit submission[4096];
+	//The OpenGL submission (m_capacity vertices, grows up to m_maxCapacity)
+	gliSubmit	*submission;
+	int			m_capacity;
+	int			m_maxCapacity;
+	
+	//Vertices packed for streaming (see gliVertexLayout), m_capacity of them
+	char		*m_packed;
+	
+	//Batching: triangles of consecutive shapes, drawn together
+	GLushort	*m_indices;
+	int			m_indexCount;
+	
+	//While the batch is only 4 vertex strips: their number (indices not written)
+	int			m_quads;
+	
+	//First vertex of the shape being drawn
+	int			m_first;
+	
+	//A line loop split by overflow() is closed with its first vertex
+	gliSubmit	m_loopStart;
+	bool		m_loopSplit;
+	
+	//Vertices of the current shape already drawn by splitShape()
+	int			m_spilled;
+	
+	//Between begin() and end()?
+	bool		m_inDraw;
+	
+	//Keep triangles around until the state changes?
+	bool		m_batching;
+	
+	//Enable state the batched triangles are drawn with
+	char		m_batchEnable[4];
+	
+	//Vertices referenced by the batched triangles
+	int			m_batchVertices;
+	
+	//Rings the submission is streamed through (NULL: drawn from client memory)
+	GPU::StreamVBO	*m_vertexStream;
+	GPU::StreamVBO	*m_indexStream;
+	
+	//Matrix stack applied to vertices (m_matrices[m_matrixDepth] is current)
+	gliMatrix	m_matrices[GLI_MATRIX_DEPTH];
+	int			m_matrixDepth;
+	bool		m_cpuTransforms;
+	
+	//Submission units per POSITION_MULT ones, of this batch (see setPositionScale)
+	float		m_positionScale;
+	
+	//! A clip rectangle, in submission units (after the transform)
+	struct ClipRect
+	{
+		int		x0, y0, x1, y1;
+	};
+	
+	//Clip rectangle stack (m_clips[m_clipDepth-1] is current, none at 0)
+	ClipRect	m_clips[GLI_CLIP_DEPTH];
+	int			m_clipDepth;
+	
+	//Built-in shaders replacing the fixed-function pipeline (NULL: not used)
+	gliProgram	*m_program;
+	
+	//List that draw calls go to instead of the GL (NULL: not recording)
+	gliList		*m_recording;
+	bool		m_recordBatching;
+	
+	//Only records; never calls the GL (see gli(bool))
+	bool		m_deferred;
+	
+	//Texture bindings and blend function this context draws with
+	GLuint		m_textures[GLI_TEXTURE_UNITS];		//Deferred contexts only
+	GLenum		m_blendSrc, m_blendDst;
+	
+	//Statistics (see drawCalls())
+	int			m_drawCalls;
+	int			m_highWater;
+	int			m_splits;
+	double		m_submitTime;
+	double		m_submitBytes;
 	
 	//Immediate texture coordinate and color
 	gliTexCoord 		m_texCoord;
@@ -163,7 +447,7 @@ private:
 	
 	//Drawing mode...
 	short m_mode;
-	short m_curVertex;
+	int m_curVertex;
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -173,8 +457,7 @@ private:
 	friend class gliEnable<GL_COLOR_ARRAY,	 2	>;
 	friend class gliEnable<GL_TEXTURE_COORD_ARRAY,	 3	>;
 	
-	char m_enable[4];					//Our logical state
-	char m_pvtEnable[4];				//Actual state..
+	char m_enable[4];					//Our logical state (GPU::State has the GL's)
 	
 	
 ////////////////////////////////////////////////////////////////////////////////
@@ -182,77 +465,120 @@ private:
 	friend class FrameBuffer;
 	friend class BindTexture;
 	
+	//Blending...
+	friend class gliBlendFunc;
+	
+	//! Change the blend function (flushing what was meant for the previous)
+	void blendFunc(GLenum in_src, GLenum in_dst);
+	
 	
 	
 ////////////////////////////////////////////////////////////////////////////////
 	//Drawing...
 	friend class Draw;
+	friend class RecordList;
+	
+	//! Send draw calls to io_list (emptied first) rather than to the GL
+	/*!	Lists hold positions at a position scale of 1, as replay() draws
+		them, so the context must be at 1.	*/
+	void beginRecording(gliList *io_list);
+	
+	//! Upload the list being recorded, and draw to the GL again
+	void endRecording();
 	
 	//Start and end a shape...
 	inline void begin(short mode)
 	{
 		m_mode = mode;
-		m_curVertex = 0;
+		
+		if (!m_batching)
+			m_curVertex = 0;
+		
+		m_first = m_curVertex;
+		m_spilled = 0;
+		m_inDraw = true;
 	}
 
 	inline void end()
 	{
-		//Check for texturing...
-		if (m_enable[0] != m_pvtEnable[0])
-		{
-			m_pvtEnable[0] = m_enable[0];
-			if (m_enable[0])
-				glEnable(GL_TEXTURE_2D);
-			else
-				glDisable(GL_TEXTURE_2D);
-		}
+		if (m_loopSplit)
+			closeLoop();
 		
-		//Check for blending...
-		if (m_enable[1] != m_pvtEnable[1])
-		{
-			m_pvtEnable[1] = m_enable[1];
-			if (m_enable[1])
-				glEnable(GL_BLEND);
-			else
-				glDisable(GL_BLEND);
-		}
-	
-		//Set up colour arrays...
-		if (m_enable[2] != m_pvtEnable[2])
-		{
-			m_pvtEnable[2] = m_enable[2];
-			if (m_enable[2])
-				glEnableClientState(GL_COLOR_ARRAY);
-			else
-				glDisableClientState(GL_COLOR_ARRAY);
-		}
-		if (m_enable[2])
-			glColorPointer(		4, GL_UNSIGNED_BYTE,
-								sizeof(submission[0]),
-								&(submission[0].colour));
+		if (m_curVertex > m_highWater)
+			m_highWater = m_curVertex;
+		if (m_curVertex - m_first + m_spilled > m_highWater)
+			m_highWater = m_curVertex - m_first + m_spilled;
+		
+		//Quads are cut down to the clip rectangle, and batched as ever
+		if (m_clipDepth != 0 && !clipShape())
+			return;
 		
-		//Set up texture coordinate arrays...
-		if (m_enable[3] != m_pvtEnable[3])
+		if (m_batching && (m_mode == GL_TRIANGLES || m_mode == GL_TRIANGLE_STRIP
+						   || m_mode == GL_TRIANGLE_FAN))
 		{
-			m_pvtEnable[3] = m_enable[3];
-			if (m_enable[3])
-				glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-			else
-				glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+			appendBatch();
+			m_inDraw = false;
+			return;
 		}
-		if (m_enable[3])
-			glTexCoordPointer(	2, GL_SHORT,
-								sizeof(submission[0]),
-								&(submission[0].texCoord));
 		
-		//Vertices and drawing the arrays at the end...
-		glVertexPointer(	3, GL_SHORT,
-							sizeof(submission[0]),
-							&(submission[0].position));
-
-		glDrawArrays(m_mode, 0, m_curVertex);
+		m_inDraw = false;
+		
+		//Anything batched was submitted before this shape
+		flushBatch();
+		
+		drawArrays(m_first, m_curVertex - m_first);
+		
+		m_curVertex = m_first = 0;
 	}
 	
+	//! Bring the GL in line with an enable state, and point at vertices
+	/*!	\param in_enable	State to draw with
+		\param in_base		Where the first vertex is (a VBO offset when streaming)
+		\param in_layout	How vertices are laid out from there	*/
+	void applyState(const char *in_enable, const char *in_base,
+					const gliVertexLayout &in_layout);
+	
+	//! Stream vertices of the submission, packed for in_enable
+	/*!	\return	Offset of the first one in m_vertexStream	*/
+	int streamVertices(const char *in_enable, int in_first, int in_count);
+	
+	//! Draw vertices of the submission as m_mode (streamed, if enabled)
+	void drawArrays(int in_first, int in_count);
+	
+	//! Add the shape just ended to the batch (as indexed triangles)
+	void appendBatch();
+	
+	//! Draw the batched triangles
+	void flushBatch();
+	
+	//! Write the indices of the batched quads (see m_quads)
+	void writeQuadIndices();
+	
+	//! The submission is full: grow it, or draw what is there to make room
+	void overflow();
+	
+	//! Draw the part of a shape that fills the submission, keep what continues it
+	void splitShape();
+	
+	//! Add the first vertex of a split line loop back at its end
+	void closeLoop();
+	
+	//! Clip the shape just ended to the clip rectangle
+	/*!	\return	Is it to be drawn as usual?  (If not, it was dropped, or
+				drawn with the scissor.)	*/
+	bool clipShape();
+	
+	//! Cut an axis-aligned quad (a 4 vertex strip) down to the clip rectangle
+	/*!	\return	1: to draw, 0: entirely outside, -1: not axis-aligned	*/
+	int clipQuad(gliSubmit *io_quad);
+	
+	//! Draw vertices of the submission with the scissor around the clip rectangle
+	/*!	Within the scissor box in use, if any, which is then put back.	*/
+	void drawScissored(int in_first, int in_count);
+	
+	//! Move the submission to buffers of in_vertices (holding what it has)
+	void reallocate(int in_vertices);
+	
 	inline void texCoord(float u, float v=0)
 	{	m_texCoord = gliTexCoord(u,v);		}
 	
@@ -273,29 +599,62 @@ private:
 	
 	inline void vertex(float x, float y=0, float z=0)
 	{
-		submission[m_curVertex].position = gliPosition3D(x,y,z);
-		submission[m_curVertex].colour = m_colour;
-		submission[m_curVertex].texCoord = m_texCoord;
+		if (m_curVertex == m_capacity)
+			overflow();
+		
+		if (m_cpuTransforms)
+			submission[m_curVertex].position = m_matrices[m_matrixDepth].apply(
+						x*POSITION_MULT, y*POSITION_MULT, z*POSITION_MULT, m_positionScale);
+		else
+			submission[m_curVertex].position = gliPosition3D(x*m_positionScale,
+															 y*m_positionScale, z);
+		
+		//What the enable state doesn't draw is left as it was
+		if (m_enable[2])
+			submission[m_curVertex].colour = m_colour;
+		if (m_enable[3])
+			submission[m_curVertex].texCoord = m_texCoord;
 		m_curVertex++;
 	}
 	
 	inline void vertexi(GLshort x=0, GLshort y=0, GLshort z=0)
 	{
-		submission[m_curVertex].position = gliPosition3D(x,y,z);
-		submission[m_curVertex].colour = m_colour;
-		submission[m_curVertex].texCoord = m_texCoord;
+		if (m_curVertex == m_capacity)
+			overflow();
+		
+		if (m_cpuTransforms)
+			submission[m_curVertex].position = m_matrices[m_matrixDepth].apply(x, y, z,
+																				m_positionScale);
+		else
+			submission[m_curVertex].position = gliPosition3D(gliQuantize(x*m_positionScale),
+															 gliQuantize(y*m_positionScale), z);
+		
+		if (m_enable[2])
+			submission[m_curVertex].colour = m_colour;
+		if (m_enable[3])
+			submission[m_curVertex].texCoord = m_texCoord;
 		m_curVertex++;
 	}
 	
 public:
-	gli()
-	: m_width(0)
-	, m_height(0)
-	, m_scale(1)
-	{
-		memset(m_enable, 0, sizeof(m_enable));
-		memset(m_pvtEnable, 0, sizeof(m_pvtEnable));
-	}
+	//! A context
+	/*!	\param in_deferred		Record only: the context never calls the GL,
+								so it may be used from any thread (see
+								gliMakeCurrent).  Everything it draws must be
+								inside a RecordList, transforms are always
+								done by gli, and textures must have been
+								loaded on the GL thread beforehand.	*/
+	gli(bool in_deferred = false);
+	~gli();
+	
+	//! Does this context only record?
+	inline bool isDeferred() const				{	return m_deferred;				}
+	
+	//! Texture bound to a unit, as drawn by this context
+	GLuint boundTexture(int in_unit) const;
+	
+	//! Bind a texture for what is drawn next (what was drawn before is flushed)
+	void bindTexture(int in_unit, GLuint in_texture);
 	
 	//Update device info
 	inline void specifyDeviceSize(int in_width, int in_height)
@@ -312,21 +671,201 @@ public:
 	inline int deviceWidth()					{	return m_width;					}
 	inline int deviceHeight()					{	return m_height;				}
 	inline float deviceScale()					{	return m_scale;					}
+	
+	//! Merge consecutive shapes into one draw call (default off)
+	/*!	While batching, triangles, strips and fans are kept as indexed
+		triangles until something that affects them changes: the enable
+		state, the bound texture, the blend function, a matrix or the render
+		target.  Lines and points are drawn right away.
+	 
+		Batches made of quads only (4 vertex strips, as drawn by blit and
+		text) take no indices: when streaming, they are drawn with the
+		shared GPU::quadIndices().
+	 
+		Call flush() before presenting a frame, and before touching the GL
+		directly.	*/
+	void setBatching(bool in_batching);
+	
+	//! Is batching on?
+	inline bool isBatching() const				{	return m_batching;				}
+	
+	//! Draw everything batched so far
+	/*!	Free when nothing is batched, so it may be called liberally.	*/
+	void flush();
+	
+	//! Limit the vertices submitted (or batched) at once
+	/*!	The submission starts at GLI_SUBMISSION_CHUNK vertices and grows by
+		as much when it fills, up to in_vertices (at most 65536).  Once
+		there, shapes are drawn and the submission reused: batches are drawn
+		early, and long shapes are split in pieces (strips and fans carry on
+		from where they were cut).
+	 
+		Not to be called inside a Draw.	*/
+	void setCapacity(int in_vertices);
+	
+	//! Limit on the vertices submitted at once
+	inline int capacity() const					{	return m_maxCapacity;			}
+	
+	//! Stream vertices through a VBO ring rather than drawing client memory
+	/*!	With client arrays, every draw call waits for the driver to copy
+		the vertices.  Streaming copies them in a GPU::StreamVBO instead,
+		which is orphaned when it wraps around so that the CPU never waits
+		on the GPU.  Indices of batches are streamed alongside, unless the
+		batch is only quads.
+	 
+		Streamed vertices hold only what is drawn: without colour and
+		texture coordinate arrays, half of a gliSubmit is uploaded.
+	 
+		The gliEnable client states work the same either way.
+	 
+		\param in_vertices	Size of the ring (at least capacity(); a few
+							frames' worth is best), 0 to stop streaming	*/
+	void setStreaming(int in_vertices);
+	
+	//! Are vertices streamed through a VBO?
+	inline bool isStreaming() const				{	return m_vertexStream != NULL;	}
+	
+	//! Draw calls issued since the last resetStatistics()
+	inline int drawCalls() const				{	return m_drawCalls;				}
+	
+	//! Most vertices held at once, or in one shape, since resetStatistics()
+	/*!	Above capacity(), some shape was split.	*/
+	inline int highWaterMark() const			{	return m_highWater;				}
+	
+	//! Shapes split because they did not fit since the last resetStatistics()
+	inline int splitCount() const				{	return m_splits;				}
+	
+	//! Milliseconds spent handing vertices to the GL since resetStatistics()
+	/*!	The driver's copy: the draw calls with client arrays, the uploads
+		and draw calls when streaming.	*/
+	inline double submitMs() const				{	return m_submitTime * 1000;		}
+	
+	//! Bytes of vertices and indices handed to the GL since resetStatistics()
+	inline double submitBytes() const			{	return m_submitBytes;			}
+	
+	//! Start counting from 0
+	inline void resetStatistics()
+	{
+		m_drawCalls = 0;
+		m_highWater = 0;
+		m_splits = 0;
+		m_submitTime = 0;
+		m_submitBytes = 0;
+	}
 
 	
+	//! Transform vertices as they are submitted, rather than in the GL
+	/*!	The matrix functions below then work on a stack kept by gli, and
+		vertices are stored transformed.  Shapes drawn with different
+		transforms may thus be batched into one draw call.  The GL's
+		modelview matrix should be left as the identity (gliModelSetup).
+	 
+		Always on with setProgrammable(true).	*/
+	void setCPUTransforms(bool in_cpu);
+	
+	//! Are vertices transformed by gli?
+	inline bool isCPUTransforms() const			{	return m_cpuTransforms;			}
+	
+	//! Draw with built-in shaders rather than the fixed-function pipeline
+	/*!	Needs an OpenGL ES 2 context.  Vertices are transformed by gli (see
+		setCPUTransforms), then by the matrix given to setProjection.  The
+		gliEnable states behave as in OpenGL ES 1: colours are white without
+		gliEnableColorArray, and texture coordinates are in 1024ths as set
+		up by gliTextureMatrixSetup.	*/
+	void setProgrammable(bool in_programmable);
+	
+	//! Are the built-in shaders used?
+	inline bool isProgrammable() const			{	return m_program != NULL;		}
+	
+	//! The built-in shaders' program (0 without them)
+	GLuint program() const;
+	
+	//! Projection applied by the built-in shaders (see gliOrtho)
+	/*!	Maps (x, y, 1), in submission units at a position scale of 1, to
+		clip space.	*/
+	void setProjection(const Matrix3D &in_projection);
+	
+	//! Store positions at in_scale times the precision of POSITION_MULT
+	/*!	From the next batch on: what was batched is flushed first.  Above 1,
+		positions are finer (to 1/(POSITION_MULT*in_scale) of a unit of
+		vertex()) but reach less far, and below 1 the other way around.  The
+		draw undoes the scale: the GL's modelview matrix is scaled by
+		1/in_scale around it, or the built-in shaders' projection.
+	 
+		Not while recording (lists are replayed at 1), clipping or inside
+		a Draw.	*/
+	void setPositionScale(float in_scale);
+	
+	//! Submission units per POSITION_MULT ones (1 unless changed)
+	inline float positionScale() const			{	return m_positionScale;			}
+	
+	//! The current transform (when transforming vertices)
+	inline const gliMatrix &matrix() const		{	return m_matrices[m_matrixDepth];	}
+	
+	//! Draw a recorded list
+	/*!	The list is drawn under the current transform, then in_transform
+		(in submission units, as matrix()).  The texture and blend function
+		are put back as they were.
+	 
+		Not to be called while recording.	*/
+	void replay(const gliList &in_list, const gliMatrix *in_transform = NULL);
+	
+	//! Is a RecordList capturing draw calls?
+	inline bool isRecording() const				{	return m_recording != NULL;		}
+	
 	inline void pushMatrix()
 	{
-		glPushMatrix();
+		if (m_cpuTransforms)
+		{
+			if (m_matrixDepth + 1 == GLI_MATRIX_DEPTH)
+				throw "gli::pushMatrix::Stack overflow";
+			
+			m_matrices[m_matrixDepth + 1] = m_matrices[m_matrixDepth];
+			m_matrixDepth++;
+			return;
+		}
+		
+		GPU::backend().pushMatrix();
 	}
 	
 	inline void popMatrix()
 	{
-		glPopMatrix();
+		if (m_cpuTransforms)
+		{
+			if (m_matrixDepth == 0)
+				throw "gli::popMatrix::Stack underflow";
+			
+			m_matrixDepth--;
+			return;
+		}
+		
+		flush();
+		GPU::backend().popMatrix();
+	}
+	
+	//! Reset the current matrix to the identity
+	inline void loadIdentity()
+	{
+		if (m_cpuTransforms)
+		{
+			m_matrices[m_matrixDepth] = gliMatrix();
+			return;
+		}
+		
+		flush();
+		GPU::backend().loadIdentity();
 	}
 	
 	inline void translate(float dx, float dy=0, float dz = 0)
 	{
-		glTranslatef(dx*POSITION_MULT, dy*POSITION_MULT, dz*POSITION_MULT);
+		if (m_cpuTransforms)
+		{
+			m_matrices[m_matrixDepth].translate(dx*POSITION_MULT, dy*POSITION_MULT);
+			return;
+		}
+		
+		flush();
+		GPU::backend().translatef(dx*POSITION_MULT, dy*POSITION_MULT, dz*POSITION_MULT);
 	}
 	
 	inline void translate(const Coord2D in_t)
@@ -336,32 +875,147 @@ public:
 	
 	inline void scale(const Coord2D in_t)
 	{
-		glScalef(in_t.x, in_t.y, 1);
+		if (m_cpuTransforms)
+		{
+			m_matrices[m_matrixDepth].scale(in_t.x, in_t.y);
+			return;
+		}
+		
+		flush();
+		GPU::backend().scalef(in_t.x, in_t.y, 1);
 	}
 	
+	
+	//! Clip what is drawn next to in_rect, within the current clip rectangle
+	/*!	in_rect is in the units of vertex(), under the current transform
+		(a rotated rectangle clips to its bounds).  Transforms must be done
+		by gli (setCPUTransforms): the GL's own matrices are not known to it,
+		and the GL's modelview is taken to be the identity.
+	 
+		Axis-aligned quads (blit, fillRect, text...) are cut down on the CPU,
+		their texture coordinates and colours along with them, so that they
+		stay in the batch; those entirely outside are dropped.  Anything else
+		is drawn on its own, with the scissor around the clip rectangle.  This
+		needs specifyDeviceSize and specifyDeviceScale, with y going down
+		the screen.  A scissor box already in use (such as DirtyRegion's,
+		set through GPU::State) is intersected with, and put back after.
+	 
+		While recording, only quads are clipped.  Clipped texture coordinates
+		are rounded to the nearest texCoordi() unit.	*/
+	void pushClip(const Rect2D &in_rect);
+	
+	//! Go back to the clip rectangle of before the last pushClip()
+	void popClip();
+	
+	//! Is what is drawn clipped?
+	inline bool isClipping() const				{	return m_clipDepth != 0;		}
+	
 }ALIGN(32);
 
+//! The context of the thread that owns the GL
+/*!	What applications draw through.  Inside the library, gliCurrent() is
+	used instead, so that threads recording a gliCommandLists list draw
+	into their own context.	*/
 extern gli gl;
 extern gliColour gliColourWhite;
 
+//! May threads make contexts current?  (Until then, gliCurrent() is gl)
+/*!	Only written by gliThreads(), on the GL thread.	*/
+extern bool gliThreaded;
+
+//! Let threads make contexts current (see gliMakeCurrent)
+/*!	Called on the GL thread, before the threads that draw are started
+	(gliCommandLists does), so that gliThreaded is never written while
+	another thread reads it.	*/
+void gliThreads();
+
+//! Context made current on the calling thread (NULL: none)
+gli *gliThreadContext();
+
+//! The calling thread's context: gl, or the one it made current
+/*!	Looked up on each call; code drawing a lot keeps it in a gli &.	*/
+inline gli &gliCurrent()
+{
+	if (!gliThreaded)
+		return gl;
+	
+	gli *c = gliThreadContext();
+	return c ? *c : gl;
+}
+
+
+//! Make a context the calling thread's gliCurrent(), for the object's lifetime
+/*!	Each thread that draws needs its own deferred context (see gli(bool)).
+	Threads that never made one current draw through gl.  gliThreads()
+	must have been called first.	*/
+class gliMakeCurrent
+{
+	gli *m_prev;
+	
+public:
+	gliMakeCurrent(gli &in_context);
+	~gliMakeCurrent();
+};
+
 
 static void gliTextureMatrixSetup()
 {
-	glMatrixMode(GL_TEXTURE);
-	glLoadIdentity();
-	glScalef(1.0f/1024.0f,1.0f/1024.0f,1.0f);
+	gli &g = gliCurrent();
+	g.flush();
+	
+	//Built into the shaders
+	if (g.isProgrammable())
+		return;
+	
+	GPU::backend().matrixMode(GL_TEXTURE);
+	GPU::backend().loadIdentity();
+	GPU::backend().scalef(1.0f/1024.0f,1.0f/1024.0f,1.0f);
 }
 
 static void gliProjectionSetup()
 {
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
+	gli &g = gliCurrent();
+	g.flush();
+	
+	if (g.isProgrammable())
+	{
+		g.setProjection(Matrix3D());
+		return;
+	}
+	
+	GPU::backend().matrixMode(GL_PROJECTION);
+	GPU::backend().loadIdentity();
 }
 
 static void gliModelSetup()
 {
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
+	gli &g = gliCurrent();
+	g.flush();
+	
+	if (g.isCPUTransforms())
+	{
+		g.loadIdentity();
+		
+		if (g.isProgrammable())
+			return;
+	}
+	
+	GPU::backend().matrixMode(GL_MODELVIEW);
+	GPU::backend().loadIdentity();
+}
+
+//! Orthographic projection for gli::setProjection, in the units of gli::vertex()
+static Matrix3D gliOrtho(float in_left, float in_right, float in_bottom, float in_top)
+{
+	float w = (in_right - in_left) * POSITION_MULT;
+	float h = (in_top - in_bottom) * POSITION_MULT;
+	
+	Matrix3D m;
+	m.rows[0] = Coord3D(2 / w, 0, -(in_right + in_left) / (in_right - in_left));
+	m.rows[1] = Coord3D(0, 2 / h, -(in_top + in_bottom) / (in_top - in_bottom));
+	m.rows[2] = Coord3D(0, 0, 1);
+	
+	return m;
 }
 
 
@@ -378,6 +1032,7 @@ static void gliModelSetup()
 */
 class gliBlendFunc
 {
+	gli &m_gl;				//!< Context the function is changed in
 	GLenum m_oldSrc;		//!< Previous src blend func
 	GLenum m_oldDst;		//!< Previous dest blend func
 
@@ -386,7 +1041,10 @@ public:
 	gliBlendFunc(GLenum in_src=GL_ONE, GLenum in_dst=GL_ZERO);
 	
 	//! Change the blend function
-	void blendFunc(GLenum in_src=GL_ONE, GLenum in_dst=GL_ZERO);
+	inline void blendFunc(GLenum in_src=GL_ONE, GLenum in_dst=GL_ZERO)
+	{
+		m_gl.blendFunc(in_src, in_dst);
+	}
 	
 	//! Restore the previous blend function
 	inline ~gliBlendFunc()
@@ -396,6 +1054,27 @@ public:
 };
 
 
+//! Clip what is drawn to a rectangle, for the object's lifetime (see gli::pushClip)
+/*!	A scrolling list draws its items inside one; those scrolled out are
+	dropped, those cut by its edges clipped, and all stay in one batch.	*/
+class gliClip
+{
+	gli &m_gl;				//!< Context the rectangle is pushed on
+	
+public:
+	inline gliClip(const Rect2D &in_rect)
+	: m_gl(gliCurrent())
+	{
+		m_gl.pushClip(in_rect);
+	}
+	
+	inline ~gliClip()
+	{
+		m_gl.popClip();
+	}
+};
+
+
 //!	OpenGL Enable Disable
 /*!\ingroup OpenGLES1
 		Usage:	enables and disables GL states.
@@ -407,19 +1086,21 @@ public:
 template<int GL_MODE, int INDEX>
 class gliEnable
 {
+	gli &m_gl;
 	char m_prevState;
 public:
 	//! Enable the given state (pass false to disable)
 	gliEnable(bool in_enable = true)
+	: m_gl(gliCurrent())
 	{
-		m_prevState = gl.m_enable[INDEX];
-		gl.m_enable[INDEX] = in_enable ? 1 : 0;
+		m_prevState = m_gl.m_enable[INDEX];
+		m_gl.m_enable[INDEX] = in_enable ? 1 : 0;
 	}
 	
 	//! Toggle enable/disable
 	inline void enable(bool in_enable = true)
 	{
-		gl.m_enable[INDEX] = in_enable ? 1 : 0;
+		m_gl.m_enable[INDEX] = in_enable ? 1 : 0;
 	}
 	
 	//! Disable (explicit)
@@ -431,7 +1112,7 @@ public:
 	//! Upon destruction, return previous state.
 	inline ~gliEnable()
 	{
-		gl.m_enable[INDEX] = m_prevState;
+		m_gl.m_enable[INDEX] = m_prevState;
 	}
 };
 
@@ -464,34 +1145,44 @@ public:
 
 class Draw
 {
+	gli &m_gl;		//!< Context drawn through (looked up once)
+	
 public:
 	//!Make sure that each begin has an associated end
 	Draw(short in_mode)
+	: m_gl(gliCurrent())
 	{
-		gl.begin(in_mode);
+		m_gl.begin(in_mode);
+	}
+	
+	//! Draw through a context the caller already has (see gliCurrent)
+	Draw(gli &io_gl, short in_mode)
+	: m_gl(io_gl)
+	{
+		m_gl.begin(in_mode);
 	}
 	
 	~Draw()
 	{
-		gl.end();
+		m_gl.end();
 	}
 	
 	//!Forward all the vertex and texture stuff...
 	inline void texCoord(float u, float v=0)
-	{	gl.texCoord(u,v);		}
+	{	m_gl.texCoord(u,v);		}
 	
 	//! Apply a texture coordinate from texture
 	inline void texCoord(const gliTexCoord &in_t)
-	{	gl.texCoord(in_t);		}
+	{	m_gl.texCoord(in_t);		}
 	
 	//! Texture coordinates from integers
 	inline void texCoordi(GLshort u, GLshort v=0)
-	{	gl.texCoordi(u,v);		}
+	{	m_gl.texCoordi(u,v);		}
 	
 	//! Texture coordinate from Coord2D
 	/*!	\param in_t[in]		Texture coordinates within Coord2D	*/
 	inline void texCoord(const Coord2D &in_t)
-	{	gl.texCoord(in_t.x, in_t.y);	}
+	{	m_gl.texCoord(in_t.x, in_t.y);	}
 	
 	//! Set up the colour using floats.
 	/*!	 \param	r[in]	Red component
@@ -499,7 +1190,7 @@ public:
 		 \param	b[in]	Blue component, default 0
 		 \param	a[in]	Alpha component, default 0	*/
 	inline void colour(float r, float g=0, float b=0, float a=0)
-	{	gl.colour(r,g,b,a);		}
+	{	m_gl.colour(r,g,b,a);		}
 	
 	//! Set the colour using bytes explicitly (range 0...255)
 	/*!	\param	r[in]	Red component, default 0
@@ -507,17 +1198,17 @@ public:
 		\param	b[in]	Blue component, default 0
 		\param	a[in]	Alpha component, default 0	*/
 	inline void colouri(GLubyte r=0, GLubyte g=0, GLubyte b=0, GLubyte a=0)
-	{	gl.colouri(r,g,b,a);		}
+	{	m_gl.colouri(r,g,b,a);		}
 	
 	//! Assign a colour using an internal gliColour object
 	/*! \param in_colour[in]		Colour to set the GL state to */
 	inline void colour(const gliColour &in_colour)
-	{	gl.colour(in_colour);				}
+	{	m_gl.colour(in_colour);				}
 	
 	//! Assign a colour stored in a Coord4D
 	/*! \param in_colour[in]		Colour to set the GL state to */
 	inline void colour(const Coord4D in_colour)
-	{	gl.colour(in_colour.x, in_colour.y, in_colour.z, in_colour.w);	}
+	{	m_gl.colour(in_colour.x, in_colour.y, in_colour.z, in_colour.w);	}
 	
 	//! Set up a vertex
 	/*!	\param x[in]	X coordinate
@@ -525,17 +1216,17 @@ public:
 		\param z[in]	Z coordinate (default 0)	*/
 	inline void vertex(float x, float y=0, float z=0)
 	{
-		gl.vertex(x,y,z);
+		m_gl.vertex(x,y,z);
 	}
 	
 	inline void vertex(Coord2D in_c)
 	{
-		gl.vertex(in_c.x, in_c.y, 0);
+		m_gl.vertex(in_c.x, in_c.y, 0);
 	}
 	
 	inline void vertexi(GLshort x=0, GLshort y=0, GLshort z=0)
 	{
-		gl.vertexi(x,y,z);
+		m_gl.vertexi(x,y,z);
 	}
 };
 
@@ -544,19 +1235,121 @@ public:
 /*! \ingroup OpenGLES1 */
 class gliTransform
 {
+	gli &m_gl;		//!< Context the matrix is pushed on
+	
 public:
-	gliTransform()		{	gl.pushMatrix();	}
-	~gliTransform()		{	gl.popMatrix();		}
+	gliTransform() : m_gl(gliCurrent())	{	m_gl.pushMatrix();	}
+	~gliTransform()						{	m_gl.popMatrix();	}
 	
 	void translate(const Coord2D &in_c)
 	{
-		gl.translate(in_c.x, in_c.y);
+		m_gl.translate(in_c.x, in_c.y);
 	}
 	
 	void scale(const Coord2D &in_s)
 	{
-		gl.scale(in_s);
+		m_gl.scale(in_s);
 	}
 };
 
+
+//!	Records what is drawn into a gliList, rather than drawing it
+/*!	Draw, blit and fill calls (anything drawn through gli) made while the
+	object is alive go into the list, along with the state they need.  The
+	list is uploaded to VBOs when the object goes out of scope, and may then
+	be drawn again and again with gli::replay().
+ 
+	Transforms are kept in the list only with gli::setCPUTransforms(true); GL
+	matrix calls are not recorded.  The position scale must be 1 (see
+	gli::setPositionScale).
+ 
+\code
+gliList background;
+ 
+{
+	RecordList r(background);	//Replaces what background held
+	
+	gliEnableTexture t;
+	tiles.use(0);
+	for (int i=0; i<200; i++)
+		blit<32,32>(tile[i], position[i]);
+}
+ 
+//Every frame
+gl.replay(background);
+\endcode	*/
+class RecordList
+{
+	gli &m_gl;		//!< Context recording into the list
+	
+public:
+	RecordList(gliList &io_list) : m_gl(gliCurrent())	{	m_gl.beginRecording(&io_list);	}
+	~RecordList()										{	m_gl.endRecording();				}
+};
+
+
+//! Lists recorded by several threads at once, drawn in a fixed order
+/*!	Each list has its own deferred context.  Any thread may record any
+	list (one thread per list at a time); none of them touches the GL.  The
+	GL thread then submits them all, in index order, whichever finished
+	first.
+ 
+\code
+class BuildScene : public IParallelTask
+{
+	void run(int in_begin, int in_end)
+	{
+		for (int i=in_begin; i<in_end; i++)
+		{
+			gliCommandLists::Record r(lists, i);
+			drawLayer(i);			//Draw, blit, drawText32...
+		}
+	}
+};
+ 
+pool.run(&build, lists.count(), 1);
+lists.submit();
+\endcode	*/
+class gliCommandLists
+{
+private:
+	std::vector<gli*>		m_contexts;
+	std::vector<gliList*>	m_lists;
+	
+	//! Prevent copies
+	gliCommandLists(const gliCommandLists &);
+	gliCommandLists &operator=(const gliCommandLists &);
+	
+public:
+	//! in_count lists, each with a context (on the GL thread, see gliThreads)
+	gliCommandLists(int in_count);
+	
+	//! To be destroyed on the GL thread
+	~gliCommandLists();
+	
+	//! Number of lists
+	inline int count() const					{	return (int)m_lists.size();	}
+	
+	//! A list (as last recorded)
+	inline gliList &list(int in_index)			{	return *m_lists[in_index];	}
+	
+	//! Record a list on the calling thread: gliCurrent() is the list's context meanwhile
+	class Record
+	{
+		gliMakeCurrent	m_current;
+		RecordList		m_record;
+		
+	public:
+		Record(gliCommandLists &io_lists, int in_index)
+		: m_current(*io_lists.m_contexts[in_index])
+		, m_record(*io_lists.m_lists[in_index])
+		{}
+	};
+	
+	friend class Record;
+	
+	//! Replay every list, in order (GL thread)
+	void submit(const gliMatrix *in_transform = NULL);
+};
+
 #endif
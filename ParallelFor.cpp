@@ -0,0 +1,137 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "ParallelFor.h"
+
+#include <unistd.h>
+
+
+ParallelFor::ParallelFor(int in_threads)
+: m_generation(0)
+, m_busy(0)
+, m_quit(false)
+, m_task(NULL)
+, m_count(0)
+, m_grain(1)
+, m_next(0)
+{
+	if (in_threads <= 0)
+		in_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_start, NULL);
+	pthread_cond_init(&m_done, NULL);
+
+	for (int i=1; i<in_threads; i++)
+	{
+		pthread_t t;
+		if (pthread_create(&t, NULL, workerMain, this) != 0)
+			break;
+
+		m_threads.push_back(t);
+	}
+}
+
+
+ParallelFor::~ParallelFor()
+{
+	pthread_mutex_lock(&m_mutex);
+	m_quit = true;
+	pthread_cond_broadcast(&m_start);
+	pthread_mutex_unlock(&m_mutex);
+
+	for (size_t i=0; i<m_threads.size(); i++)
+		pthread_join(m_threads[i], NULL);
+
+	pthread_cond_destroy(&m_done);
+	pthread_cond_destroy(&m_start);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+
+void *ParallelFor::workerMain(void *in_self)
+{
+	ParallelFor *self = (ParallelFor*)in_self;
+	unsigned int seen = 0;
+
+	pthread_mutex_lock(&self->m_mutex);
+
+	for (;;)
+	{
+		while (!self->m_quit && self->m_generation == seen)
+			pthread_cond_wait(&self->m_start, &self->m_mutex);
+
+		if (self->m_quit)	break;
+
+		seen = self->m_generation;
+		pthread_mutex_unlock(&self->m_mutex);
+
+		self->work();
+
+		pthread_mutex_lock(&self->m_mutex);
+		if (--self->m_busy == 0)
+			pthread_cond_signal(&self->m_done);
+	}
+
+	pthread_mutex_unlock(&self->m_mutex);
+	return NULL;
+}
+
+
+void ParallelFor::work()
+{
+	for (;;)
+	{
+		int begin = __sync_fetch_and_add(&m_next, m_grain);
+		if (begin >= m_count)	return;
+
+		int end = begin + m_grain;
+		if (end > m_count)	end = m_count;
+
+		m_task->run(begin, end);
+	}
+}
+
+
+void ParallelFor::run(IParallelTask *in_task, int in_count, int in_grain)
+{
+	if (in_count <= 0)	return;
+
+	//Not worth waking anybody up
+	if (m_threads.empty() || in_count <= in_grain)
+	{
+		in_task->run(0, in_count);
+		return;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	m_task = in_task;
+	m_count = in_count;
+	m_grain = in_grain > 0 ? in_grain : 1;
+	m_next = 0;
+	m_busy = (int)m_threads.size();
+	m_generation++;
+	pthread_cond_broadcast(&m_start);
+	pthread_mutex_unlock(&m_mutex);
+
+	work();
+
+	pthread_mutex_lock(&m_mutex);
+	while (m_busy > 0)
+		pthread_cond_wait(&m_done, &m_mutex);
+	m_task = NULL;
+	pthread_mutex_unlock(&m_mutex);
+}
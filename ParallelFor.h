@@ -0,0 +1,123 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <pthread.h>
+#include <vector>
+
+/*!	\file	ParallelFor.h
+	\brief	Split a loop across a set of worker threads.
+
+	The workers are created once and sleep between loops, so a loop can be
+	run every frame without paying for thread creation.
+
+	\code
+class Update : public IParallelTask
+{
+	void run(int in_begin, int in_end)
+	{
+		for (int i=in_begin; i<in_end; i++)
+			...
+	}
+};
+
+ParallelFor pool;
+Update u;
+pool.run(&u, count);
+	\endcode
+*/
+
+
+//! A loop body that may be run over any sub-range, from any thread
+class IParallelTask
+{
+public:
+	//! Process the items in_begin ... in_end-1
+	virtual void run(int in_begin, int in_end)								= 0;
+
+	virtual ~IParallelTask()	{}
+};
+
+
+//! A set of worker threads that run IParallelTask loops
+/*!	run() is not re-entrant; only one loop may be in flight at a time.	*/
+class ParallelFor
+{
+private:
+	//! The workers
+	std::vector<pthread_t>	m_threads;
+
+	//! Guards everything below
+	pthread_mutex_t			m_mutex;
+
+	//! Signalled when a new loop is available (or on quit)
+	pthread_cond_t			m_start;
+
+	//! Signalled when the last worker finishes a loop
+	pthread_cond_t			m_done;
+
+	//! Incremented for every loop, so workers can tell new work apart
+	unsigned int			m_generation;
+
+	//! Workers still busy with the current loop
+	int						m_busy;
+
+	//! True when the workers must exit
+	bool					m_quit;
+
+	//! The current loop
+	IParallelTask			*m_task;
+
+	//! Number of items in the current loop
+	int						m_count;
+
+	//! Items claimed at a time
+	int						m_grain;
+
+	//! Next item to be claimed (atomic)
+	volatile int			m_next;
+
+	//! Thread entry point
+	static void *workerMain(void *in_self);
+
+	//! Claim and run chunks until the loop is exhausted
+	void work();
+
+	//! Prevent copies
+	ParallelFor(const ParallelFor &)	{}
+
+public:
+	//! Start the workers
+	/*!	\param in_threads	Total threads working on a loop, including the
+							caller.  0 uses one per processor.	*/
+	ParallelFor(int in_threads = 0);
+
+	//! Stop the workers
+	~ParallelFor();
+
+	//! Threads working on each loop (including the caller)
+	int threadCount() const		{	return (int)m_threads.size() + 1;	}
+
+	//! Run a loop over in_count items; returns once all items are done
+	/*!	\param in_task	The loop body
+		\param in_count	Number of items
+		\param in_grain	Items claimed by a thread at a time	*/
+	void run(IParallelTask *in_task, int in_count, int in_grain = 64);
+};
+
+#endif
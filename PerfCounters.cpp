@@ -0,0 +1,123 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+
+
+//! Open one counter for the calling thread (-1 on failure)
+static int openCounter(unsigned int in_type, unsigned long long in_config)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+
+	attr.size = sizeof(attr);
+	attr.type = in_type;
+	attr.config = in_config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+
+PerfCounters::PerfCounters()
+{
+	for (int i=0; i<COUNTER_COUNT; i++)
+	{
+		m_fd[i] = -1;
+		m_values[i] = -1;
+	}
+
+#ifdef __linux__
+	m_fd[Cycles] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	m_fd[Instructions] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	m_fd[CacheReferences] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+	m_fd[CacheMisses] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	m_fd[L1DataMisses] = openCounter(PERF_TYPE_HW_CACHE,
+									 PERF_COUNT_HW_CACHE_L1D
+									 | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+									 | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#endif
+}
+
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+	for (int i=0; i<COUNTER_COUNT; i++)
+	{
+		if (m_fd[i] >= 0)
+			close(m_fd[i]);
+	}
+#endif
+}
+
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+	for (int i=0; i<COUNTER_COUNT; i++)
+	{
+		if (m_fd[i] < 0)	continue;
+
+		ioctl(m_fd[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(m_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+
+void PerfCounters::stop()
+{
+#ifdef __linux__
+	for (int i=0; i<COUNTER_COUNT; i++)
+	{
+		if (m_fd[i] < 0)	continue;
+
+		ioctl(m_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+		long long v;
+		if (read(m_fd[i], &v, sizeof(v)) == sizeof(v))
+			m_values[i] = v;
+		else
+			m_values[i] = -1;
+	}
+#endif
+}
+
+
+const char *PerfCounters::name(Counter in_counter)
+{
+	static const char *names[COUNTER_COUNT] =
+	{
+		"cycles",
+		"instructions",
+		"cache_references",
+		"cache_misses",
+		"l1d_read_misses"
+	};
+
+	return in_counter >= 0 && in_counter < COUNTER_COUNT ? names[in_counter] : "";
+}
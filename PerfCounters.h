@@ -0,0 +1,87 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+/*!	\file	PerfCounters.h
+	\brief	Hardware performance counters around a section of code.
+
+	Timing says that something got faster; counters say why.  On Linux this
+	reads the processor's counters through perf_event_open.  Elsewhere, or
+	when the kernel refuses (see /proc/sys/kernel/perf_event_paranoid), the
+	counters are simply unavailable and read as -1.
+
+	\code
+PerfCounters counters;
+
+counters.start();
+world.step(dt);
+counters.stop();
+
+printf("%lld cache misses\\n", counters.value(PerfCounters::CacheMisses));
+	\endcode
+
+	Only the calling thread is counted.
+*/
+class PerfCounters
+{
+public:
+	enum Counter
+	{
+		Cycles,
+		Instructions,
+		CacheReferences,	//!< Last level cache accesses
+		CacheMisses,		//!< Last level cache misses
+		L1DataMisses,		//!< Level 1 data cache read misses
+
+		COUNTER_COUNT
+	};
+
+private:
+	//! File descriptor of each counter (-1 when unavailable)
+	int			m_fd[COUNTER_COUNT];
+
+	//! Counts as of the last stop()
+	long long	m_values[COUNTER_COUNT];
+
+	//! Prevent copies
+	PerfCounters(const PerfCounters &)	{}
+
+public:
+	//! Open the counters
+	PerfCounters();
+
+	//! Close the counters
+	~PerfCounters();
+
+	//! Can this counter be read here?
+	bool isAvailable(Counter in_counter) const	{	return m_fd[in_counter] >= 0;	}
+
+	//! Zero the counters and start counting
+	void start();
+
+	//! Stop counting and read the counters
+	void stop();
+
+	//! Count between the last start() and stop() (-1 when unavailable)
+	long long value(Counter in_counter) const	{	return m_values[in_counter];	}
+
+	//! Short name of a counter, for reports
+	static const char *name(Counter in_counter);
+};
+
+#endif
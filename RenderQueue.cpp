@@ -0,0 +1,181 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "RenderQueue.h"
+#include "GPUState.h"
+
+#include <algorithm>
+
+//! Depth (0 to 1) as an integer of in_bits bits
+static uint64_t quantize(float in_depth, int in_bits)
+{
+	const uint64_t max = ((uint64_t)1 << in_bits) - 1;
+
+	if (!(in_depth > 0))	return 0;
+	if (in_depth >= 1)		return max;
+
+	return (uint64_t)(in_depth * max);
+}
+
+
+uint64_t RenderState::key() const
+{
+	//Ids are cut to fit: sharing bits only costs state changes
+	const uint64_t l = (uint64_t)(layer & 0xff) << 56;
+	const uint64_t p = program & 0xfff;
+	const uint64_t t = texture & 0xffff;
+
+	if (!translucent)
+		return l | (p << 43) | (t << 27) | quantize(depth, 27);
+
+	//Back to front only: blending needs it, and the stable sort keeps those
+	//at the same depth in the order they were added
+	const uint64_t d = quantize(depth, 24) ^ 0xffffff;
+
+	return l | ((uint64_t)1 << 55) | (d << 31);
+}
+
+
+bool RenderState::differs(const RenderState &in_other) const
+{
+	if (translucent != in_other.translucent
+		|| texture != in_other.texture
+		|| program != in_other.program)
+		return true;
+
+	return translucent && (blendSrc != in_other.blendSrc || blendDst != in_other.blendDst);
+}
+
+
+
+RenderQueue::RenderQueue()
+: m_lastItems(0)
+, m_unsortedChanges(0)
+, m_sortedChanges(0)
+{}
+
+
+void RenderQueue::sort()
+{
+	const int n = (int)m_entries.size();
+	m_scratch.resize(n);
+
+	Entry *src = &m_entries[0];
+	Entry *dst = &m_scratch[0];
+
+	//Least significant byte first: each pass keeps the order of the last
+	for (int shift=0; shift<64; shift+=8)
+	{
+		int offsets[256] = {0};
+
+		for (int i=0; i<n; i++)
+			offsets[(src[i].key >> shift) & 0xff]++;
+
+		//Every key has the same byte?  Nothing moves.
+		if (offsets[(src[0].key >> shift) & 0xff] == n)
+			continue;
+
+		int total = 0;
+		for (int b=0; b<256; b++)
+		{
+			const int c = offsets[b];
+			offsets[b] = total;
+			total += c;
+		}
+
+		for (int i=0; i<n; i++)
+			dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
+
+		std::swap(src, dst);
+	}
+
+	if (src != &m_entries[0])
+		m_entries.swap(m_scratch);
+}
+
+
+void RenderQueue::submit()
+{
+	const int n = (int)m_items.size();
+
+	m_lastItems = n;
+	m_unsortedChanges = 0;
+	m_sortedChanges = 0;
+
+	if (n == 0)
+		return;
+
+	m_entries.resize(n);
+	for (int i=0; i<n; i++)
+	{
+		m_entries[i].key = m_items[i].state.key();
+		m_entries[i].item = i;
+
+		if (i && m_items[i].state.differs(m_items[i-1].state))
+			m_unsortedChanges++;
+	}
+
+	sort();
+
+	gli &g = gliCurrent();
+	const GLuint texture = g.boundTexture(0);
+	const GLuint program = GPU::State::program();
+
+	gliEnableTexture texturing(false);
+	gliEnableBlendFunc blending(false);
+	gliBlendFunc blendFunc;
+
+	const RenderState *prev = NULL;
+
+	for (int i=0; i<n; i++)
+	{
+		const Item &item = m_items[m_entries[i].item];
+		const RenderState &s = item.state;
+
+		if (prev && s.differs(*prev))
+			m_sortedChanges++;
+		prev = &s;
+
+		texturing.enable(s.texture != 0);
+		if (s.texture)
+			g.bindTexture(0, s.texture);
+
+		blending.enable(s.translucent);
+		if (s.translucent)
+			blendFunc.blendFunc(s.blendSrc, s.blendDst);
+
+		//What gli kept was drawn with the program before; gli's own (0 in
+		//fixed-function) is used by the items that don't have one.
+		const GLuint use = s.program ? s.program : g.program();
+		if (use != GPU::State::program())
+		{
+			g.flush();
+			GPU::State::useProgram(use);
+		}
+
+		item.drawable->onRender();
+	}
+
+	//As the caller left them
+	g.bindTexture(0, texture);
+	if (program != GPU::State::program())
+	{
+		g.flush();
+		GPU::State::useProgram(program);
+	}
+
+	m_items.clear();
+}
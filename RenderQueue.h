@@ -0,0 +1,169 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "Events.h"
+#include "Immediate.h"
+#include <vector>
+#include <stdint.h>
+
+/*!	\file	RenderQueue.h
+	\brief	Drawables sorted by the state they draw with, once per frame.
+
+	Called one after the other, IDrawable::onRender() switches textures,
+	blending and shaders as often as the drawables happen to alternate.  A
+	RenderQueue rather collects them with the state each one needs, sorts
+	them on a 64 bit key, and renders them so that drawables sharing a state
+	follow one another (and gli batches them together).
+
+	From the most significant bits down, a key holds:
+		- the layer			Layers are drawn in order, never mixed
+		- translucency		Opaque drawables first, then translucent ones
+		- for opaque ones:		shader, texture, blend function, depth (front
+								to back)
+		- for translucent ones:	depth (back to front), and nothing else
+
+	Translucent drawables thus keep the order their depths give, whatever
+	their state; those at the same depth keep the order they were added in
+	(the sort is stable), even if they draw with different states.  Opaque drawables of a layer are drawn in any
+	order: ones that overlap go to different layers.
+
+	\code
+RenderQueue queue;
+
+queue.add(&background, RenderState(backgroundTexture, 0));
+for (int i=0; i<ships; i++)
+	queue.add(&ship[i], RenderState(shipTexture, 1, ship[i].depth()));
+queue.add(&smoke, RenderState(smokeTexture, 1, 0.5f).blend(GL_SRC_ALPHA,
+															GL_ONE_MINUS_SRC_ALPHA));
+
+queue.submit();
+	\endcode
+*/
+
+//! What a drawable needs set before it renders
+class RenderState
+{
+public:
+	int			layer;			//!< Drawn after lower layers (0 to 255)
+	float		depth;			//!< 0 (front) to 1 (back), within a layer
+	GLuint		texture;		//!< Bound to unit 0 (0: texturing disabled)
+	GLuint		program;		//!< Shader program (0: gli's own)
+	bool		translucent;	//!< Blended (see blend())
+	GLenum		blendSrc;		//!< Blend function, when translucent
+	GLenum		blendDst;
+
+	//! Opaque state
+	RenderState(GLuint in_texture = 0, int in_layer = 0, float in_depth = 0)
+	: layer(in_layer)
+	, depth(in_depth)
+	, texture(in_texture)
+	, program(0)
+	, translucent(false)
+	, blendSrc(GL_ONE)
+	, blendDst(GL_ZERO)
+	{}
+
+	//! Make it translucent, blended with the given function
+	inline RenderState &blend(GLenum in_src, GLenum in_dst)
+	{
+		translucent = true;
+		blendSrc = in_src;
+		blendDst = in_dst;
+		return *this;
+	}
+
+	//! Draw with a shader program of one's own
+	/*!	For drawables that draw through the GL themselves: gli binds its own
+		program (see gli::setProgrammable) to draw what it was given.	*/
+	inline RenderState &shader(GLuint in_program)
+	{
+		program = in_program;
+		return *this;
+	}
+
+	//! The sort key
+	uint64_t key() const;
+
+	//! Does going from this state to another change the GL's?
+	bool differs(const RenderState &in_other) const;
+};
+
+
+//! Drawables rendered in state order (see RenderQueue.h)
+class RenderQueue
+{
+private:
+	//! A drawable added this frame
+	struct Item
+	{
+		IDrawable		*drawable;
+		RenderState		state;
+	};
+
+	//! Key of an item, and where the item is
+	struct Entry
+	{
+		uint64_t		key;
+		int				item;
+	};
+
+	std::vector<Item>	m_items;
+	std::vector<Entry>	m_entries;
+	std::vector<Entry>	m_scratch;		//!< Radix sort buffer
+
+	//Statistics of the last submit()
+	int		m_lastItems;
+	int		m_unsortedChanges;
+	int		m_sortedChanges;
+
+	//! Sort m_entries on their keys (stable)
+	void sort();
+
+public:
+	RenderQueue();
+
+	//! Render a drawable this frame, with the given state
+	inline void add(IDrawable *in_drawable, const RenderState &in_state)
+	{
+		Item i = {in_drawable, in_state};
+		m_items.push_back(i);
+	}
+
+	//! Drawables added since the last submit()
+	inline int count() const					{	return (int)m_items.size();	}
+
+	//! Render everything added, sorted, and start over
+	/*!	The texture of unit 0, the blend function and the program are as
+		they were before, once done.	*/
+	void submit();
+
+	//! Forget everything added
+	inline void clear()							{	m_items.clear();			}
+
+	//! Drawables rendered by the last submit()
+	inline int lastItems() const				{	return m_lastItems;			}
+
+	//! State changes the last submit() would have made, unsorted
+	inline int unsortedStateChanges() const		{	return m_unsortedChanges;	}
+
+	//! State changes the last submit() made
+	inline int stateChanges() const				{	return m_sortedChanges;		}
+};
+
+#endif
@@ -18,7 +18,9 @@
 #define RESTORER_H
 
 #include "Smart.h"
+#ifdef __APPLE__
 #include <CoreFoundation/CoreFoundation.h>
+#endif
 
 /*
 	Restorable
@@ -34,6 +36,8 @@ public:
 };
 
 
+//Restorer is backed by CoreFoundation: Apple platforms only
+#ifdef __APPLE__
 /*
 	Restorer
 	
@@ -101,5 +105,6 @@ Restorer *CreateSaveObject(CFStringRef in_fileName);
 		Throws a string describing the error
 */
 Restorer *CreateRestoreObject(CFStringRef in_fileName);
+#endif
 
 #endif
@@ -0,0 +1,101 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <string.h>
+#include <math.h>
+
+/*!	\file	SIMD.h
+	\brief	Four-wide float vectors for the inner loops of the physics code.
+
+	The compiler vector extensions (GCC and clang) are used rather than
+	intrinsics.  They become NEON on the device and SSE in the simulator
+	without any per-platform code.
+
+	Comparisons return a vint4 with every bit set where true, which is meant
+	to be used with v4select and v4any.
+*/
+
+//! Four floats
+typedef float	vfloat4	__attribute__((vector_size(16)));
+
+//! Four ints (also the result of comparing vfloat4)
+typedef int		vint4	__attribute__((vector_size(16)));
+
+
+//! The same value in every lane
+static inline vfloat4 v4splat(const float in_f)
+{
+	vfloat4 r = {in_f, in_f, in_f, in_f};
+	return r;
+}
+
+//! Load four floats (no alignment needed)
+static inline vfloat4 v4load(const float *in_p)
+{
+	vfloat4 r;
+	memcpy(&r, in_p, sizeof(r));
+	return r;
+}
+
+//! Store four floats (no alignment needed)
+static inline void v4store(float *out_p, const vfloat4 in_v)
+{
+	memcpy(out_p, &in_v, sizeof(in_v));
+}
+
+//! Lanes of a where the mask is set, else lanes of b
+static inline vfloat4 v4select(const vint4 in_mask, const vfloat4 a, const vfloat4 b)
+{
+	return (vfloat4)((in_mask & (vint4)a) | (~in_mask & (vint4)b));
+}
+
+//! Lane-wise minimum
+static inline vfloat4 v4min(const vfloat4 a, const vfloat4 b)
+{
+	return v4select(a < b, a, b);
+}
+
+//! Lane-wise maximum
+static inline vfloat4 v4max(const vfloat4 a, const vfloat4 b)
+{
+	return v4select(a > b, a, b);
+}
+
+//! Lane-wise square root
+/*!	There is no portable vector square root; the lanes are done one by one
+	and the compiler is left to do better where it can.	*/
+static inline vfloat4 v4sqrt(const vfloat4 in_v)
+{
+	vfloat4 r = {sqrtf(in_v[0]), sqrtf(in_v[1]), sqrtf(in_v[2]), sqrtf(in_v[3])};
+	return r;
+}
+
+//! True if any lane of the mask is set
+static inline bool v4any(const vint4 in_mask)
+{
+	return (in_mask[0] | in_mask[1] | in_mask[2] | in_mask[3]) != 0;
+}
+
+//! Sum of the four lanes
+static inline float v4sum(const vfloat4 in_v)
+{
+	return (in_v[0] + in_v[1]) + (in_v[2] + in_v[3]);
+}
+
+#endif
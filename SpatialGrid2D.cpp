@@ -0,0 +1,93 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "SpatialGrid2D.h"
+
+//! Fewest cells a grid is allowed to shrink to before the cell size grows
+#define SPATIAL_GRID_MIN_CELLS		1024
+
+//! Cells allowed per point
+#define SPATIAL_GRID_CELLS_PER_ITEM	4
+
+
+void SpatialGrid2D::build(const Coord2D *in_positions, int in_count, float in_cellSize)
+{
+	m_items.resize(in_count);
+	m_itemCell.resize(in_count);
+
+	if (in_count == 0)
+	{
+		m_width = m_height = 0;
+		m_cellStart.assign(1, 0);
+		return;
+	}
+
+	Coord2D lo = in_positions[0];
+	Coord2D hi = lo;
+
+	for (int i=1; i<in_count; i++)
+	{
+		const Coord2D &p = in_positions[i];
+		if (p.x < lo.x)	lo.x = p.x;
+		if (p.y < lo.y)	lo.y = p.y;
+		if (p.x > hi.x)	hi.x = p.x;
+		if (p.y > hi.y)	hi.y = p.y;
+	}
+
+	//Don't let a single stray body allocate the world
+	long maxCells = (long)in_count * SPATIAL_GRID_CELLS_PER_ITEM;
+	if (maxCells < SPATIAL_GRID_MIN_CELLS)	maxCells = SPATIAL_GRID_MIN_CELLS;
+
+	float size = in_cellSize > 0 ? in_cellSize : 1;
+	long w, h;
+
+	for (;;)
+	{
+		w = (long)((hi.x - lo.x) / size) + 1;
+		h = (long)((hi.y - lo.y) / size) + 1;
+
+		if (w * h <= maxCells)	break;
+		size *= 2;
+	}
+
+	m_cellSize = size;
+	m_invCellSize = 1.0f / size;
+	m_origin = lo;
+	m_width = (int)w;
+	m_height = (int)h;
+
+	//Counting sort
+	m_cellStart.assign(m_width * m_height + 1, 0);
+
+	for (int i=0; i<in_count; i++)
+	{
+		int c = cell(cellX(in_positions[i].x), cellY(in_positions[i].y));
+		m_itemCell[i] = c;
+		m_cellStart[c+1]++;
+	}
+
+	for (int c=0; c<m_width * m_height; c++)
+		m_cellStart[c+1] += m_cellStart[c];
+
+	//Use the cell starts as insertion cursors; each ends up at the next start
+	for (int i=0; i<in_count; i++)
+		m_items[m_cellStart[m_itemCell[i]]++] = i;
+
+	for (int c=m_width * m_height; c>0; c--)
+		m_cellStart[c] = m_cellStart[c-1];
+
+	m_cellStart[0] = 0;
+}
@@ -0,0 +1,132 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef SPATIALGRID2D_H
+#define SPATIALGRID2D_H
+
+#include <vector>
+#include "Coord2D.h"
+
+/*!	\file	SpatialGrid2D.h
+	\brief	Uniform grid of points, rebuilt from scratch whenever they move.
+
+	Points are counting-sorted by cell so that every cell is a contiguous
+	range of items.  Rebuilding is linear in the number of points, which is
+	cheaper than keeping a tree up to date for bodies that all move.
+
+	\code
+grid.build(positions, count, 2*maxRadius);
+
+for (int i=grid.begin(cell); i<grid.end(cell); i++)
+	doSomething(grid.item(i));
+	\endcode
+*/
+class SpatialGrid2D
+{
+private:
+	//! Size of a cell (may be larger than requested, see build())
+	float				m_cellSize;
+
+	//! 1 / m_cellSize
+	float				m_invCellSize;
+
+	//! Lower corner of cell (0,0)
+	Coord2D				m_origin;
+
+	//! Number of cells across
+	int					m_width;
+
+	//! Number of cells down
+	int					m_height;
+
+	//! Index of the first item in each cell (one extra at the end)
+	std::vector<int>	m_cellStart;
+
+	//! Items, sorted by cell
+	std::vector<int>	m_items;
+
+	//! Scratch: cell of each item
+	std::vector<int>	m_itemCell;
+
+public:
+	//! Empty grid
+	SpatialGrid2D()
+	: m_cellSize(1)
+	, m_invCellSize(1)
+	, m_width(0)
+	, m_height(0)
+	{}
+
+	//! Sort points into cells
+	/*!	The cell size is doubled until there are no more than a few cells
+		per point, so a stray point far away never allocates a huge grid.
+		\param	in_positions[in]	Positions of the points
+		\param	in_count[in]		Number of points
+		\param	in_cellSize[in]		Smallest acceptable cell size	*/
+	void build(const Coord2D *in_positions, int in_count, float in_cellSize);
+
+	//! Column of an x coordinate (clamped to the grid)
+	inline int cellX(float in_x) const
+	{
+		int x = (int)floorf((in_x - m_origin.x) * m_invCellSize);
+		return x < 0 ? 0 : (x >= m_width ? m_width - 1 : x);
+	}
+
+	//! Row of a y coordinate (clamped to the grid)
+	inline int cellY(float in_y) const
+	{
+		int y = (int)floorf((in_y - m_origin.y) * m_invCellSize);
+		return y < 0 ? 0 : (y >= m_height ? m_height - 1 : y);
+	}
+
+	//! Cell index from column and row
+	inline int cell(int in_x, int in_y) const	{	return in_y * m_width + in_x;	}
+
+	//! First position in the sorted items of a cell
+	inline int begin(int in_cell) const			{	return m_cellStart[in_cell];	}
+
+	//! One past the last position in the sorted items of a cell
+	inline int end(int in_cell) const			{	return m_cellStart[in_cell+1];	}
+
+	//! Item stored at a sorted position
+	inline int item(int in_sorted) const		{	return m_items[in_sorted];		}
+
+	//! All the items, sorted by cell
+	inline const int *items() const				{	return m_items.empty() ? NULL : &m_items[0];	}
+
+	//! Number of items
+	inline int count() const					{	return (int)m_items.size();		}
+
+	//! Columns
+	inline int width() const					{	return m_width;					}
+
+	//! Rows
+	inline int height() const					{	return m_height;				}
+
+	//! Number of cells
+	inline int cellCount() const				{	return m_width * m_height;		}
+
+	//! Size of a cell
+	inline float cellSize() const				{	return m_cellSize;				}
+
+	//! Lower corner of the grid
+	inline Coord2D origin() const				{	return m_origin;				}
+
+	//! True once build() was called with at least one point
+	inline bool isEmpty() const					{	return m_width == 0;			}
+};
+
+#endif
@@ -66,6 +66,13 @@ public:
 		m_velocity = m_acceleration = Coord2D(0,0);
 	}
 
+	//Explicitly move the sphere, leaving the previous position alone so that
+	//	the correction shows up as velocity (as addRepulsiveForce does)
+	inline void displace(const Coord2D in_offset)
+	{
+		m_position += in_offset;
+	}
+
 	//F = ma
 	inline void addForce(const Coord2D in_force)
 	{
@@ -156,6 +163,7 @@ public:
 };
 
 
+#ifdef __APPLE__
 ////////////////////////////////////////////////////////////////////////////////
 //	Sphere2DRestorer
 //		Provides a means to serialize and deserialize a Sphere2D object...
@@ -195,3 +203,5 @@ public:
 };
 
 #endif
+
+#endif
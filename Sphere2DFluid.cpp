@@ -0,0 +1,287 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "Sphere2DFluid.h"
+#include "SIMD.h"
+
+enum
+{
+	PASS_DENSITY,
+	PASS_FORCE
+};
+
+
+Sphere2DFluid::Sphere2DFluid(Sphere2DWorld *io_world, float in_smoothing)
+: m_world(io_world)
+, m_pool(NULL)
+, m_h(in_smoothing)
+, m_restDensity(1)
+, m_stiffness(1000)
+, m_viscosity(0.5f)
+, m_pass(PASS_DENSITY)
+{
+	m_world->setRepulsion(false);
+}
+
+
+void Sphere2DFluid::gather()
+{
+	int n = m_world->count();
+
+	m_positions.resize(n);
+	for (int i=0; i<n; i++)
+		m_positions[i] = m_world->body(i).position();
+
+	m_grid.build(n ? &m_positions[0] : NULL, n, m_h);
+
+	m_x.resize(n);			m_y.resize(n);
+	m_vx.resize(n);			m_vy.resize(n);
+	m_mass.resize(n);
+	m_density.resize(n);	m_pressure.resize(n);
+	m_fx.resize(n);			m_fy.resize(n);
+
+	for (int s=0; s<n; s++)
+	{
+		const Sphere2D &b = m_world->body(m_grid.item(s));
+		Coord2D v = b.velocity();
+
+		m_x[s] = m_positions[m_grid.item(s)].x;
+		m_y[s] = m_positions[m_grid.item(s)].y;
+		m_vx[s] = v.x;
+		m_vy[s] = v.y;
+		m_mass[s] = b.mass;
+	}
+}
+
+
+void Sphere2DFluid::densityPass(int in_begin, int in_end)
+{
+	const float h2 = m_h * m_h;
+	const float poly6 = 4.0f / ((float)M_PI * powf(m_h, 8));
+
+	const vfloat4 vh2 = v4splat(h2);
+	const vfloat4 zero = v4splat(0);
+
+	for (int i=in_begin; i<in_end; i++)
+	{
+		const float xi = m_x[i];
+		const float yi = m_y[i];
+		const vfloat4 vxi = v4splat(xi);
+		const vfloat4 vyi = v4splat(yi);
+
+		vfloat4 acc = zero;
+		float sum = 0;
+
+		int cx = m_grid.cellX(xi);
+		int cy = m_grid.cellY(yi);
+
+		for (int ny=cy-1; ny<=cy+1; ny++)
+		{
+			if (ny < 0 || ny >= m_grid.height())	continue;
+
+			for (int nx=cx-1; nx<=cx+1; nx++)
+			{
+				if (nx < 0 || nx >= m_grid.width())	continue;
+
+				int c = m_grid.cell(nx, ny);
+				int j = m_grid.begin(c);
+				int e = m_grid.end(c);
+
+				//W = poly6 * (h^2 - r^2)^3, the particle itself included
+				for (; j + 4 <= e; j += 4)
+				{
+					vfloat4 dx = vxi - v4load(&m_x[j]);
+					vfloat4 dy = vyi - v4load(&m_y[j]);
+					vfloat4 q = vh2 - (dx*dx + dy*dy);
+
+					acc += v4select(q > zero, v4load(&m_mass[j]) * q*q*q, zero);
+				}
+
+				for (; j<e; j++)
+				{
+					float dx = xi - m_x[j];
+					float dy = yi - m_y[j];
+					float q = h2 - (dx*dx + dy*dy);
+
+					if (q > 0)	sum += m_mass[j] * q*q*q;
+				}
+			}
+		}
+
+		float density = poly6 * (sum + v4sum(acc));
+		float pressure = m_stiffness * (density - m_restDensity);
+
+		//Negative pressure pulls particles into clumps; water just separates
+		m_density[i] = density;
+		m_pressure[i] = pressure > 0 ? pressure : 0;
+	}
+}
+
+
+void Sphere2DFluid::forcePass(int in_begin, int in_end)
+{
+	const float h = m_h;
+	const float h2 = h * h;
+	const float spiky = 30.0f / ((float)M_PI * powf(h, 5));
+	const float visc = m_viscosity * 40.0f / ((float)M_PI * powf(h, 5));
+
+	const vfloat4 vh = v4splat(h);
+	const vfloat4 vh2 = v4splat(h2);
+	const vfloat4 zero = v4splat(0);
+	const vfloat4 one = v4splat(1);
+	const vfloat4 vspiky = v4splat(spiky);
+	const vfloat4 vvisc = v4splat(visc);
+
+	for (int i=in_begin; i<in_end; i++)
+	{
+		const float xi = m_x[i], yi = m_y[i];
+		const float vxi = m_vx[i], vyi = m_vy[i];
+		const float pi = m_pressure[i];
+
+		const vfloat4 Vxi = v4splat(xi), Vyi = v4splat(yi);
+		const vfloat4 Vvxi = v4splat(vxi), Vvyi = v4splat(vyi);
+		const vfloat4 Vpi = v4splat(pi);
+
+		vfloat4 accX = zero, accY = zero;
+		float fx = 0, fy = 0;
+
+		int cx = m_grid.cellX(xi);
+		int cy = m_grid.cellY(yi);
+
+		for (int ny=cy-1; ny<=cy+1; ny++)
+		{
+			if (ny < 0 || ny >= m_grid.height())	continue;
+
+			for (int nx=cx-1; nx<=cx+1; nx++)
+			{
+				if (nx < 0 || nx >= m_grid.width())	continue;
+
+				int c = m_grid.cell(nx, ny);
+				int j = m_grid.begin(c);
+				int e = m_grid.end(c);
+
+				//Pressure:		m_j (p_i + p_j) / (2 rho_j) * spiky (h-r)^2 / r * (x_i - x_j)
+				//Viscosity:	mu m_j / rho_j * visc (h-r) * (v_j - v_i)
+				for (; j + 4 <= e; j += 4)
+				{
+					vfloat4 dx = Vxi - v4load(&m_x[j]);
+					vfloat4 dy = Vyi - v4load(&m_y[j]);
+					vfloat4 r2 = dx*dx + dy*dy;
+
+					vint4 near = (r2 < vh2) & (r2 > zero);
+					if (!v4any(near))	continue;
+
+					vfloat4 r = v4sqrt(v4select(near, r2, one));
+					vfloat4 hr = vh - r;
+					vfloat4 mOverRho = v4load(&m_mass[j]) / v4load(&m_density[j]);
+
+					vfloat4 p = mOverRho * (Vpi + v4load(&m_pressure[j])) * 0.5f
+								* vspiky * hr*hr / r;
+					vfloat4 v = mOverRho * vvisc * hr;
+
+					vfloat4 ax = p*dx + v*(v4load(&m_vx[j]) - Vvxi);
+					vfloat4 ay = p*dy + v*(v4load(&m_vy[j]) - Vvyi);
+
+					accX += v4select(near, ax, zero);
+					accY += v4select(near, ay, zero);
+				}
+
+				for (; j<e; j++)
+				{
+					float dx = xi - m_x[j];
+					float dy = yi - m_y[j];
+					float r2 = dx*dx + dy*dy;
+
+					if (r2 >= h2 || r2 <= 0)	continue;
+
+					float r = sqrtf(r2);
+					float hr = h - r;
+					float mOverRho = m_mass[j] / m_density[j];
+
+					float p = mOverRho * (pi + m_pressure[j]) * 0.5f * spiky * hr*hr / r;
+					float v = mOverRho * visc * hr;
+
+					fx += p*dx + v*(m_vx[j] - vxi);
+					fy += p*dy + v*(m_vy[j] - vyi);
+				}
+			}
+		}
+
+		//Force density to acceleration
+		m_fx[i] = (fx + v4sum(accX)) / m_density[i];
+		m_fy[i] = (fy + v4sum(accY)) / m_density[i];
+	}
+}
+
+
+void Sphere2DFluid::run(int in_begin, int in_end)
+{
+	if (m_pass == PASS_DENSITY)
+		densityPass(in_begin, in_end);
+	else
+		forcePass(in_begin, in_end);
+}
+
+
+void Sphere2DFluid::runPass(int in_pass)
+{
+	m_pass = in_pass;
+
+	if (m_pool)
+		m_pool->run(this, m_grid.count(), 256);
+	else
+		run(0, m_grid.count());
+}
+
+
+void Sphere2DFluid::calibrateRestDensity()
+{
+	gather();
+	runPass(PASS_DENSITY);
+
+	if (m_grid.count() == 0)	return;
+
+	double sum = 0;
+	for (int i=0; i<m_grid.count(); i++)
+		sum += m_density[i];
+
+	m_restDensity = (float)(sum / m_grid.count());
+}
+
+
+void Sphere2DFluid::addFluidForces()
+{
+	gather();
+	runPass(PASS_DENSITY);
+	runPass(PASS_FORCE);
+
+	for (int s=0; s<m_grid.count(); s++)
+	{
+		Sphere2D &b = m_world->body(m_grid.item(s));
+		b.addForce((Coord2D(m_fx[s], m_fy[s]) + m_gravity) * b.mass);
+	}
+}
+
+
+void Sphere2DFluid::step(float in_timestep)
+{
+	m_world->resolveCollisions();
+	addFluidForces();
+	m_world->accumulateForces();
+	m_world->applyGravity();
+	m_world->integrate(in_timestep);
+	m_world->updateGrid();
+}
@@ -0,0 +1,154 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef SPHERE2DFLUID_H
+#define SPHERE2DFLUID_H
+
+#include <vector>
+#include "Sphere2DWorld.h"
+#include "SpatialGrid2D.h"
+#include "ParallelFor.h"
+
+/*!	\file	Sphere2DFluid.h
+	\brief	Smoothed-particle hydrodynamics over the bodies of a Sphere2DWorld.
+
+	Repulsive spheres make gummy water.  This treats every body of a world
+	as a fluid particle instead: each step the density around every particle
+	is measured, turned into pressure, and the pressure and viscosity forces
+	are fed into Sphere2D::addForce before the usual Verlet step.
+
+	Neighbours are found through a grid whose cells are as large as the
+	smoothing radius, so only the 3x3 block of cells around a particle can
+	contribute.  Both passes gather (each particle only writes to itself) so
+	they can be split across threads.
+
+	\code
+Sphere2DWorld water;
+//... add the particles ...
+
+Sphere2DFluid fluid(&water, 8);		//8 units smoothing radius
+fluid.setGravity(Coord2D(0, -98));
+fluid.calibrateRestDensity();		//Particles were placed at rest
+
+ParallelFor pool;
+fluid.setParallelFor(&pool);
+
+//Each frame
+fluid.step(dt);
+	\endcode
+
+	Kernels are the 2D forms of those in "Particle-Based Fluid Simulation for
+	Interactive Applications" (Müller, Charypar, Gross 2003).
+*/
+class Sphere2DFluid : private IParallelTask
+{
+private:
+	//! The particles (not owned)
+	Sphere2DWorld			*m_world;
+
+	//! Workers (not owned, NULL for single-threaded)
+	ParallelFor				*m_pool;
+
+	//! Smoothing radius
+	float					m_h;
+
+	//! Density at which pressure is 0
+	float					m_restDensity;
+
+	//! Pressure per unit of density above rest
+	float					m_stiffness;
+
+	//! Viscosity coefficient
+	float					m_viscosity;
+
+	//! Acceleration applied to every particle
+	Coord2D					m_gravity;
+
+	//! Cell-linked list of the particles
+	SpatialGrid2D			m_grid;
+
+	//! Which pass run() does
+	int						m_pass;
+
+	//! Positions, in handle order (for the grid)
+	std::vector<Coord2D>	m_positions;
+
+	//! Everything below is in grid order so that neighbours are contiguous
+	std::vector<float>		m_x, m_y, m_vx, m_vy, m_mass;
+	std::vector<float>		m_density, m_pressure;
+	std::vector<float>		m_fx, m_fy;
+
+	//! Rebuild the grid and the sorted arrays from the world
+	void gather();
+
+	//! Density and pressure of sorted particles in_begin ... in_end-1
+	void densityPass(int in_begin, int in_end);
+
+	//! Pressure and viscosity acceleration of sorted particles in_begin ... in_end-1
+	void forcePass(int in_begin, int in_end);
+
+	//! IParallelTask
+	void run(int in_begin, int in_end);
+
+	//! Run a pass over every particle (possibly across threads)
+	void runPass(int in_pass);
+
+public:
+	//! Simulate the bodies of a world as fluid
+	/*!	Repulsion between the bodies is turned off in the world; pressure
+		does that job.
+		\param io_world		The particles
+		\param in_smoothing	Smoothing radius (how far a particle reaches)	*/
+	Sphere2DFluid(Sphere2DWorld *io_world, float in_smoothing);
+
+	//! Use worker threads for the density and force passes (NULL for none)
+	void setParallelFor(ParallelFor *in_pool)	{	m_pool = in_pool;		}
+
+	//! Density at which the fluid is at rest (default 1)
+	void setRestDensity(float in_d)			{	m_restDensity = in_d;		}
+
+	//! Stiffness: pressure per unit of density above rest (default 1000)
+	void setStiffness(float in_k)			{	m_stiffness = in_k;			}
+
+	//! Viscosity (default 0.5)
+	void setViscosity(float in_mu)			{	m_viscosity = in_mu;		}
+
+	//! Constant acceleration applied to all particles (default none)
+	void setGravity(const Coord2D in_g)		{	m_gravity = in_g;			}
+
+	//! Smoothing radius
+	float smoothingRadius() const			{	return m_h;					}
+
+	//! Rest density
+	float restDensity() const				{	return m_restDensity;		}
+
+	//! Set the rest density to the average of the current densities
+	/*!	Place the particles at rest, then call this.	*/
+	void calibrateRestDensity();
+
+	//! Advance the fluid
+	/*!	Collides against the world's static geometry, adds the fluid forces
+		and runs the world's accumulateForces(), applyGravity(), integrate()
+		and updateGrid().	*/
+	void step(float in_timestep);
+
+	//! Compute densities and forces, and add them to the bodies
+	/*!	step() calls this; it is public for callers running the world's
+		phases themselves.	*/
+	void addFluidForces();
+};
+
+#endif
@@ -0,0 +1,672 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "Sphere2DWorld.h"
+#include "StaticGeometry2D.h"
+#include "SIMD.h"
+
+#include <algorithm>
+#include <float.h>
+
+
+//! Orders ray hits by distance
+static bool hitCloser(const Sphere2DRayHit &a, const Sphere2DRayHit &b)
+{
+	return a.distance < b.distance;
+}
+
+
+//! Spread the low 16 bits of a value over the even bits
+static inline unsigned int spreadBits(unsigned int x)
+{
+	x &= 0x0000ffff;
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+
+//! Sort in_order by io_keys (both are permuted), 8 bits per pass
+static void radixSort(std::vector<unsigned int> &io_keys, std::vector<int> &io_order,
+					  std::vector<unsigned int> &io_keyScratch,
+					  std::vector<int> &io_orderScratch)
+{
+	int n = (int)io_keys.size();
+
+	io_keyScratch.resize(n);
+	io_orderScratch.resize(n);
+
+	for (int shift=0; shift<32; shift+=8)
+	{
+		int offsets[256] = {0};
+
+		for (int i=0; i<n; i++)
+			offsets[(io_keys[i] >> shift) & 0xff]++;
+
+		//A pass that leaves everything in place is skipped
+		if (offsets[(io_keys[0] >> shift) & 0xff] == n)
+			continue;
+
+		int sum = 0;
+		for (int b=0; b<256; b++)
+		{
+			int c = offsets[b];
+			offsets[b] = sum;
+			sum += c;
+		}
+
+		for (int i=0; i<n; i++)
+		{
+			int d = offsets[(io_keys[i] >> shift) & 0xff]++;
+			io_keyScratch[d] = io_keys[i];
+			io_orderScratch[d] = io_order[i];
+		}
+
+		io_keys.swap(io_keyScratch);
+		io_order.swap(io_orderScratch);
+	}
+}
+
+
+Sphere2DWorld::Sphere2DWorld()
+: m_static(NULL)
+, m_gravitationalConstant(1)
+, m_resistance(0)
+, m_repulsion(true)
+, m_maxRadius(0)
+, m_stamp(0)
+, m_reorderInterval(0)
+, m_stepsSinceReorder(0)
+{}
+
+
+int Sphere2DWorld::add(const Sphere2D &in_body)
+{
+	//Handles stay dense, so the new handle and index are both the count
+	int n = (int)m_bodies.size();
+
+	m_bodies.push_back(in_body);
+	m_handleToIndex.push_back(n);
+	m_indexToHandle.push_back(n);
+
+	return n;
+}
+
+
+void Sphere2DWorld::step(float in_timestep)
+{
+	resolveCollisions();
+	accumulateForces();
+	applyGravity();
+	integrate(in_timestep);
+
+	if (m_reorderInterval > 0 && ++m_stepsSinceReorder >= m_reorderInterval)
+		reorder();
+	else
+		updateGrid();
+}
+
+
+void Sphere2DWorld::resolveCollisions()
+{
+	if (m_repulsion && !m_grid.isEmpty())
+	{
+		//Cells are at least as large as two radii, so only the neighbouring
+		//	cells need to be tested.  Half of them suffice since each pair is
+		//	found from the cell that comes first.
+		static const int forward[4][2] = {{1,0}, {-1,1}, {0,1}, {1,1}};
+
+		for (int cy=0; cy<m_grid.height(); cy++)
+		{
+			for (int cx=0; cx<m_grid.width(); cx++)
+			{
+				int c = m_grid.cell(cx, cy);
+				int b = m_grid.begin(c);
+				int e = m_grid.end(c);
+
+				for (int i=b; i<e; i++)
+				{
+					Sphere2D &a = m_bodies[m_grid.item(i)];
+
+					for (int j=i+1; j<e; j++)
+						a.addRepulsiveForce(m_bodies[m_grid.item(j)]);
+
+					for (int n=0; n<4; n++)
+					{
+						int nx = cx + forward[n][0];
+						int ny = cy + forward[n][1];
+
+						if (nx < 0 || nx >= m_grid.width() || ny >= m_grid.height())
+							continue;
+
+						int nc = m_grid.cell(nx, ny);
+
+						for (int j=m_grid.begin(nc); j<m_grid.end(nc); j++)
+							a.addRepulsiveForce(m_bodies[m_grid.item(j)]);
+					}
+				}
+			}
+		}
+	}
+
+	if (m_static)
+	{
+		for (size_t i=0; i<m_bodies.size(); i++)
+			m_static->collide(&m_bodies[i]);
+	}
+}
+
+
+void Sphere2DWorld::accumulateForces()
+{
+	if (m_resistance == 0)	return;
+
+	for (size_t i=0; i<m_bodies.size(); i++)
+		m_bodies[i].addResistiveForce(m_resistance);
+}
+
+
+void Sphere2DWorld::applyGravity()
+{
+	for (size_t a=0; a<m_attractors.size(); a++)
+	{
+		int attractor = indexOf(m_attractors[a]);
+		const Sphere2D &other = m_bodies[attractor];
+
+		for (int i=0; i<(int)m_bodies.size(); i++)
+		{
+			if (i != attractor)
+				m_bodies[i].addNewtonsLawOfUniversalGravitationToSelf(other, m_gravitationalConstant);
+		}
+	}
+}
+
+
+void Sphere2DWorld::integrate(float in_timestep)
+{
+	for (size_t i=0; i<m_bodies.size(); i++)
+		m_bodies[i].integrate(in_timestep);
+}
+
+
+void Sphere2DWorld::updateGrid()
+{
+	int n = (int)m_bodies.size();
+
+	m_gridPositions.resize(n);
+	m_maxRadius = 0;
+
+	for (int i=0; i<n; i++)
+	{
+		m_gridPositions[i] = m_bodies[i].position();
+		if (m_bodies[i].radius > m_maxRadius)
+			m_maxRadius = m_bodies[i].radius;
+	}
+
+	m_grid.build(n ? &m_gridPositions[0] : NULL, n, 2*m_maxRadius);
+
+	m_sortedX.resize(n);
+	m_sortedY.resize(n);
+	m_sortedRadius.resize(n);
+
+	for (int s=0; s<n; s++)
+	{
+		int i = m_grid.item(s);
+		m_sortedX[s] = m_gridPositions[i].x;
+		m_sortedY[s] = m_gridPositions[i].y;
+		m_sortedRadius[s] = m_bodies[i].radius;
+	}
+
+	m_cellStamp.assign(m_grid.cellCount(), 0);
+	m_stamp = 0;
+}
+
+
+void Sphere2DWorld::reorder()
+{
+	int n = (int)m_bodies.size();
+	m_stepsSinceReorder = 0;
+
+	if (n < 2)
+	{
+		updateGrid();
+		return;
+	}
+
+	Coord2D lo = m_bodies[0].position();
+	Coord2D hi = lo;
+
+	for (int i=1; i<n; i++)
+	{
+		Coord2D p = m_bodies[i].position();
+		if (p.x < lo.x)	lo.x = p.x;
+		if (p.y < lo.y)	lo.y = p.y;
+		if (p.x > hi.x)	hi.x = p.x;
+		if (p.y > hi.y)	hi.y = p.y;
+	}
+
+	//Quantize to 16 bits per axis, interleaved into 32 bit keys
+	float sx = hi.x > lo.x ? 65535.0f / (hi.x - lo.x) : 0;
+	float sy = hi.y > lo.y ? 65535.0f / (hi.y - lo.y) : 0;
+
+	m_keys.resize(n);
+	m_order.resize(n);
+
+	for (int i=0; i<n; i++)
+	{
+		Coord2D p = m_bodies[i].position();
+		unsigned int qx = (unsigned int)((p.x - lo.x) * sx);
+		unsigned int qy = (unsigned int)((p.y - lo.y) * sy);
+
+		m_keys[i] = spreadBits(qx) | (spreadBits(qy) << 1);
+		m_order[i] = i;
+	}
+
+	radixSort(m_keys, m_order, m_keyScratch, m_orderScratch);
+
+	//Move the bodies, and fix up the handles
+	m_bodyScratch.resize(n);
+	m_orderScratch.resize(n);
+
+	for (int i=0; i<n; i++)
+	{
+		int from = m_order[i];
+		int handle = m_indexToHandle[from];
+
+		m_bodyScratch[i] = m_bodies[from];
+		m_orderScratch[i] = handle;
+		m_handleToIndex[handle] = i;
+	}
+
+	m_bodies.swap(m_bodyScratch);
+	m_indexToHandle.swap(m_orderScratch);
+
+	updateGrid();
+}
+
+
+void Sphere2DWorld::nextStamp()
+{
+	m_stamp++;
+
+	if (m_stamp == 0)
+	{
+		std::fill(m_cellStamp.begin(), m_cellStamp.end(), 0);
+		m_stamp = 1;
+	}
+}
+
+
+bool Sphere2DWorld::rayCastCell(int in_cell, const Coord2D in_origin, const Coord2D in_dir,
+								float in_maxDistance, Sphere2DRayHit *io_hit) const
+{
+	int b = m_grid.begin(in_cell);
+	int e = m_grid.end(in_cell);
+
+	if (b == e)	return false;
+
+	const float *xs = &m_sortedX[0];
+	const float *ys = &m_sortedY[0];
+	const float *rs = &m_sortedRadius[0];
+
+	float best = io_hit->handle < 0 ? in_maxDistance : io_hit->distance;
+	bool found = false;
+
+	//Ray o + t*d against circle (c, r) with m = o - c:
+	//	t^2 + 2(m.d)t + (m.m - r^2) = 0
+	//	misses when the discriminant is negative, or when outside (m.m > r^2)
+	//	and pointing away (m.d > 0).  Four circles are rejected at once; the
+	//	rare survivors are finished one at a time.
+	vfloat4 ox = v4splat(in_origin.x);
+	vfloat4 oy = v4splat(in_origin.y);
+	vfloat4 dx = v4splat(in_dir.x);
+	vfloat4 dy = v4splat(in_dir.y);
+	vfloat4 zero = v4splat(0);
+
+	int i = b;
+
+	for (; i + 4 <= e; i += 4)
+	{
+		vfloat4 mx = ox - v4load(xs + i);
+		vfloat4 my = oy - v4load(ys + i);
+		vfloat4 r = v4load(rs + i);
+
+		vfloat4 mb = mx*dx + my*dy;
+		vfloat4 mc = mx*mx + my*my - r*r;
+		vfloat4 disc = mb*mb - mc;
+
+		vint4 hit = (disc >= zero) & ~((mc > zero) & (mb > zero));
+
+		if (!v4any(hit))	continue;
+
+		for (int k=0; k<4; k++)
+		{
+			if (!hit[k])	continue;
+
+			float t = mc[k] <= 0 ? 0 : -mb[k] - sqrtf(disc[k]);
+
+			if (t <= best)
+			{
+				best = t;
+				io_hit->handle = i + k;
+				found = true;
+			}
+		}
+	}
+
+	for (; i<e; i++)
+	{
+		float mx = in_origin.x - xs[i];
+		float my = in_origin.y - ys[i];
+
+		float mb = mx*in_dir.x + my*in_dir.y;
+		float mc = mx*mx + my*my - rs[i]*rs[i];
+		float disc = mb*mb - mc;
+
+		if (disc < 0 || (mc > 0 && mb > 0))	continue;
+
+		float t = mc <= 0 ? 0 : -mb - sqrtf(disc);
+
+		if (t <= best)
+		{
+			best = t;
+			io_hit->handle = i;
+			found = true;
+		}
+	}
+
+	if (found)
+	{
+		//handle holds the sorted position until here
+		int s = io_hit->handle;
+		Coord2D centre(xs[s], ys[s]);
+
+		io_hit->handle = handleOf(m_grid.item(s));
+		io_hit->distance = best;
+		io_hit->point = in_origin + in_dir * best;
+
+		Coord2D n = io_hit->point - centre;
+		float len = n.magnitude();
+		io_hit->normal = len > 0 ? n / len : -in_dir;
+	}
+
+	return found;
+}
+
+
+bool Sphere2DWorld::rayCastGrid(const Coord2D in_origin, const Coord2D in_dir,
+								float in_maxDistance, Sphere2DRayHit *out_hit,
+								std::vector<Sphere2DRayHit> *out_all)
+{
+	if (m_grid.isEmpty())	return false;
+
+	float cs = m_grid.cellSize();
+	Coord2D lo = m_grid.origin() - Coord2D(cs, cs);
+	Coord2D hi = m_grid.origin() + Coord2D((m_grid.width()+1)*cs, (m_grid.height()+1)*cs);
+
+	//Clip the ray to the grid (plus a border of one cell for the radii)
+	float tEnter = 0;
+	float tExit = in_maxDistance;
+
+	for (int axis=0; axis<2; axis++)
+	{
+		float o = axis == 0 ? in_origin.x : in_origin.y;
+		float d = axis == 0 ? in_dir.x : in_dir.y;
+		float l = axis == 0 ? lo.x : lo.y;
+		float h = axis == 0 ? hi.x : hi.y;
+
+		if (d == 0)
+		{
+			if (o < l || o > h)	return false;
+			continue;
+		}
+
+		float t0 = (l - o) / d;
+		float t1 = (h - o) / d;
+		if (t0 > t1)	std::swap(t0, t1);
+
+		if (t0 > tEnter)	tEnter = t0;
+		if (t1 < tExit)		tExit = t1;
+	}
+
+	if (tEnter > tExit)	return false;
+
+	//Walk the cells (Amanatides & Woo), in cell units relative to the grid
+	Coord2D start = (in_origin + in_dir * tEnter - m_grid.origin()) / cs;
+	int cx = std::max(-1, std::min((int)floorf(start.x), m_grid.width()));
+	int cy = std::max(-1, std::min((int)floorf(start.y), m_grid.height()));
+
+	int stepX = in_dir.x > 0 ? 1 : -1;
+	int stepY = in_dir.y > 0 ? 1 : -1;
+
+	float tMaxX = FLT_MAX, tMaxY = FLT_MAX;
+	float tDeltaX = FLT_MAX, tDeltaY = FLT_MAX;
+
+	if (in_dir.x != 0)
+	{
+		tMaxX = tEnter + ((cx + (stepX > 0 ? 1 : 0)) - start.x) * cs / in_dir.x;
+		tDeltaX = cs / fabsf(in_dir.x);
+	}
+
+	if (in_dir.y != 0)
+	{
+		tMaxY = tEnter + ((cy + (stepY > 0 ? 1 : 0)) - start.y) * cs / in_dir.y;
+		tDeltaY = cs / fabsf(in_dir.y);
+	}
+
+	nextStamp();
+
+	Sphere2DRayHit best;
+	float tCell = tEnter;
+
+	while (tCell <= tExit
+		   && cx >= -1 && cx <= m_grid.width()
+		   && cy >= -1 && cy <= m_grid.height())
+	{
+		//A hit point lies in a visited cell, and the body's centre is no more
+		//	than half a cell from it.  So every closer hit has been found once
+		//	the cells being entered are further than the best hit.
+		if (out_all == NULL && best.handle >= 0 && tCell > best.distance)
+			break;
+
+		for (int ny=cy-1; ny<=cy+1; ny++)
+		{
+			if (ny < 0 || ny >= m_grid.height())	continue;
+
+			for (int nx=cx-1; nx<=cx+1; nx++)
+			{
+				if (nx < 0 || nx >= m_grid.width())	continue;
+
+				int c = m_grid.cell(nx, ny);
+				if (m_cellStamp[c] == m_stamp)	continue;
+				m_cellStamp[c] = m_stamp;
+
+				if (out_all)
+				{
+					//Report everything in the cell
+					for (int s=m_grid.begin(c); s<m_grid.end(c); s++)
+					{
+						Coord2D centre(m_sortedX[s], m_sortedY[s]);
+						Coord2D m = in_origin - centre;
+						float mb = dot(m, in_dir);
+						float mc = dot(m, m) - m_sortedRadius[s]*m_sortedRadius[s];
+						float disc = mb*mb - mc;
+
+						if (disc < 0 || (mc > 0 && mb > 0))	continue;
+
+						float t = mc <= 0 ? 0 : -mb - sqrtf(disc);
+						if (t > in_maxDistance)	continue;
+
+						Sphere2DRayHit h;
+						h.handle = handleOf(m_grid.item(s));
+						h.distance = t;
+						h.point = in_origin + in_dir * t;
+
+						Coord2D n = h.point - centre;
+						float len = n.magnitude();
+						h.normal = len > 0 ? n / len : -in_dir;
+
+						out_all->push_back(h);
+					}
+				}
+				else
+				{
+					rayCastCell(c, in_origin, in_dir, in_maxDistance, &best);
+				}
+			}
+		}
+
+		if (tMaxX < tMaxY)
+		{
+			tCell = tMaxX;
+			tMaxX += tDeltaX;
+			cx += stepX;
+		}
+		else
+		{
+			tCell = tMaxY;
+			tMaxY += tDeltaY;
+			cy += stepY;
+		}
+	}
+
+	if (out_hit)	*out_hit = best;
+
+	return best.handle >= 0;
+}
+
+
+bool Sphere2DWorld::rayCast(const Coord2D in_origin, const Coord2D in_direction,
+							float in_maxDistance, Sphere2DRayHit *out_hit)
+{
+	float len = in_direction.magnitude();
+	if (len <= 0)	return false;
+
+	return rayCastGrid(in_origin, in_direction / len, in_maxDistance, out_hit, NULL);
+}
+
+
+int Sphere2DWorld::rayCastAll(const Coord2D in_origin, const Coord2D in_direction,
+							  float in_maxDistance, std::vector<Sphere2DRayHit> &out_hits)
+{
+	float len = in_direction.magnitude();
+	if (len <= 0)	return 0;
+
+	size_t first = out_hits.size();
+	rayCastGrid(in_origin, in_direction / len, in_maxDistance, NULL, &out_hits);
+
+	std::sort(out_hits.begin() + first, out_hits.end(), hitCloser);
+
+	return (int)(out_hits.size() - first);
+}
+
+
+int Sphere2DWorld::rayCastBatch(const Sphere2DRay *in_rays, int in_count, Sphere2DRayHit *out_hits)
+{
+	int hits = 0;
+
+	for (int i=0; i<in_count; i++)
+	{
+		out_hits[i] = Sphere2DRayHit();
+
+		float len = in_rays[i].direction.magnitude();
+		if (len <= 0)	continue;
+
+		if (rayCastGrid(in_rays[i].origin, in_rays[i].direction / len,
+						in_rays[i].maxDistance, out_hits + i, NULL))
+			hits++;
+	}
+
+	return hits;
+}
+
+
+int Sphere2DWorld::overlapCircle(const Coord2D in_centre, float in_radius,
+								 std::vector<int> &out_handles)
+{
+	if (m_grid.isEmpty())	return 0;
+
+	float reach = in_radius + m_maxRadius;
+	int x0 = m_grid.cellX(in_centre.x - reach), x1 = m_grid.cellX(in_centre.x + reach);
+	int y0 = m_grid.cellY(in_centre.y - reach), y1 = m_grid.cellY(in_centre.y + reach);
+	int found = 0;
+
+	for (int cy=y0; cy<=y1; cy++)
+	{
+		for (int cx=x0; cx<=x1; cx++)
+		{
+			int c = m_grid.cell(cx, cy);
+
+			for (int s=m_grid.begin(c); s<m_grid.end(c); s++)
+			{
+				float dx = m_sortedX[s] - in_centre.x;
+				float dy = m_sortedY[s] - in_centre.y;
+				float r = in_radius + m_sortedRadius[s];
+
+				if (dx*dx + dy*dy < r*r)
+				{
+					out_handles.push_back(handleOf(m_grid.item(s)));
+					found++;
+				}
+			}
+		}
+	}
+
+	return found;
+}
+
+
+int Sphere2DWorld::overlapRect(const Rect2D &in_rect, std::vector<int> &out_handles)
+{
+	if (m_grid.isEmpty())	return 0;
+
+	//Rect2D may have a negative size
+	Coord2D a = in_rect.corner;
+	Coord2D b = in_rect.corner + in_rect.size;
+	Coord2D lo(std::min(a.x, b.x), std::min(a.y, b.y));
+	Coord2D hi(std::max(a.x, b.x), std::max(a.y, b.y));
+
+	int x0 = m_grid.cellX(lo.x - m_maxRadius), x1 = m_grid.cellX(hi.x + m_maxRadius);
+	int y0 = m_grid.cellY(lo.y - m_maxRadius), y1 = m_grid.cellY(hi.y + m_maxRadius);
+	int found = 0;
+
+	for (int cy=y0; cy<=y1; cy++)
+	{
+		for (int cx=x0; cx<=x1; cx++)
+		{
+			int c = m_grid.cell(cx, cy);
+
+			for (int s=m_grid.begin(c); s<m_grid.end(c); s++)
+			{
+				//Distance from the centre to the closest point of the rect
+				float px = std::max(lo.x, std::min(m_sortedX[s], hi.x));
+				float py = std::max(lo.y, std::min(m_sortedY[s], hi.y));
+				float dx = m_sortedX[s] - px;
+				float dy = m_sortedY[s] - py;
+
+				if (dx*dx + dy*dy < m_sortedRadius[s]*m_sortedRadius[s])
+				{
+					out_handles.push_back(handleOf(m_grid.item(s)));
+					found++;
+				}
+			}
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,286 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef SPHERE2DWORLD_H
+#define SPHERE2DWORLD_H
+
+#include <vector>
+#include "Sphere2D.h"
+#include "Rect2D.h"
+#include "SpatialGrid2D.h"
+
+/*!	\file	Sphere2DWorld.h
+	\brief	A set of Sphere2D bodies simulated together, and queries on them.
+
+	Gameplay code asks questions like "what does this bullet hit first?" or
+	"what is under this finger?".  Rather than every caller scanning every
+	sphere, the world keeps a uniform grid of the bodies up to date as part of
+	each step and answers those questions from it.
+
+	\code
+Sphere2DWorld world;
+int player = world.add(playerSphere);
+world.setStaticGeometry(&level);
+
+//Each frame
+world.body(player).addForce(input);
+world.step(dt);
+
+Sphere2DRayHit hit;
+if (world.rayCast(gun, aim, 500, &hit))
+	damage(hit.handle);
+	\endcode
+
+	Bodies are referred to by handle.  Forces are applied to body(handle)
+	between steps as with a lone Sphere2D.  The grid reflects positions as of
+	the last step(); call updateGrid() after moving bodies by hand if queries
+	must see the move before the next step.
+
+	As bodies move, their order in memory drifts away from their order in
+	space and neighbour loops turn into random access.  setReorderInterval()
+	has the world sort its bodies along a Z-order (Morton) curve every few
+	steps.  Handles go through an indirection table, so they stay valid
+	across reorders; they run from 0 to count()-1 in order of add().
+*/
+
+class StaticGeometry2D;
+
+
+//! Result of a ray cast
+class Sphere2DRayHit
+{
+public:
+	//! Body that was hit
+	int		handle;
+
+	//! Distance along the ray (0 if the ray starts inside the body)
+	float	distance;
+
+	//! Point on the surface of the body
+	Coord2D	point;
+
+	//! Surface normal at the point
+	Coord2D	normal;
+
+	Sphere2DRayHit()
+	: handle(-1)
+	, distance(0)
+	{}
+};
+
+
+//! A ray for batched ray casts
+class Sphere2DRay
+{
+public:
+	//! Start of the ray
+	Coord2D	origin;
+
+	//! Direction (need not be normalized)
+	Coord2D	direction;
+
+	//! Furthest distance to look
+	float	maxDistance;
+
+	Sphere2DRay(Coord2D in_origin = Coord2D(), Coord2D in_direction = Coord2D(1,0),
+				float in_maxDistance = 1e30f)
+	: origin(in_origin)
+	, direction(in_direction)
+	, maxDistance(in_maxDistance)
+	{}
+};
+
+
+//! Simulates a set of spheres and answers spatial queries about them
+class Sphere2DWorld
+{
+private:
+	//! The bodies
+	std::vector<Sphere2D>		m_bodies;
+
+	//! Bodies that attract every other body
+	std::vector<int>			m_attractors;
+
+	//! Level geometry (not owned, may be NULL)
+	const StaticGeometry2D		*m_static;
+
+	//! Gravitational constant used with the attractors
+	float						m_gravitationalConstant;
+
+	//! Resistance applied to every body (0 for none)
+	float						m_resistance;
+
+	//! Do the bodies push each other apart?
+	bool						m_repulsion;
+
+	//! Largest radius of any body (decides the grid cell size)
+	float						m_maxRadius;
+
+	//! The grid of body positions
+	SpatialGrid2D				m_grid;
+
+	//! Positions handed to the grid (scratch)
+	std::vector<Coord2D>		m_gridPositions;
+
+	//! x, y and radius of the bodies in grid order (for SIMD tests)
+	std::vector<float>			m_sortedX;
+	std::vector<float>			m_sortedY;
+	std::vector<float>			m_sortedRadius;
+
+	//! Query stamp of each cell, so that a cell is only visited once
+	std::vector<unsigned int>	m_cellStamp;
+
+	//! Current query stamp
+	unsigned int				m_stamp;
+
+	//! Where the body of each handle is stored
+	std::vector<int>			m_handleToIndex;
+
+	//! Handle of the body stored at each index
+	std::vector<int>			m_indexToHandle;
+
+	//! Steps between reorders (0 never reorders)
+	int							m_reorderInterval;
+
+	//! Steps since the last reorder
+	int							m_stepsSinceReorder;
+
+	//! Reorder scratch
+	std::vector<unsigned int>	m_keys, m_keyScratch;
+	std::vector<int>			m_order, m_orderScratch;
+	std::vector<Sphere2D>		m_bodyScratch;
+
+	//! Handle of the body stored at an index
+	inline int handleOf(int in_index) const		{	return m_indexToHandle[in_index];	}
+
+	//! Index of the body referred to by a handle
+	inline int indexOf(int in_handle) const		{	return m_handleToIndex[in_handle];	}
+
+	//! Begin a query that visits cells at most once
+	void nextStamp();
+
+	//! Closest hit among the bodies of a cell
+	/*!	\return true if a hit closer than io_hit->distance was found */
+	bool rayCastCell(int in_cell, const Coord2D in_origin, const Coord2D in_dir,
+					 float in_maxDistance, Sphere2DRayHit *io_hit) const;
+
+	//! Walk the cells a ray passes through (and their neighbours)
+	/*!	\param	in_all	Report every hit into out_all instead of the closest	*/
+	bool rayCastGrid(const Coord2D in_origin, const Coord2D in_dir,
+					 float in_maxDistance, Sphere2DRayHit *out_hit,
+					 std::vector<Sphere2DRayHit> *out_all);
+
+public:
+	//! An empty world
+	Sphere2DWorld();
+
+	//! Add a body
+	/*!	\return	The handle of the new body	*/
+	int add(const Sphere2D &in_body);
+
+	//! Number of bodies
+	int count() const						{	return (int)m_bodies.size();		}
+
+	//! Access a body through its handle
+	Sphere2D &body(int in_handle)			{	return m_bodies[indexOf(in_handle)];	}
+
+	//! Access a body through its handle
+	const Sphere2D &body(int in_handle) const	{	return m_bodies[indexOf(in_handle)];	}
+
+	//! Level geometry to collide against (NULL for none)
+	void setStaticGeometry(const StaticGeometry2D *in_static)	{	m_static = in_static;	}
+
+	//! Have a body attract all others through addNewtonsLawOfUniversalGravitationToSelf
+	void addAttractor(int in_handle)		{	m_attractors.push_back(in_handle);	}
+
+	//! Constant used for attraction (default 1)
+	void setGravitationalConstant(float in_g)	{	m_gravitationalConstant = in_g;	}
+
+	//! Resistance applied to all bodies each step (default 0)
+	void setResistance(float in_r)			{	m_resistance = in_r;				}
+
+	//! Should the bodies push each other apart? (default true)
+	void setRepulsion(bool in_enable)		{	m_repulsion = in_enable;			}
+
+	//! Sort the bodies in Z-order every in_steps steps (default 0, never)
+	/*!	Worth it once there are thousands of bodies that move around; 10 to
+		60 steps is a good range since the order decays slowly.	*/
+	void setReorderInterval(int in_steps)	{	m_reorderInterval = in_steps;	}
+
+	//! Advance the simulation
+	/*!	This is resolveCollisions(), accumulateForces(), applyGravity(),
+		integrate() and updateGrid() in that order (reorder() replaces
+		updateGrid() when one is due).  Each phase is public so that they may
+		be timed or interleaved with custom forces.	*/
+	void step(float in_timestep);
+
+	//! Push overlapping bodies apart, and out of the static geometry
+	void resolveCollisions();
+
+	//! Apply the resistive force
+	void accumulateForces();
+
+	//! Attract all bodies towards the attractors
+	void applyGravity();
+
+	//! Verlet integrate every body
+	void integrate(float in_timestep);
+
+	//! Re-sort the bodies into the grid
+	void updateGrid();
+
+	//! Sort the bodies in memory along a Z-order curve, then updateGrid()
+	/*!	Handles are unaffected.	*/
+	void reorder();
+
+	//! The grid (as of the last updateGrid())
+	const SpatialGrid2D &grid() const		{	return m_grid;		}
+
+	//! Closest body along a ray
+	/*!	\param	in_origin[in]		Start of the ray
+		\param	in_direction[in]	Direction of the ray (need not be normalized)
+		\param	in_maxDistance[in]	How far to look
+		\param	out_hit[out]		The closest hit
+		\return	true if anything was hit	*/
+	bool rayCast(const Coord2D in_origin, const Coord2D in_direction,
+				 float in_maxDistance, Sphere2DRayHit *out_hit);
+
+	//! Every body along a ray
+	/*!	Hits are appended to out_hits, closest first.
+		\return	The number of hits	*/
+	int rayCastAll(const Coord2D in_origin, const Coord2D in_direction,
+				   float in_maxDistance, std::vector<Sphere2DRayHit> &out_hits);
+
+	//! Closest hit for each of many rays
+	/*!	Suited to thousands of rays per frame (bullets, line of sight).  Rays
+		that hit nothing have a handle of -1.
+		\param	in_rays[in]		The rays
+		\param	in_count[in]	Number of rays
+		\param	out_hits[out]	One result per ray
+		\return	Number of rays that hit something	*/
+	int rayCastBatch(const Sphere2DRay *in_rays, int in_count, Sphere2DRayHit *out_hits);
+
+	//! Bodies overlapping a circle
+	/*!	\return	Number of handles appended to out_handles	*/
+	int overlapCircle(const Coord2D in_centre, float in_radius,
+					  std::vector<int> &out_handles);
+
+	//! Bodies overlapping a rectangle
+	/*!	\return	Number of handles appended to out_handles	*/
+	int overlapRect(const Rect2D &in_rect, std::vector<int> &out_handles);
+};
+
+#endif
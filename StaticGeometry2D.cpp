@@ -0,0 +1,603 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StaticGeometry2D.h"
+
+#include <algorithm>
+
+//! Number of primitives that may be stored in a leaf
+#define STATIC_GEOMETRY_LEAF_SIZE	4
+
+//! Deepest traversal supported (a balanced tree of 2^64 leaves!)
+#define STATIC_GEOMETRY_STACK		64
+
+//! Contacts per sphere that are sorted before being resolved
+#define STATIC_GEOMETRY_CONTACTS	32
+
+
+struct StaticGeometry2D::BuildItem
+{
+	Coord2D	min;
+	Coord2D	max;
+	Coord2D	centre;
+	int		ref;
+};
+
+
+//! Sorts build items along an axis (0 = x, 1 = y)
+class BuildItemAxisLess
+{
+	int m_axis;
+
+public:
+	BuildItemAxisLess(int in_axis) : m_axis(in_axis)	{}
+
+	template<class T>
+	bool operator()(const T &a, const T &b) const
+	{
+		return m_axis == 0	? a.centre.x < b.centre.x
+							: a.centre.y < b.centre.y;
+	}
+};
+
+
+static inline Coord2D minOf(const Coord2D &a, const Coord2D &b)
+{
+	return Coord2D(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y);
+}
+
+
+static inline Coord2D maxOf(const Coord2D &a, const Coord2D &b)
+{
+	return Coord2D(a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y);
+}
+
+
+void StaticGeometry2D::addSegment(const Coord2D in_a, const Coord2D in_b)
+{
+	m_segments.push_back(Segment2D(in_a, in_b));
+}
+
+
+void StaticGeometry2D::addPolygon(const Coord2D *in_points, int in_count)
+{
+	if (in_count < 3)	throw "StaticGeometry2D::addPolygon::Need at least 3 points";
+
+	//Twice the signed area; negative when clockwise
+	float area = 0;
+	for (int i=0; i<in_count; i++)
+	{
+		const Coord2D &p0 = in_points[i];
+		const Coord2D &p1 = in_points[(i+1)%in_count];
+		area += p0.x*p1.y - p1.x*p0.y;
+	}
+
+	if (area >= 0)
+	{
+		for (int i=0; i<in_count; i++)
+			m_polyPoints.push_back(in_points[i]);
+	}
+	else
+	{
+		for (int i=in_count-1; i>=0; i--)
+			m_polyPoints.push_back(in_points[i]);
+	}
+
+	m_polyStart.push_back((int)m_polyPoints.size());
+}
+
+
+void StaticGeometry2D::clear()
+{
+	m_segments.clear();
+	m_polyPoints.clear();
+	m_polyStart.clear();
+	m_polyStart.push_back(0);
+	m_refs.clear();
+	m_nodes.clear();
+}
+
+
+void StaticGeometry2D::bounds(int in_ref, Coord2D &out_min, Coord2D &out_max) const
+{
+	if (in_ref >= 0)
+	{
+		const Segment2D &s = m_segments[in_ref];
+		out_min = minOf(s.a, s.b);
+		out_max = maxOf(s.a, s.b);
+	}
+	else
+	{
+		int poly = ~in_ref;
+		out_min = out_max = m_polyPoints[m_polyStart[poly]];
+
+		for (int i=m_polyStart[poly]+1; i<m_polyStart[poly+1]; i++)
+		{
+			out_min = minOf(out_min, m_polyPoints[i]);
+			out_max = maxOf(out_max, m_polyPoints[i]);
+		}
+	}
+}
+
+
+void StaticGeometry2D::build()
+{
+	std::vector<BuildItem> items;
+	items.reserve(m_segments.size() + polygonCount());
+
+	for (int i=0; i<segmentCount(); i++)
+	{
+		BuildItem b;
+		b.ref = i;
+		items.push_back(b);
+	}
+
+	for (int i=0; i<polygonCount(); i++)
+	{
+		BuildItem b;
+		b.ref = ~i;
+		items.push_back(b);
+	}
+
+	for (size_t i=0; i<items.size(); i++)
+	{
+		bounds(items[i].ref, items[i].min, items[i].max);
+		items[i].centre = (items[i].min + items[i].max) * 0.5f;
+	}
+
+	m_nodes.clear();
+	m_refs.clear();
+
+	if (items.empty())	return;
+
+	//A binary tree with leaves of at least half size has fewer than this
+	m_nodes.reserve(4 * items.size() / STATIC_GEOMETRY_LEAF_SIZE + 1);
+	m_nodes.push_back(Node());
+	buildNode(items, 0, 0, (int)items.size());
+
+	m_refs.resize(items.size());
+	for (size_t i=0; i<items.size(); i++)
+		m_refs[i] = items[i].ref;
+}
+
+
+void StaticGeometry2D::buildNode(std::vector<BuildItem> &io_items, int in_node,
+								 int in_first, int in_count)
+{
+	Coord2D bmin = io_items[in_first].min;
+	Coord2D bmax = io_items[in_first].max;
+	Coord2D cmin = io_items[in_first].centre;
+	Coord2D cmax = cmin;
+
+	for (int i=in_first+1; i<in_first+in_count; i++)
+	{
+		bmin = minOf(bmin, io_items[i].min);
+		bmax = maxOf(bmax, io_items[i].max);
+		cmin = minOf(cmin, io_items[i].centre);
+		cmax = maxOf(cmax, io_items[i].centre);
+	}
+
+	m_nodes[in_node].min = bmin;
+	m_nodes[in_node].max = bmax;
+
+	if (in_count <= STATIC_GEOMETRY_LEAF_SIZE)
+	{
+		m_nodes[in_node].first = in_first;
+		m_nodes[in_node].count = in_count;
+		return;
+	}
+
+	//Median split along the axis where the centres are most spread out
+	int axis = (cmax.x - cmin.x) >= (cmax.y - cmin.y) ? 0 : 1;
+	int half = in_count / 2;
+
+	std::nth_element(	io_items.begin() + in_first,
+						io_items.begin() + in_first + half,
+						io_items.begin() + in_first + in_count,
+						BuildItemAxisLess(axis));
+
+	int left = (int)m_nodes.size();
+	m_nodes.push_back(Node());
+	m_nodes.push_back(Node());
+
+	m_nodes[in_node].first = left;
+	m_nodes[in_node].count = 0;
+
+	buildNode(io_items, left,   in_first, half);
+	buildNode(io_items, left+1, in_first + half, in_count - half);
+}
+
+
+bool StaticGeometry2D::collideSegment(const Segment2D &in_s, Sphere2D *io_sphere) const
+{
+	Coord2D p = io_sphere->position();
+	Coord2D ab = in_s.b - in_s.a;
+	Coord2D n(-ab.y, ab.x);
+	float r = io_sphere->radius;
+
+	//Did the centre go through the wall this step?  Put it back on its side.
+	float sp = dot(io_sphere->previousPosition() - in_s.a, n);
+	float sc = dot(p - in_s.a, n);
+
+	if ((sp < 0 && sc > 0) || (sp > 0 && sc < 0))
+	{
+		Coord2D prev = io_sphere->previousPosition();
+		Coord2D hit = prev + (p - prev) * (sp / (sp - sc));
+		float t = dot(hit - in_s.a, ab);
+
+		if (t >= 0 && t <= dot(ab, ab))
+		{
+			Coord2D normal = n.normal();
+			if (sp < 0)	normal = -normal;
+
+			io_sphere->displace(normal * (r - dot(p - in_s.a, normal)));
+			return true;
+		}
+	}
+
+	Coord2D c = in_s.closestPoint(p);
+	Coord2D d = p - c;
+	float dist2 = dot(d, d);
+
+	if (dist2 >= r*r)
+		return false;
+
+	float dist = sqrtf(dist2);
+
+	if (dist < 0.01f)
+	{
+		//Sitting on the wall, leave on the side we came from
+		if (dot(n, n) <= 0)		return false;
+
+		Coord2D normal = n.normal();
+		if (sp < 0)	normal = -normal;
+
+		io_sphere->displace(normal * r);
+		return true;
+	}
+
+	io_sphere->displace(d / dist * (r - dist));
+	return true;
+}
+
+
+bool StaticGeometry2D::collidePolygon(int in_poly, Sphere2D *io_sphere) const
+{
+	const Coord2D *pts = &m_polyPoints[m_polyStart[in_poly]];
+	int count = m_polyStart[in_poly+1] - m_polyStart[in_poly];
+
+	Coord2D p = io_sphere->position();
+	float r = io_sphere->radius;
+
+	//Edge with the largest separation (outward normals, counter-clockwise)
+	float bestSep = -1e30f;
+	Coord2D bestNormal;
+
+	for (int i=0; i<count; i++)
+	{
+		Coord2D e = pts[(i+1)%count] - pts[i];
+		float len = e.magnitude();
+		if (len <= 0)	continue;
+
+		Coord2D n(e.y / len, -e.x / len);
+		float sep = dot(p - pts[i], n);
+
+		if (sep > bestSep)
+		{
+			bestSep = sep;
+			bestNormal = n;
+		}
+	}
+
+	if (bestSep >= r)
+		return false;
+
+	if (bestSep < 0.01f)
+	{
+		//Centre is inside; leave through the nearest edge
+		io_sphere->displace(bestNormal * (r - bestSep));
+		return true;
+	}
+
+	//Centre is outside; the closest point on the boundary decides
+	float bestDist2 = 1e30f;
+	Coord2D closest;
+
+	for (int i=0; i<count; i++)
+	{
+		Coord2D c = Segment2D(pts[i], pts[(i+1)%count]).closestPoint(p);
+		float d2 = distanceSquared(p, c);
+
+		if (d2 < bestDist2)
+		{
+			bestDist2 = d2;
+			closest = c;
+		}
+	}
+
+	if (bestDist2 >= r*r)
+		return false;
+
+	float dist = sqrtf(bestDist2);
+	io_sphere->displace((p - closest) / dist * (r - dist));
+	return true;
+}
+
+
+float StaticGeometry2D::separationSquared(int in_ref, const Coord2D in_p) const
+{
+	if (in_ref >= 0)
+		return distanceSquared(in_p, m_segments[in_ref].closestPoint(in_p));
+
+	int poly = ~in_ref;
+	const Coord2D *pts = &m_polyPoints[m_polyStart[poly]];
+	int count = m_polyStart[poly+1] - m_polyStart[poly];
+
+	bool inside = true;
+	float best = 1e30f;
+
+	for (int i=0; i<count; i++)
+	{
+		const Coord2D &a = pts[i];
+		const Coord2D &b = pts[(i+1)%count];
+
+		if ((b.x - a.x)*(in_p.y - a.y) - (b.y - a.y)*(in_p.x - a.x) < 0)
+			inside = false;
+
+		float d2 = distanceSquared(in_p, Segment2D(a, b).closestPoint(in_p));
+		if (d2 < best)	best = d2;
+	}
+
+	return inside ? 0 : best;
+}
+
+
+bool StaticGeometry2D::collide(Sphere2D *io_sphere) const
+{
+	if (m_nodes.empty())	return false;
+
+	int stack[STATIC_GEOMETRY_STACK];
+	int top = 0;
+
+	//Contacts are resolved nearest first.  Otherwise the end of a wall
+	//	segment adjacent to the one being rested upon pushes spheres sideways.
+	int		hits[STATIC_GEOMETRY_CONTACTS];
+	float	hitDist[STATIC_GEOMETRY_CONTACTS];
+	int		hitCount = 0;
+	bool	touched = false;
+
+	Coord2D p = io_sphere->position();
+	Coord2D r(io_sphere->radius, io_sphere->radius);
+	Coord2D smin = minOf(p, io_sphere->previousPosition()) - r;
+	Coord2D smax = maxOf(p, io_sphere->previousPosition()) + r;
+
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const Node &node = m_nodes[stack[--top]];
+
+		if (smax.x < node.min.x || smin.x > node.max.x
+			|| smax.y < node.min.y || smin.y > node.max.y)
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[top++] = node.first;
+			stack[top++] = node.first+1;
+			continue;
+		}
+
+		for (int i=node.first; i<node.first + node.count; i++)
+		{
+			int ref = m_refs[i];
+
+			if (hitCount == STATIC_GEOMETRY_CONTACTS)
+			{
+				//Too crowded to sort; resolve right away
+				if (ref >= 0)
+					touched |= collideSegment(m_segments[ref], io_sphere);
+				else
+					touched |= collidePolygon(~ref, io_sphere);
+				continue;
+			}
+
+			//Insertion sort (there are usually only a handful)
+			float d2 = separationSquared(ref, p);
+			int j = hitCount++;
+
+			while (j > 0 && hitDist[j-1] > d2)
+			{
+				hits[j] = hits[j-1];
+				hitDist[j] = hitDist[j-1];
+				j--;
+			}
+
+			hits[j] = ref;
+			hitDist[j] = d2;
+		}
+	}
+
+	for (int i=0; i<hitCount; i++)
+	{
+		if (hits[i] >= 0)
+			touched |= collideSegment(m_segments[hits[i]], io_sphere);
+		else
+			touched |= collidePolygon(~hits[i], io_sphere);
+	}
+
+	return touched;
+}
+
+
+int StaticGeometry2D::collide(Sphere2D *io_spheres, int in_count) const
+{
+	int touched = 0;
+
+	for (int i=0; i<in_count; i++)
+		if (collide(io_spheres + i))
+			touched++;
+
+	return touched;
+}
+
+
+int StaticGeometry2D::query(const Coord2D in_min, const Coord2D in_max,
+							std::vector<int> &out_refs) const
+{
+	if (m_nodes.empty())	return 0;
+
+	int stack[STATIC_GEOMETRY_STACK];
+	int top = 0;
+	int found = 0;
+
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const Node &node = m_nodes[stack[--top]];
+
+		if (in_max.x < node.min.x || in_min.x > node.max.x
+			|| in_max.y < node.min.y || in_min.y > node.max.y)
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[top++] = node.first;
+			stack[top++] = node.first+1;
+			continue;
+		}
+
+		for (int i=node.first; i<node.first + node.count; i++)
+		{
+			out_refs.push_back(m_refs[i]);
+			found++;
+		}
+	}
+
+	return found;
+}
+
+
+//! Ray (unit direction) against segment a-b; updates io_best and out_normal
+static bool rayHitsSegment(const Coord2D &in_origin, const Coord2D &in_dir,
+						   const Coord2D &a, const Coord2D &b,
+						   float *io_best, Coord2D *out_normal)
+{
+	Coord2D e = b - a;
+	float denom = in_dir.x*e.y - in_dir.y*e.x;
+
+	//Parallel; grazing along a wall is not a hit
+	if (denom == 0)	return false;
+
+	Coord2D ap = a - in_origin;
+	float t = (ap.x*e.y - ap.y*e.x) / denom;
+	float u = (ap.x*in_dir.y - ap.y*in_dir.x) / denom;
+
+	if (t < 0 || t > *io_best || u < 0 || u > 1)
+		return false;
+
+	Coord2D n(-e.y, e.x);
+	if (dot(n, in_dir) > 0)
+		n = -n;
+
+	*io_best = t;
+	*out_normal = n.normal();
+	return true;
+}
+
+
+bool StaticGeometry2D::rayCast(const Coord2D in_origin, const Coord2D in_direction,
+							   float in_maxDistance, float *out_distance,
+							   Coord2D *out_normal) const
+{
+	if (m_nodes.empty())	return false;
+
+	float len = in_direction.magnitude();
+	if (len == 0)	return false;
+
+	Coord2D dir = in_direction / len;
+	float invX = dir.x != 0 ? 1.0f / dir.x : 1e30f;
+	float invY = dir.y != 0 ? 1.0f / dir.y : 1e30f;
+
+	int stack[STATIC_GEOMETRY_STACK];
+	int top = 0;
+
+	float best = in_maxDistance;
+	bool found = false;
+
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const Node &node = m_nodes[stack[--top]];
+
+		//Slab test against the part of the ray that can still improve
+		float tx0 = (node.min.x - in_origin.x) * invX;
+		float tx1 = (node.max.x - in_origin.x) * invX;
+		float ty0 = (node.min.y - in_origin.y) * invY;
+		float ty1 = (node.max.y - in_origin.y) * invY;
+
+		if (tx0 > tx1)	std::swap(tx0, tx1);
+		if (ty0 > ty1)	std::swap(ty0, ty1);
+
+		float tEnter = tx0 > ty0 ? tx0 : ty0;
+		float tExit = tx1 < ty1 ? tx1 : ty1;
+
+		if (tEnter > tExit || tExit < 0 || tEnter > best)
+			continue;
+
+		if (node.count == 0)
+		{
+			stack[top++] = node.first;
+			stack[top++] = node.first+1;
+			continue;
+		}
+
+		for (int i=node.first; i<node.first + node.count; i++)
+		{
+			int ref = m_refs[i];
+
+			if (ref >= 0)
+			{
+				const Segment2D &s = m_segments[ref];
+				found |= rayHitsSegment(in_origin, dir, s.a, s.b, &best, out_normal);
+				continue;
+			}
+
+			int poly = ~ref;
+			const Coord2D *pts = &m_polyPoints[m_polyStart[poly]];
+			int count = m_polyStart[poly+1] - m_polyStart[poly];
+
+			for (int j=0; j<count; j++)
+			{
+				const Coord2D &a = pts[j];
+				const Coord2D &b = pts[(j+1)%count];
+
+				//Counter-clockwise, so the outside is to the right; skip back faces
+				if ((b.y - a.y)*dir.x - (b.x - a.x)*dir.y >= 0)
+					continue;
+
+				found |= rayHitsSegment(in_origin, dir, a, b, &best, out_normal);
+			}
+		}
+	}
+
+	if (found)
+		*out_distance = best;
+
+	return found;
+}
@@ -0,0 +1,188 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STATICGEOMETRY2D_H
+#define STATICGEOMETRY2D_H
+
+#include <vector>
+#include "Coord2D.h"
+#include "Sphere2D.h"
+
+/*!	\file	StaticGeometry2D.h
+	\brief	Level geometry (walls, terrain) that spheres collide against.
+
+	Static geometry never moves, so it is built once (typically when a level
+	is loaded) into a bounding-volume hierarchy.  Each step, every sphere
+	queries the hierarchy and is pushed out of whatever it overlaps.
+
+	\code
+StaticGeometry2D level;
+level.addSegment(Coord2D(0,0), Coord2D(320,0));
+level.addPolygon(rockPoints, 5);
+level.build();
+
+//Each step, before integrating...
+level.collide(&sphere);
+	\endcode
+*/
+
+
+//! A line segment from a to b
+class Segment2D
+{
+public:
+	//! Start of the segment
+	Coord2D a;
+
+	//! End of the segment
+	Coord2D b;
+
+	//! Initialize a segment
+	Segment2D(Coord2D in_a = Coord2D(), Coord2D in_b = Coord2D())
+	: a(in_a)
+	, b(in_b)
+	{}
+
+	//! Closest point on the segment to in_p
+	inline Coord2D closestPoint(const Coord2D in_p) const
+	{
+		Coord2D ab = b - a;
+		float len2 = dot(ab, ab);
+
+		if (len2 <= 0)	return a;
+
+		float t = dot(in_p - a, ab) / len2;
+
+		if (t < 0)	t = 0;
+		if (t > 1)	t = 1;
+
+		return a + ab * t;
+	}
+};
+
+
+//! Collection of static colliders organized in a bounding-volume hierarchy
+/*!	Add segments and convex polygons, then call build().  Adding geometry
+	after build() requires another call to build() before it is seen by
+	collide().	*/
+class StaticGeometry2D
+{
+private:
+	//! Node within the hierarchy
+	/*!	Leaves have count > 0 and reference m_refs[first ... first+count).
+		Inner nodes have count == 0 and children first and first+1.	*/
+	struct Node
+	{
+		Coord2D	min;
+		Coord2D max;
+		int		first;
+		int		count;
+	};
+
+	//! Walls added through addSegment
+	std::vector<Segment2D>	m_segments;
+
+	//! Vertices of all polygons (counter-clockwise)
+	std::vector<Coord2D>	m_polyPoints;
+
+	//! Start of each polygon within m_polyPoints (one extra at the end)
+	std::vector<int>		m_polyStart;
+
+	//! Primitive references (>= 0 segment, < 0 is polygon ~index)
+	std::vector<int>		m_refs;
+
+	//! The hierarchy (m_nodes[0] is the root)
+	std::vector<Node>		m_nodes;
+
+	//! Bounds of a primitive reference
+	void bounds(int in_ref, Coord2D &out_min, Coord2D &out_max) const;
+
+	//! Primitive bounds, only needed while building
+	struct BuildItem;
+
+	//! Recursively subdivide io_items[in_first ... in_first+in_count) into in_node
+	void buildNode(std::vector<BuildItem> &io_items, int in_node,
+				   int in_first, int in_count);
+
+	//! Squared distance from a point to a primitive (0 when inside)
+	float separationSquared(int in_ref, const Coord2D in_p) const;
+
+	//! Push a sphere out of a segment
+	bool collideSegment(const Segment2D &in_s, Sphere2D *io_sphere) const;
+
+	//! Push a sphere out of polygon in_poly
+	bool collidePolygon(int in_poly, Sphere2D *io_sphere) const;
+
+public:
+	//! Initialize empty geometry
+	StaticGeometry2D()
+	{
+		m_polyStart.push_back(0);
+	}
+
+	//! Add a wall
+	void addSegment(const Coord2D in_a, const Coord2D in_b);
+
+	//! Add a convex polygon
+	/*!	\param in_points[in]	The vertices, in either winding order
+		\param in_count[in]		Number of vertices (at least 3)	*/
+	void addPolygon(const Coord2D *in_points, int in_count);
+
+	//! Remove all the geometry
+	void clear();
+
+	//! Build the hierarchy (call once all geometry has been added)
+	void build();
+
+	//! Number of segments
+	int segmentCount() const	{	return (int)m_segments.size();		}
+
+	//! Number of polygons
+	int polygonCount() const	{	return (int)m_polyStart.size() - 1;	}
+
+	//! Push the sphere out of any geometry it overlaps
+	/*!	Like Sphere2D::addRepulsiveForce, the position is corrected directly
+		and the previous position is left alone.
+		\return	true if the sphere touched anything	*/
+	bool collide(Sphere2D *io_sphere) const;
+
+	//! Collide an array of spheres
+	/*!	\return	Number of spheres that touched something	*/
+	int collide(Sphere2D *io_spheres, int in_count) const;
+
+	//! Find all primitives whose bounds overlap the box [in_min, in_max]
+	/*!	Primitive references are reported as in the internal list: a value
+		>= 0 is a segment index, a negative value is polygon ~value.
+		\return	Number of references appended to out_refs	*/
+	int query(const Coord2D in_min, const Coord2D in_max,
+			  std::vector<int> &out_refs) const;
+
+	//! Closest geometry along a ray
+	/*!	Polygons are only hit from outside.  Safe to call from many threads.
+		\param in_origin[in]		Start of the ray
+		\param in_direction[in]		Direction (need not be normalized)
+		\param in_maxDistance[in]	How far to look
+		\param out_distance[out]	Distance to the hit
+		\param out_normal[out]		Unit normal of the surface, facing the ray
+		\return	true if anything was hit	*/
+	bool rayCast(const Coord2D in_origin, const Coord2D in_direction, float in_maxDistance,
+				 float *out_distance, Coord2D *out_normal) const;
+
+	//! Segment from its index
+	const Segment2D &segment(int in_index) const	{	return m_segments[in_index];	}
+};
+
+#endif
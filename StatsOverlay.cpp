@@ -0,0 +1,122 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#include "StatsOverlay.h"
+#include "Immediate.h"
+
+namespace GPU
+{
+	//! Digits, 3x5: a row per 3 bits, top row in the high bits
+	static const unsigned short g_digits[10] =
+	{
+		075557, 026222, 071747, 071717, 055711,
+		074717, 074757, 071111, 075757, 075717
+	};
+
+
+	//! Fill a rectangle (while batching, this only adds to the batch)
+	static void quad(gli &io_gl, float in_x, float in_y, float in_w, float in_h,
+					 const gliColour &in_colour)
+	{
+		Draw d(io_gl, GL_TRIANGLE_STRIP);
+		d.colour(in_colour);
+		d.vertex(in_x, in_y);
+		d.vertex(in_x+in_w, in_y);
+		d.vertex(in_x, in_y+in_h);
+		d.vertex(in_x+in_w, in_y+in_h);
+	}
+
+
+	StatsOverlay::StatsOverlay(const Coord2D &in_position, float in_width, float in_rowHeight)
+	:	m_position(in_position),
+		m_width(in_width),
+		m_rowHeight(in_rowHeight)
+	{
+	}
+
+
+	void StatsOverlay::number(int in_value, float in_right, float in_top) const
+	{
+		//A digit is 5 pixels of the row, and as many across as tall allows
+		const float pixel = m_rowHeight / 7;
+		const float advance = pixel * 4;
+		const gliColour white(1.0f, 1.0f, 1.0f, 1.0f);
+		gli &g = gliCurrent();
+
+		if (in_value < 0)
+			in_value = 0;
+
+		float x = in_right - pixel * 3;
+		do
+		{
+			const unsigned short bits = g_digits[in_value % 10];
+
+			for (int row=0; row<5; row++)
+				for (int col=0; col<3; col++)
+					if (bits & (1 << ((4-row)*3 + (2-col))))
+						quad(g, x + col*pixel, in_top + pixel + row*pixel, pixel, pixel, white);
+
+			x -= advance;
+			in_value /= 10;
+		}
+		while (in_value);
+	}
+
+
+	void StatsOverlay::draw() const
+	{
+#ifndef GPU_NO_STATS
+		using namespace Stats;
+
+		gliDisableTexture glETexture;
+		gliDisableTexCoordArray glETextureCoord;
+		gliEnableColorArray glEColour;
+		gliEnableBlendFunc glEBlend;
+		gliBlendFunc glBlend(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		gli &g = gliCurrent();
+		const bool wasBatching = g.isBatching();
+		g.setBatching(true);
+
+		//Room for the counts, to the right of the bars
+		const float numbers = m_rowHeight / 7 * 4 * 8;
+		const float x = m_position.x, y = m_position.y;
+
+		quad(g, x - 2, y - 2, m_width + numbers + 4, m_rowHeight * COUNTER_COUNT + 4,
+			 gliColour(0.0f, 0.0f, 0.0f, 0.5f));
+
+		for (int i=0; i<COUNTER_COUNT; i++)
+		{
+			const Counter c = (Counter)i;
+			const float top = y + i * m_rowHeight;
+			const int most = maximum(c);
+			const float scale = most > 0 ? m_width / most : 0;
+
+			//Bar, in the colour of its counter
+			quad(g, x, top + 1, last(c) * scale, m_rowHeight - 2,
+				 gliColour(i & 1 ? 1.0f : 0.3f, i & 2 ? 1.0f : 0.3f, i & 4 ? 1.0f : 0.3f, 0.8f));
+
+			//Average tick
+			quad(g, x + average(c) * scale, top, 1, m_rowHeight, gliColour(1.0f, 1.0f, 1.0f, 1.0f));
+
+			number(last(c), x + m_width + numbers, top);
+		}
+
+		//Draws the overlay, unless the caller batches
+		g.setBatching(wasBatching);
+#endif
+	}
+};
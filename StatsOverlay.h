@@ -0,0 +1,59 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#ifndef BubblePod_StatsOverlay_h
+#define BubblePod_StatsOverlay_h
+
+#include "Coord2D.h"
+#include "GPUStats.h"
+
+/*!	\file	StatsOverlay.h
+	\brief	GPU::Stats counters, drawn over the frame.
+
+	One row per counter: a bar for the last frame's count, scaled to the
+	largest count of the last frames, a tick where their average is, and
+	the count itself in a tiny built-in font.  Everything is untextured
+	quads, drawn through gli in one batch.
+
+	Draw it last, after GPU::Stats::endFrame() or before: it shows the last
+	finished frame either way.  Its own draw calls are counted in the frame
+	under way, like any other.	*/
+
+namespace GPU
+{
+	class StatsOverlay
+	{
+		Coord2D		m_position;		//!< Top left corner
+		float		m_width;		//!< Width of the bars
+		float		m_rowHeight;	//!< Height of a row (the digits fit it)
+
+		//! Draw a number, its last digit ending at in_right
+		void number(int in_value, float in_right, float in_top) const;
+
+	public:
+		//! An overlay at in_position, in the units of gli::vertex()
+		StatsOverlay(const Coord2D &in_position = Coord2D(4, 4),
+					 float in_width = 120, float in_rowHeight = 8);
+
+		//! Move the overlay
+		inline void setPosition(const Coord2D &in_position)	{	m_position = in_position;	}
+
+		//! Draw the counters (nothing under GPU_NO_STATS)
+		void draw() const;
+	};
+};
+
+#endif
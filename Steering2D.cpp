@@ -0,0 +1,341 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "Steering2D.h"
+#include "StaticGeometry2D.h"
+#include "SIMD.h"
+
+#include <math.h>
+
+
+//! xorshift; cheap, and each agent keeps its own state so threads never share
+static inline float nextRandom(unsigned int &io_state)
+{
+	unsigned int x = io_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	io_state = x;
+
+	//[-1, 1]
+	return (float)(x & 0xffffff) / (float)0x7fffff - 1.0f;
+}
+
+
+//! Shorten a vector to at most in_max
+static inline Coord2D truncate(const Coord2D in_v, float in_max)
+{
+	float len2 = dot(in_v, in_v);
+
+	if (len2 > in_max * in_max)
+		return in_v * (in_max / sqrtf(len2));
+
+	return in_v;
+}
+
+
+Steering2D::Steering2D(Sphere2DWorld *io_world)
+: m_world(io_world)
+, m_static(NULL)
+, m_pool(NULL)
+{}
+
+
+int Steering2D::addAgent(int in_handle, int in_behaviours)
+{
+	int agent = (int)m_handles.size();
+
+	m_handles.push_back(in_handle);
+	m_behaviours.push_back(in_behaviours);
+	m_targets.push_back(m_world->body(in_handle).position());
+	m_threats.push_back(Coord2D());
+	m_wanderAngle.push_back(0);
+	m_random.push_back(2654435761u * (unsigned int)(agent + 1));
+	m_forces.push_back(Coord2D());
+
+	return agent;
+}
+
+
+void Steering2D::setBehaviours(int in_agent, int in_behaviours)
+{
+	if (in_agent == AllAgents)
+		m_behaviours.assign(m_behaviours.size(), in_behaviours);
+	else
+		m_behaviours[in_agent] = in_behaviours;
+}
+
+
+void Steering2D::setTarget(int in_agent, const Coord2D in_target)
+{
+	if (in_agent == AllAgents)
+		m_targets.assign(m_targets.size(), in_target);
+	else
+		m_targets[in_agent] = in_target;
+}
+
+
+void Steering2D::setThreat(int in_agent, const Coord2D in_threat)
+{
+	if (in_agent == AllAgents)
+		m_threats.assign(m_threats.size(), in_threat);
+	else
+		m_threats[in_agent] = in_threat;
+}
+
+
+void Steering2D::gather()
+{
+	int n = (int)m_handles.size();
+
+	m_positions.resize(n);
+	for (int i=0; i<n; i++)
+		m_positions[i] = m_world->body(m_handles[i]).position();
+
+	float reach = m_params.neighbourRadius > m_params.separationRadius
+					? m_params.neighbourRadius : m_params.separationRadius;
+	m_grid.build(n ? &m_positions[0] : NULL, n, reach);
+
+	m_x.resize(n);	m_y.resize(n);
+	m_vx.resize(n);	m_vy.resize(n);
+
+	for (int s=0; s<n; s++)
+	{
+		int a = m_grid.item(s);
+		Coord2D v = m_world->body(m_handles[a]).velocity();
+
+		m_x[s] = m_positions[a].x;
+		m_y[s] = m_positions[a].y;
+		m_vx[s] = v.x;
+		m_vy[s] = v.y;
+	}
+}
+
+
+Coord2D Steering2D::steerTowards(const Coord2D in_desired, const Coord2D in_velocity) const
+{
+	//Scaled so that turning around at full speed takes twice the maximum force
+	return (in_desired - in_velocity) * (m_params.maxForce / m_params.maxSpeed);
+}
+
+
+void Steering2D::run(int in_begin, int in_end)
+{
+	const Steering2DParams &P = m_params;
+
+	const float nr2 = P.neighbourRadius * P.neighbourRadius;
+	const float sr2 = P.separationRadius * P.separationRadius;
+
+	const vfloat4 vnr2 = v4splat(nr2);
+	const vfloat4 vsr2 = v4splat(sr2);
+	const vfloat4 zero = v4splat(0);
+	const vfloat4 one = v4splat(1);
+
+	for (int s=in_begin; s<in_end; s++)
+	{
+		const int agent = m_grid.item(s);
+		const int mask = m_behaviours[agent];
+
+		const Coord2D p(m_x[s], m_y[s]);
+		const Coord2D v(m_vx[s], m_vy[s]);
+
+		Coord2D force;
+
+		if (mask & Flock)
+		{
+			vfloat4 vcount = zero, vcx = zero, vcy = zero;
+			vfloat4 vax = zero, vay = zero, vsx = zero, vsy = zero;
+			float count = 0, cx = 0, cy = 0, ax = 0, ay = 0, sx = 0, sy = 0;
+
+			const vfloat4 px = v4splat(p.x), py = v4splat(p.y);
+
+			int gx = m_grid.cellX(p.x);
+			int gy = m_grid.cellY(p.y);
+
+			for (int ny=gy-1; ny<=gy+1; ny++)
+			{
+				if (ny < 0 || ny >= m_grid.height())	continue;
+
+				for (int nx=gx-1; nx<=gx+1; nx++)
+				{
+					if (nx < 0 || nx >= m_grid.width())	continue;
+
+					int c = m_grid.cell(nx, ny);
+					int j = m_grid.begin(c);
+					int e = m_grid.end(c);
+
+					for (; j + 4 <= e; j += 4)
+					{
+						vfloat4 dx = v4load(&m_x[j]) - px;
+						vfloat4 dy = v4load(&m_y[j]) - py;
+						vfloat4 d2 = dx*dx + dy*dy;
+
+						//The agent itself (and anything on top of it) has d2 == 0
+						vint4 near = (d2 < vnr2) & (d2 > zero);
+						vint4 close = (d2 < vsr2) & (d2 > zero);
+
+						vcount += v4select(near, one, zero);
+						vcx += v4select(near, dx, zero);
+						vcy += v4select(near, dy, zero);
+						vax += v4select(near, v4load(&m_vx[j]), zero);
+						vay += v4select(near, v4load(&m_vy[j]), zero);
+
+						//Pushed away in inverse proportion to distance
+						vfloat4 inv = one / v4select(close, d2, one);
+						vsx -= v4select(close, dx * inv, zero);
+						vsy -= v4select(close, dy * inv, zero);
+					}
+
+					for (; j<e; j++)
+					{
+						float dx = m_x[j] - p.x;
+						float dy = m_y[j] - p.y;
+						float d2 = dx*dx + dy*dy;
+
+						if (d2 <= 0)	continue;
+
+						if (d2 < nr2)
+						{
+							count++;
+							cx += dx;		cy += dy;
+							ax += m_vx[j];	ay += m_vy[j];
+						}
+
+						if (d2 < sr2)
+						{
+							sx -= dx / d2;
+							sy -= dy / d2;
+						}
+					}
+				}
+			}
+
+			count += v4sum(vcount);
+
+			if ((mask & Separation) && P.separation != 0)
+			{
+				Coord2D away(sx + v4sum(vsx), sy + v4sum(vsy));
+				float len = away.magnitude();
+
+				if (len > 0)
+					force += steerTowards(away * (P.maxSpeed / len), v) * P.separation;
+			}
+
+			if (count > 0)
+			{
+				if ((mask & Alignment) && P.alignment != 0)
+				{
+					Coord2D heading = Coord2D(ax + v4sum(vax), ay + v4sum(vay)) / count;
+					force += steerTowards(truncate(heading, P.maxSpeed), v) * P.alignment;
+				}
+
+				if ((mask & Cohesion) && P.cohesion != 0)
+				{
+					Coord2D toCentre = Coord2D(cx + v4sum(vcx), cy + v4sum(vcy)) / count;
+					float len = toCentre.magnitude();
+
+					if (len > 0)
+						force += steerTowards(toCentre * (P.maxSpeed / len), v) * P.cohesion;
+				}
+			}
+		}
+
+		if ((mask & Seek) && P.seek != 0)
+		{
+			Coord2D d = m_targets[agent] - p;
+			float len = d.magnitude();
+
+			if (len > 0)
+				force += steerTowards(d * (P.maxSpeed / len), v) * P.seek;
+		}
+
+		if ((mask & Flee) && P.flee != 0)
+		{
+			Coord2D d = p - m_threats[agent];
+			float len = d.magnitude();
+
+			if (len > 0 && len < P.panicRadius)
+				force += steerTowards(d * (P.maxSpeed / len), v) * P.flee;
+		}
+
+		if ((mask & Arrive) && P.arrive != 0)
+		{
+			Coord2D d = m_targets[agent] - p;
+			float len = d.magnitude();
+
+			if (len > 0)
+			{
+				float speed = P.maxSpeed * (len < P.arriveRadius ? len / P.arriveRadius : 1);
+				force += steerTowards(d * (speed / len), v) * P.arrive;
+			}
+			else
+				force += steerTowards(Coord2D(), v) * P.arrive;
+		}
+
+		if ((mask & Wander) && P.wander != 0)
+		{
+			float &angle = m_wanderAngle[agent];
+			angle += nextRandom(m_random[agent]) * P.wanderJitter;
+
+			float speed = v.magnitude();
+			Coord2D heading = speed > 0 ? v / speed : Coord2D(1, 0);
+
+			Coord2D point = heading * P.wanderDistance
+							+ Coord2D(cosf(angle), sinf(angle)) * P.wanderRadius;
+			float len = point.magnitude();
+
+			if (len > 0)
+				force += steerTowards(point * (P.maxSpeed / len), v) * P.wander;
+		}
+
+		if ((mask & ObstacleAvoidance) && m_static && P.avoidance != 0)
+		{
+			float speed = v.magnitude();
+			float radius = m_world->body(m_handles[agent]).radius;
+			float look = speed * P.lookAhead + radius;
+
+			float distance;
+			Coord2D normal;
+
+			if (speed > 0 && m_static->rayCast(p, v, look, &distance, &normal))
+			{
+				//Stronger the closer the wall, straight away from it
+				float urgency = (look - distance) / look;
+				force += normal * (P.maxForce * urgency * P.avoidance);
+			}
+		}
+
+		m_forces[agent] = truncate(force, P.maxForce);
+	}
+}
+
+
+void Steering2D::computeForces()
+{
+	gather();
+
+	if (m_pool)
+		m_pool->run(this, m_grid.count(), 256);
+	else
+		run(0, m_grid.count());
+}
+
+
+void Steering2D::applyForces()
+{
+	for (size_t i=0; i<m_handles.size(); i++)
+		m_world->body(m_handles[i]).addForce(m_forces[i]);
+}
@@ -0,0 +1,229 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef STEERING2D_H
+#define STEERING2D_H
+
+#include <vector>
+#include "Sphere2DWorld.h"
+#include "SpatialGrid2D.h"
+#include "ParallelFor.h"
+
+class StaticGeometry2D;
+
+/*!	\file	Steering2D.h
+	\brief	Steering behaviours and flocking for crowds of Sphere2D bodies.
+
+	Each agent is a body of a Sphere2DWorld.  Every update, the agents are
+	sorted into a grid as large as the neighbourhood radius, and each agent
+	blends the behaviours it has enabled (Reynolds, "Steering Behaviors For
+	Autonomous Characters", 1999) into one force, which is handed to
+	Sphere2D::addForce.
+
+	\code
+Steering2D crowd(&world);
+crowd.params().maxSpeed = 40;
+crowd.params().cohesion = 0.5f;
+
+for (int i=0; i<enemies; i++)
+	crowd.addAgent(enemyHandle[i], Steering2D::Flock | Steering2D::Seek);
+
+crowd.setStaticGeometry(&level);
+crowd.setParallelFor(&pool);
+
+//Each frame, before world.step()
+crowd.setTarget(Steering2D::AllAgents, playerPosition);
+crowd.update();
+	\endcode
+
+	Agents of one Steering2D only flock with each other; use several for
+	several flocks.  The grid of the last update is available through grid()
+	for other systems that need to find agents.
+*/
+
+
+//! Tuning shared by all the agents of a Steering2D
+class Steering2DParams
+{
+public:
+	//! Speed the behaviours aim for
+	float	maxSpeed;
+
+	//! Longest steering force
+	float	maxForce;
+
+	//! Agents closer than this are neighbours (alignment, cohesion)
+	float	neighbourRadius;
+
+	//! Agents closer than this are pushed away (separation)
+	float	separationRadius;
+
+	//! Arrive slows down within this distance of the target
+	float	arriveRadius;
+
+	//! Flee ignores threats further than this
+	float	panicRadius;
+
+	//! Wander: distance of the circle ahead of the agent
+	float	wanderDistance;
+
+	//! Wander: radius of that circle
+	float	wanderRadius;
+
+	//! Wander: largest change of angle per update (radians)
+	float	wanderJitter;
+
+	//! Obstacle avoidance: look-ahead, in seconds at the current speed
+	float	lookAhead;
+
+	//! Weight of each behaviour in the blend
+	float	seek, flee, arrive, wander;
+	float	separation, alignment, cohesion, avoidance;
+
+	Steering2DParams()
+	: maxSpeed(50)
+	, maxForce(100)
+	, neighbourRadius(20)
+	, separationRadius(8)
+	, arriveRadius(40)
+	, panicRadius(100)
+	, wanderDistance(20)
+	, wanderRadius(10)
+	, wanderJitter(0.5f)
+	, lookAhead(0.5f)
+	, seek(1), flee(1), arrive(1), wander(1)
+	, separation(1.5f), alignment(1), cohesion(1), avoidance(3)
+	{}
+};
+
+
+//! Steers a set of Sphere2DWorld bodies
+class Steering2D : private IParallelTask
+{
+public:
+	//! Behaviours, combined into a mask per agent
+	enum Behaviour
+	{
+		Seek				= 1,
+		Flee				= 2,
+		Arrive				= 4,
+		Wander				= 8,
+		Separation			= 16,
+		Alignment			= 32,
+		Cohesion			= 64,
+		ObstacleAvoidance	= 128,
+
+		Flock				= Separation | Alignment | Cohesion
+	};
+
+	//! Passed as an agent to apply a setting to every agent
+	enum
+	{
+		AllAgents			= -1
+	};
+
+private:
+	//! The bodies (not owned)
+	Sphere2DWorld			*m_world;
+
+	//! Level to avoid (not owned, may be NULL)
+	const StaticGeometry2D	*m_static;
+
+	//! Workers (not owned, NULL for single-threaded)
+	ParallelFor				*m_pool;
+
+	//! Tuning
+	Steering2DParams		m_params;
+
+	//! Per agent, in the order they were added
+	std::vector<int>		m_handles;
+	std::vector<int>		m_behaviours;
+	std::vector<Coord2D>	m_targets;
+	std::vector<Coord2D>	m_threats;
+	std::vector<float>		m_wanderAngle;
+	std::vector<unsigned int>	m_random;
+	std::vector<Coord2D>	m_forces;
+
+	//! Positions of the agents (for the grid)
+	std::vector<Coord2D>	m_positions;
+
+	//! Agents by neighbourhood
+	SpatialGrid2D			m_grid;
+
+	//! Positions and velocities in grid order (for SIMD)
+	std::vector<float>		m_x, m_y, m_vx, m_vy;
+
+	//! Copy the agents out of the world and sort them into the grid
+	void gather();
+
+	//! IParallelTask: steer sorted agents in_begin ... in_end-1
+	void run(int in_begin, int in_end);
+
+	//! Velocity change that turns in_velocity towards in_desired
+	Coord2D steerTowards(const Coord2D in_desired, const Coord2D in_velocity) const;
+
+	//! Prevent copies
+	Steering2D(const Steering2D &)	{}
+
+public:
+	//! Steer bodies of a world
+	Steering2D(Sphere2DWorld *io_world);
+
+	//! Tuning (may be changed between updates)
+	Steering2DParams &params()					{	return m_params;		}
+
+	//! Level for ObstacleAvoidance (NULL for none)
+	void setStaticGeometry(const StaticGeometry2D *in_static)	{	m_static = in_static;	}
+
+	//! Use worker threads (NULL for none)
+	void setParallelFor(ParallelFor *in_pool)	{	m_pool = in_pool;		}
+
+	//! Steer a body
+	/*!	\param in_handle		Body within the world
+		\param in_behaviours	Mask of Behaviour
+		\return	The agent	*/
+	int addAgent(int in_handle, int in_behaviours);
+
+	//! Number of agents
+	int agentCount() const						{	return (int)m_handles.size();	}
+
+	//! Change which behaviours an agent uses (or AllAgents)
+	void setBehaviours(int in_agent, int in_behaviours);
+
+	//! Where Seek and Arrive head (or AllAgents)
+	void setTarget(int in_agent, const Coord2D in_target);
+
+	//! What Flee runs away from (or AllAgents)
+	void setThreat(int in_agent, const Coord2D in_threat);
+
+	//! Compute the steering forces, without applying them
+	void computeForces();
+
+	//! Add the forces of the last computeForces() to the bodies
+	void applyForces();
+
+	//! computeForces() and applyForces()
+	void update()								{	computeForces();	applyForces();	}
+
+	//! Force of an agent, as of the last computeForces()
+	Coord2D force(int in_agent) const			{	return m_forces[in_agent];		}
+
+	//! Agents sorted by position, as of the last computeForces()
+	/*!	Items of the grid are agents (not world handles).	*/
+	const SpatialGrid2D &grid() const			{	return m_grid;			}
+};
+
+#endif
@@ -0,0 +1,158 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "Text32.h"
+
+#include <stddef.h>
+
+namespace Text32
+{
+	//! Every glyph of the font, by character
+	class GlyphTable
+	{
+	public:
+		Glyph32	ascii[128];		//!< Single byte characters
+		Glyph32	c3[64];			//!< Second byte of 0xc3 sequences (Latin-1 letters)
+
+		GlyphTable()
+		{
+			for (int i=0; i<128; i++)
+				ascii[i] = none();
+			for (int i=0; i<64; i++)
+				c3[i] = none();
+
+			for (int i=0; i<26; i++)
+			{
+				ascii['A' + i] = glyph(0, i);
+				ascii['a' + i] = glyph(1, i);
+			}
+
+			ascii['\''] = glyph(0, 26);
+
+			c3[0x89 - 0x80] = glyph(0, 27);		//É
+			c3[0x80 - 0x80] = glyph(0, 28);		//À
+			c3[0x8A - 0x80] = glyph(0, 29);		//Ê
+			c3[0xa9 - 0x80] = glyph(1, 27);		//é
+			c3[0xa0 - 0x80] = glyph(1, 28);		//à
+			c3[0xaa - 0x80] = glyph(1, 29);		//ê
+		}
+
+	private:
+		static Glyph32 glyph(int in_column, int in_row)
+		{
+			Glyph32 g = {	(short)(in_column * GLYPH_WIDTH),
+							(short)(in_row * GLYPH_HEIGHT)	};
+			return g;
+		}
+
+		static Glyph32 none()
+		{
+			Glyph32 g = {-1, -1};
+			return g;
+		}
+	};
+
+	static const GlyphTable g_table;
+
+
+	const Glyph32 *next(const unsigned char *&io_sz)
+	{
+		const unsigned char c = *(io_sz++);
+		const Glyph32 *g = NULL;
+
+		if (c < 0x80)
+			g = &g_table.ascii[c];
+		else if (c == 0xc3 && (*io_sz & 0xc0) == 0x80)
+			g = &g_table.c3[*(io_sz++) - 0x80];
+
+		return (g && g->u >= 0) ? g : NULL;
+	}
+
+
+	int length(const char *in_sz)
+	{
+		const unsigned char *sz = (const unsigned char*)in_sz;
+		int count = 0;
+
+		while (*sz)
+		{
+			next(sz);
+			count++;
+		}
+
+		return count;
+	}
+
+
+	int quads(float in_sx, float in_sy,
+			  float in_x, float in_y,
+			  float in_w, float in_h,
+			  const char *in_sz,
+			  TextVertex32 *out_vertices, int in_max)
+	{
+		const unsigned char *sz = (const unsigned char*)in_sz;
+		const short sx = (short)in_sx;
+		const short sy = (short)in_sy;
+
+		TextVertex32 *v = out_vertices;
+		TextVertex32 *end = out_vertices + in_max * QUAD_VERTICES;
+
+		while (*sz && v != end)
+		{
+			const Glyph32 *g = next(sz);
+
+			if (g)
+			{
+				const short u = sx + g->u;
+				const short t = sy + g->v;
+
+				v[0].x = in_x;			v[0].y = in_y;
+				v[0].u = u;				v[0].v = t;
+
+				v[1].x = in_x + in_w;	v[1].y = in_y;
+				v[1].u = u + GLYPH_WIDTH;	v[1].v = t;
+
+				v[2].x = in_x;			v[2].y = in_y + in_h;
+				v[2].u = u;				v[2].v = t + GLYPH_HEIGHT;
+
+				v[3].x = in_x + in_w;	v[3].y = in_y + in_h;
+				v[3].u = u + GLYPH_WIDTH;	v[3].v = t + GLYPH_HEIGHT;
+
+				v += QUAD_VERTICES;
+			}
+
+			in_x += in_w;
+		}
+
+		return (v - out_vertices) / QUAD_VERTICES;
+	}
+
+
+	void indices(int in_first, int in_quads, unsigned short *out_indices)
+	{
+		for (int i=0; i<in_quads; i++)
+		{
+			const unsigned short q = in_first + i*QUAD_VERTICES;
+
+			*(out_indices++) = q;
+			*(out_indices++) = q + 1;
+			*(out_indices++) = q + 2;
+			*(out_indices++) = q + 2;
+			*(out_indices++) = q + 1;
+			*(out_indices++) = q + 3;
+		}
+	}
+};
@@ -0,0 +1,90 @@
+/*
+   Copyright 2011 Michael Fortin
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef TEXT32_H
+#define TEXT32_H
+
+/*!	\file	Text32.h
+	\brief	Glyph quads for the 32 pixel font used by drawText32.
+
+	The font is a column of 16x32 cells: capitals on the left, small letters
+	on the right, one letter per row.  Rows past 'Z' hold the apostrophe,
+	É, À and Ê (and their small forms).  Strings are UTF-8.
+
+	Where each glyph lies is looked up in a table built once, rather than
+	worked out for every character.  Nothing here touches the GL: quads are
+	written to plain arrays, to be drawn however the caller likes (Blit.h
+	draws them itself, or hands them to gli).
+*/
+
+//! Where a glyph lies in the font texture, in texels
+struct Glyph32
+{
+	short u, v;			//!< Top left corner
+};
+
+
+//! A corner of a glyph quad
+struct TextVertex32
+{
+	float x, y;			//!< Position
+	short u, v;			//!< Texture coordinate, in texels
+};
+
+
+namespace Text32
+{
+	enum
+	{
+		GLYPH_WIDTH		= 16,	//!< Width of a cell, in texels
+		GLYPH_HEIGHT	= 32,	//!< Height of a cell, in texels
+		QUAD_VERTICES	= 4,	//!< Vertices written per glyph
+		QUAD_INDICES	= 6		//!< Indices written per glyph
+	};
+
+	//! Glyph of the character at io_sz, which is moved past it
+	/*!	\return	NULL for characters that are not in the font (they still
+				take up room on the line)	*/
+	const Glyph32 *next(const unsigned char *&io_sz);
+
+	//! Characters in a string (multi-byte sequences counting as one)
+	int length(const char *in_sz);
+
+	//! Write the quads of a string
+	/*!	Each glyph gives 4 vertices, in triangle strip order: top left, top
+		right, bottom left, bottom right.
+
+		\param in_sx, in_sy		Where the font is in its texture (texels)
+		\param in_x, in_y		Top left of the first character
+		\param in_w, in_h		Size of a character on screen
+		\param in_sz			The string
+		\param out_vertices		Room for in_max quads
+		\param in_max			Quads that fit in out_vertices
+		\return	Quads written (at most in_max)	*/
+	int quads(float in_sx, float in_sy,
+			  float in_x, float in_y,
+			  float in_w, float in_h,
+			  const char *in_sz,
+			  TextVertex32 *out_vertices, int in_max);
+
+	//! Write the indices of quads as triangles (6 indices per quad)
+	/*!	\param in_first		Vertex the first quad starts at
+		\param in_quads		Number of quads
+		\param out_indices	Room for 6*in_quads indices	*/
+	void indices(int in_first, int in_quads, unsigned short *out_indices);
+};
+
+#endif
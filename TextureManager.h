@@ -18,6 +18,8 @@
 #include "FrameBuffer.h"
 #include "DataSource.h"
 #include "Camera.h"
+#include "GPUState.h"
+#include "GPUBackend.h"
 
 #ifndef TEXTURE_MANAGER_H
 #define TEXTURE_MANAGER_H
@@ -113,10 +115,16 @@ public:
 	virtual ~Texture()
 	{
 		if (m_texID != 0)
-			glDeleteTextures(1, &m_texID);
+		{
+			GPU::State::forgetTexture(m_texID);
+			GPU::backend().deleteTextures(1, &m_texID);
+		}
 		
 		if (m_texSecond != 0)
-			glDeleteTextures(1, &m_texSecond);
+		{
+			GPU::State::forgetTexture(m_texSecond);
+			GPU::backend().deleteTextures(1, &m_texSecond);
+		}
 	}
 };
 
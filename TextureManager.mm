@@ -18,11 +18,11 @@
 #import <CoreFoundation/CoreFoundation.h>
 #import "Immediate.h"
 #import "SmartMM.h"
+#import "GPUState.h"
 #include "GPUExtensions.h"
 
 
 //Texture info...
-static GLuint g_boundTexture[4]	= {0,0,0,0};
 
 Texture::Texture(const char *in_textureName)
 : m_texID(0)
@@ -45,14 +45,10 @@ GLuint Texture::use(int in_index)
 {
 	if (m_texID == 0)	lazyLoad();
 	
-	GLuint r = g_boundTexture[in_index];
+	gli &g = gliCurrent();
+	GLuint r = g.boundTexture(in_index);
 	
-	if (g_boundTexture[in_index] != m_texID)
-	{
-		glActiveTexture(GL_TEXTURE0 + in_index);
-		glBindTexture(GL_TEXTURE_2D, m_texID);
-		g_boundTexture[in_index] = m_texID;
-	}
+	g.bindTexture(in_index, m_texID);
 	
 	return r;
 }
@@ -62,14 +58,10 @@ GLuint FrameBuffer::use(int in_index)
 {
 	if (m_texID == 0)	lazyInit();
 	
-	GLuint r = g_boundTexture[in_index];
+	gli &g = gliCurrent();
+	GLuint r = g.boundTexture(in_index);
 	
-	if (g_boundTexture[in_index] != m_texID)
-	{
-		glActiveTexture(GL_TEXTURE0 + in_index);
-		glBindTexture(GL_TEXTURE_2D, m_texID);
-		g_boundTexture[in_index] = m_texID;
-	}
+	g.bindTexture(in_index, m_texID);
 	
 	return r;
 }
@@ -121,7 +113,7 @@ void Texture::lazyLoad()
 	int width = s.x;
 	int height = s.y;
 	
-	glGenTextures(1, &m_texID);
+	GPU::backend().genTextures(1, &m_texID);
 	if (m_texID == 0)	throw "Texture::lazyLoad::Failed creating texture!";
 	
 	//Slightly recursive, but is elegant
@@ -129,14 +121,14 @@ void Texture::lazyLoad()
 		BindTexture bt(this);
 		
 		// More efficient to set parameters first!
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_data()->minFilter());
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_data()->magFilter());
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_data()->wrapU());
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_data()->wrapV());
-		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, m_data()->generateMipmap());
+		GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_data()->minFilter());
+		GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_data()->magFilter());
+		GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_data()->wrapU());
+		GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_data()->wrapV());
+		GPU::backend().texParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, m_data()->generateMipmap());
 		
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, npt2.x, npt2.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, m_data()->data());
+		GPU::backend().texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, npt2.x, npt2.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		GPU::backend().texSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, m_data()->data());
 		m_data()->releaseData();
 		
 	}
@@ -154,17 +146,17 @@ void Texture::checkForMoreData()
 		if (m_texSecond == 0)
 		{
 			m_texSecond = m_texID;
-			glGenTextures(1, &m_texID);
+			GPU::backend().genTextures(1, &m_texID);
 			
 			BindTexture bt(this);
 			
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_data()->minFilter());
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_data()->magFilter());
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_data()->wrapU());
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_data()->wrapV());
-			glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, m_data()->generateMipmap());
+			GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_data()->minFilter());
+			GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_data()->magFilter());
+			GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_data()->wrapU());
+			GPU::backend().texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_data()->wrapV());
+			GPU::backend().texParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, m_data()->generateMipmap());
 			
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_npt2.x, m_npt2.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			GPU::backend().texImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_npt2.x, m_npt2.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 		}
 		else
 		{
@@ -174,7 +166,7 @@ void Texture::checkForMoreData()
 		}
 		
 		BindTexture bt(this);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, s.x, s.y, GL_RGBA, GL_UNSIGNED_BYTE, m_data()->data());
+		GPU::backend().texSubImage2D(GL_TEXTURE_2D, 0, 0, 0, s.x, s.y, GL_RGBA, GL_UNSIGNED_BYTE, m_data()->data());
 		m_data()->releaseData();
 	}
 }
@@ -183,10 +175,5 @@ void Texture::checkForMoreData()
 
 BindTexture::~BindTexture()
 {
-	if (g_boundTexture[m_index] != m_prev)
-	{
-		glActiveTexture(GL_TEXTURE0 + m_index);
-		glBindTexture(GL_TEXTURE_2D, m_prev);
-		g_boundTexture[m_index] = m_prev;
-	}
+	gliCurrent().bindTexture(m_index, m_prev);
 }
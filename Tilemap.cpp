@@ -0,0 +1,264 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#include "Tilemap.h"
+#include "Immediate.h"
+#include "GPUState.h"
+#include "GPUBackend.h"
+#include "GPUStats.h"
+
+#include <algorithm>
+#include <math.h>
+
+using namespace GPU;
+
+
+Tilemap::Tilemap(int in_width, int in_height, int in_layers,
+				 const Coord2D &in_tileSize, const Coord2D &in_atlasTile,
+				 int in_atlasColumns, int in_chunkSize)
+: m_width(in_width)
+, m_height(in_height)
+, m_layers(in_layers)
+, m_tileSize(in_tileSize)
+, m_atlasTile(in_atlasTile)
+, m_atlasColumns(in_atlasColumns)
+, m_chunkSize(in_chunkSize)
+, m_chunksX(in_chunkSize > 0 ? (in_width + in_chunkSize - 1) / in_chunkSize : 0)
+, m_chunksY(in_chunkSize > 0 ? (in_height + in_chunkSize - 1) / in_chunkSize : 0)
+, m_frame(0)
+, m_chunksDrawn(0)
+, m_bakes(0)
+{
+	if (in_width <= 0 || in_height <= 0 || in_layers <= 0 || in_atlasColumns <= 0)
+		throw "Tilemap::Tilemap::Invalid size";
+
+	//Every quad of a chunk must be reachable by the shared indices
+	if (in_chunkSize <= 0 || in_chunkSize * in_chunkSize > GPU_QUAD_INDICES)
+		throw "Tilemap::Tilemap::Invalid chunk size";
+
+	const int cells = in_width * in_height * in_layers;
+	m_tiles = new int[cells];
+	for (int i=0; i<cells; i++)
+		m_tiles[i] = -1;
+
+	m_chunks = new Chunk[m_chunksX * m_chunksY * in_layers];
+	m_offsets = new Coord2D[in_layers];
+}
+
+
+void Tilemap::set(int in_layer, int in_x, int in_y, int in_tile)
+{
+	if (in_layer < 0 || in_layer >= m_layers || in_x < 0 || in_x >= m_width
+		|| in_y < 0 || in_y >= m_height)
+		throw "Tilemap::set::Out of the map";
+
+	int &t = m_tiles[cell(in_layer, in_x, in_y)];
+	if (t == in_tile)
+		return;
+
+	t = in_tile;
+	chunk(in_layer, in_x / m_chunkSize, in_y / m_chunkSize).dirty = true;
+}
+
+
+int Tilemap::get(int in_layer, int in_x, int in_y) const
+{
+	if (in_layer < 0 || in_layer >= m_layers || in_x < 0 || in_x >= m_width
+		|| in_y < 0 || in_y >= m_height)
+		throw "Tilemap::get::Out of the map";
+
+	return m_tiles[cell(in_layer, in_x, in_y)];
+}
+
+
+void Tilemap::setAnimation(int in_tile, int in_frames)
+{
+	if (in_tile < 0 || in_frames <= 0)
+		throw "Tilemap::setAnimation::Invalid animation";
+
+	if (in_tile >= (int)m_animations.size())
+		m_animations.resize(in_tile + 1, 1);
+	m_animations[in_tile] = in_frames;
+
+	for (int i=0; i<m_chunksX * m_chunksY * m_layers; i++)
+		m_chunks[i].dirty = true;
+}
+
+
+void Tilemap::setLayerOffset(int in_layer, const Coord2D &in_offset)
+{
+	if (in_layer < 0 || in_layer >= m_layers)
+		throw "Tilemap::setLayerOffset::No such layer";
+
+	m_offsets[in_layer] = in_offset;
+}
+
+
+bool Tilemap::byFrames(const Quad &in_a, const Quad &in_b)
+{
+	return in_a.frames < in_b.frames;
+}
+
+
+void Tilemap::bake(int in_layer, int in_cx, int in_cy)
+{
+	Chunk &c = chunk(in_layer, in_cx, in_cy);
+	c.dirty = false;
+	c.ranges.clear();
+	m_bakes++;
+
+	//Tiles of the chunk, those of an animation together
+	const int x0 = in_cx * m_chunkSize, y0 = in_cy * m_chunkSize;
+	const int x1 = std::min(x0 + m_chunkSize, m_width);
+	const int y1 = std::min(y0 + m_chunkSize, m_height);
+
+	m_quads.clear();
+	for (int y=y0; y<y1; y++)
+		for (int x=x0; x<x1; x++)
+		{
+			const int t = m_tiles[cell(in_layer, x, y)];
+			if (t < 0)
+				continue;
+
+			Quad q = {frames(t), x, y, t};
+			m_quads.push_back(q);
+		}
+
+	if (m_quads.empty())
+	{
+		c.vertices = NULL;
+		return;
+	}
+
+	std::stable_sort(m_quads.begin(), m_quads.end(), byFrames);
+
+	//Room for them?  (The VBO only grows, so that edits don't reallocate it.)
+	const int vertices = (int)m_quads.size() * 4;
+	if (c.vertices() == NULL || c.vertices->count() < vertices)
+		c.vertices = new VBO_V2_T2(vertices);
+
+	VBO_V2_T2 &v = *c.vertices();
+
+	for (int i=0; i<(int)m_quads.size(); i++)
+	{
+		const Quad &q = m_quads[i];
+
+		if (c.ranges.empty() || c.ranges.back().frames != q.frames)
+		{
+			Range r = {q.frames, i, 0};
+			c.ranges.push_back(r);
+		}
+		c.ranges.back().count++;
+
+		//Corners in the order of a triangle strip, as blit() draws them (and
+		//in submission units, as gli::vertex() stores them)
+		const float x = q.x * m_tileSize.x * POSITION_MULT, y = q.y * m_tileSize.y * POSITION_MULT;
+		const float tw = m_tileSize.x * POSITION_MULT, th = m_tileSize.y * POSITION_MULT;
+		const float u = (q.tile % m_atlasColumns) * m_atlasTile.x;
+		const float w = (q.tile / m_atlasColumns) * m_atlasTile.y;
+
+		for (int k=0; k<4; k++)
+		{
+			Type::Description::V2_T2 &corner = v[i*4 + k];
+			corner.position = Coord2D(x + (k & 1) * tw, y + (k >> 1) * th);
+			corner.texture = Coord2D(u + (k & 1) * m_atlasTile.x, w + (k >> 1) * m_atlasTile.y);
+		}
+	}
+
+	v.sync(vertices);
+}
+
+
+void Tilemap::draw(const Rect2D &in_view)
+{
+	//What gli kept goes below
+	gliCurrent().flush();
+
+	m_chunksDrawn = 0;
+	m_bakes = 0;
+
+	//Chunks overlapping the view
+	const float chunkW = m_tileSize.x * m_chunkSize, chunkH = m_tileSize.y * m_chunkSize;
+	const int cx0 = std::max(0, (int)floorf(in_view.corner.x / chunkW));
+	const int cy0 = std::max(0, (int)floorf(in_view.corner.y / chunkH));
+	const int cx1 = std::min(m_chunksX - 1, (int)floorf((in_view.corner.x + in_view.size.x) / chunkW));
+	const int cy1 = std::min(m_chunksY - 1, (int)floorf((in_view.corner.y + in_view.size.y) / chunkH));
+
+	if (cx0 > cx1 || cy0 > cy1)
+		return;
+
+	State::enable(GL_TEXTURE_2D, true);
+	State::clientState(GL_COLOR_ARRAY, false);
+	State::clientState(GL_TEXTURE_COORD_ARRAY, true);
+
+	BindVBO i(quadIndices());
+	One<BindVBO> v;
+
+	const Type::TypeDescription *d = VBO_V2_T2::elementDescription();
+
+	for (int l=0; l<m_layers; l++)
+		for (int cy=cy0; cy<=cy1; cy++)
+			for (int cx=cx0; cx<=cx1; cx++)
+			{
+				Chunk &c = chunk(l, cx, cy);
+				if (c.dirty)
+					bake(l, cx, cy);
+
+				if (c.vertices() == NULL)
+					continue;
+
+				if (v() == NULL)
+					v = new BindVBO(c.vertices());
+				else
+					v->rebind(c.vertices());
+
+				backend().vertexPointer(2, GL_FLOAT, sizeof(Type::Description::V2_T2),
+										(const char*)NULL + d[0].offset());
+				backend().texCoordPointer(2, GL_FLOAT, sizeof(Type::Description::V2_T2),
+										  (const char*)NULL + d[1].offset());
+
+				for (size_t k=0; k<c.ranges.size(); k++)
+				{
+					const Range &r = c.ranges[k];
+
+					//Animated, or a shifted layer?  Move the texture coordinates.
+					Coord2D offset = m_offsets[l];
+					offset.x += (m_frame % r.frames) * m_atlasTile.x;
+
+					const bool moved = offset.x != 0 || offset.y != 0;
+					if (moved)
+					{
+						backend().matrixMode(GL_TEXTURE);
+						backend().pushMatrix();
+						backend().translatef(offset.x, offset.y, 0);
+					}
+
+					backend().drawElements(GL_TRIANGLES, r.count * 6, GL_UNSIGNED_SHORT,
+										   (const char*)NULL + r.first * 6 * sizeof(GLushort));
+
+					if (moved)
+					{
+						backend().popMatrix();
+						backend().matrixMode(GL_MODELVIEW);
+					}
+
+					Stats::count(Stats::DrawCalls);
+					Stats::count(Stats::Vertices, r.count * 4);
+				}
+
+				m_chunksDrawn++;
+			}
+}
@@ -0,0 +1,184 @@
+/*
+ *	Copyright 2011 Michael Fortin
+ *
+ *	 Licensed under the Apache License, Version 2.0 (the "License");
+ *	 you may not use this file except in compliance with the License.
+ *	 You may obtain a copy of the License at
+ *
+ *		http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *	 Unless required by applicable law or agreed to in writing, software
+ *	 distributed under the License is distributed on an "AS IS" BASIS,
+ *	 WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *	 See the License for the specific language governing permissions and
+ *	 limitations under the License.
+ */
+
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include "Coord2D.h"
+#include "Rect2D.h"
+#include "GPUBuffer.h"
+#include <vector>
+
+/*!	\file	Tilemap.h
+	\brief	Tile layers baked into VBOs a chunk at a time (OpenGL ES 1x).
+
+	Drawing a level with blit<32,32>() works out four vertices per visible
+	tile every frame.  A Tilemap rather splits each layer in square chunks,
+	and bakes the tiles of a chunk once into a GPU::VBO_V2_T2.  A chunk is
+	baked again only when one of its tiles changes, and only the chunks
+	overlapping the view are drawn: a draw call or so per chunk, with the
+	indices of GPU::quadIndices().
+
+	Geometry never changes for the sake of looks.  An animated tile shows
+	the tiles that follow it in its atlas row in turn (see setAnimation), by
+	moving the texture coordinates of the chunk with the texture matrix, and
+	a layer may be shifted in the atlas as a whole (see setLayerOffset).
+
+	Tiles are in the units of gli::vertex(), texture coordinates in those of
+	gli::texCoordi() (see gliTextureSetup), and the atlas is the texture bound
+	to unit 0.  The fixed-function pipeline is used, with the GL's modelview
+	matrix: not gli's built-in shaders.
+
+	\code
+Tilemap level(200, 40, 2, Coord2D(32, 32), Coord2D(32, 32), 16);
+level.set(0, x, y, GRASS);
+level.setAnimation(WATER, 4);
+
+//Each frame...
+atlas.use();
+level.setFrame(frame / 8);
+level.draw(Rect2D(cameraX, cameraY, 480, 320));
+	\endcode
+*/
+
+//! Default width and height of a chunk, in tiles
+#define TILEMAP_CHUNK	16
+
+//! Layers of tiles drawn from cached chunks (see Tilemap.h)
+class Tilemap
+{
+private:
+	//! Tiles of a chunk that show the same frame: drawn together
+	struct Range
+	{
+		int		frames;				//!< Of their animation (1: not animated)
+		int		first, count;		//!< Quads in the chunk's VBO
+	};
+
+	//! A square of a layer
+	struct Chunk
+	{
+		One<GPU::VBO_V2_T2>		vertices;	//!< NULL until there are tiles
+		std::vector<Range>		ranges;
+		bool					dirty;		//!< To bake before drawing
+
+		Chunk() : dirty(true)	{}
+	};
+
+	//! A tile to bake, and the frames of its animation
+	struct Quad
+	{
+		int		frames;
+		int		x, y, tile;
+	};
+
+	const int		m_width, m_height, m_layers;
+	const Coord2D	m_tileSize;
+	const Coord2D	m_atlasTile;
+	const int		m_atlasColumns;
+	const int		m_chunkSize;
+	const int		m_chunksX, m_chunksY;
+
+	//! Tile of every cell, layer after layer (-1: none)
+	Many<int>		m_tiles;
+
+	//! Chunks of every layer, layer after layer
+	Many<Chunk>		m_chunks;
+
+	//! Texture offset of every layer
+	Many<Coord2D>	m_offsets;
+
+	//! Frames of the animation starting at each tile (missing: 1)
+	std::vector<int>	m_animations;
+
+	//! Animation clock
+	int				m_frame;
+
+	//Statistics of the last draw()
+	int				m_chunksDrawn;
+	int				m_bakes;
+
+	//! Sorting buffer of bake()
+	std::vector<Quad>	m_quads;
+
+	//! Cell of a layer
+	inline int cell(int in_layer, int in_x, int in_y) const
+	{	return (in_layer * m_height + in_y) * m_width + in_x;		}
+
+	//! Chunk of a layer
+	inline Chunk &chunk(int in_layer, int in_cx, int in_cy) const
+	{	return m_chunks[(in_layer * m_chunksY + in_cy) * m_chunksX + in_cx];	}
+
+	//! Frames of the animation of a tile
+	inline int frames(int in_tile) const
+	{	return in_tile < (int)m_animations.size() ? m_animations[in_tile] : 1;	}
+
+	//! Order of tiles in a chunk: by animation, then as they were
+	static bool byFrames(const Quad &in_a, const Quad &in_b);
+
+	//! Rebuild the VBO of a chunk from its tiles
+	void bake(int in_layer, int in_cx, int in_cy);
+
+	//! Prevent copies
+	Tilemap(const Tilemap &);
+	Tilemap &operator=(const Tilemap &);
+
+public:
+	//! An empty map
+	/*!	\param in_width, in_height	Size, in tiles
+		\param in_layers			Layers, drawn first to last
+		\param in_tileSize			Size of a tile on screen
+		\param in_atlasTile			Size of a tile in the atlas
+		\param in_atlasColumns		Tiles in a row of the atlas (tile t is at
+									column t % in_atlasColumns, row t / in_atlasColumns)
+		\param in_chunkSize			Width and height of a chunk, in tiles (at most 128)	*/
+	Tilemap(int in_width, int in_height, int in_layers,
+			const Coord2D &in_tileSize, const Coord2D &in_atlasTile,
+			int in_atlasColumns, int in_chunkSize = TILEMAP_CHUNK);
+
+	//! Size, in tiles
+	inline int width() const					{	return m_width;				}
+	inline int height() const					{	return m_height;			}
+	inline int layers() const					{	return m_layers;			}
+
+	//! Change a tile (-1: none), and have its chunk baked again
+	void set(int in_layer, int in_x, int in_y, int in_tile);
+
+	//! A tile (-1: none)
+	int get(int in_layer, int in_x, int in_y) const;
+
+	//! Animate a tile through the in_frames tiles starting with it in its row
+	/*!	Every chunk is baked again (tiles of an animation are drawn apart).	*/
+	void setAnimation(int in_tile, int in_frames);
+
+	//! Advance the animations (each shows frame in_frame % its frames)
+	inline void setFrame(int in_frame)			{	m_frame = in_frame;			}
+
+	//! Shift the texture coordinates of a layer (in those of gli::texCoordi())
+	void setLayerOffset(int in_layer, const Coord2D &in_offset);
+
+	//! Draw the chunks that overlap in_view, layer after layer
+	/*!	What gli batched is drawn first.  Chunks that changed are baked.	*/
+	void draw(const Rect2D &in_view);
+
+	//! Chunks drawn by the last draw()
+	inline int chunksDrawn() const				{	return m_chunksDrawn;		}
+
+	//! Chunks baked by the last draw()
+	inline int bakes() const					{	return m_bakes;				}
+};
+
+#endif
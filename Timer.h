@@ -15,6 +15,7 @@
  */
 
 #include <sys/time.h>
+#include <stddef.h>
 
 #ifndef TIMER_H
 #define TIMER_H